@@ -20,16 +20,25 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/time.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "wolfengine.h"
 
 #include <openssl/engine.h>
 #include <openssl/evp.h>
 #include <openssl/ec.h>
+#include <openssl/rsa.h>
 #include <openssl/ssl.h>
 #include <openssl/aes.h>
+#ifdef WE_HAVE_PROVIDER
+#include <openssl/provider.h>
+#endif
+#ifdef WE_HAVE_KEYD
+#include <pthread.h>
+#endif
 
 #include "openssl_bc.h"
 
@@ -183,6 +192,51 @@ static int sha3_512_bench(ENGINE *e)
 }
 #endif
 
+#ifdef WE_HAVE_PROVIDER
+/* Name of the wolfEngine provider library. */
+static const char *prov_name = "libwolfprov";
+/* Property query that fetches algorithms from the wolfEngine provider. */
+#define PROV_PROPS      "provider=libwolfprov"
+
+/* Load the wolfEngine provider keeping OpenSSL's default as a fallback. */
+static OSSL_PROVIDER *prov_load(void)
+{
+    OSSL_PROVIDER *prov;
+
+    prov = OSSL_PROVIDER_try_load(NULL, prov_name, 1);
+    if (prov == NULL) {
+        printf("ERR: Failed to load provider %s\n", prov_name);
+    }
+
+    return prov;
+}
+
+#ifdef WE_HAVE_SHA256
+static int prov_sha256_bench(ENGINE *e)
+{
+    int err = 0;
+    OSSL_PROVIDER *prov;
+    EVP_MD *md = NULL;
+    size_t i;
+
+    (void)e;
+
+    err = (prov = prov_load()) == NULL;
+    if (err == 0) {
+        err = (md = EVP_MD_fetch(NULL, "SHA256", PROV_PROPS)) == NULL;
+    }
+    for (i = 0; err == 0 && i < DGST_LEN_SIZE; i++) {
+        err = digest_bench(NULL, "SHA256-PROV", md, dgst_len[i]);
+    }
+
+    EVP_MD_free(md);
+    OSSL_PROVIDER_unload(prov);
+
+    return err;
+}
+#endif
+#endif /* WE_HAVE_PROVIDER */
+
 #endif /* WE_HAVE_DIGEST */
 
 #ifdef WE_HAVE_AESGCM
@@ -335,40 +389,147 @@ static int aes256_gcm_bench(ENGINE *e)
 
     return err;
 }
+
+#ifdef WE_HAVE_PROVIDER
+static int prov_aes256_gcm_bench(ENGINE *e)
+{
+    int err = 0;
+    OSSL_PROVIDER *prov = NULL;
+    EVP_CIPHER *cipher = NULL;
+    EVP_CIPHER_CTX *ctx = NULL;
+    unsigned char key[32] = {0,};
+    size_t i;
+
+    (void)e;
+
+    err = RAND_bytes(key, sizeof(key)) == 0;
+
+    if (err == 0) {
+        err = (prov = prov_load()) == NULL;
+    }
+    if (err == 0) {
+        err = (cipher = EVP_CIPHER_fetch(NULL, "AES-256-GCM",
+                                         PROV_PROPS)) == NULL;
+    }
+    if (err == 0) {
+        err = (ctx = EVP_CIPHER_CTX_new()) == NULL;
+    }
+    if (err == 0) {
+        err = EVP_CipherInit_ex(ctx, cipher, NULL, key, NULL, 1) != 1;
+    }
+    if (err == 0) {
+        for (i = 0; err == 0 && i < DGST_LEN_SIZE; i++) {
+            err = aesgcm_enc_bench("AES256-GCM-PROV", ctx, aesgcm_len[i]);
+        }
+    }
+    if (err == 0) {
+        err = EVP_CipherInit_ex(ctx, cipher, NULL, key, NULL, 0) != 1;
+    }
+    if (err == 0) {
+        for (i = 0; err == 0 && i < DGST_LEN_SIZE; i++) {
+            err = aesgcm_dec_bench("AES256-GCM-PROV", ctx, aesgcm_len[i]);
+        }
+    }
+
+    EVP_CIPHER_CTX_free(ctx);
+    EVP_CIPHER_free(cipher);
+    if (prov != NULL) {
+        OSSL_PROVIDER_unload(prov);
+    }
+
+    return err;
+}
+#endif /* WE_HAVE_PROVIDER */
 #endif
 
-#ifdef WE_HAVE_EVP_PKEY
+#if defined(WE_HAVE_RSA) && defined(WE_HAVE_EVP_PKEY)
+/* Largest RSA key size benchmarked, in bytes. */
+#define RSA_BENCH_MAX_SZ    512
 
-#ifdef WE_HAVE_ECKEYGEN
-static int eckg_bench(ENGINE *e, int nid, const char *curve)
+static const char *rsa_pad_name(int padding)
+{
+    const char *name;
+
+    switch (padding) {
+        case RSA_PKCS1_PADDING:
+            name = "PKCS1";
+            break;
+        case RSA_PKCS1_OAEP_PADDING:
+            name = "OAEP";
+            break;
+        case RSA_NO_PADDING:
+            name = "NONE";
+            break;
+        case RSA_PKCS1_PSS_PADDING:
+            name = "PSS";
+            break;
+        default:
+            name = "";
+            break;
+    }
+
+    return name;
+}
+
+static int rsa_gen_key(ENGINE *e, int bits, EVP_PKEY **pkey)
 {
     int err;
     EVP_PKEY_CTX *ctx;
-    EVP_PKEY *key;
+
+    err = (ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, e)) == NULL;
+    if (err == 0) {
+        err = EVP_PKEY_keygen_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, bits) != 1;
+    }
+    if (err == 0) {
+        *pkey = NULL;
+        err = EVP_PKEY_keygen(ctx, pkey) != 1;
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+
+    return err;
+}
+
+static int rsa_keygen_bench(ENGINE *e, int bits, const char *name,
+                            EVP_PKEY **pkey)
+{
+    int err;
+    EVP_PKEY_CTX *ctx;
+    EVP_PKEY *key = NULL;
     unsigned int cnt = 0;
     double secs;
     BENCH_DECLS;
 
-    err = (ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, e)) == NULL;
+    err = (ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, e)) == NULL;
     if (err == 0) {
         err = EVP_PKEY_keygen_init(ctx) != 1;
     }
     if (err == 0) {
-        err = EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, nid) != 1;
+        err = EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, bits) != 1;
     }
     if (err == 0) {
         BENCH_START();
         do {
+            EVP_PKEY_free(key);
             key = NULL;
             err |= EVP_PKEY_keygen(ctx, &key) != 1;
-            EVP_PKEY_free(key);
             cnt++;
         }
         while (BENCH_COND(1));
 
         secs = BENCH_SECS();
-        printf("%-5s EVP keygen %10.2f ops/sec %12.3f us/op\n", curve,
-               cnt / secs, secs / cnt * 1000000);
+        printf("%-8s %-18s %10.2f ops/sec %12.3f us/op\n", name,
+               "EVP keygen", cnt / secs, secs / cnt * 1000000);
+    }
+    if (err == 0) {
+        /* Keep last key generated for the other operations. */
+        *pkey = key;
+    }
+    else {
+        EVP_PKEY_free(key);
     }
 
     EVP_PKEY_CTX_free(ctx);
@@ -376,209 +537,1262 @@ static int eckg_bench(ENGINE *e, int nid, const char *curve)
     return err;
 }
 
-#ifdef WE_HAVE_EC_P256
-static int eckg_p256_bench(ENGINE *e)
+static int rsa_pkey_ctx_setup(EVP_PKEY_CTX *ctx, int padding, const EVP_MD *md)
 {
-    return eckg_bench(e, NID_X9_62_prime256v1, "P-256");
-}
+    int err;
+
+    err = EVP_PKEY_CTX_set_rsa_padding(ctx, padding) != 1;
+    if (err == 0 && md != NULL && padding == RSA_PKCS1_OAEP_PADDING) {
+        err = EVP_PKEY_CTX_set_rsa_oaep_md(ctx, md) != 1;
+    }
+    else if (err == 0 && md != NULL) {
+        err = EVP_PKEY_CTX_set_signature_md(ctx, md) != 1;
+    }
+#ifdef WE_HAVE_RSA_PSS
+    if (err == 0 && padding == RSA_PKCS1_PSS_PADDING) {
+        err = EVP_PKEY_CTX_set_rsa_pss_saltlen(ctx, RSA_PSS_SALTLEN_DIGEST)
+              != 1;
+    }
 #endif
 
-#ifdef WE_HAVE_EC_P384
-static int eckg_p384_bench(ENGINE *e)
-{
-    return eckg_bench(e, NID_secp384r1, "P-384");
+    return err;
 }
-#endif
-#endif
 
-#ifdef WE_HAVE_ECDH
-static int ecdh_bench(ENGINE *e, int nid, const char *curve)
+static int rsa_sign_bench(ENGINE *e, EVP_PKEY *pkey, int padding,
+                          const EVP_MD *md, const char *name,
+                          unsigned char *sig, size_t *sigLen)
 {
     int err;
-    EVP_PKEY_CTX *kgCtx;
-    EVP_PKEY_CTX *ctx = NULL;
-    EVP_PKEY *key = NULL;
-    EVP_PKEY *peerKey = NULL;
-    unsigned char secret[48];
-    size_t outLen;
+    unsigned char dgst[32] = {0,};
+    size_t len = 0;
+    EVP_PKEY_CTX *ctx;
     unsigned int cnt = 0;
     double secs;
+    char op[32];
     BENCH_DECLS;
 
-    err = (kgCtx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, e)) == NULL;
+    err = (ctx = EVP_PKEY_CTX_new(pkey, e)) == NULL;
     if (err == 0) {
-        err = EVP_PKEY_keygen_init(kgCtx) != 1;
-    }
-    if (err == 0) {
-        err = EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kgCtx, nid) != 1;
+        err = EVP_PKEY_sign_init(ctx) != 1;
     }
     if (err == 0) {
-        err = EVP_PKEY_keygen(kgCtx, &key) != 1;
+        err = rsa_pkey_ctx_setup(ctx, padding, md);
     }
     if (err == 0) {
-        err = EVP_PKEY_keygen(kgCtx, &peerKey) != 1;
+        BENCH_START();
+        do {
+            len = *sigLen;
+            err |= EVP_PKEY_sign(ctx, sig, &len, dgst, sizeof(dgst)) != 1;
+            cnt++;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        snprintf(op, sizeof(op), "EVP sign %s", rsa_pad_name(padding));
+        printf("%-8s %-18s %10.2f ops/sec %12.3f us/op\n", name, op,
+               cnt / secs, secs / cnt * 1000000);
     }
     if (err == 0) {
-        err = (ctx = EVP_PKEY_CTX_new(key, e)) == NULL;
+        *sigLen = len;
     }
+
+    EVP_PKEY_CTX_free(ctx);
+
+    return err;
+}
+
+static int rsa_verify_bench(ENGINE *e, EVP_PKEY *pkey, int padding,
+                            const EVP_MD *md, const char *name,
+                            unsigned char *sig, size_t sigLen)
+{
+    int err;
+    unsigned char dgst[32] = {0,};
+    EVP_PKEY_CTX *ctx;
+    unsigned int cnt = 0;
+    double secs;
+    char op[32];
+    BENCH_DECLS;
+
+    err = (ctx = EVP_PKEY_CTX_new(pkey, e)) == NULL;
     if (err == 0) {
-        err = EVP_PKEY_derive_init(ctx) != 1;
+        err = EVP_PKEY_verify_init(ctx) != 1;
     }
     if (err == 0) {
-        err = EVP_PKEY_derive_set_peer(ctx, peerKey) != 1;
+        err = rsa_pkey_ctx_setup(ctx, padding, md);
     }
     if (err == 0) {
         BENCH_START();
         do {
-            outLen = sizeof(secret);
-            err |= EVP_PKEY_derive(ctx, secret, &outLen) != 1;
+            err |= EVP_PKEY_verify(ctx, sig, sigLen, dgst, sizeof(dgst)) != 1;
             cnt++;
         }
         while (BENCH_COND(1));
 
         secs = BENCH_SECS();
-        printf("%-5s EVP derive %10.2f ops/sec %12.3f us/op\n", curve,
+        snprintf(op, sizeof(op), "EVP verify %s", rsa_pad_name(padding));
+        printf("%-8s %-18s %10.2f ops/sec %12.3f us/op\n", name, op,
                cnt / secs, secs / cnt * 1000000);
     }
 
-    EVP_PKEY_free(peerKey);
-    EVP_PKEY_free(key);
     EVP_PKEY_CTX_free(ctx);
-    EVP_PKEY_CTX_free(kgCtx);
 
     return err;
 }
 
-#ifdef WE_HAVE_EC_P256
-static int ecdh_p256_bench(ENGINE *e)
+static int rsa_encrypt_bench(ENGINE *e, EVP_PKEY *pkey, int padding,
+                             const EVP_MD *md, const char *name,
+                             unsigned char *ct, size_t *ctLen)
 {
-    return ecdh_bench(e, NID_X9_62_prime256v1, "P-256");
-}
-#endif
+    int err;
+    unsigned char msg[RSA_BENCH_MAX_SZ];
+    size_t msgLen = 32;
+    size_t len = 0;
+    EVP_PKEY_CTX *ctx;
+    unsigned int cnt = 0;
+    double secs;
+    char op[32];
+    BENCH_DECLS;
 
-#ifdef WE_HAVE_EC_P384
-static int ecdh_p384_bench(ENGINE *e)
-{
-    return ecdh_bench(e, NID_secp384r1, "P-384");
+    memset(msg, 0x5a, sizeof(msg));
+    if (padding == RSA_NO_PADDING) {
+        /* Input is a full modulus size number - keep it less than modulus. */
+        msgLen = EVP_PKEY_size(pkey);
+        msg[0] = 0;
+    }
+
+    err = (ctx = EVP_PKEY_CTX_new(pkey, e)) == NULL;
+    if (err == 0) {
+        err = EVP_PKEY_encrypt_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = rsa_pkey_ctx_setup(ctx, padding, md);
+    }
+    if (err == 0) {
+        BENCH_START();
+        do {
+            len = *ctLen;
+            err |= EVP_PKEY_encrypt(ctx, ct, &len, msg, msgLen) != 1;
+            cnt++;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        snprintf(op, sizeof(op), "EVP encrypt %s", rsa_pad_name(padding));
+        printf("%-8s %-18s %10.2f ops/sec %12.3f us/op\n", name, op,
+               cnt / secs, secs / cnt * 1000000);
+    }
+    if (err == 0) {
+        *ctLen = len;
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+
+    return err;
 }
-#endif
-#endif
 
-#ifdef WE_HAVE_ECDSA
-static int ecdsa_sign_bench(ENGINE *e, EVP_PKEY *pkey, const EVP_MD* md,
-                            const char* curve, unsigned char *sig, size_t *len)
+static int rsa_decrypt_bench(ENGINE *e, EVP_PKEY *pkey, int padding,
+                             const EVP_MD *md, const char *name,
+                             unsigned char *ct, size_t ctLen)
 {
-    int err = 0;
-    unsigned char buf[20] = {0,};
-    unsigned char ecdsaSig[120];
-    size_t ecdsaSigLen = 0;
-    EVP_MD_CTX *mdCtx;
-    EVP_PKEY_CTX *pkeyCtx = NULL;
+    int err;
+    unsigned char msg[RSA_BENCH_MAX_SZ];
+    size_t len;
+    EVP_PKEY_CTX *ctx;
     unsigned int cnt = 0;
     double secs;
+    char op[32];
     BENCH_DECLS;
 
-    err = (mdCtx = EVP_MD_CTX_new()) == NULL;
+    err = (ctx = EVP_PKEY_CTX_new(pkey, e)) == NULL;
+    if (err == 0) {
+        err = EVP_PKEY_decrypt_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = rsa_pkey_ctx_setup(ctx, padding, md);
+    }
     if (err == 0) {
         BENCH_START();
         do {
-            ecdsaSigLen = sizeof(ecdsaSig);
-            err |= EVP_DigestSignInit(mdCtx, &pkeyCtx, md, e, pkey) != 1;
-#if OPENSSL_VERSION_NUMBER >= 0x1010100fL
-            err |= EVP_DigestSign(mdCtx, ecdsaSig, &ecdsaSigLen, buf,
-                                  sizeof(buf)) != 1;
-#else
-            err |= EVP_DigestSignUpdate(mdCtx, buf, sizeof(buf)) != 1;
-            err |= EVP_DigestSignFinal(mdCtx, ecdsaSig, &ecdsaSigLen) != 1;
-#endif
+            len = sizeof(msg);
+            err |= EVP_PKEY_decrypt(ctx, msg, &len, ct, ctLen) != 1;
             cnt++;
         }
         while (BENCH_COND(1));
 
         secs = BENCH_SECS();
-        printf("%-5s EVP sign   %10.2f ops/sec %12.3f us/op\n", curve,
+        snprintf(op, sizeof(op), "EVP decrypt %s", rsa_pad_name(padding));
+        printf("%-8s %-18s %10.2f ops/sec %12.3f us/op\n", name, op,
                cnt / secs, secs / cnt * 1000000);
     }
 
-    if (err == 0) {
-        memcpy(sig, ecdsaSig, ecdsaSigLen);
-        *len = ecdsaSigLen;
-    }
-    
-    EVP_MD_CTX_free(mdCtx);
+    EVP_PKEY_CTX_free(ctx);
 
     return err;
 }
 
-static int ecdsa_verify_bench(ENGINE *e, EVP_PKEY *pkey, const EVP_MD* md,
-                              const char* curve, unsigned char* sig, size_t len)
+static int rsa_meth_bench(ENGINE *e, EVP_PKEY *pkey, const char *name)
 {
-    int err = 0;
-    unsigned char buf[20] = {0,};
-    EVP_MD_CTX *mdCtx;
-    EVP_PKEY_CTX *pkeyCtx = NULL;
+    int err;
+    RSA *rsa = NULL;
+    const RSA_METHOD *meth;
+    unsigned char dgst[32] = {0,};
+    unsigned char sig[RSA_BENCH_MAX_SZ];
+    unsigned char out[RSA_BENCH_MAX_SZ];
+    int sigLen = 0;
+    unsigned int cnt = 0;
+    double secs;
+    BENCH_DECLS;
+
+    /* Use a copy of the key so the RSA_METHOD of the EVP_PKEY is unchanged. */
+    err = (rsa = RSAPrivateKey_dup(EVP_PKEY_get0_RSA(pkey))) == NULL;
+    if (err == 0) {
+        meth = (e != NULL) ? ENGINE_get_RSA(e) : RSA_get_default_method();
+        err = meth == NULL;
+    }
+    if (err == 0) {
+        err = RSA_set_method(rsa, meth) != 1;
+    }
+    if (err == 0) {
+        BENCH_START();
+        do {
+            sigLen = RSA_private_encrypt(sizeof(dgst), dgst, sig, rsa,
+                                         RSA_PKCS1_PADDING);
+            err |= sigLen <= 0;
+            cnt++;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        printf("%-8s %-18s %10.2f ops/sec %12.3f us/op\n", name,
+               "RSA_METHOD sign", cnt / secs, secs / cnt * 1000000);
+    }
+    if (err == 0) {
+        cnt = 0;
+        BENCH_START();
+        do {
+            err |= RSA_public_decrypt(sigLen, sig, out, rsa,
+                                      RSA_PKCS1_PADDING) != sizeof(dgst);
+            cnt++;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        printf("%-8s %-18s %10.2f ops/sec %12.3f us/op\n", name,
+               "RSA_METHOD verify", cnt / secs, secs / cnt * 1000000);
+    }
+
+    RSA_free(rsa);
+
+    return err;
+}
+
+static int rsa_digest_sign_bench(ENGINE *e, EVP_PKEY *pkey, const EVP_MD *md,
+                                 const char *name, unsigned char *sig,
+                                 size_t *sigLen)
+{
+    int err = 0;
+    unsigned char buf[20] = {0,};
+    size_t len = 0;
+    EVP_MD_CTX *mdCtx;
+    EVP_PKEY_CTX *pkeyCtx = NULL;
+    unsigned int cnt = 0;
+    double secs;
+    BENCH_DECLS;
+
+    err = (mdCtx = EVP_MD_CTX_new()) == NULL;
+    if (err == 0) {
+        BENCH_START();
+        do {
+            len = *sigLen;
+            err |= EVP_DigestSignInit(mdCtx, &pkeyCtx, md, e, pkey) != 1;
+#if OPENSSL_VERSION_NUMBER >= 0x1010100fL
+            err |= EVP_DigestSign(mdCtx, sig, &len, buf, sizeof(buf)) != 1;
+#else
+            err |= EVP_DigestSignUpdate(mdCtx, buf, sizeof(buf)) != 1;
+            err |= EVP_DigestSignFinal(mdCtx, sig, &len) != 1;
+#endif
+            cnt++;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        printf("%-8s %-18s %10.2f ops/sec %12.3f us/op\n", name,
+               "DigestSign", cnt / secs, secs / cnt * 1000000);
+    }
+    if (err == 0) {
+        *sigLen = len;
+    }
+
+    EVP_MD_CTX_free(mdCtx);
+
+    return err;
+}
+
+static int rsa_digest_verify_bench(ENGINE *e, EVP_PKEY *pkey, const EVP_MD *md,
+                                   const char *name, unsigned char *sig,
+                                   size_t sigLen)
+{
+    int err = 0;
+    unsigned char buf[20] = {0,};
+    EVP_MD_CTX *mdCtx;
+    EVP_PKEY_CTX *pkeyCtx = NULL;
+    unsigned int cnt = 0;
+    double secs;
+    BENCH_DECLS;
+
+    err = (mdCtx = EVP_MD_CTX_new()) == NULL;
+    if (err == 0) {
+        BENCH_START();
+        do {
+            err |= EVP_DigestVerifyInit(mdCtx, &pkeyCtx, md, e, pkey) != 1;
+#if OPENSSL_VERSION_NUMBER >= 0x1010100fL
+            err |= EVP_DigestVerify(mdCtx, sig, sigLen, buf, sizeof(buf)) != 1;
+#else
+            err |= EVP_DigestVerifyUpdate(mdCtx, buf, sizeof(buf)) != 1;
+            err |= EVP_DigestVerifyFinal(mdCtx, sig, sigLen) != 1;
+#endif
+            cnt++;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        printf("%-8s %-18s %10.2f ops/sec %12.3f us/op\n", name,
+               "DigestVerify", cnt / secs, secs / cnt * 1000000);
+    }
+
+    EVP_MD_CTX_free(mdCtx);
+
+    return err;
+}
+
+static int rsa_bench(ENGINE *e, int bits, const char *name)
+{
+    int err;
+    EVP_PKEY *key = NULL;
+    unsigned char buf[RSA_BENCH_MAX_SZ];
+    size_t len;
+    int paddings[] = { RSA_PKCS1_PADDING, RSA_PKCS1_OAEP_PADDING,
+                       RSA_NO_PADDING };
+    int i;
+
+    err = rsa_keygen_bench(e, bits, name, &key);
+    if (err == 0) {
+        len = sizeof(buf);
+        err = rsa_sign_bench(e, key, RSA_PKCS1_PADDING, EVP_sha256(), name,
+                             buf, &len);
+    }
+    if (err == 0) {
+        err = rsa_verify_bench(e, key, RSA_PKCS1_PADDING, EVP_sha256(), name,
+                               buf, len);
+    }
+    if (err == 0) {
+        err = rsa_meth_bench(e, key, name);
+    }
+    for (i = 0; err == 0 && i < (int)(sizeof(paddings) / sizeof(*paddings));
+         i++) {
+        len = sizeof(buf);
+        err = rsa_encrypt_bench(e, key, paddings[i], NULL, name, buf, &len);
+        if (err == 0) {
+            err = rsa_decrypt_bench(e, key, paddings[i], NULL, name, buf, len);
+        }
+    }
+    if (err == 0) {
+        len = sizeof(buf);
+        err = rsa_digest_sign_bench(e, key, EVP_sha256(), name, buf, &len);
+    }
+    if (err == 0) {
+        err = rsa_digest_verify_bench(e, key, EVP_sha256(), name, buf, len);
+    }
+
+    EVP_PKEY_free(key);
+
+    return err;
+}
+
+static int rsa_2048_bench(ENGINE *e)
+{
+    return rsa_bench(e, 2048, "RSA-2048");
+}
+
+static int rsa_3072_bench(ENGINE *e)
+{
+    return rsa_bench(e, 3072, "RSA-3072");
+}
+
+static int rsa_4096_bench(ENGINE *e)
+{
+    return rsa_bench(e, 4096, "RSA-4096");
+}
+
+#ifdef WE_HAVE_THREADS
+static int rsa_keygen_threads_bench(ENGINE *e, int bits, int threads,
+                                    const char *name)
+{
+    int err;
+    EVP_PKEY *key = NULL;
+
+    err = e == NULL;
+    if (err == 0) {
+        err = ENGINE_ctrl_cmd(e, "rsa_keygen_threads", threads, NULL, NULL,
+                              0) != 1;
+    }
+    if (err == 0) {
+        err = rsa_keygen_bench(e, bits, name, &key);
+    }
+    if (e != NULL) {
+        ENGINE_ctrl_cmd(e, "rsa_keygen_threads", 1, NULL, NULL, 0);
+    }
+
+    EVP_PKEY_free(key);
+
+    return err;
+}
+
+static int rsa_keygen_4096_t1_bench(ENGINE *e)
+{
+    return rsa_keygen_threads_bench(e, 4096, 1, "4096-T1");
+}
+
+static int rsa_keygen_4096_t2_bench(ENGINE *e)
+{
+    return rsa_keygen_threads_bench(e, 4096, 2, "4096-T2");
+}
+
+static int rsa_keygen_4096_t4_bench(ENGINE *e)
+{
+    return rsa_keygen_threads_bench(e, 4096, 4, "4096-T4");
+}
+
+static int rsa_keygen_4096_t8_bench(ENGINE *e)
+{
+    return rsa_keygen_threads_bench(e, 4096, 8, "4096-T8");
+}
+#endif /* WE_HAVE_THREADS */
+
+static int rsa_oaep_bench(ENGINE *e, const EVP_MD *md, const char *name)
+{
+    int err;
+    EVP_PKEY *key = NULL;
+    unsigned char ct[256];
+    size_t len = sizeof(ct);
+
+    err = rsa_gen_key(e, 2048, &key);
+    if (err == 0) {
+        err = rsa_encrypt_bench(e, key, RSA_PKCS1_OAEP_PADDING, md, name, ct,
+                                &len);
+    }
+    if (err == 0) {
+        err = rsa_decrypt_bench(e, key, RSA_PKCS1_OAEP_PADDING, md, name, ct,
+                                len);
+    }
+
+    EVP_PKEY_free(key);
+
+    return err;
+}
+
+static int rsa_oaep_sha1_bench(ENGINE *e)
+{
+    return rsa_oaep_bench(e, EVP_sha1(), "OAEP-1");
+}
+
+static int rsa_oaep_sha256_bench(ENGINE *e)
+{
+    return rsa_oaep_bench(e, EVP_sha256(), "OAEP-256");
+}
+
+static int rsa_oaep_sha384_bench(ENGINE *e)
+{
+    return rsa_oaep_bench(e, EVP_sha384(), "OAEP-384");
+}
+
+#ifdef WE_HAVE_RSA_PSS
+static int rsa_pss_2048_bench(ENGINE *e)
+{
+    int err;
+    EVP_PKEY *key = NULL;
+    unsigned char sig[256];
+    size_t len = sizeof(sig);
+
+    err = rsa_gen_key(e, 2048, &key);
+    if (err == 0) {
+        err = rsa_sign_bench(e, key, RSA_PKCS1_PSS_PADDING, EVP_sha256(),
+                             "PSS-2048", sig, &len);
+    }
+    if (err == 0) {
+        err = rsa_verify_bench(e, key, RSA_PKCS1_PSS_PADDING, EVP_sha256(),
+                               "PSS-2048", sig, len);
+    }
+
+    EVP_PKEY_free(key);
+
+    return err;
+}
+#endif
+
+#define RSA_BATCH_CNT   64
+
+static int rsa_batch_verify_bench(ENGINE *e, int threads, const char *name)
+{
+    int err;
+    EVP_PKEY *key = NULL;
+    EVP_PKEY_CTX *ctx = NULL;
+    unsigned char dgst[32] = {0,};
+    unsigned char sig[256];
+    size_t sigLen = sizeof(sig);
+    WE_RSA_VERIFY_ITEM items[RSA_BATCH_CNT];
+    WE_RSA_BATCH_VERIFY batch;
+    unsigned char results[RSA_BATCH_CNT / 8];
+    unsigned int cnt = 0;
+    double secs;
+    int i;
+    BENCH_DECLS;
+
+    err = e == NULL;
+    if (err == 0) {
+        err = rsa_gen_key(e, 2048, &key);
+    }
+    if (err == 0) {
+        err = (ctx = EVP_PKEY_CTX_new(key, NULL)) == NULL;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_sign_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = rsa_pkey_ctx_setup(ctx, RSA_PKCS1_PADDING, EVP_sha256());
+    }
+    if (err == 0) {
+        err = EVP_PKEY_sign(ctx, sig, &sigLen, dgst, sizeof(dgst)) != 1;
+    }
+    if (err == 0) {
+        for (i = 0; i < RSA_BATCH_CNT; i++) {
+            items[i].pkey = key;
+            items[i].md = EVP_sha256();
+            items[i].digest = dgst;
+            items[i].digestLen = sizeof(dgst);
+            items[i].sig = sig;
+            items[i].sigLen = sigLen;
+        }
+        batch.items = items;
+        batch.cnt = RSA_BATCH_CNT;
+        batch.results = results;
+        batch.threads = threads;
+
+        BENCH_START();
+        do {
+            err |= ENGINE_ctrl_cmd(e, "rsa_batch_verify", 0, &batch, NULL,
+                                   0) != 1;
+            err |= results[0] != 0xff;
+            cnt += RSA_BATCH_CNT;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        printf("%-8s %-18s %10.2f ops/sec %12.3f us/op\n", name,
+               "batch verify PKCS1", cnt / secs, secs / cnt * 1000000);
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+    EVP_PKEY_free(key);
+
+    return err;
+}
+
+static int rsa_batch_verify_t1_bench(ENGINE *e)
+{
+    return rsa_batch_verify_bench(e, 1, "BATCH-T1");
+}
+
+#ifdef WE_HAVE_THREADS
+static int rsa_batch_verify_t4_bench(ENGINE *e)
+{
+    return rsa_batch_verify_bench(e, 4, "BATCH-T4");
+}
+#endif
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+static int rsa_primes_bench(ENGINE *e, int bits, int primes, const char *name)
+{
+    int err;
+    EVP_PKEY_CTX *ctx;
+    EVP_PKEY *key = NULL;
+    unsigned char buf[RSA_BENCH_MAX_SZ];
+    size_t len = sizeof(buf);
+
+    /* Generate key with OpenSSL so that only signing is compared. */
+    err = (ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL)) == NULL;
+    if (err == 0) {
+        err = EVP_PKEY_keygen_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, bits) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_rsa_keygen_primes(ctx, primes) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_keygen(ctx, &key) != 1;
+    }
+    if (err == 0) {
+        err = rsa_sign_bench(e, key, RSA_PKCS1_PADDING, EVP_sha256(), name,
+                             buf, &len);
+    }
+
+    EVP_PKEY_free(key);
+    EVP_PKEY_CTX_free(ctx);
+
+    return err;
+}
+
+static int rsa_3072_2p_bench(ENGINE *e)
+{
+    return rsa_primes_bench(e, 3072, 2, "3072-2P");
+}
+
+static int rsa_3072_3p_bench(ENGINE *e)
+{
+    return rsa_primes_bench(e, 3072, 3, "3072-3P");
+}
+
+static int rsa_4096_2p_bench(ENGINE *e)
+{
+    return rsa_primes_bench(e, 4096, 2, "4096-2P");
+}
+
+static int rsa_4096_3p_bench(ENGINE *e)
+{
+    return rsa_primes_bench(e, 4096, 3, "4096-3P");
+}
+#endif /* OPENSSL_VERSION_NUMBER >= 0x10101000L */
+#endif /* WE_HAVE_RSA && WE_HAVE_EVP_PKEY */
+
+#ifdef WE_HAVE_EVP_PKEY
+
+#ifdef WE_HAVE_ECKEYGEN
+static int eckg_bench(ENGINE *e, int nid, const char *curve)
+{
+    int err;
+    EVP_PKEY_CTX *ctx;
+    EVP_PKEY *key;
+    unsigned int cnt = 0;
+    double secs;
+    BENCH_DECLS;
+
+    err = (ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, e)) == NULL;
+    if (err == 0) {
+        err = EVP_PKEY_keygen_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, nid) != 1;
+    }
+    if (err == 0) {
+        BENCH_START();
+        do {
+            key = NULL;
+            err |= EVP_PKEY_keygen(ctx, &key) != 1;
+            EVP_PKEY_free(key);
+            cnt++;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        printf("%-5s EVP keygen %10.2f ops/sec %12.3f us/op\n", curve,
+               cnt / secs, secs / cnt * 1000000);
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+
+    return err;
+}
+
+#ifdef WE_HAVE_EC_P256
+static int eckg_p256_bench(ENGINE *e)
+{
+    return eckg_bench(e, NID_X9_62_prime256v1, "P-256");
+}
+#endif
+
+#ifdef WE_HAVE_EC_P384
+static int eckg_p384_bench(ENGINE *e)
+{
+    return eckg_bench(e, NID_secp384r1, "P-384");
+}
+#endif
+
+#ifdef WE_HAVE_EC_P256
+/* Number of key pairs generated in a batch. */
+#define ECKG_BATCH_CNT      64
+
+static int eckg_p256_batch_bench(ENGINE *e, int threads, const char *name)
+{
+    int err = 0;
+    int i;
+    static unsigned char raw[ECKG_BATCH_CNT * 3 * 32];
+    EVP_PKEY *keys[ECKG_BATCH_CNT];
+    WE_EC_KEYGEN_BATCH batch;
+    unsigned int cnt = 0;
+    double secs;
+    BENCH_DECLS;
+
+    batch.curveNid = NID_X9_62_prime256v1;
+    batch.cnt = ECKG_BATCH_CNT;
+    batch.threads = threads;
+
+    /* Raw key material only. */
+    batch.raw = raw;
+    batch.pkeys = NULL;
+    BENCH_START();
+    do {
+        err |= ENGINE_ctrl_cmd(e, "ec_keygen_batch", 0, &batch, NULL, 0) != 1;
+        cnt += ECKG_BATCH_CNT;
+    }
+    while (err == 0 && BENCH_COND(1));
+
+    secs = BENCH_SECS();
+    printf("P-256 %-8s %-18s %10.2f ops/sec %12.3f us/op\n", name,
+           "batch keygen raw", cnt / secs, secs / cnt * 1000000);
+
+    /* EVP_PKEY objects only. */
+    batch.raw = NULL;
+    batch.pkeys = keys;
+    cnt = 0;
+    BENCH_START();
+    do {
+        err |= ENGINE_ctrl_cmd(e, "ec_keygen_batch", 0, &batch, NULL, 0) != 1;
+        for (i = 0; err == 0 && i < ECKG_BATCH_CNT; i++) {
+            EVP_PKEY_free(keys[i]);
+        }
+        cnt += ECKG_BATCH_CNT;
+    }
+    while (err == 0 && BENCH_COND(1));
+
+    secs = BENCH_SECS();
+    printf("P-256 %-8s %-18s %10.2f ops/sec %12.3f us/op\n", name,
+           "batch keygen pkey", cnt / secs, secs / cnt * 1000000);
+
+    return err;
+}
+
+static int eckg_p256_batch_t1_bench(ENGINE *e)
+{
+    return eckg_p256_batch_bench(e, 1, "BATCH-T1");
+}
+
+#ifdef WE_HAVE_THREADS
+static int eckg_p256_batch_t4_bench(ENGINE *e)
+{
+    return eckg_p256_batch_bench(e, 4, "BATCH-T4");
+}
+#endif
+#endif
+#endif
+
+#ifdef WE_HAVE_ECDH
+static int ecdh_bench(ENGINE *e, int nid, const char *curve)
+{
+    int err;
+    EVP_PKEY_CTX *kgCtx;
+    EVP_PKEY_CTX *ctx = NULL;
+    EVP_PKEY *key = NULL;
+    EVP_PKEY *peerKey = NULL;
+    unsigned char secret[48];
+    size_t outLen;
+    unsigned int cnt = 0;
+    double secs;
+    BENCH_DECLS;
+
+    err = (kgCtx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, e)) == NULL;
+    if (err == 0) {
+        err = EVP_PKEY_keygen_init(kgCtx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kgCtx, nid) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_keygen(kgCtx, &key) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_keygen(kgCtx, &peerKey) != 1;
+    }
+    if (err == 0) {
+        err = (ctx = EVP_PKEY_CTX_new(key, e)) == NULL;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_derive_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_derive_set_peer(ctx, peerKey) != 1;
+    }
+    if (err == 0) {
+        BENCH_START();
+        do {
+            outLen = sizeof(secret);
+            err |= EVP_PKEY_derive(ctx, secret, &outLen) != 1;
+            cnt++;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        printf("%-5s EVP derive %10.2f ops/sec %12.3f us/op\n", curve,
+               cnt / secs, secs / cnt * 1000000);
+    }
+
+    EVP_PKEY_free(peerKey);
+    EVP_PKEY_free(key);
+    EVP_PKEY_CTX_free(ctx);
+    EVP_PKEY_CTX_free(kgCtx);
+
+    return err;
+}
+
+#ifdef WE_HAVE_EC_P256
+static int ecdh_p256_bench(ENGINE *e)
+{
+    return ecdh_bench(e, NID_X9_62_prime256v1, "P-256");
+}
+#endif
+
+#ifdef WE_HAVE_EC_P256
+/* Number of peers to derive secrets with in one call. */
+#define ECDH_MULTI_PEERS    64
+
+static int ecdh_p256_multi_bench(ENGINE *e, int threads, const char *name)
+{
+    int err;
+    int i;
+    EVP_PKEY_CTX *kgCtx;
+    EVP_PKEY_CTX *ctx;
+    EVP_PKEY *key = NULL;
+    EVP_PKEY *peerKey[ECDH_MULTI_PEERS];
+    unsigned char *pub[ECDH_MULTI_PEERS];
+    WE_ECDH_PEER peers[ECDH_MULTI_PEERS];
+    WE_ECDH_MULTI_DERIVE derive;
+    static unsigned char secrets[ECDH_MULTI_PEERS * 32];
+    unsigned char results[ECDH_MULTI_PEERS / 8];
+    size_t outLen;
+    unsigned int cnt = 0;
+    double secs;
+    BENCH_DECLS;
+
+    memset(peerKey, 0, sizeof(peerKey));
+    memset(pub, 0, sizeof(pub));
+
+    err = (kgCtx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, e)) == NULL;
+    if (err == 0) {
+        err = EVP_PKEY_keygen_init(kgCtx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kgCtx,
+                                                     NID_X9_62_prime256v1) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_keygen(kgCtx, &key) != 1;
+    }
+    for (i = 0; err == 0 && i < ECDH_MULTI_PEERS; i++) {
+        err = EVP_PKEY_keygen(kgCtx, &peerKey[i]) != 1;
+        if (err == 0) {
+            peers[i].pointLen = EC_KEY_key2buf(
+                EVP_PKEY_get0_EC_KEY(peerKey[i]),
+                POINT_CONVERSION_UNCOMPRESSED, &pub[i], NULL);
+            peers[i].point = pub[i];
+            err = peers[i].pointLen == 0;
+        }
+    }
+    if (err == 0) {
+        /* Separate context for each peer for comparison. */
+        BENCH_START();
+        do {
+            i = cnt % ECDH_MULTI_PEERS;
+            ctx = EVP_PKEY_CTX_new(key, e);
+            err |= ctx == NULL;
+            err |= EVP_PKEY_derive_init(ctx) != 1;
+            err |= EVP_PKEY_derive_set_peer(ctx, peerKey[i]) != 1;
+            outLen = 32;
+            err |= EVP_PKEY_derive(ctx, secrets, &outLen) != 1;
+            EVP_PKEY_CTX_free(ctx);
+            cnt++;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        printf("P-256 %-8s %-18s %10.2f ops/sec %12.3f us/op\n", name,
+               "separate derive", cnt / secs, secs / cnt * 1000000);
+
+        derive.pkey = key;
+        derive.peers = peers;
+        derive.cnt = ECDH_MULTI_PEERS;
+        derive.secrets = secrets;
+        derive.results = results;
+        derive.threads = threads;
+
+        cnt = 0;
+        BENCH_START();
+        do {
+            err |= ENGINE_ctrl_cmd(e, "ecdh_multi_derive", 0, &derive, NULL,
+                                   0) != 1;
+            for (i = 0; i < ECDH_MULTI_PEERS / 8; i++) {
+                err |= results[i] != 0xff;
+            }
+            cnt += ECDH_MULTI_PEERS;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        printf("P-256 %-8s %-18s %10.2f ops/sec %12.3f us/op\n", name,
+               "multi derive", cnt / secs, secs / cnt * 1000000);
+    }
+
+    for (i = 0; i < ECDH_MULTI_PEERS; i++) {
+        OPENSSL_free(pub[i]);
+        EVP_PKEY_free(peerKey[i]);
+    }
+    EVP_PKEY_free(key);
+    EVP_PKEY_CTX_free(kgCtx);
+
+    return err;
+}
+
+static int ecdh_p256_multi_t1_bench(ENGINE *e)
+{
+    return ecdh_p256_multi_bench(e, 1, "MULTI-T1");
+}
+
+#ifdef WE_HAVE_THREADS
+static int ecdh_p256_multi_t4_bench(ENGINE *e)
+{
+    return ecdh_p256_multi_bench(e, 4, "MULTI-T4");
+}
+#endif
+#endif
+
+#ifdef WE_HAVE_EC_P384
+static int ecdh_p384_bench(ENGINE *e)
+{
+    return ecdh_bench(e, NID_secp384r1, "P-384");
+}
+#endif
+#endif
+
+#ifdef WE_HAVE_ECDSA
+static int ecdsa_sign_bench(ENGINE *e, EVP_PKEY *pkey, const EVP_MD* md,
+                            const char* curve, unsigned char *sig, size_t *len)
+{
+    int err = 0;
+    unsigned char buf[20] = {0,};
+    unsigned char ecdsaSig[120];
+    size_t ecdsaSigLen = 0;
+    EVP_MD_CTX *mdCtx;
+    EVP_PKEY_CTX *pkeyCtx = NULL;
+    unsigned int cnt = 0;
+    double secs;
+    BENCH_DECLS;
+
+    err = (mdCtx = EVP_MD_CTX_new()) == NULL;
+    if (err == 0) {
+        BENCH_START();
+        do {
+            ecdsaSigLen = sizeof(ecdsaSig);
+            err |= EVP_DigestSignInit(mdCtx, &pkeyCtx, md, e, pkey) != 1;
+#if OPENSSL_VERSION_NUMBER >= 0x1010100fL
+            err |= EVP_DigestSign(mdCtx, ecdsaSig, &ecdsaSigLen, buf,
+                                  sizeof(buf)) != 1;
+#else
+            err |= EVP_DigestSignUpdate(mdCtx, buf, sizeof(buf)) != 1;
+            err |= EVP_DigestSignFinal(mdCtx, ecdsaSig, &ecdsaSigLen) != 1;
+#endif
+            cnt++;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        printf("%-5s EVP sign   %10.2f ops/sec %12.3f us/op\n", curve,
+               cnt / secs, secs / cnt * 1000000);
+    }
+
+    if (err == 0) {
+        memcpy(sig, ecdsaSig, ecdsaSigLen);
+        *len = ecdsaSigLen;
+    }
+    
+    EVP_MD_CTX_free(mdCtx);
+
+    return err;
+}
+
+static int ecdsa_verify_bench(ENGINE *e, EVP_PKEY *pkey, const EVP_MD* md,
+                              const char* curve, unsigned char* sig, size_t len)
+{
+    int err = 0;
+    unsigned char buf[20] = {0,};
+    EVP_MD_CTX *mdCtx;
+    EVP_PKEY_CTX *pkeyCtx = NULL;
+    unsigned int cnt = 0;
+    double secs;
+    BENCH_DECLS;
+
+    err = (mdCtx = EVP_MD_CTX_new()) == NULL;
+    if (err == 0) {
+        BENCH_START();
+        do {
+            err |= EVP_DigestVerifyInit(mdCtx, &pkeyCtx, md, e, pkey) != 1;
+#if OPENSSL_VERSION_NUMBER >= 0x1010100fL
+            err |= EVP_DigestVerify(mdCtx, sig, len, buf, sizeof(buf)) != 1;
+#else
+            err |= EVP_DigestVerifyUpdate(mdCtx, buf, sizeof(buf)) != 1;
+            err |= EVP_DigestVerifyFinal(mdCtx, sig, len) != 1;
+#endif
+            cnt++;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        printf("%-5s EVP verify %10.2f ops/sec %12.3f us/op\n", curve,
+               cnt / secs, secs / cnt * 1000000);
+    }
+
+    EVP_MD_CTX_free(mdCtx);
+
+    return err;
+}
+
+#ifdef WE_HAVE_EC_P256
+static int ecdsa_p256_bench(ENGINE *e)
+{
+    int err;
+    unsigned char sig[100];
+    size_t len;
+    EVP_PKEY_CTX *kgCtx;
+    EVP_PKEY *key = NULL;
+
+    err = (kgCtx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, e)) == NULL;
+    if (err == 0) {
+        err = EVP_PKEY_keygen_init(kgCtx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kgCtx,
+                                                     NID_X9_62_prime256v1) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_keygen(kgCtx, &key) != 1;
+    }
+    if (err == 0) {
+        err = ecdsa_sign_bench(e, key, EVP_sha256(), "P-256", sig, &len);
+    }
+    if (err == 0) {
+        err = ecdsa_verify_bench(e, key, EVP_sha256(), "P-256", sig, len);
+    }
+
+    EVP_PKEY_free(key);
+    EVP_PKEY_CTX_free(kgCtx);
+
+    return err;
+}
+
+/* Number of issuer keys verified against in round-robin. */
+#define ECDSA_VERIFY_KEYS   32
+
+static int ecdsa_verify_keys_bench(ENGINE *e, EVP_PKEY **key,
+                                   unsigned char sig[][100], size_t *len,
+                                   const char *name)
+{
+    int err = 0;
+    int i;
+    unsigned char buf[20] = {0,};
+    EVP_MD_CTX *mdCtx;
+    unsigned int cnt = 0;
+    double secs;
+    BENCH_DECLS;
+
+    err = (mdCtx = EVP_MD_CTX_new()) == NULL;
+    if (err == 0) {
+        BENCH_START();
+        do {
+            i = cnt % ECDSA_VERIFY_KEYS;
+            err |= EVP_DigestVerifyInit(mdCtx, NULL, EVP_sha256(), e,
+                                        key[i]) != 1;
+            err |= EVP_DigestVerifyUpdate(mdCtx, buf, sizeof(buf)) != 1;
+            err |= EVP_DigestVerifyFinal(mdCtx, sig[i], len[i]) != 1;
+            cnt++;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        printf("P-256 EVP verify %-8s %10.2f ops/sec %12.3f us/op\n", name,
+               cnt / secs, secs / cnt * 1000000);
+    }
+
+    EVP_MD_CTX_free(mdCtx);
+
+    return err;
+}
+
+static int ecdsa_p256_keys_sign(ENGINE *e, EVP_PKEY **key,
+                                unsigned char sig[][100], size_t *len)
+{
+    int err = 0;
+    int i;
+    unsigned char buf[20] = {0,};
+    EVP_PKEY_CTX *kgCtx;
+    EVP_MD_CTX *mdCtx = NULL;
+
+    err = (kgCtx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, e)) == NULL;
+    if (err == 0) {
+        err = EVP_PKEY_keygen_init(kgCtx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kgCtx,
+                                                     NID_X9_62_prime256v1) != 1;
+    }
+    if (err == 0) {
+        err = (mdCtx = EVP_MD_CTX_new()) == NULL;
+    }
+    for (i = 0; err == 0 && i < ECDSA_VERIFY_KEYS; i++) {
+        err = EVP_PKEY_keygen(kgCtx, &key[i]) != 1;
+        if (err == 0) {
+            len[i] = sizeof(sig[i]);
+            err = EVP_DigestSignInit(mdCtx, NULL, EVP_sha256(), e,
+                                     key[i]) != 1;
+        }
+        if (err == 0) {
+            err = EVP_DigestSignUpdate(mdCtx, buf, sizeof(buf)) != 1;
+        }
+        if (err == 0) {
+            err = EVP_DigestSignFinal(mdCtx, sig[i], &len[i]) != 1;
+        }
+    }
+
+    EVP_MD_CTX_free(mdCtx);
+    EVP_PKEY_CTX_free(kgCtx);
+
+    return err;
+}
+
+static int ecdsa_p256_pub_cache_bench(ENGINE *e)
+{
+    int err = 0;
+    int i;
+    static unsigned char sig[ECDSA_VERIFY_KEYS][100];
+    size_t len[ECDSA_VERIFY_KEYS];
+    EVP_PKEY *key[ECDSA_VERIFY_KEYS];
+
+    memset(key, 0, sizeof(key));
+
+    err = ecdsa_p256_keys_sign(e, key, sig, len);
+    if (err == 0) {
+        err = ecdsa_verify_keys_bench(e, key, sig, len, "no-cache");
+    }
+    if (err == 0) {
+        err = ENGINE_ctrl_cmd(e, "ec_pub_cache_size", ECDSA_VERIFY_KEYS, NULL,
+                              NULL, 0) != 1;
+    }
+    if (err == 0) {
+        err = ecdsa_verify_keys_bench(e, key, sig, len, "cache");
+        ENGINE_ctrl_cmd(e, "ec_pub_cache_size", 0, NULL, NULL, 0);
+    }
+
+    for (i = 0; i < ECDSA_VERIFY_KEYS; i++) {
+        EVP_PKEY_free(key[i]);
+    }
+
+    return err;
+}
+
+/* Number of signatures in a batch. */
+#define ECDSA_BATCH_CNT     64
+
+static int ecdsa_p256_batch_verify_bench(ENGINE *e, int threads,
+                                         const char *name)
+{
+    int err = 0;
+    int i;
+    static unsigned char sig[ECDSA_VERIFY_KEYS][100];
+    size_t len[ECDSA_VERIFY_KEYS];
+    EVP_PKEY *key[ECDSA_VERIFY_KEYS];
+    unsigned char buf[20] = {0,};
+    unsigned char dgst[32];
+    unsigned int dgstLen = sizeof(dgst);
+    WE_ECDSA_VERIFY_ITEM items[ECDSA_BATCH_CNT];
+    WE_ECDSA_BATCH_VERIFY batch;
+    unsigned char results[ECDSA_BATCH_CNT / 8];
+    EVP_PKEY_CTX *ctx;
     unsigned int cnt = 0;
     double secs;
     BENCH_DECLS;
 
-    err = (mdCtx = EVP_MD_CTX_new()) == NULL;
+    memset(key, 0, sizeof(key));
+
+    err = ecdsa_p256_keys_sign(e, key, sig, len);
+    if (err == 0) {
+        err = EVP_Digest(buf, sizeof(buf), dgst, &dgstLen, EVP_sha256(),
+                         NULL) != 1;
+    }
     if (err == 0) {
+        for (i = 0; i < ECDSA_BATCH_CNT; i++) {
+            items[i].pkey = key[i % ECDSA_VERIFY_KEYS];
+            items[i].digest = dgst;
+            items[i].digestLen = dgstLen;
+            items[i].sig = sig[i % ECDSA_VERIFY_KEYS];
+            items[i].sigLen = len[i % ECDSA_VERIFY_KEYS];
+        }
+        batch.items = items;
+        batch.cnt = ECDSA_BATCH_CNT;
+        batch.results = results;
+        batch.threads = threads;
+
+        /* Separate verify of each item for comparison. */
         BENCH_START();
         do {
-            err |= EVP_DigestVerifyInit(mdCtx, &pkeyCtx, md, e, pkey) != 1;
-#if OPENSSL_VERSION_NUMBER >= 0x1010100fL
-            err |= EVP_DigestVerify(mdCtx, sig, len, buf, sizeof(buf)) != 1;
-#else
-            err |= EVP_DigestVerifyUpdate(mdCtx, buf, sizeof(buf)) != 1;
-            err |= EVP_DigestVerifyFinal(mdCtx, sig, len) != 1;
-#endif
+            i = cnt % ECDSA_BATCH_CNT;
+            ctx = EVP_PKEY_CTX_new(items[i].pkey, e);
+            err |= ctx == NULL;
+            err |= EVP_PKEY_verify_init(ctx) != 1;
+            err |= EVP_PKEY_verify(ctx, items[i].sig, items[i].sigLen,
+                                   items[i].digest, items[i].digestLen) != 1;
+            EVP_PKEY_CTX_free(ctx);
             cnt++;
         }
         while (BENCH_COND(1));
 
         secs = BENCH_SECS();
-        printf("%-5s EVP verify %10.2f ops/sec %12.3f us/op\n", curve,
-               cnt / secs, secs / cnt * 1000000);
+        printf("P-256 %-8s %-18s %10.2f ops/sec %12.3f us/op\n", name,
+               "separate verify", cnt / secs, secs / cnt * 1000000);
+
+        cnt = 0;
+        BENCH_START();
+        do {
+            err |= ENGINE_ctrl_cmd(e, "ecdsa_batch_verify", 0, &batch, NULL,
+                                   0) != 1;
+            for (i = 0; i < ECDSA_BATCH_CNT / 8; i++) {
+                err |= results[i] != 0xff;
+            }
+            cnt += ECDSA_BATCH_CNT;
+        }
+        while (BENCH_COND(1));
+
+        secs = BENCH_SECS();
+        printf("P-256 %-8s %-18s %10.2f ops/sec %12.3f us/op\n", name,
+               "batch verify", cnt / secs, secs / cnt * 1000000);
     }
 
-    EVP_MD_CTX_free(mdCtx);
+    for (i = 0; i < ECDSA_VERIFY_KEYS; i++) {
+        EVP_PKEY_free(key[i]);
+    }
 
     return err;
 }
 
-#ifdef WE_HAVE_EC_P256
-static int ecdsa_p256_bench(ENGINE *e)
+static int ecdsa_p256_batch_verify_t1_bench(ENGINE *e)
 {
-    int err;
-    unsigned char sig[100];
-    size_t len;
-    EVP_PKEY_CTX *kgCtx;
-    EVP_PKEY *key = NULL;
-
-    err = (kgCtx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, e)) == NULL;
-    if (err == 0) {
-        err = EVP_PKEY_keygen_init(kgCtx) != 1;
-    }
-    if (err == 0) {
-        err = EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kgCtx,
-                                                     NID_X9_62_prime256v1) != 1;
-    }
-    if (err == 0) {
-        err = EVP_PKEY_keygen(kgCtx, &key) != 1;
-    }
-    if (err == 0) {
-        err = ecdsa_sign_bench(e, key, EVP_sha256(), "P-256", sig, &len);
-    }
-    if (err == 0) {
-        err = ecdsa_verify_bench(e, key, EVP_sha256(), "P-256", sig, len);
-    }
-
-    EVP_PKEY_free(key);
-    EVP_PKEY_CTX_free(kgCtx);
+    return ecdsa_p256_batch_verify_bench(e, 1, "BATCH-T1");
+}
 
-    return err;
+#ifdef WE_HAVE_THREADS
+static int ecdsa_p256_batch_verify_t4_bench(ENGINE *e)
+{
+    return ecdsa_p256_batch_verify_bench(e, 4, "BATCH-T4");
 }
 #endif
+#endif
 
 #ifdef WE_HAVE_EC_P384
 static int ecdsa_p384_bench(ENGINE *e)
@@ -668,6 +1882,97 @@ static int eckg_ec_key_p384_bench(ENGINE *e)
     return eckg_ec_key_bench(e, NID_secp384r1, "P-384");
 }
 #endif
+
+/* Number of key generations timed for the latency histogram. */
+#define ECKG_LAT_CNT        1024
+/* Key generations per burst - pool is given time to fill between bursts. */
+#define ECKG_LAT_BURST      32
+
+static int eckg_lat_cmp(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+
+    return (da > db) - (da < db);
+}
+
+static int eckg_ec_key_latency_bench(EC_KEY *key, const char *curve,
+                                     const char *name)
+{
+    int err = 0;
+    int i;
+    static double lat[ECKG_LAT_CNT];
+    BENCH_DECLS;
+
+    for (i = 0; err == 0 && i < ECKG_LAT_CNT; i++) {
+        if ((i % ECKG_LAT_BURST) == 0) {
+            /* Idle time between bursts of handshakes. */
+            usleep(20000);
+        }
+        BENCH_START();
+        err = EC_KEY_generate_key(key) != 1;
+        gettimeofday(&end, NULL);
+        lat[i] = (end.tv_sec - start.tv_sec) * 1000000.0 +
+                 (end.tv_usec - start.tv_usec);
+    }
+    if (err == 0) {
+        qsort(lat, ECKG_LAT_CNT, sizeof(*lat), eckg_lat_cmp);
+        printf("%-5s KEY keygen %-7s p50 %9.1f us  p90 %9.1f us  "
+               "p99 %9.1f us  max %9.1f us\n", curve, name,
+               lat[ECKG_LAT_CNT / 2], lat[ECKG_LAT_CNT * 90 / 100],
+               lat[ECKG_LAT_CNT * 99 / 100], lat[ECKG_LAT_CNT - 1]);
+    }
+
+    return err;
+}
+
+static int eckg_ec_key_pool_bench(ENGINE *e, int nid, const char *curve)
+{
+    int err;
+    EC_GROUP *group = NULL;
+    EC_KEY *key = NULL;
+
+    err = (group = EC_GROUP_new_by_curve_name(nid)) == NULL;
+    if (err == 0) {
+        err = (key = EC_KEY_new_method(e)) == NULL;
+    }
+    if (err == 0) {
+        err = EC_KEY_set_group(key, group) != 1;
+    }
+    if (err == 0) {
+        err = eckg_ec_key_latency_bench(key, curve, "no-pool");
+    }
+    if (err == 0) {
+        /* Pool needs wolfEngine built with threads. */
+        if (ENGINE_ctrl_cmd(e, "ec_key_pool_size", ECKG_LAT_BURST, NULL,
+                            NULL, 0) == 1) {
+            err = eckg_ec_key_latency_bench(key, curve, "pool");
+            ENGINE_ctrl_cmd(e, "ec_key_pool_size", 0, NULL, NULL, 0);
+        }
+        else {
+            printf("%-5s KEY keygen pool not supported\n", curve);
+        }
+    }
+
+    EC_KEY_free(key);
+    EC_GROUP_free(group);
+
+    return err;
+}
+
+#ifdef WE_HAVE_EC_P256
+static int eckg_ec_key_p256_latency_bench(ENGINE *e)
+{
+    return eckg_ec_key_pool_bench(e, NID_X9_62_prime256v1, "P-256");
+}
+#endif
+
+#ifdef WE_HAVE_EC_P384
+static int eckg_ec_key_p384_latency_bench(ENGINE *e)
+{
+    return eckg_ec_key_pool_bench(e, NID_secp384r1, "P-384");
+}
+#endif
 #endif
 
 #ifdef WE_HAVE_ECDH
@@ -866,10 +2171,220 @@ static int ecdsa_ec_key_p384_bench(ENGINE *e)
     return err;
 }
 #endif
+
+#ifdef WE_HAVE_EC_P256
+/* Number of signatures timed for the latency histogram. */
+#define ECDSA_LAT_CNT       1024
+/* Signatures per burst - pool is given time to fill between bursts. */
+#define ECDSA_LAT_BURST     32
+
+static int ecdsa_lat_cmp(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+
+    return (da > db) - (da < db);
+}
+
+static int ecdsa_ec_key_latency_bench(EC_KEY *key, const char *name)
+{
+    int err = 0;
+    int i;
+    unsigned char dgst[32] = {0,};
+    unsigned char ecdsaSig[120];
+    unsigned int ecdsaSigLen;
+    static double lat[ECDSA_LAT_CNT];
+    BENCH_DECLS;
+
+    for (i = 0; err == 0 && i < ECDSA_LAT_CNT; i++) {
+        if ((i % ECDSA_LAT_BURST) == 0) {
+            /* Idle time between bursts of signing. */
+            usleep(20000);
+        }
+        ecdsaSigLen = sizeof(ecdsaSig);
+        BENCH_START();
+        err = ECDSA_sign(0, dgst, sizeof(dgst), ecdsaSig, &ecdsaSigLen,
+                         key) != 1;
+        gettimeofday(&end, NULL);
+        lat[i] = (end.tv_sec - start.tv_sec) * 1000000.0 +
+                 (end.tv_usec - start.tv_usec);
+    }
+    if (err == 0) {
+        qsort(lat, ECDSA_LAT_CNT, sizeof(*lat), ecdsa_lat_cmp);
+        printf("P-256 KEY sign %-9s p50 %9.1f us  p90 %9.1f us  "
+               "p99 %9.1f us  max %9.1f us\n", name,
+               lat[ECDSA_LAT_CNT / 2], lat[ECDSA_LAT_CNT * 90 / 100],
+               lat[ECDSA_LAT_CNT * 99 / 100], lat[ECDSA_LAT_CNT - 1]);
+    }
+
+    return err;
+}
+
+static int ecdsa_ec_key_p256_latency_bench(ENGINE *e)
+{
+    int err;
+    EC_GROUP *group = NULL;
+    EC_KEY *key = NULL;
+
+    err = (group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1)) == NULL;
+    if (err == 0) {
+        err = (key = EC_KEY_new_method(e)) == NULL;
+    }
+    if (err == 0) {
+        err = EC_KEY_set_group(key, group) != 1;
+    }
+    if (err == 0) {
+        err = EC_KEY_generate_key(key) != 1;
+    }
+    if (err == 0) {
+        err = ecdsa_ec_key_latency_bench(key, "no-pool");
+    }
+    if (err == 0) {
+        /* Pool needs wolfSSL built with threads and public math. */
+        if (ENGINE_ctrl_cmd(e, "ecdsa_sign_pool_size", ECDSA_LAT_BURST, NULL,
+                            NULL, 0) == 1) {
+            err = ecdsa_ec_key_latency_bench(key, "pool");
+            ENGINE_ctrl_cmd(e, "ecdsa_sign_pool_size", 0, NULL, NULL, 0);
+        }
+        else {
+            printf("P-256 KEY sign pool not supported\n");
+        }
+    }
+
+    EC_KEY_free(key);
+    EC_GROUP_free(group);
+
+    return err;
+}
+#endif
 #endif
 
 #endif /* WE_HAVE_EVP_PKEY */
 
+#ifdef WE_HAVE_KEYD
+/* Socket of key daemon. NULL when not benchmarking key daemon. */
+static const char *keyd_socket = NULL;
+/* Identifier of key in key daemon to sign with. */
+static const char *keyd_key = "rsa2048.der";
+
+typedef struct KEYD_BENCH_THREAD {
+    ENGINE *e;
+    EVP_PKEY *pkey;
+    unsigned int cnt;
+    int err;
+} KEYD_BENCH_THREAD;
+
+static void *keyd_sign_thread(void *arg)
+{
+    KEYD_BENCH_THREAD *t = (KEYD_BENCH_THREAD *)arg;
+    EVP_PKEY_CTX *ctx;
+    unsigned char dgst[32];
+    unsigned char sig[512];
+    size_t sigLen;
+    BENCH_DECLS;
+
+    memset(dgst, 0x5a, sizeof(dgst));
+
+    t->err = (ctx = EVP_PKEY_CTX_new(t->pkey, t->e)) == NULL;
+    if (t->err == 0) {
+        t->err = EVP_PKEY_sign_init(ctx) != 1;
+    }
+    if (t->err == 0 && EVP_PKEY_base_id(t->pkey) == EVP_PKEY_RSA) {
+        t->err = EVP_PKEY_CTX_set_signature_md(ctx, EVP_sha256()) != 1;
+    }
+    if (t->err == 0) {
+        /* Threads share connections with requests pipelined on each. */
+        BENCH_START();
+        do {
+            sigLen = sizeof(sig);
+            t->err |= EVP_PKEY_sign(ctx, sig, &sigLen, dgst,
+                                    sizeof(dgst)) != 1;
+            t->cnt++;
+        }
+        while (BENCH_COND(1));
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+
+    return NULL;
+}
+
+static int keyd_sign_bench(ENGINE *e, int threads, const char *name)
+{
+    int err;
+    int init = 0;
+    EVP_PKEY *pkey = NULL;
+    KEYD_BENCH_THREAD t[4];
+    pthread_t thread[4];
+    int started = 0;
+    unsigned int cnt = 0;
+    double secs;
+    int i;
+    BENCH_DECLS;
+
+    if (keyd_socket == NULL) {
+        printf("%-8s %-18s skipped - no --keyd socket\n", name, "keyd sign");
+        return 0;
+    }
+
+    err = e == NULL;
+    if (err == 0) {
+        /* Loading keys requires a functional reference. */
+        err = ENGINE_init(e) != 1;
+        init = (err == 0);
+    }
+    if (err == 0) {
+        err = ENGINE_ctrl_cmd_string(e, "keyd_socket", keyd_socket, 0) != 1;
+    }
+    if (err == 0) {
+        err = (pkey = ENGINE_load_private_key(e, keyd_key, NULL, NULL)) ==
+              NULL;
+    }
+    if (err == 0) {
+        memset(t, 0, sizeof(t));
+        BENCH_START();
+        for (; started < threads; started++) {
+            t[started].e = e;
+            t[started].pkey = pkey;
+            if (pthread_create(&thread[started], NULL, keyd_sign_thread,
+                               &t[started]) != 0) {
+                err = 1;
+                break;
+            }
+        }
+        for (i = 0; i < started; i++) {
+            pthread_join(thread[i], NULL);
+            err |= t[i].err;
+            cnt += t[i].cnt;
+        }
+        gettimeofday(&end, NULL);
+    }
+    if (err == 0) {
+        secs = BENCH_SECS();
+        printf("%-8s %-18s %10.2f ops/sec %12.3f us/op\n", name, "keyd sign",
+               cnt / secs, secs / cnt * 1000000);
+    }
+
+    EVP_PKEY_free(pkey);
+    if (init) {
+        ENGINE_ctrl_cmd(e, "keyd_socket", 0, NULL, NULL, 0);
+        ENGINE_finish(e);
+    }
+
+    return err;
+}
+
+static int keyd_sign_t1_bench(ENGINE *e)
+{
+    return keyd_sign_bench(e, 1, "KEYD-T1");
+}
+
+static int keyd_sign_t4_bench(ENGINE *e)
+{
+    return keyd_sign_bench(e, 4, "KEYD-T4");
+}
+#endif /* WE_HAVE_KEYD */
+
 BENCH_ALG bench_alg[] = {
 #ifdef WE_HAVE_SHA256
     BENCH_DECL("SHA256", sha256_bench),
@@ -880,6 +2395,9 @@ BENCH_ALG bench_alg[] = {
 #ifdef WE_HAVE_SHA512
     BENCH_DECL("SHA512", sha512_bench),
 #endif
+#if defined(WE_HAVE_PROVIDER) && defined(WE_HAVE_SHA256)
+    BENCH_DECL("SHA256-PROV", prov_sha256_bench),
+#endif
 #ifdef WE_HAVE_SHA3_224
     BENCH_DECL("SHA3_224", sha3_224_bench),
 #endif
@@ -895,17 +2413,61 @@ BENCH_ALG bench_alg[] = {
 #ifdef WE_HAVE_AESGCM
     BENCH_DECL("AES128-GCM", aes128_gcm_bench),
     BENCH_DECL("AES256-GCM", aes256_gcm_bench),
+    #ifdef WE_HAVE_PROVIDER
+        BENCH_DECL("AES256-GCM-PROV", prov_aes256_gcm_bench),
+    #endif
+#endif
+#if defined(WE_HAVE_RSA) && defined(WE_HAVE_EVP_PKEY)
+    BENCH_DECL("RSA-2048", rsa_2048_bench),
+    BENCH_DECL("RSA-3072", rsa_3072_bench),
+    BENCH_DECL("RSA-4096", rsa_4096_bench),
+    #ifdef WE_HAVE_THREADS
+        BENCH_DECL("RSA-KG-4096-T1", rsa_keygen_4096_t1_bench),
+        BENCH_DECL("RSA-KG-4096-T2", rsa_keygen_4096_t2_bench),
+        BENCH_DECL("RSA-KG-4096-T4", rsa_keygen_4096_t4_bench),
+        BENCH_DECL("RSA-KG-4096-T8", rsa_keygen_4096_t8_bench),
+    #endif
+    BENCH_DECL("RSA-OAEP-SHA1", rsa_oaep_sha1_bench),
+    BENCH_DECL("RSA-OAEP-SHA256", rsa_oaep_sha256_bench),
+    BENCH_DECL("RSA-OAEP-SHA384", rsa_oaep_sha384_bench),
+    #ifdef WE_HAVE_RSA_PSS
+        BENCH_DECL("RSA-PSS-2048", rsa_pss_2048_bench),
+    #endif
+    BENCH_DECL("RSA-BATCH-T1", rsa_batch_verify_t1_bench),
+    #ifdef WE_HAVE_THREADS
+        BENCH_DECL("RSA-BATCH-T4", rsa_batch_verify_t4_bench),
+    #endif
+    #if OPENSSL_VERSION_NUMBER >= 0x10101000L
+        BENCH_DECL("RSA-3072-2P", rsa_3072_2p_bench),
+        BENCH_DECL("RSA-3072-3P", rsa_3072_3p_bench),
+        BENCH_DECL("RSA-4096-2P", rsa_4096_2p_bench),
+        BENCH_DECL("RSA-4096-3P", rsa_4096_3p_bench),
+    #endif
 #endif
 #ifdef WE_HAVE_EVP_PKEY
 #ifdef WE_HAVE_EC_P256
     #ifdef WE_HAVE_ECKEYGEN
         BENCH_DECL("ECKG-P256", eckg_p256_bench),
+        BENCH_DECL("ECKG-P256-BATCH-T1", eckg_p256_batch_t1_bench),
+        #ifdef WE_HAVE_THREADS
+            BENCH_DECL("ECKG-P256-BATCH-T4", eckg_p256_batch_t4_bench),
+        #endif
     #endif
     #ifdef WE_HAVE_ECDH
         BENCH_DECL("ECDH-P256", ecdh_p256_bench),
+        BENCH_DECL("ECDH-P256-MULTI-T1", ecdh_p256_multi_t1_bench),
+        #ifdef WE_HAVE_THREADS
+            BENCH_DECL("ECDH-P256-MULTI-T4", ecdh_p256_multi_t4_bench),
+        #endif
     #endif
     #ifdef WE_HAVE_ECDSA
         BENCH_DECL("ECDSA-P256", ecdsa_p256_bench),
+        BENCH_DECL("ECDSA-P256-KEYS", ecdsa_p256_pub_cache_bench),
+        BENCH_DECL("ECDSA-P256-BATCH-T1", ecdsa_p256_batch_verify_t1_bench),
+        #ifdef WE_HAVE_THREADS
+            BENCH_DECL("ECDSA-P256-BATCH-T4",
+                       ecdsa_p256_batch_verify_t4_bench),
+        #endif
     #endif
 #endif
 #ifdef WE_HAVE_EC_P384
@@ -924,17 +2486,20 @@ BENCH_ALG bench_alg[] = {
 #ifdef WE_HAVE_EC_P256
     #ifdef WE_HAVE_ECKEYGEN
         BENCH_DECL("ECKG-ECKEY-P256", eckg_ec_key_p256_bench),
+        BENCH_DECL("ECKG-ECKEY-P256-LAT", eckg_ec_key_p256_latency_bench),
     #endif
     #ifdef WE_HAVE_ECDH
         BENCH_DECL("ECDH-ECKEY-P256", ecdh_ec_key_p256_bench),
     #endif
     #ifdef WE_HAVE_ECDSA
         BENCH_DECL("ECDSA-ECKEY-P256", ecdsa_ec_key_p256_bench),
+        BENCH_DECL("ECDSA-ECKEY-P256-LAT", ecdsa_ec_key_p256_latency_bench),
     #endif
 #endif
 #ifdef WE_HAVE_EC_P384
     #ifdef WE_HAVE_ECKEYGEN
         BENCH_DECL("ECKG-ECKEY-P384", eckg_ec_key_p384_bench),
+        BENCH_DECL("ECKG-ECKEY-P384-LAT", eckg_ec_key_p384_latency_bench),
     #endif
     #ifdef WE_HAVE_ECDH
         BENCH_DECL("ECDH-ECKEY-P384", ecdh_ec_key_p384_bench),
@@ -944,6 +2509,10 @@ BENCH_ALG bench_alg[] = {
     #endif
 #endif
 #endif
+#ifdef WE_HAVE_KEYD
+    BENCH_DECL("KEYD-SIGN-T1", keyd_sign_t1_bench),
+    BENCH_DECL("KEYD-SIGN-T4", keyd_sign_t4_bench),
+#endif
 };
 #define BENCH_ALG_COUNT  (int)(sizeof(bench_alg) / sizeof(*bench_alg))
 
@@ -957,6 +2526,15 @@ static void usage()
     printf("                  Default: .libs\n");
     printf("  --engine <str>  Name of wolfsslengine. Default: libwolfengine\n");
     printf("  --no-engine     Do not use an engine - use OpenSSL direct\n");
+#ifdef WE_HAVE_PROVIDER
+    printf("  *-PROV cases    Load provider %s from the --dir path\n",
+           prov_name);
+#endif
+#ifdef WE_HAVE_KEYD
+    printf("  --keyd <path>   Socket of running keyd for KEYD-* cases\n");
+    printf("  --keyd-key <id> Key in keyd to sign with. Default: %s\n",
+           keyd_key);
+#endif
     printf("  --list          Display all algorithms\n");
     printf("  <num>           Run this bench case, but not all\n");
     printf("  <name>          Run this bench case, but not all\n");
@@ -1016,6 +2594,32 @@ int main(int argc, char *argv[])
         else if (strncmp(*argv, "--no-engine", 9) == 0) {
             name = NULL;
         }
+#ifdef WE_HAVE_KEYD
+        else if (strncmp(*argv, "--keyd-key", 11) == 0) {
+            argc--;
+            argv++;
+            if (argc == 0) {
+                printf("\n");
+                printf("Missing key identifier argument\n");
+                usage();
+                err = 1;
+                break;
+            }
+            keyd_key = *argv;
+        }
+        else if (strncmp(*argv, "--keyd", 7) == 0) {
+            argc--;
+            argv++;
+            if (argc == 0) {
+                printf("\n");
+                printf("Missing socket argument\n");
+                usage();
+                err = 1;
+                break;
+            }
+            keyd_socket = *argv;
+        }
+#endif
         else if (strncmp(*argv, "--list", 7) == 0) {
             for (i = 0; i < BENCH_ALG_COUNT; i++) {
                 printf("%2d: %s\n", i + 1, bench_alg[i].alg);
@@ -1052,6 +2656,13 @@ int main(int argc, char *argv[])
         }
     }
 
+#ifdef WE_HAVE_PROVIDER
+    if (err == 0 && runBench) {
+        /* Provider cases load the provider from the same directory. */
+        OSSL_PROVIDER_set_default_search_path(NULL, dir);
+    }
+#endif
+
     if (err == 0 && runBench && name != NULL) {
         printf("\n");
 
@@ -47,12 +47,19 @@
 
 #include "openssl_bc.h"
 #include "we_logging.h"
+#include "wolfengine.h"
 
 /*
  * Global random
  */
 
+#ifdef WE_HAVE_THREADS
+WC_RNG* we_rng_get(void);
+/* wolfSSL's random isn't thread safe - each thread has its own. */
+#define we_rng      we_rng_get()
+#else
 extern WC_RNG* we_rng;
+#endif
 
 /* For digest method in OpenSSL 1.0.2 */
 int we_pkey_get_nids(const int** nids);
@@ -88,6 +95,7 @@ int we_init_sha3_384_meth(void);
 extern EVP_MD *we_sha3_512_md;
 int we_init_sha3_512_meth(void);
 
+int we_nid_to_wc_hash_type(int nid);
 int we_nid_to_wc_hash_oid(int nid);
 
 /*
@@ -122,6 +130,33 @@ extern EVP_CIPHER* we_aes192_ccm_ciph;
 extern EVP_CIPHER* we_aes256_ccm_ciph;
 int we_init_aesccm_meths(void);
 
+/*
+ * Parallel verification of a batch of signatures.
+ */
+
+#if defined(WE_HAVE_RSA) || (defined(WE_HAVE_ECC) && defined(WE_HAVE_ECDSA))
+#define WE_HAVE_BATCH_VERIFY
+
+/* Index of item in batch and the key it is verified with. */
+typedef struct we_BatchEntry
+{
+    /* Algorithm's key of item - NULL when item has no usable key. */
+    const void *key;
+    /* Index of item in batch. */
+    size_t idx;
+} we_BatchEntry;
+
+/* Get the key of the item at index idx. */
+typedef const void *(*we_BatchGetKey)(const void *items, size_t idx);
+/* Verify the entries in [start, end) setting ok[idx] to 1 when verified. */
+typedef void (*we_BatchVerifyRange)(const void *items,
+    const we_BatchEntry *entries, size_t start, size_t end, unsigned char *ok);
+
+int we_batch_verify(const void *items, size_t cnt, int threads,
+                    we_BatchGetKey getKey, we_BatchVerifyRange verify,
+                    unsigned char *results);
+#endif
+
 /*
  * RSA methods.
  */
@@ -129,9 +164,58 @@ int we_init_aesccm_meths(void);
 #ifdef WE_HAVE_RSA
 
 extern EVP_PKEY_METHOD *we_rsa_pkey_method;
+#ifdef WE_HAVE_RSA_PSS
+extern EVP_PKEY_METHOD *we_rsa_pss_pkey_method;
+#endif
 int we_init_rsa_pkey_meth(void);
 extern RSA_METHOD *we_rsa_method;
 int we_init_rsa_meth(void);
+int we_rsa_batch_verify(WE_RSA_BATCH_VERIFY *batch);
+int we_rsa_preload(RSA *rsa, int priv);
+#ifdef WOLFSSL_PUBLIC_MP
+BIGNUM *we_mp_to_bn(mp_int *mp);
+#endif
+
+/* Keys from pooled or parallel searched primes are calculated with wolfSSL's
+ * math functions which need to be public. */
+#if defined(WE_HAVE_THREADS) && defined(WOLFSSL_PUBLIC_MP)
+#define WE_HAVE_RSA_KEYGEN_THREADS
+int we_rsa_prime_pool_set_size(long size);
+int we_rsa_prime_pool_set_threads(long threads);
+void we_rsa_prime_pool_free(void);
+int we_rsa_prime_pool_keygen(int bits, long pubExp, RSA **rsa);
+int we_rsa_prime_pool_get_used(long *used);
+int we_rsa_keygen_set_threads(long threads);
+int we_rsa_parallel_keygen(int bits, long pubExp, RSA **rsa);
+#endif /* WE_HAVE_THREADS && WOLFSSL_PUBLIC_MP */
+
+/* Parallel CRT needs wolfSSL's math functions to be public. */
+#if defined(WE_HAVE_THREADS) && defined(WOLFSSL_PUBLIC_MP)
+#define WE_HAVE_RSA_PARALLEL_CRT
+int we_rsa_crt_set_parallel(long enable);
+int we_rsa_crt_set_cpu(long cpu);
+void we_rsa_crt_free(void);
+int we_rsa_crt_parallel_enabled(void);
+int we_rsa_crt_private(RsaKey *key, const unsigned char *in, word32 inLen,
+                       unsigned char *out, word32 outLen, WC_RNG *rng);
+#endif /* WE_HAVE_THREADS && WOLFSSL_PUBLIC_MP */
+
+/* Multi-prime keys need wolfSSL's math functions to be public and OpenSSL's
+ * multi-prime APIs. */
+#if defined(WOLFSSL_PUBLIC_MP) && OPENSSL_VERSION_NUMBER >= 0x10101000L
+#define WE_HAVE_RSA_MULTI_PRIME
+/* Maximum number of primes in an RSA key. */
+#define WE_RSA_MAX_PRIMES       4
+typedef struct we_RsaMultiPrime we_RsaMultiPrime;
+int we_rsa_multi_prime_max(int bits);
+int we_rsa_multi_prime_load(const RSA *rsa, RsaKey *key,
+                            we_RsaMultiPrime **mp);
+void we_rsa_multi_prime_free(we_RsaMultiPrime *mp);
+int we_rsa_multi_prime_private(RsaKey *key, we_RsaMultiPrime *mp,
+                               const unsigned char *in, word32 inLen,
+                               unsigned char *out, word32 outLen, WC_RNG *rng);
+int we_rsa_multi_prime_keygen(int bits, int primes, long pubExp, RSA **rsa);
+#endif /* WOLFSSL_PUBLIC_MP && OPENSSL_VERSION_NUMBER >= 0x10101000L */
 
 #endif /* WE_HAVE_RSA */
 
@@ -141,12 +225,113 @@ int we_init_rsa_meth(void);
 
 #ifdef WE_HAVE_EC_KEY
 extern EC_KEY_METHOD *we_ec_key_method;
-#endif
+int we_ec_key_preload(EC_KEY *ecKey, int priv);
+
+/* Precomputed ECDSA signing needs wolfSSL's math functions to be public. */
+#if defined(WE_HAVE_ECDSA) && defined(WOLFSSL_PUBLIC_MP)
+#define WE_HAVE_ECDSA_SIGN_SETUP
+/* Size in bytes of the largest supported curve - P-384. */
+#define WE_ECDSA_MAX_SZ         48
+int we_ecdsa_precompute(int curveId, WC_RNG *rng, unsigned char *kinv,
+                        unsigned char *r, unsigned char *blind);
+int we_ecdsa_sign_precomp(ecc_key *key, WC_RNG *rng, const unsigned char *dgst,
+                          int dLen, const unsigned char *kinv,
+                          const unsigned char *r, const unsigned char *blind,
+                          unsigned char *sig, word32 *sigLen);
+#ifdef WE_HAVE_THREADS
+#define WE_HAVE_ECDSA_SIGN_POOL
+int we_ecdsa_pool_set_size(long size);
+void we_ecdsa_pool_free(void);
+int we_ecdsa_pool_get(int curveId, unsigned char *kinv, unsigned char *r,
+                      unsigned char *blind);
+#endif /* WE_HAVE_THREADS */
+#endif /* WE_HAVE_ECDSA && WOLFSSL_PUBLIC_MP */
+#endif /* WE_HAVE_EC_KEY */
+
 extern EVP_PKEY_METHOD *we_ec_method;
 extern EVP_PKEY_METHOD *we_ec_p256_method;
 extern EVP_PKEY_METHOD *we_ec_p384_method;
 int we_init_ecc_meths(void);
+void we_ec_groups_free(void);
 int we_init_ec_key_meths(void);
+#if defined(WE_HAVE_ECC) && defined(WE_HAVE_ECDSA)
+int we_ecdsa_batch_verify(WE_ECDSA_BATCH_VERIFY *batch);
+#endif
+#if defined(WE_HAVE_ECC) && defined(WE_HAVE_ECKEYGEN)
+int we_ec_keygen_batch(WE_EC_KEYGEN_BATCH *batch);
+#endif
+#if defined(WE_HAVE_ECC) && defined(WE_HAVE_ECDH)
+int we_ecdh_multi_derive(WE_ECDH_MULTI_DERIVE *derive);
+#endif
+
+#if defined(WE_HAVE_ECC) && defined(WE_HAVE_EVP_PKEY) && defined(WE_HAVE_ECDSA)
+/* Cache of wolfSSL keys for frequently used public keys. */
+#define WE_HAVE_EC_PUB_CACHE
+int we_ec_pub_cache_set_size(long size);
+void we_ec_pub_cache_free(void);
+int we_ec_pub_cache_enabled(void);
+int we_ec_pub_cache_get(int curveId, const unsigned char *pub, int pubLen,
+                        ecc_key **key);
+void we_ec_pub_cache_lock(ecc_key *key);
+void we_ec_pub_cache_unlock(ecc_key *key);
+void we_ec_pub_cache_put(ecc_key *key);
+#endif /* WE_HAVE_ECC && WE_HAVE_EVP_PKEY && WE_HAVE_ECDSA */
+
+#if defined(WE_HAVE_ECC) && defined(WE_HAVE_THREADS)
+/* Pool of pre-generated key pairs for ephemeral keys. */
+#define WE_HAVE_EC_KEY_POOL
+/* Size in bytes of the largest supported curve - P-384. */
+#define WE_EC_KEY_POOL_MAX_SZ   48
+int we_ec_key_pool_set_size(long size);
+int we_ec_key_pool_set_low(long low);
+void we_ec_key_pool_free(void);
+int we_ec_key_pool_get(int curveId, ecc_key *key);
+#endif /* WE_HAVE_ECC && WE_HAVE_THREADS */
+
+#if defined(WE_HAVE_ECC) && defined(WE_HAVE_ECDH) && defined(HAVE_X963_KDF)
+/* ANSI X9.63 KDF applied to the shared secret when deriving. */
+#define WE_HAVE_ECDH_X963_KDF
+#endif /* WE_HAVE_ECC && WE_HAVE_ECDH && HAVE_X963_KDF */
+
+#if defined(WE_HAVE_RSA) || defined(WE_HAVE_ECC)
+/* Keys loaded once by ID and held decoded for ENGINE_load_private_key(). */
+#define WE_HAVE_KEYSTORE
+int we_keystore_set_dir(const char *dir);
+void we_keystore_flush(void);
+void we_keystore_free(void);
+EVP_PKEY *we_keystore_load_privkey(ENGINE *e, const char *id,
+                                   UI_METHOD *uiMethod, void *cbData);
+EVP_PKEY *we_keystore_load_pubkey(ENGINE *e, const char *id,
+                                  UI_METHOD *uiMethod, void *cbData);
+#endif /* WE_HAVE_RSA || WE_HAVE_ECC */
+
+#if defined(WE_HAVE_KEYD) && !defined(WE_HAVE_KEYSTORE)
+/* Keys held by the key daemon are loaded through the keystore. */
+#undef WE_HAVE_KEYD
+#endif
+#ifdef WE_HAVE_KEYD
+/* Private key operations forwarded to the key daemon over a Unix socket. */
+#include "we_keyd.h"
+int we_keyd_set_socket(const char *path);
+void we_keyd_free(void);
+int we_keyd_enabled(void);
+EVP_PKEY *we_keyd_get_public(const char *id);
+int we_keyd_set_key_id(EVP_PKEY *pkey, const char *id);
+#ifdef WE_HAVE_RSA
+const char *we_keyd_rsa_key_id(const RSA *rsa);
+int we_keyd_rsa_sign(const char *id, int padding, const EVP_MD *md,
+                     const EVP_MD *mgf1Md, int saltLen,
+                     const unsigned char *tbs, size_t tbsLen,
+                     unsigned char *sig, size_t *sigLen);
+int we_keyd_rsa_decrypt(const char *id, int padding, const unsigned char *in,
+                        size_t inLen, unsigned char *out, size_t *outLen);
+#endif /* WE_HAVE_RSA */
+#ifdef WE_HAVE_ECC
+const char *we_keyd_ec_key_id(const EC_KEY *ecKey);
+int we_keyd_ecdsa_sign(const char *id, const unsigned char *dgst,
+                       size_t dgstLen, unsigned char *sig, size_t *sigLen);
+#endif /* WE_HAVE_ECC */
+#endif /* WE_HAVE_KEYD */
 
 int wolfengine_bind(ENGINE *e, const char *id);
 
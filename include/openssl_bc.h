@@ -94,15 +94,16 @@ void EVP_CIPHER_meth_free(EVP_CIPHER *cipher);
 RSA *EVP_PKEY_get0_RSA(EVP_PKEY *pkey);
 EC_KEY *EVP_PKEY_get0_EC_KEY(EVP_PKEY *pkey);
 
-size_t EC_KEY_priv2buf(const EC_KEY *eckey, unsigned char **pbuf);
-size_t EC_KEY_key2buf(const EC_KEY *key, point_conversion_form_t form,
-                      unsigned char **pbuf, BN_CTX *ctx);
+size_t EC_KEY_priv2oct(const EC_KEY *eckey, unsigned char *buf, size_t len);
 int EC_KEY_oct2key(EC_KEY *key, const unsigned char *buf, size_t len,
                    BN_CTX *ctx);
 int EC_KEY_oct2priv(EC_KEY *eckey, const unsigned char *buf, size_t len);
 
 void RSA_get0_key(const RSA *r,
                   const BIGNUM **n, const BIGNUM **e, const BIGNUM **d);
+int RSA_set0_key(RSA *r, BIGNUM *n, BIGNUM *e, BIGNUM *d);
+int RSA_set0_factors(RSA *r, BIGNUM *p, BIGNUM *q);
+int RSA_set0_crt_params(RSA *r, BIGNUM *dmp1, BIGNUM *dmq1, BIGNUM *iqmp);
 RSA_METHOD *RSA_meth_new(const char *name, int flags);
 void RSA_meth_free(RSA_METHOD *meth);
 int RSA_meth_set_init(RSA_METHOD *meth, int (*init) (RSA *rsa));
@@ -122,6 +123,16 @@ int RSA_meth_set_priv_dec(RSA_METHOD *meth,
                           int (*priv_dec) (int flen, const unsigned char *from,
                                            unsigned char *to, RSA *rsa,
                                            int padding));
+int RSA_meth_set_sign(RSA_METHOD *meth,
+                      int (*sign) (int type, const unsigned char *m,
+                                   unsigned int m_length,
+                                   unsigned char *sigret, unsigned int *siglen,
+                                   const RSA *rsa));
+int RSA_meth_set_verify(RSA_METHOD *meth,
+                        int (*verify) (int dtype, const unsigned char *m,
+                                       unsigned int m_length,
+                                       const unsigned char *sigbuf,
+                                       unsigned int siglen, const RSA *rsa));
 int RSA_meth_set_finish(RSA_METHOD *meth, int (*finish) (RSA *rsa));
 
 #endif /* OPENSSL_VERSION_NUMBER < 0x10100000L */
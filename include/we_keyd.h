@@ -0,0 +1,107 @@
+/* we_keyd.h
+ *
+ * Copyright (C) 2019-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfengine.
+ *
+ * wolfengine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfengine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WE_KEYD_H
+#define WE_KEYD_H
+
+/* Protocol between wolfEngine and the key daemon over a Unix socket.
+ *
+ * A request is a fixed size header followed by the key identifier and the
+ * data. A response is a fixed size header followed by the data. All integers
+ * are big-endian.
+ *
+ * Each request carries a sequence number that is returned in the response.
+ * Requests may be pipelined on a connection and responses are returned in the
+ * order operations complete. wolfEngine shares a few connections between the
+ * application's threads and has many requests outstanding on each.
+ *
+ * Request header:
+ *   0 - 3   Sequence number
+ *   4       Operation - WE_KEYD_OP_*
+ *   5       RSA padding mode - RSA_*_PADDING
+ *   6       Length of key identifier
+ *   7       Reserved - zero
+ *   8 - 11  NID of signature digest - 0 when data is signed as is
+ *   12 - 15 NID of MGF1 digest for PSS - 0 for the signature digest
+ *   16 - 19 PSS salt length - RSA_PSS_SALTLEN_* special values allowed
+ *   20 - 23 Length of data
+ *
+ * Response header:
+ *   0 - 3   Sequence number of request
+ *   4       Status - WE_KEYD_STATUS_*
+ *   5 - 7   Reserved - zero
+ *   8 - 11  Length of data
+ */
+
+/* Get the public key as a DER encoded SubjectPublicKeyInfo. No data. */
+#define WE_KEYD_OP_PUBKEY           1
+/* Sign digest, or DigestInfo when no digest NID, with an RSA key. */
+#define WE_KEYD_OP_RSA_SIGN         2
+/* Decrypt data with an RSA key. */
+#define WE_KEYD_OP_RSA_DECRYPT      3
+/* Sign digest with an EC key. Returns DER encoded ECDSA signature. */
+#define WE_KEYD_OP_ECDSA_SIGN       4
+
+/* Operation performed. */
+#define WE_KEYD_STATUS_OK           0
+/* Operation failed - no data. */
+#define WE_KEYD_STATUS_ERROR        1
+
+/* Size of request header in bytes. */
+#define WE_KEYD_REQ_HDR_SZ          24
+/* Size of response header in bytes. */
+#define WE_KEYD_RSP_HDR_SZ          12
+/* Maximum length of a key identifier. */
+#define WE_KEYD_MAX_ID_SZ           255
+/* Maximum length of request or response data - RSA 4096-bit public key. */
+#define WE_KEYD_MAX_DATA_SZ         2048
+
+/* Offsets of request header fields. */
+#define WE_KEYD_REQ_SEQ             0
+#define WE_KEYD_REQ_OP              4
+#define WE_KEYD_REQ_PADDING         5
+#define WE_KEYD_REQ_ID_LEN          6
+#define WE_KEYD_REQ_MD_NID          8
+#define WE_KEYD_REQ_MGF1_NID        12
+#define WE_KEYD_REQ_SALT_LEN        16
+#define WE_KEYD_REQ_DATA_LEN        20
+
+/* Offsets of response header fields. */
+#define WE_KEYD_RSP_SEQ             0
+#define WE_KEYD_RSP_STATUS          4
+#define WE_KEYD_RSP_DATA_LEN        8
+
+/* Encode a 32-bit value big-endian into buffer. */
+#define WE_KEYD_PUT32(b, v)                                                   \
+    do {                                                                      \
+        (b)[0] = (unsigned char)((unsigned int)(v) >> 24);                    \
+        (b)[1] = (unsigned char)((unsigned int)(v) >> 16);                    \
+        (b)[2] = (unsigned char)((unsigned int)(v) >>  8);                    \
+        (b)[3] = (unsigned char)((unsigned int)(v)      );                    \
+    }                                                                         \
+    while (0)
+
+/* Decode a big-endian 32-bit value from buffer. */
+#define WE_KEYD_GET32(b)                                                      \
+    (((unsigned int)(b)[0] << 24) | ((unsigned int)(b)[1] << 16) |            \
+     ((unsigned int)(b)[2] <<  8) | ((unsigned int)(b)[3]      ))
+
+#endif /* WE_KEYD_H */
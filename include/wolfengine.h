@@ -25,6 +25,9 @@
 /* OpenSSL 3.0.0 has deprecated the ENGINE API. */
 #define OPENSSL_API_COMPAT      10101
 
+#include <stddef.h>
+#include <openssl/evp.h>
+
 /* This is the ID expected by OpenSSL when loading wolfEngine dynamically. */
 extern const char *wolfengine_lib;
 /* Engine id - implementation uses wolfSSL */
@@ -34,4 +37,130 @@ extern const char *wolfengine_name;
 
 void ENGINE_load_wolfengine(void);
 
+/**
+ * RSA PKCS #1 v1.5 signature to verify as part of a batch.
+ */
+typedef struct WE_RSA_VERIFY_ITEM {
+    /* RSA public key to verify with. */
+    EVP_PKEY *pkey;
+    /* Digest of DigestInfo. NULL when raw data was signed. */
+    const EVP_MD *md;
+    /* Digest, or raw data, that was signed. */
+    const unsigned char *digest;
+    /* Length of digest in bytes. */
+    size_t digestLen;
+    /* Signature to verify. */
+    const unsigned char *sig;
+    /* Length of signature in bytes. */
+    size_t sigLen;
+} WE_RSA_VERIFY_ITEM;
+
+/**
+ * Batch of RSA signatures to verify with the "rsa_batch_verify" control
+ * command:
+ *   ENGINE_ctrl_cmd(e, "rsa_batch_verify", 0, &batch, NULL, 0)
+ * Each signature is verified individually - on threads in parallel when
+ * threads is greater than 1.
+ */
+typedef struct WE_RSA_BATCH_VERIFY {
+    /* Signatures to verify. */
+    const WE_RSA_VERIFY_ITEM *items;
+    /* Number of items. */
+    size_t cnt;
+    /* Result bitmap of (cnt + 7) / 8 bytes. Bit (i % 8) of byte (i / 8) is
+       set when item i verified. */
+    unsigned char *results;
+    /* Number of threads to verify on. 0 or 1 verifies on calling thread. */
+    int threads;
+} WE_RSA_BATCH_VERIFY;
+
+/**
+ * ECDSA signature to verify as part of a batch.
+ */
+typedef struct WE_ECDSA_VERIFY_ITEM {
+    /* EC public key to verify with. */
+    EVP_PKEY *pkey;
+    /* Digest that was signed. */
+    const unsigned char *digest;
+    /* Length of digest in bytes. */
+    size_t digestLen;
+    /* DER encoded signature to verify. */
+    const unsigned char *sig;
+    /* Length of signature in bytes. */
+    size_t sigLen;
+} WE_ECDSA_VERIFY_ITEM;
+
+/**
+ * Batch of ECDSA signatures to verify with the "ecdsa_batch_verify" control
+ * command:
+ *   ENGINE_ctrl_cmd(e, "ecdsa_batch_verify", 0, &batch, NULL, 0)
+ * Each signature is verified individually - on threads in parallel when
+ * threads is greater than 1.
+ */
+typedef struct WE_ECDSA_BATCH_VERIFY {
+    /* Signatures to verify. */
+    const WE_ECDSA_VERIFY_ITEM *items;
+    /* Number of items. */
+    size_t cnt;
+    /* Result bitmap of (cnt + 7) / 8 bytes. Bit (i % 8) of byte (i / 8) is
+       set when item i verified. */
+    unsigned char *results;
+    /* Number of threads to verify on. 0 or 1 verifies on calling thread. */
+    int threads;
+} WE_ECDSA_BATCH_VERIFY;
+
+/**
+ * Batch of EC key pairs to generate with the "ec_keygen_batch" control
+ * command:
+ *   ENGINE_ctrl_cmd(e, "ec_keygen_batch", 0, &batch, NULL, 0)
+ * At least one of raw and pkeys must be set.
+ */
+typedef struct WE_EC_KEYGEN_BATCH {
+    /* OpenSSL curve name (NID) of key pairs - P-256 or P-384. */
+    int curveNid;
+    /* Number of key pairs to generate. */
+    size_t cnt;
+    /* Raw key pairs output - cnt * 3 * curve size bytes. Each key pair is
+       x | y | d, each big-endian and padded to the size of the curve.
+       NULL when not required. */
+    unsigned char *raw;
+    /* New EVP_PKEY objects output - cnt pointers. NULL when not required. */
+    EVP_PKEY **pkeys;
+    /* Number of threads to generate on. 0 or 1 generates on calling thread.
+       */
+    int threads;
+} WE_EC_KEYGEN_BATCH;
+
+/**
+ * Peer's public key to derive an ECDH secret with.
+ */
+typedef struct WE_ECDH_PEER {
+    /* Peer's public key as an encoded EC point (X9.63 octet string). */
+    const unsigned char *point;
+    /* Length of encoded point in bytes. */
+    size_t pointLen;
+} WE_ECDH_PEER;
+
+/**
+ * One private key and many peers to derive ECDH secrets with using the
+ * "ecdh_multi_derive" control command:
+ *   ENGINE_ctrl_cmd(e, "ecdh_multi_derive", 0, &derive, NULL, 0)
+ */
+typedef struct WE_ECDH_MULTI_DERIVE {
+    /* EC private key - P-256 or P-384. */
+    EVP_PKEY *pkey;
+    /* Peers' public keys on the same curve as the private key. */
+    const WE_ECDH_PEER *peers;
+    /* Number of peers. */
+    size_t cnt;
+    /* Secrets output - cnt * curve size bytes. Secret of peer i is at
+       offset i * curve size. Zeroized when derivation with peer failed. */
+    unsigned char *secrets;
+    /* Result bitmap of (cnt + 7) / 8 bytes. Bit (i % 8) of byte (i / 8) is
+       set when secret with peer i was derived. */
+    unsigned char *results;
+    /* Number of threads to derive on. 0 or 1 derives on calling thread. */
+    int threads;
+} WE_ECDH_MULTI_DERIVE;
+
 #endif /* WOLFENGINE_H */
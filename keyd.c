@@ -0,0 +1,824 @@
+/* keyd.c
+ *
+ * Copyright (C) 2019-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfengine.
+ *
+ * wolfengine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfengine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Key daemon - holds private keys and performs private key operations for
+ * applications using wolfEngine with the keyd_socket control command set.
+ *
+ * Each connection has a reader thread that queues requests. The queue is
+ * capped and readers stop reading while it is full. Worker threads take the
+ * queued requests in batches, perform the operations with wolfEngine and
+ * write the responses of each connection in the batch in one write.
+ * Responses are returned as operations complete so requests pipelined on a
+ * connection may be answered out of order.
+ *
+ * Each worker loads its own key objects so that no wolfSSL key is used by two
+ * threads at once.
+ *
+ * SIGINT and SIGTERM are blocked in all threads and taken by a signal thread
+ * with sigwait(). It wakes the accept loop through a pipe.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "wolfengine.h"
+
+#include <openssl/engine.h>
+#include <openssl/evp.h>
+#include <openssl/ec.h>
+#include <openssl/rsa.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include "openssl_bc.h"
+#include "we_keyd.h"
+
+/* Maximum number of requests taken by a worker at once. */
+#define KEYD_MAX_BATCH      256
+/* Number of keys kept loaded by each worker. */
+#define KEYD_WORKER_KEYS    8
+/* Milliseconds to wait before accepting again when out of descriptors. */
+#define KEYD_ACCEPT_BACKOFF 100
+
+/* Connection from a client. */
+typedef struct KEYD_CONN {
+    /* Socket of connection. */
+    int fd;
+    /* Serializes writing of responses. */
+    pthread_mutex_t writeMutex;
+    /* Reader and queued requests holding connection. Protected by queue
+     * mutex. */
+    int refs;
+} KEYD_CONN;
+
+/* Queued request and its response. */
+typedef struct KEYD_REQ {
+    /* Connection request was received on. */
+    KEYD_CONN *conn;
+    /* Sequence number of request. */
+    unsigned int seq;
+    /* Operation - WE_KEYD_OP_*. */
+    int op;
+    /* RSA padding mode. */
+    int padding;
+    /* NID of signature digest. */
+    int mdNid;
+    /* NID of MGF1 digest. */
+    int mgf1Nid;
+    /* PSS salt length. */
+    int saltLen;
+    /* Key identifier - NUL terminated. */
+    char id[WE_KEYD_MAX_ID_SZ + 1];
+    /* Data of request. */
+    unsigned char data[WE_KEYD_MAX_DATA_SZ];
+    /* Length of data in bytes. */
+    size_t dataLen;
+    /* Encoded response. */
+    unsigned char rsp[WE_KEYD_RSP_HDR_SZ + WE_KEYD_MAX_DATA_SZ];
+    /* Length of encoded response in bytes. 0 once written. */
+    size_t rspLen;
+    /* Next request in queue or batch. */
+    struct KEYD_REQ *next;
+} KEYD_REQ;
+
+/* Key loaded by a worker. */
+typedef struct KEYD_KEY {
+    /* Key identifier - NUL terminated. Empty when slot unused. */
+    char id[WE_KEYD_MAX_ID_SZ + 1];
+    /* Key object owned by the worker. */
+    EVP_PKEY *pkey;
+} KEYD_KEY;
+
+/* Engine performing operations. */
+static ENGINE *keyd_engine = NULL;
+/* Maximum number of requests in a batch. */
+static int keyd_batch = 16;
+/* Maximum number of requests queued. */
+static int keyd_queue_max = 1024;
+
+/* Protects the request queue and connection reference counts. */
+static pthread_mutex_t keyd_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Signals requests queued or stopping. */
+static pthread_cond_t keyd_cond = PTHREAD_COND_INITIALIZER;
+/* Signals space in queue or stopping. */
+static pthread_cond_t keyd_space_cond = PTHREAD_COND_INITIALIZER;
+/* First request in queue. */
+static KEYD_REQ *keyd_head = NULL;
+/* Last request in queue. */
+static KEYD_REQ *keyd_tail = NULL;
+/* Number of requests in queue. */
+static int keyd_queued = 0;
+/* Indicates workers are to stop. */
+static int keyd_stopping = 0;
+
+/* Pipe written to by the signal thread to stop accepting connections. */
+static int keyd_stop_pipe[2] = { -1, -1 };
+
+/* Wait for SIGINT or SIGTERM and wake the accept loop. */
+static void *keyd_signal_thread(void *arg)
+{
+    sigset_t *set = (sigset_t *)arg;
+    int sig;
+
+    if (sigwait(set, &sig) == 0) {
+        while (write(keyd_stop_pipe[1], "", 1) < 0 && errno == EINTR) {
+        }
+    }
+
+    return NULL;
+}
+
+static int keyd_write_all(int fd, const unsigned char *buf, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+
+    return len != 0;
+}
+
+static int keyd_read_all(int fd, unsigned char *buf, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        n = recv(fd, buf, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+
+    return len != 0;
+}
+
+/* Release a reference to the connection - closed when last released. */
+static void keyd_conn_put(KEYD_CONN *conn)
+{
+    int last;
+
+    pthread_mutex_lock(&keyd_mutex);
+    last = (--conn->refs == 0);
+    pthread_mutex_unlock(&keyd_mutex);
+
+    if (last) {
+        close(conn->fd);
+        pthread_mutex_destroy(&conn->writeMutex);
+        free(conn);
+    }
+}
+
+/* Read requests from the connection and queue them for the workers. */
+static void *keyd_reader(void *arg)
+{
+    KEYD_CONN *conn = (KEYD_CONN *)arg;
+    KEYD_REQ *req;
+    unsigned char hdr[WE_KEYD_REQ_HDR_SZ];
+    size_t idLen;
+    int err = 0;
+
+    while (err == 0) {
+        err = keyd_read_all(conn->fd, hdr, sizeof(hdr));
+        if (err == 0) {
+            idLen = hdr[WE_KEYD_REQ_ID_LEN];
+            req = (KEYD_REQ *)malloc(sizeof(*req));
+            err = req == NULL;
+        }
+        if (err == 0) {
+            req->conn = conn;
+            req->seq = WE_KEYD_GET32(hdr + WE_KEYD_REQ_SEQ);
+            req->op = hdr[WE_KEYD_REQ_OP];
+            req->padding = hdr[WE_KEYD_REQ_PADDING];
+            req->mdNid = (int)WE_KEYD_GET32(hdr + WE_KEYD_REQ_MD_NID);
+            req->mgf1Nid = (int)WE_KEYD_GET32(hdr + WE_KEYD_REQ_MGF1_NID);
+            req->saltLen = (int)WE_KEYD_GET32(hdr + WE_KEYD_REQ_SALT_LEN);
+            req->dataLen = WE_KEYD_GET32(hdr + WE_KEYD_REQ_DATA_LEN);
+            req->rspLen = 0;
+            req->next = NULL;
+            /* Stream can't be resynchronized after a bad header. */
+            err = idLen == 0 || req->dataLen > sizeof(req->data);
+            if (err == 0) {
+                err = keyd_read_all(conn->fd, (unsigned char *)req->id,
+                                    idLen);
+            }
+            if (err == 0) {
+                req->id[idLen] = '\0';
+                err = keyd_read_all(conn->fd, req->data, req->dataLen);
+            }
+            if (err != 0) {
+                free(req);
+            }
+        }
+        if (err == 0) {
+            pthread_mutex_lock(&keyd_mutex);
+            /* Stop reading from client while queue is full. */
+            while (keyd_queued >= keyd_queue_max && !keyd_stopping) {
+                pthread_cond_wait(&keyd_space_cond, &keyd_mutex);
+            }
+            err = keyd_stopping;
+            if (err == 0) {
+                conn->refs++;
+                if (keyd_tail == NULL) {
+                    keyd_head = req;
+                }
+                else {
+                    keyd_tail->next = req;
+                }
+                keyd_tail = req;
+                keyd_queued++;
+                pthread_cond_signal(&keyd_cond);
+            }
+            pthread_mutex_unlock(&keyd_mutex);
+            if (err != 0) {
+                free(req);
+            }
+        }
+    }
+
+    keyd_conn_put(conn);
+
+    return NULL;
+}
+
+/* Sign with an RSA or EC key through the engine's EVP_PKEY methods. */
+static int keyd_sign(KEYD_REQ *req, EVP_PKEY *pkey, unsigned char *out,
+                     size_t *outLen)
+{
+    int err;
+    EVP_PKEY_CTX *ctx;
+    const EVP_MD *md;
+
+    err = (ctx = EVP_PKEY_CTX_new(pkey, keyd_engine)) == NULL;
+    if (err == 0) {
+        err = EVP_PKEY_sign_init(ctx) != 1;
+    }
+    if (err == 0 && req->op == WE_KEYD_OP_RSA_SIGN) {
+        err = EVP_PKEY_CTX_set_rsa_padding(ctx, req->padding) != 1;
+        if (err == 0 && req->mdNid != 0) {
+            err = (md = EVP_get_digestbynid(req->mdNid)) == NULL;
+            if (err == 0) {
+                err = EVP_PKEY_CTX_set_signature_md(ctx, md) != 1;
+            }
+        }
+        if (err == 0 && req->padding == RSA_PKCS1_PSS_PADDING) {
+            if (req->mgf1Nid != 0) {
+                err = (md = EVP_get_digestbynid(req->mgf1Nid)) == NULL;
+                if (err == 0) {
+                    err = EVP_PKEY_CTX_set_rsa_mgf1_md(ctx, md) != 1;
+                }
+            }
+            if (err == 0) {
+                err = EVP_PKEY_CTX_set_rsa_pss_saltlen(ctx, req->saltLen) != 1;
+            }
+        }
+    }
+    if (err == 0) {
+        err = EVP_PKEY_sign(ctx, out, outLen, req->data, req->dataLen) != 1;
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+
+    return err;
+}
+
+/* Perform the operation of the request with the key and encode response. */
+static void keyd_process(KEYD_REQ *req, EVP_PKEY *pkey)
+{
+    int err;
+    unsigned char *out = req->rsp + WE_KEYD_RSP_HDR_SZ;
+    size_t outLen = WE_KEYD_MAX_DATA_SZ;
+    int len;
+
+    err = pkey == NULL;
+    if (err == 0) {
+        switch (req->op) {
+            case WE_KEYD_OP_PUBKEY:
+                len = i2d_PUBKEY(pkey, NULL);
+                err = len <= 0 || len > WE_KEYD_MAX_DATA_SZ;
+                if (err == 0) {
+                    outLen = (size_t)i2d_PUBKEY(pkey, &out);
+                }
+                break;
+            case WE_KEYD_OP_RSA_SIGN:
+                err = EVP_PKEY_base_id(pkey) != EVP_PKEY_RSA;
+                if (err == 0) {
+                    err = keyd_sign(req, pkey, out, &outLen);
+                }
+                break;
+            case WE_KEYD_OP_RSA_DECRYPT:
+                err = EVP_PKEY_base_id(pkey) != EVP_PKEY_RSA;
+                if (err == 0) {
+                    len = RSA_private_decrypt((int)req->dataLen, req->data,
+                        out, (RSA *)EVP_PKEY_get0_RSA(pkey), req->padding);
+                    err = len < 0;
+                    outLen = (size_t)len;
+                }
+                break;
+            case WE_KEYD_OP_ECDSA_SIGN:
+                err = EVP_PKEY_base_id(pkey) != EVP_PKEY_EC;
+                if (err == 0) {
+                    err = keyd_sign(req, pkey, out, &outLen);
+                }
+                break;
+            default:
+                err = 1;
+                break;
+        }
+    }
+    if (err != 0) {
+        outLen = 0;
+    }
+
+    memset(req->rsp, 0, WE_KEYD_RSP_HDR_SZ);
+    WE_KEYD_PUT32(req->rsp + WE_KEYD_RSP_SEQ, req->seq);
+    req->rsp[WE_KEYD_RSP_STATUS] = (err == 0) ? WE_KEYD_STATUS_OK :
+                                                WE_KEYD_STATUS_ERROR;
+    WE_KEYD_PUT32(req->rsp + WE_KEYD_RSP_DATA_LEN, outLen);
+    req->rspLen = WE_KEYD_RSP_HDR_SZ + outLen;
+
+    /* Plaintext or digest not needed any more. */
+    OPENSSL_cleanse(req->data, req->dataLen);
+}
+
+/* Write the responses of the batch - one write per connection. */
+static void keyd_respond(KEYD_REQ *batch, unsigned char *buf)
+{
+    KEYD_REQ *req;
+    KEYD_REQ *other;
+    size_t len;
+
+    for (req = batch; req != NULL; req = req->next) {
+        if (req->rspLen == 0) {
+            continue;
+        }
+
+        /* Gather responses to the same connection. */
+        len = 0;
+        for (other = req; other != NULL; other = other->next) {
+            if (other->conn == req->conn && other->rspLen > 0) {
+                memcpy(buf + len, other->rsp, other->rspLen);
+                len += other->rspLen;
+                other->rspLen = 0;
+            }
+        }
+
+        /* Failure is seen by the reader when the client has gone. */
+        pthread_mutex_lock(&req->conn->writeMutex);
+        keyd_write_all(req->conn->fd, buf, len);
+        pthread_mutex_unlock(&req->conn->writeMutex);
+        OPENSSL_cleanse(buf, len);
+    }
+}
+
+/* Get the worker's key object for the identifier, loading it when not
+ * loaded. The least recently loaded key is dropped when all slots are used. */
+static EVP_PKEY *keyd_worker_key(KEYD_KEY *keys, int *next, const char *id)
+{
+    EVP_PKEY *pkey = NULL;
+    int i;
+
+    for (i = 0; i < KEYD_WORKER_KEYS; i++) {
+        if (keys[i].pkey != NULL && strcmp(keys[i].id, id) == 0) {
+            pkey = keys[i].pkey;
+            break;
+        }
+    }
+    if (pkey == NULL) {
+        /* Keystore decodes a new key object for each load. */
+        pkey = ENGINE_load_private_key(keyd_engine, id, NULL, NULL);
+        if (pkey != NULL) {
+            i = *next;
+            EVP_PKEY_free(keys[i].pkey);
+            keys[i].pkey = pkey;
+            strcpy(keys[i].id, id);
+            *next = (i + 1) % KEYD_WORKER_KEYS;
+        }
+    }
+
+    return pkey;
+}
+
+/* Take batches of requests from the queue and process them. */
+static void *keyd_worker(void *arg)
+{
+    unsigned char *buf;
+    KEYD_REQ *batch;
+    KEYD_REQ *req;
+    KEYD_KEY keys[KEYD_WORKER_KEYS];
+    int next = 0;
+    int n;
+
+    (void)arg;
+
+    buf = (unsigned char *)malloc((size_t)keyd_batch *
+                                  (WE_KEYD_RSP_HDR_SZ + WE_KEYD_MAX_DATA_SZ));
+    if (buf == NULL) {
+        fprintf(stderr, "Failed to allocate response buffer\n");
+        return NULL;
+    }
+    memset(keys, 0, sizeof(keys));
+
+    for (;;) {
+        pthread_mutex_lock(&keyd_mutex);
+        while (keyd_head == NULL && !keyd_stopping) {
+            pthread_cond_wait(&keyd_cond, &keyd_mutex);
+        }
+        if (keyd_head == NULL) {
+            pthread_mutex_unlock(&keyd_mutex);
+            break;
+        }
+        /* Take all queued requests up to the batch size. */
+        batch = keyd_head;
+        for (req = batch, n = 1; req->next != NULL && n < keyd_batch; n++) {
+            req = req->next;
+        }
+        keyd_head = req->next;
+        if (keyd_head == NULL) {
+            keyd_tail = NULL;
+        }
+        req->next = NULL;
+        keyd_queued -= n;
+        pthread_cond_broadcast(&keyd_space_cond);
+        pthread_mutex_unlock(&keyd_mutex);
+
+        for (req = batch; req != NULL; req = req->next) {
+            keyd_process(req, keyd_worker_key(keys, &next, req->id));
+        }
+
+        keyd_respond(batch, buf);
+
+        while (batch != NULL) {
+            req = batch;
+            batch = batch->next;
+            keyd_conn_put(req->conn);
+            free(req);
+        }
+    }
+
+    for (n = 0; n < KEYD_WORKER_KEYS; n++) {
+        EVP_PKEY_free(keys[n].pkey);
+    }
+    free(buf);
+
+    return NULL;
+}
+
+/* Accept a connection and start a reader for it. Returns 1 when accepting
+ * can't continue. */
+static int keyd_accept(int fd)
+{
+    int err = 0;
+    int connFd;
+    KEYD_CONN *conn = NULL;
+    pthread_t thread;
+    struct pollfd stop;
+
+    connFd = accept(fd, NULL, NULL);
+    if (connFd < 0 && (errno == EMFILE || errno == ENFILE ||
+                       errno == ENOBUFS || errno == ENOMEM)) {
+        /* Back off until connections close - wake early to stop. */
+        fprintf(stderr, "Failed to accept: %s\n", strerror(errno));
+        stop.fd = keyd_stop_pipe[0];
+        stop.events = POLLIN;
+        poll(&stop, 1, KEYD_ACCEPT_BACKOFF);
+    }
+    else if (connFd < 0 && errno != EINTR && errno != ECONNABORTED &&
+             errno != EAGAIN && errno != EWOULDBLOCK && errno != EPROTO) {
+        fprintf(stderr, "Failed to accept: %s\n", strerror(errno));
+        err = 1;
+    }
+    if (connFd >= 0) {
+        /* Listening socket is non-blocking but reader blocks. */
+        fcntl(connFd, F_SETFL, fcntl(connFd, F_GETFL) & ~O_NONBLOCK);
+        conn = (KEYD_CONN *)malloc(sizeof(*conn));
+    }
+    if (conn != NULL) {
+        conn->fd = connFd;
+        conn->refs = 1;
+        pthread_mutex_init(&conn->writeMutex, NULL);
+        if (pthread_create(&thread, NULL, keyd_reader, conn) != 0) {
+            pthread_mutex_destroy(&conn->writeMutex);
+            free(conn);
+            conn = NULL;
+        }
+        else {
+            pthread_detach(thread);
+        }
+    }
+    if (connFd >= 0 && conn == NULL) {
+        close(connFd);
+    }
+
+    return err;
+}
+
+/* Accept connections until signalled, starting a reader for each. */
+static int keyd_serve(const char *path)
+{
+    int err;
+    int fd = -1;
+    struct sockaddr_un addr;
+    struct pollfd fds[2];
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    err = strlen(path) >= sizeof(addr.sun_path);
+    if (err != 0) {
+        fprintf(stderr, "Socket path too long\n");
+    }
+    if (err == 0) {
+        strcpy(addr.sun_path, path);
+        err = (fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0;
+    }
+    if (err == 0) {
+        unlink(path);
+        /* Only the owner may connect and use the keys. */
+        umask(077);
+        err = bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0;
+        if (err == 0) {
+            err = listen(fd, SOMAXCONN) != 0;
+        }
+        if (err == 0) {
+            /* Readiness may be gone by the time accept() is called. */
+            err = fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0;
+        }
+        if (err != 0) {
+            fprintf(stderr, "Failed to listen on %s: %s\n", path,
+                    strerror(errno));
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    if (err == 0) {
+        fds[0].fd = fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = keyd_stop_pipe[0];
+        fds[1].events = POLLIN;
+    }
+    while (err == 0) {
+        if (poll(fds, 2, -1) < 0) {
+            err = errno != EINTR;
+            continue;
+        }
+        if (fds[1].revents != 0) {
+            /* Signalled to stop. */
+            break;
+        }
+        if (fds[0].revents != 0) {
+            err = keyd_accept(fd);
+        }
+    }
+
+    if (fd >= 0) {
+        close(fd);
+        unlink(path);
+    }
+
+    return err;
+}
+
+static void usage(void)
+{
+    printf("\n");
+    printf("Usage: keyd [options]\n");
+    printf("  --help           Show this usage information.\n");
+    printf("  --socket <path>  Unix socket to listen on. Required.\n");
+    printf("  --keys <path>    Directory of DER key files. Required.\n");
+    printf("  --threads <num>  Number of worker threads. Default: 4\n");
+    printf("  --batch <num>    Maximum requests processed at once by a\n");
+    printf("                   worker. Default: 16\n");
+    printf("  --queue <num>    Maximum requests queued. Default: 1024\n");
+    printf("  --static         Use the static engine.\n");
+    printf("  --dir <path>     Location of wolfengine shared library.\n");
+    printf("                   Default: .libs\n");
+    printf("  --engine <str>   Engine name. Default: libwolfengine\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int err = 0;
+    ENGINE *e = NULL;
+#ifdef WE_NO_DYNAMIC_ENGINE
+    int staticEngine = 1;
+    const char *name = wolfengine_id;
+#else
+    int staticEngine = 0;
+    const char *name = wolfengine_lib;
+#endif /* WE_NO_DYNAMIC_ENGINE */
+    const char *dir = ".libs";
+    const char *sockPath = NULL;
+    const char *keysDir = NULL;
+    int threads = 4;
+    pthread_t *workers = NULL;
+    int started = 0;
+    int init = 0;
+    int i;
+    sigset_t sigs;
+    pthread_t sigThread;
+    int sigStarted = 0;
+
+    for (--argc, ++argv; err == 0 && argc > 0; argc--, argv++) {
+        if (strncmp(*argv, "--help", 7) == 0) {
+            usage();
+            return 0;
+        }
+        else if (strncmp(*argv, "--static", 9) == 0) {
+            staticEngine = 1;
+        }
+        else if (argc > 1 && strncmp(*argv, "--socket", 9) == 0) {
+            sockPath = *(++argv);
+            argc--;
+        }
+        else if (argc > 1 && strncmp(*argv, "--keys", 7) == 0) {
+            keysDir = *(++argv);
+            argc--;
+        }
+        else if (argc > 1 && strncmp(*argv, "--threads", 10) == 0) {
+            threads = atoi(*(++argv));
+            argc--;
+        }
+        else if (argc > 1 && strncmp(*argv, "--batch", 8) == 0) {
+            keyd_batch = atoi(*(++argv));
+            argc--;
+        }
+        else if (argc > 1 && strncmp(*argv, "--queue", 8) == 0) {
+            keyd_queue_max = atoi(*(++argv));
+            argc--;
+        }
+        else if (argc > 1 && strncmp(*argv, "--dir", 6) == 0) {
+            dir = *(++argv);
+            argc--;
+        }
+        else if (argc > 1 && strncmp(*argv, "--engine", 9) == 0) {
+            name = *(++argv);
+            argc--;
+        }
+        else {
+            printf("\n");
+            printf("Unrecognized option or missing argument: %s\n", *argv);
+            err = 1;
+        }
+    }
+    if (err == 0 && (sockPath == NULL || keysDir == NULL || threads <= 0 ||
+                     keyd_batch <= 0 || keyd_batch > KEYD_MAX_BATCH ||
+                     keyd_queue_max <= 0)) {
+        printf("\n");
+        printf("Socket and keys directory required, threads, batch and queue "
+               "must be positive and batch at most %d\n", KEYD_MAX_BATCH);
+        err = 1;
+    }
+    if (err != 0) {
+        usage();
+    }
+
+    if (err == 0) {
+        /* Block signals to stop before any thread is created so that only the
+         * signal thread takes them. */
+        sigemptyset(&sigs);
+        sigaddset(&sigs, SIGINT);
+        sigaddset(&sigs, SIGTERM);
+        err = pthread_sigmask(SIG_BLOCK, &sigs, NULL) != 0;
+    }
+    if (err == 0) {
+        /* Set directory where wolfsslengine library is stored */
+        setenv("OPENSSL_ENGINES", dir, 1);
+
+        if (staticEngine == 1) {
+            ENGINE_load_wolfengine();
+            name = wolfengine_id;
+        }
+    #ifndef WE_NO_DYNAMIC_ENGINE
+        else {
+        #if OPENSSL_VERSION_NUMBER >= 0x10100000L
+            OPENSSL_init_ssl(OPENSSL_INIT_ENGINE_DYNAMIC |
+                             OPENSSL_INIT_LOAD_CONFIG,
+                             NULL);
+        #else
+            ENGINE_load_dynamic();
+        #endif
+        }
+    #endif /* WE_NO_DYNAMIC_ENGINE */
+
+        e = ENGINE_by_id(name);
+        if (e == NULL) {
+            fprintf(stderr, "ERR: Failed to find engine!\n");
+            err = 1;
+        }
+    }
+    if (err == 0) {
+        /* Loading keys requires a functional reference. */
+        err = ENGINE_init(e) != 1;
+        init = (err == 0);
+    }
+    if (err == 0) {
+        /* Key files are mapped once by the engine's keystore. */
+        err = ENGINE_ctrl_cmd_string(e, "keystore_dir", keysDir, 0) != 1;
+        if (err != 0) {
+            fprintf(stderr, "ERR: Failed to set keystore directory\n");
+        }
+    }
+
+    if (err == 0) {
+        keyd_engine = e;
+
+        /* Clients going away mustn't stop the daemon. */
+        signal(SIGPIPE, SIG_IGN);
+        err = pipe(keyd_stop_pipe) != 0;
+    }
+    if (err == 0) {
+        err = pthread_create(&sigThread, NULL, keyd_signal_thread, &sigs) != 0;
+        sigStarted = (err == 0);
+        if (err != 0) {
+            fprintf(stderr, "ERR: Failed to start signal thread\n");
+        }
+    }
+    if (err == 0) {
+        err = (workers = (pthread_t *)malloc(threads * sizeof(*workers))) ==
+              NULL;
+    }
+    while (err == 0 && started < threads) {
+        err = pthread_create(&workers[started], NULL, keyd_worker, NULL) != 0;
+        if (err != 0) {
+            fprintf(stderr, "ERR: Failed to start worker thread\n");
+        }
+        else {
+            started++;
+        }
+    }
+    if (err == 0) {
+        printf("Serving keys in %s on %s with %d threads\n", keysDir,
+               sockPath, threads);
+        fflush(stdout);
+        err = keyd_serve(sockPath);
+    }
+
+    /* Connection readers still blocked reading are stopped on exit. */
+    pthread_mutex_lock(&keyd_mutex);
+    keyd_stopping = 1;
+    pthread_cond_broadcast(&keyd_cond);
+    pthread_cond_broadcast(&keyd_space_cond);
+    pthread_mutex_unlock(&keyd_mutex);
+    for (i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    if (sigStarted) {
+        /* Wake signal thread when stopping for another reason. */
+        pthread_kill(sigThread, SIGTERM);
+        pthread_join(sigThread, NULL);
+    }
+    if (keyd_stop_pipe[0] >= 0) {
+        close(keyd_stop_pipe[0]);
+        close(keyd_stop_pipe[1]);
+    }
+
+    if (init) {
+        ENGINE_finish(e);
+    }
+    ENGINE_free(e);
+
+    return err;
+}
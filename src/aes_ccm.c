@@ -111,7 +111,8 @@ static int we_aes_ccm_init(EVP_CIPHER_CTX *ctx, const unsigned char *key,
         aes->ivSet = 0;
         /* No tag set. */
         aes->tagLen = 0;
-        /* Start with no AAD. */
+        /* Start with no AAD - discard any left from previous operation. */
+        OPENSSL_free(aes->aad);
         aes->aad = NULL;
         aes->aadLen = 0;
         aes->enc = enc;
@@ -353,6 +354,7 @@ static int we_aes_ccm_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
  *  - EVP_CTRL_CCM_IV_GEN: set the generated IV/nonce
  *  - EVP_CTRL_AEAD_GET_TAG: get the tag value after encrypt
  *  - EVP_CTRL_AEAD_SET_TAG: set the tag value before decrypt
+ *  - EVP_CTRL_COPY: copy the AAD into a duplicated context
  *  - EVP_CTRL_AEAD_TLS1_AAD: set AAD for TLS
  *
  * @param  ctx   [in.out]  EVP cipher context of operation.
@@ -446,6 +448,23 @@ static int we_aes_ccm_ctrl(EVP_CIPHER_CTX *ctx, int type, int arg, void *ptr)
                 }
                 break;
 
+            case EVP_CTRL_COPY:
+                WOLFENGINE_MSG("EVP_CTRL_COPY");
+                /* Copy the AAD into new context - rest copied by OpenSSL.
+                 *   ptr [in] EVP cipher context to copy into
+                 */
+                if (aes->aad != NULL) {
+                    we_AesCcm *dup = (we_AesCcm *)
+                        EVP_CIPHER_CTX_get_cipher_data((EVP_CIPHER_CTX *)ptr);
+                    dup->aad = (unsigned char *)OPENSSL_memdup(aes->aad,
+                                                               aes->aadLen);
+                    if (dup->aad == NULL) {
+                        WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_memdup", dup->aad);
+                        ret = 0;
+                    }
+                }
+                break;
+
             case EVP_CTRL_AEAD_TLS1_AAD:
                 WOLFENGINE_MSG("EVP_CTRL_AEAD_TLS1_AAD");
                 /* Set additional authentication data for TLS
@@ -513,12 +532,37 @@ static int we_aes_ccm_ctrl(EVP_CIPHER_CTX *ctx, int type, int arg, void *ptr)
     return ret;
 }
 
+/**
+ * Dispose of the AES-CCM data.
+ *
+ * @param  ctx  [in]  EVP cipher context of operation.
+ * @return  1 on success and 0 on failure.
+ */
+static int we_aes_ccm_cleanup(EVP_CIPHER_CTX *ctx)
+{
+    we_AesCcm *aes;
+
+    WOLFENGINE_ENTER("we_aes_ccm_cleanup");
+
+    aes = (we_AesCcm *)EVP_CIPHER_CTX_get_cipher_data(ctx);
+    if (aes != NULL) {
+        OPENSSL_free(aes->aad);
+        aes->aad = NULL;
+        aes->aadLen = 0;
+    }
+
+    WOLFENGINE_LEAVE("we_aes_ccm_cleanup", 1);
+
+    return 1;
+}
+
 /** Flags for AES-CCM method. */
 #define AES_CCM_FLAGS              \
     (EVP_CIPH_FLAG_CUSTOM_CIPHER | \
      EVP_CIPH_CUSTOM_IV          | \
      EVP_CIPH_CUSTOM_IV_LENGTH   | \
      EVP_CIPH_ALWAYS_CALL_INIT   | \
+     EVP_CIPH_CUSTOM_COPY        | \
      EVP_CIPH_FLAG_AEAD_CIPHER   | \
      EVP_CIPH_CCM_MODE)
 
@@ -554,6 +598,9 @@ static int we_init_aesccm_meth(EVP_CIPHER *cipher)
     if (ret == 1) {
         ret = EVP_CIPHER_meth_set_ctrl(cipher, we_aes_ccm_ctrl);
     }
+    if (ret == 1) {
+        ret = EVP_CIPHER_meth_set_cleanup(cipher, we_aes_ccm_cleanup);
+    }
     if (ret == 1) {
         ret = EVP_CIPHER_meth_set_impl_ctx_size(cipher, sizeof(we_AesCcm));
     }
@@ -64,6 +64,8 @@ typedef struct we_AesGcm
     unsigned int   enc:1;
     /** Flag to indicate whether dping this for TLS */
     unsigned int   tls:1;
+    /** Flag to indicate whether a streaming operation has started. */
+    unsigned int   streaming:1;
 } we_AesGcm;
 
 /**
@@ -97,7 +99,8 @@ static int we_aes_gcm_init(EVP_CIPHER_CTX *ctx, const unsigned char *key,
         aes->ivSet = 0;
         /* No tag set. */
         aes->tagLen = 0;
-        /* Start with no AAD. */
+        /* Start with no AAD - discard any left from previous operation. */
+        OPENSSL_free(aes->aad);
         aes->aad = NULL;
         aes->aadLen = 0;
         aes->enc = enc;
@@ -106,6 +109,10 @@ static int we_aes_gcm_init(EVP_CIPHER_CTX *ctx, const unsigned char *key,
         /* Not doing CCM for TLS unless ctrl function called. */
         aes->tls = 0;
     }
+    if ((ret == 1) && ((key != NULL) || (iv != NULL))) {
+        /* New key or IV starts a new operation. */
+        aes->streaming = 0;
+    }
     if ((ret == 1) && (key != NULL)) {
         /* Set the AES-GCM key. */
         rc = wc_AesGcmSetKey(&aes->aes, key, EVP_CIPHER_CTX_key_length(ctx));
@@ -115,9 +122,12 @@ static int we_aes_gcm_init(EVP_CIPHER_CTX *ctx, const unsigned char *key,
         }
     }
     if ((ret == 1) && (iv != NULL)) {
-        /* Cache IV - see ctrl func for other ways to set IV. */
-        aes->ivLen = GCM_NONCE_MID_SZ;
-        XMEMCPY(aes->iv, iv, GCM_NONCE_MID_SZ);
+        /* Cache IV - see ctrl func for other ways to set IV.
+         * Use length set with EVP_CTRL_AEAD_SET_IVLEN when available. */
+        if (aes->ivLen == 0) {
+            aes->ivLen = GCM_NONCE_MID_SZ;
+        }
+        XMEMCPY(aes->iv, iv, aes->ivLen);
     }
 
     WOLFENGINE_LEAVE("we_aes_gcm_init", ret);
@@ -200,9 +210,103 @@ static int we_aes_gcm_tls_cipher(we_AesGcm *aes, unsigned char *out,
     return ret;
 }
 
+#ifdef WE_HAVE_AESGCM_STREAM
+/**
+ * Stream AAD or data through wolfSSL, or finish the operation.
+ *
+ * The first call starts the operation with the cached IV. AAD must all be
+ * passed in before the data. Finishing calculates the tag when encrypting and
+ * checks it when decrypting.
+ *
+ * @param  aes  [in,out]  AES-GCM object.
+ * @param  out  [out]     Buffer to store enciphered result.<br>
+ *                        NULL indicates AAD in.
+ * @param  in   [in]      AAD or data to encrypt/decrypt.<br>
+ *                        NULL indicates finish operation.
+ * @param  len  [in]      Length of AAD or data to encrypt/decrypt.
+ * @return  Length of output data on success and -1 on failure.
+ */
+static int we_aes_gcm_stream(we_AesGcm *aes, unsigned char *out,
+                             const unsigned char *in, size_t len)
+{
+    int ret = 0;
+    int rc = 0;
+
+    WOLFENGINE_ENTER("we_aes_gcm_stream");
+
+    if (!aes->streaming) {
+        /* Key already set - start operation with IV. */
+        rc = wc_AesGcmInit(&aes->aes, NULL, 0, aes->iv, aes->ivLen);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_AesGcmInit", rc);
+            ret = -1;
+        }
+        else {
+            aes->streaming = 1;
+        }
+    }
+    if ((ret == 0) && (in != NULL) && (out == NULL)) {
+        /* Authenticate AAD only. */
+        if (aes->enc) {
+            rc = wc_AesGcmEncryptUpdate(&aes->aes, NULL, NULL, 0, in,
+                                        (word32)len);
+        }
+        else {
+            rc = wc_AesGcmDecryptUpdate(&aes->aes, NULL, NULL, 0, in,
+                                        (word32)len);
+        }
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_AesGcmUpdate - AAD", rc);
+            ret = -1;
+        }
+    }
+    else if ((ret == 0) && (in != NULL)) {
+        /* Encrypt/decrypt data. */
+        if (aes->enc) {
+            rc = wc_AesGcmEncryptUpdate(&aes->aes, out, in, (word32)len,
+                                        NULL, 0);
+        }
+        else {
+            rc = wc_AesGcmDecryptUpdate(&aes->aes, out, in, (word32)len,
+                                        NULL, 0);
+        }
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_AesGcmUpdate", rc);
+            ret = -1;
+        }
+        else {
+            ret = (int)len;
+        }
+    }
+    else if (ret == 0) {
+        if (aes->enc) {
+            /* Tag always full size on calculation. */
+            aes->tagLen = EVP_GCM_TLS_TAG_LEN;
+            rc = wc_AesGcmEncryptFinal(&aes->aes, aes->tag,
+                                       (word32)aes->tagLen);
+        }
+        else {
+            rc = wc_AesGcmDecryptFinal(&aes->aes, aes->tag,
+                                       (word32)aes->tagLen);
+        }
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_AesGcmFinal", rc);
+            ret = -1;
+        }
+        /* Next operation starts again with IV. */
+        aes->streaming = 0;
+    }
+
+    WOLFENGINE_LEAVE("we_aes_gcm_stream", ret);
+
+    return ret;
+}
+#endif /* WE_HAVE_AESGCM_STREAM */
+
 /**
  * Encrypt/decrypt the data.
- * One-shot encrypt/decrypt - not streaming.
+ * Streams when wolfSSL supports it, except for TLS and when encrypting with an
+ * IV generated by wolfSSL. Otherwise, one-shot encrypt/decrypt.
  *
  * @param  ctx  [in,out]  EVP cipher context of operation.
  * @param  out  [out]     Buffer to store enciphered result.<br>
@@ -234,6 +338,11 @@ static int we_aes_gcm_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
     if ((ret == 1) && aes->tls) {
         ret = we_aes_gcm_tls_cipher(aes, out, in, len);
     }
+#ifdef WE_HAVE_AESGCM_STREAM
+    else if ((ret == 1) && ((!aes->enc) || (!aes->ivSet))) {
+        ret = we_aes_gcm_stream(aes, out, in, len);
+    }
+#endif
     else if ((ret == 1) && (out == NULL)) {
         /* Resize stored AAD and append new data. */
         p = OPENSSL_realloc(aes->aad, aes->aadLen + (int)len);
@@ -306,6 +415,62 @@ static int we_aes_gcm_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
     return ret;
 }
 
+/**
+ * Deep copy the AES-GCM data that OpenSSL copied by value.
+ *
+ * @param  aes  [in]  AES-GCM object copied from.
+ * @param  dst  [in]  EVP cipher context copied into.
+ * @return  1 on success and 0 on failure.
+ */
+static int we_aes_gcm_copy(we_AesGcm *aes, EVP_CIPHER_CTX *dst)
+{
+    int ret = 1;
+    we_AesGcm *dup;
+
+    WOLFENGINE_ENTER("we_aes_gcm_copy");
+
+    dup = (we_AesGcm *)EVP_CIPHER_CTX_get_cipher_data(dst);
+    if (dup == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("EVP_CIPHER_CTX_get_cipher_data", dup);
+        ret = 0;
+    }
+    if ((ret == 1) && (aes->aad != NULL)) {
+        dup->aad = (unsigned char *)OPENSSL_memdup(aes->aad, aes->aadLen);
+        if (dup->aad == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_memdup", dup->aad);
+            ret = 0;
+        }
+    }
+#if defined(WE_HAVE_AESGCM_STREAM) && defined(WOLFSSL_SMALL_STACK) && \
+    !defined(WOLFSSL_AESNI)
+    /* Streaming state is allocated when on the heap. */
+    if ((ret == 1) && (aes->aes.streamData != NULL)) {
+        dup->aes.streamData = (byte *)XMALLOC(5 * AES_BLOCK_SIZE,
+                                              dup->aes.heap, DYNAMIC_TYPE_AES);
+        if (dup->aes.streamData == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("XMALLOC", dup->aes.streamData);
+            ret = 0;
+        }
+        else {
+            XMEMCPY(dup->aes.streamData, aes->aes.streamData,
+                    5 * AES_BLOCK_SIZE);
+        }
+    }
+#endif
+    if ((ret == 0) && (dup != NULL)) {
+        /* Don't free the originals when the copy is cleaned up. */
+        dup->aad = NULL;
+#if defined(WE_HAVE_AESGCM_STREAM) && defined(WOLFSSL_SMALL_STACK) && \
+    !defined(WOLFSSL_AESNI)
+        dup->aes.streamData = NULL;
+#endif
+    }
+
+    WOLFENGINE_LEAVE("we_aes_gcm_copy", ret);
+
+    return ret;
+}
+
 /**
  * Extra operations for AES-GCM.
  * Supported operations include:
@@ -316,6 +481,7 @@ static int we_aes_gcm_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
  *  - EVP_CTRL_GCM_IV_GEN: set the generated IV/nonce
  *  - EVP_CTRL_AEAD_GET_TAG: get the tag value after encrypt
  *  - EVP_CTRL_AEAD_SET_TAG: set the tag value before decrypt
+ *  - EVP_CTRL_COPY: copy the AAD into a duplicated context
  *  - EVP_CTRL_AEAD_TLS1_AAD: set AAD for TLS
  *
  * @param  ctx   [in.out]  EVP cipher context of operation.
@@ -452,6 +618,14 @@ static int we_aes_gcm_ctrl(EVP_CIPHER_CTX *ctx, int type, int arg, void *ptr)
                 }
                 break;
 
+            case EVP_CTRL_COPY:
+                WOLFENGINE_MSG("EVP_CTRL_COPY");
+                /* Copy the AAD into new context - rest copied by OpenSSL.
+                 *   ptr [in] EVP cipher context to copy into
+                 */
+                ret = we_aes_gcm_copy(aes, (EVP_CIPHER_CTX *)ptr);
+                break;
+
             case EVP_CTRL_AEAD_TLS1_AAD:
                 WOLFENGINE_MSG("EVP_CTRL_AEAD_TLS1_AAD");
                 /* Set additional authentication data for TLS
@@ -516,12 +690,38 @@ static int we_aes_gcm_ctrl(EVP_CIPHER_CTX *ctx, int type, int arg, void *ptr)
     return ret;
 }
 
+/**
+ * Dispose of the AES-GCM data.
+ *
+ * @param  ctx  [in]  EVP cipher context of operation.
+ * @return  1 on success and 0 on failure.
+ */
+static int we_aes_gcm_cleanup(EVP_CIPHER_CTX *ctx)
+{
+    we_AesGcm *aes;
+
+    WOLFENGINE_ENTER("we_aes_gcm_cleanup");
+
+    aes = (we_AesGcm *)EVP_CIPHER_CTX_get_cipher_data(ctx);
+    if (aes != NULL) {
+        OPENSSL_free(aes->aad);
+        aes->aad = NULL;
+        aes->aadLen = 0;
+        wc_AesFree(&aes->aes);
+    }
+
+    WOLFENGINE_LEAVE("we_aes_gcm_cleanup", 1);
+
+    return 1;
+}
+
 /** Flags for AES-GCM method. */
 #define AES_GCM_FLAGS              \
     (EVP_CIPH_FLAG_CUSTOM_CIPHER | \
      EVP_CIPH_CUSTOM_IV          | \
      EVP_CIPH_CUSTOM_IV_LENGTH   | \
      EVP_CIPH_ALWAYS_CALL_INIT   | \
+     EVP_CIPH_CUSTOM_COPY        | \
      EVP_CIPH_FLAG_AEAD_CIPHER   | \
      EVP_CIPH_GCM_MODE)
 
@@ -557,6 +757,9 @@ static int we_init_aesgcm_meth(EVP_CIPHER *cipher)
     if (ret == 1) {
         ret = EVP_CIPHER_meth_set_ctrl(cipher, we_aes_gcm_ctrl);
     }
+    if (ret == 1) {
+        ret = EVP_CIPHER_meth_set_cleanup(cipher, we_aes_gcm_cleanup);
+    }
     if (ret == 1) {
         ret = EVP_CIPHER_meth_set_impl_ctx_size(cipher, sizeof(we_AesGcm));
     }
@@ -0,0 +1,224 @@
+/* batch_verify.c
+ *
+ * Copyright (C) 2019-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfengine.
+ *
+ * wolfengine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfengine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+
+#include "internal.h"
+
+#ifdef WE_HAVE_BATCH_VERIFY
+
+#ifdef WE_HAVE_THREADS
+#include <pthread.h>
+#endif
+
+/* Maximum number of threads to verify a batch of signatures on. */
+#define MAX_BATCH_VERIFY_THREADS 64
+
+/**
+ * Range of sorted batch entries to verify on one thread.
+ */
+typedef struct we_BatchWork
+{
+    /* Items of batch - passed to verify function. */
+    const void *items;
+    /* Entries sorted by key. */
+    const we_BatchEntry *entries;
+    /* Index of first entry to verify. */
+    size_t start;
+    /* Index after last entry to verify. */
+    size_t end;
+    /* Result of each item - 1 when verified. */
+    unsigned char *ok;
+    /* Algorithm specific function that verifies the range. */
+    we_BatchVerifyRange verify;
+} we_BatchWork;
+
+/**
+ * Compare batch entries so that entries with the same key are adjacent.
+ *
+ * @param  a  [in]  First batch entry.
+ * @param  b  [in]  Second batch entry.
+ * @returns  Negative, 0 or positive as a is before, same as or after b.
+ */
+static int we_batch_cmp(const void *a, const void *b)
+{
+    const we_BatchEntry *ea = (const we_BatchEntry *)a;
+    const we_BatchEntry *eb = (const we_BatchEntry *)b;
+    int ret;
+
+    if ((size_t)ea->key != (size_t)eb->key) {
+        ret = ((size_t)ea->key < (size_t)eb->key) ? -1 : 1;
+    }
+    else {
+        ret = (ea->idx < eb->idx) ? -1 : (ea->idx > eb->idx);
+    }
+
+    return ret;
+}
+
+/**
+ * Verify the range of entries of a work item.
+ *
+ * @param  work  [in]  Range of entries to verify and results.
+ */
+static void we_batch_verify_work(we_BatchWork *work)
+{
+    work->verify(work->items, work->entries, work->start, work->end,
+                 work->ok);
+}
+
+#ifdef WE_HAVE_THREADS
+/**
+ * Thread entry point to verify a range of batch entries.
+ *
+ * @param  arg  [in]  Range of entries to verify.
+ * @returns  NULL.
+ */
+static void *we_batch_verify_worker(void *arg)
+{
+    we_batch_verify_work((we_BatchWork *)arg);
+
+    return NULL;
+}
+#endif /* WE_HAVE_THREADS */
+
+/**
+ * Verify a batch of signatures, in parallel when threads are requested.
+ *
+ * Each signature is verified individually - there is no combined batch
+ * verification equation. The items are sorted by key so that the algorithm's
+ * verify function sets up each public key once per run of items with that
+ * key. The sorted items are split evenly over the threads and the calling
+ * thread verifies the first range. A range whose thread can't be started is
+ * verified on the calling thread.
+ *
+ * @param  items    [in]   Items of batch. Only used by getKey and verify.
+ * @param  cnt      [in]   Number of items.
+ * @param  threads  [in]   Number of threads to verify on. 0 or 1 verifies on
+ *                         calling thread.
+ * @param  getKey   [in]   Gets the key of an item. NULL for no usable key.
+ * @param  verify   [in]   Verifies a range of sorted entries.
+ * @param  results  [out]  Result bitmap of (cnt + 7) / 8 bytes. Bit (i % 8)
+ *                         of byte (i / 8) is set when item i verified.
+ * @returns  1 when the batch was processed and 0 on failure.
+ */
+int we_batch_verify(const void *items, size_t cnt, int threads,
+                    we_BatchGetKey getKey, we_BatchVerifyRange verify,
+                    unsigned char *results)
+{
+    int ret = 1;
+    size_t i;
+    int t;
+    int cntThreads = 1;
+    we_BatchEntry *entries = NULL;
+    unsigned char *ok = NULL;
+    we_BatchWork work[MAX_BATCH_VERIFY_THREADS];
+#ifdef WE_HAVE_THREADS
+    pthread_t thread[MAX_BATCH_VERIFY_THREADS];
+    int started[MAX_BATCH_VERIFY_THREADS];
+#endif
+
+    WOLFENGINE_ENTER("we_batch_verify");
+
+    if (cnt > 0) {
+        entries = (we_BatchEntry *)OPENSSL_malloc(cnt * sizeof(*entries));
+        if (entries == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_malloc", entries);
+            ret = 0;
+        }
+        if (ret == 1) {
+            ok = (unsigned char *)OPENSSL_zalloc(cnt);
+            if (ok == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_zalloc", ok);
+                ret = 0;
+            }
+        }
+    }
+
+    if (ret == 1 && cnt > 0) {
+        for (i = 0; i < cnt; i++) {
+            entries[i].idx = i;
+            entries[i].key = getKey(items, i);
+        }
+        /* Group items with the same key together. */
+        qsort(entries, cnt, sizeof(*entries), we_batch_cmp);
+
+#ifdef WE_HAVE_THREADS
+        if (threads > 1) {
+            cntThreads = threads;
+            if (cntThreads > MAX_BATCH_VERIFY_THREADS) {
+                cntThreads = MAX_BATCH_VERIFY_THREADS;
+            }
+            if ((size_t)cntThreads > cnt) {
+                cntThreads = (int)cnt;
+            }
+        }
+#else
+        (void)threads;
+#endif
+        for (t = 0; t < cntThreads; t++) {
+            work[t].items = items;
+            work[t].entries = entries;
+            work[t].start = (cnt * t) / cntThreads;
+            work[t].end = (cnt * (t + 1)) / cntThreads;
+            work[t].ok = ok;
+            work[t].verify = verify;
+        }
+
+#ifdef WE_HAVE_THREADS
+        for (t = 1; t < cntThreads; t++) {
+            started[t] = pthread_create(&thread[t], NULL,
+                                        we_batch_verify_worker,
+                                        &work[t]) == 0;
+            if (!started[t]) {
+                /* Verify range on calling thread instead. */
+                WOLFENGINE_ERROR_MSG("Failed to start batch verify thread");
+                we_batch_verify_work(&work[t]);
+            }
+        }
+#endif
+        we_batch_verify_work(&work[0]);
+#ifdef WE_HAVE_THREADS
+        for (t = 1; t < cntThreads; t++) {
+            if (started[t]) {
+                pthread_join(thread[t], NULL);
+            }
+        }
+#endif
+    }
+
+    if (ret == 1) {
+        XMEMSET(results, 0, (cnt + 7) / 8);
+        for (i = 0; i < cnt; i++) {
+            if (ok[i] == 1) {
+                results[i / 8] |= (unsigned char)(1 << (i % 8));
+            }
+        }
+    }
+
+    OPENSSL_free(ok);
+    OPENSSL_free(entries);
+
+    WOLFENGINE_LEAVE("we_batch_verify", ret);
+
+    return ret;
+}
+
+#endif /* WE_HAVE_BATCH_VERIFY */
@@ -21,11 +21,22 @@
 
 #include "internal.h"
 
+#ifdef WE_HAVE_THREADS
+#include <pthread.h>
+#endif
+
 #ifdef WE_HAVE_ECC
 /*
  * ECC
  */
 
+/* Maximum number of threads to generate a batch of key pairs on. */
+#define MAX_BATCH_KEYGEN_THREADS 64
+/* Maximum number of threads to derive secrets with many peers on. */
+#define MAX_MULTI_DERIVE_THREADS 64
+/* Maximum size of an uncompressed point - 0x04 | x | y. */
+#define WE_EC_MAX_POINT_SZ       (1 + 2 * MAX_ECC_BYTES)
+
 /**
  * Get the curve id for the curve name (NID).
  *
@@ -63,6 +74,40 @@ static int we_ec_get_curve_id(int curveName, int *curveId)
     return ret;
 }
 
+/**
+ * Encode the public key of the EC key as an uncompressed point.
+ *
+ * Uses the caller's buffer so that no memory is allocated.
+ *
+ * @param  ecKey  [in]   OpenSSL EC key.
+ * @param  buf    [out]  Buffer of WE_EC_MAX_POINT_SZ bytes.
+ * @returns  Length of encoded point in bytes or 0 on failure.
+ */
+static size_t we_ec_key_pub2oct(const EC_KEY *ecKey, unsigned char *buf)
+{
+    size_t len = 0;
+    const EC_POINT *pub;
+
+    WOLFENGINE_ENTER("we_ec_key_pub2oct");
+
+    pub = EC_KEY_get0_public_key(ecKey);
+    if (pub == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("EC_KEY_get0_public_key", (EC_POINT*)pub);
+    }
+    else {
+        len = EC_POINT_point2oct(EC_KEY_get0_group(ecKey), pub,
+                                 POINT_CONVERSION_UNCOMPRESSED, buf,
+                                 WE_EC_MAX_POINT_SZ, NULL);
+        if (len == 0) {
+            WOLFENGINE_ERROR_FUNC("EC_POINT_point2oct", (int)len);
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_ec_key_pub2oct", len != 0);
+
+    return len;
+}
+
 /**
  * Set private key from the EC key into wolfSSL ECC key.
  *
@@ -75,14 +120,14 @@ static int we_ec_set_private(ecc_key *key, int curveId, const EC_KEY *ecKey)
 {
     int ret = 1, rc;
     size_t privLen = 0;
-    unsigned char* privBuf = NULL;
+    unsigned char privBuf[MAX_ECC_BYTES];
 
     WOLFENGINE_ENTER("we_ec_set_private");
 
-    /* Get the EC key private key as binary data. */
-    privLen = EC_KEY_priv2buf(ecKey, &privBuf);
-    if (privLen <= 0) {
-        WOLFENGINE_ERROR_FUNC("EC_KEY_priv2buf", (int)privLen);
+    /* Get the EC key private key as binary data - no allocation. */
+    privLen = EC_KEY_priv2oct(ecKey, privBuf, sizeof(privBuf));
+    if (privLen == 0) {
+        WOLFENGINE_ERROR_FUNC("EC_KEY_priv2oct", (int)privLen);
         ret = 0;
     }
     /* Import private key. */
@@ -95,10 +140,8 @@ static int we_ec_set_private(ecc_key *key, int curveId, const EC_KEY *ecKey)
         }
     }
 
-    if (privLen > 0) {
-        /* Zeroize and free private key data. */
-        OPENSSL_clear_free(privBuf, privLen);
-    }
+    /* Zeroize private key data. */
+    OPENSSL_cleanse(privBuf, sizeof(privBuf));
 
     WOLFENGINE_LEAVE("we_ec_set_private", ret);
 
@@ -117,17 +160,15 @@ static int we_ec_set_public(ecc_key *key, int curveId, EC_KEY *ecKey)
 {
     int ret = 1, rc;
     size_t pubLen;
-    unsigned char* pubBuf = NULL;
+    unsigned char pubBuf[WE_EC_MAX_POINT_SZ];
     unsigned char* x;
     unsigned char* y;
 
     WOLFENGINE_ENTER("we_ec_set_public");
 
     /* Get the EC key public key as and uncompressed point. */
-    pubLen = EC_KEY_key2buf(ecKey, POINT_CONVERSION_UNCOMPRESSED, &pubBuf,
-                            NULL);
-    if (pubLen <= 0) {
-        WOLFENGINE_ERROR_FUNC("EC_KEY_key2buf", (int)pubLen);
+    pubLen = we_ec_key_pub2oct(ecKey, pubBuf);
+    if (pubLen == 0) {
         ret = 0;
     }
 
@@ -143,13 +184,62 @@ static int we_ec_set_public(ecc_key *key, int curveId, EC_KEY *ecKey)
         }
     }
 
-    OPENSSL_free(pubBuf);
-
     WOLFENGINE_LEAVE("we_ec_set_public", ret);
 
     return ret;
 }
 
+#if defined(WE_HAVE_ECDH) || defined(WE_HAVE_EC_KEY)
+/**
+ * Import a peer's public key into a wolfSSL ECC key.
+ *
+ * Any key already in the wolfSSL object is replaced. Validation checks that
+ * the point is on the curve, which is sufficient for the supported curves as
+ * they have a cofactor of 1.
+ *
+ * @param  peer        [in]  wolfSSL ECC key to import into.
+ * @param  curveId     [in]  wolfSSL curve identifier.
+ * @param  peerKey     [in]  Public key as an uncompressed point.
+ * @param  peerKeyLen  [in]  Length of public key in bytes.
+ * @param  validate    [in]  Whether to validate the public key.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_ec_import_peer(ecc_key *peer, int curveId,
+                             const unsigned char *peerKey, int peerKeyLen,
+                             int validate)
+{
+    int ret = 1, rc;
+
+    WOLFENGINE_ENTER("we_ec_import_peer");
+
+    wc_ecc_free(peer);
+    rc = wc_ecc_init(peer);
+    if (rc != 0) {
+        WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
+        ret = 0;
+    }
+    if (ret == 1) {
+        rc = wc_ecc_import_x963_ex(peerKey, (word32)peerKeyLen, peer, curveId);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_import_x963_ex", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1 && validate) {
+        rc = wc_ecc_point_is_on_curve(&peer->pubkey,
+                                      wc_ecc_get_curve_idx(curveId));
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_point_is_on_curve", rc);
+            ret = 0;
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_ec_import_peer", ret);
+
+    return ret;
+}
+#endif /* WE_HAVE_ECDH || WE_HAVE_EC_KEY */
+
 /**
  * Export the key from the wolfSSL EC key object into OpenSSL EC_KEY object.
  *
@@ -161,13 +251,16 @@ static int we_ec_set_public(ecc_key *key, int curveId, EC_KEY *ecKey)
 static int we_ec_export_key(ecc_key *ecc, int len, EC_KEY *key)
 {
     int ret, rc;
-    unsigned char *buf = NULL;
+    /* Public key as uncompressed point followed by private key. */
+    unsigned char buf[WE_EC_MAX_POINT_SZ + MAX_ECC_BYTES];
     unsigned char *d = NULL;
 
     WOLFENGINE_ENTER("we_ec_export_key");
 
-    /* Allocate buffer to hold private and public key data. */
-    ret = (buf = (unsigned char *)OPENSSL_malloc(len * 3 + 1)) != NULL;
+    ret = (len > 0 && len <= MAX_ECC_BYTES);
+    if (ret == 0) {
+        WOLFENGINE_ERROR_MSG("Invalid EC key length");
+    }
     if (ret == 1) {
         unsigned char *x = buf + 1;
         unsigned char *y = x + len;
@@ -199,9 +292,8 @@ static int we_ec_export_key(ecc_key *ecc, int len, EC_KEY *key)
         }
     }
 
-    if (buf != NULL) {
-        OPENSSL_clear_free(buf, len * 3 + 1);
-    }
+    /* Zeroize private key data. */
+    OPENSSL_cleanse(buf, sizeof(buf));
 
     WOLFENGINE_LEAVE("we_ec_export_key", ret);
 
@@ -209,6 +301,103 @@ static int we_ec_export_key(ecc_key *ecc, int len, EC_KEY *key)
 }
 
 #ifdef WE_HAVE_EVP_PKEY
+#ifdef WE_HAVE_ECKEYGEN
+#ifdef WE_HAVE_EC_P256
+/** Shared OpenSSL group for P-256 - created once at initialization. */
+static EC_GROUP *we_ec_p256_group = NULL;
+#endif
+#ifdef WE_HAVE_EC_P384
+/** Shared OpenSSL group for P-384 - created once at initialization. */
+static EC_GROUP *we_ec_p384_group = NULL;
+#endif
+
+/**
+ * Get the shared OpenSSL group for the curve name (NID).
+ *
+ * The group is not to be modified or freed by the caller.
+ *
+ * @param  curveName  [in]  OpenSSL curve name.
+ * @returns  Shared EC_GROUP object or NULL when curve is not supported.
+ */
+static const EC_GROUP *we_ec_get_group(int curveName)
+{
+    const EC_GROUP *group = NULL;
+
+    switch (curveName) {
+#ifdef WE_HAVE_EC_P256
+        case NID_X9_62_prime256v1:
+            group = we_ec_p256_group;
+            break;
+#endif
+#ifdef WE_HAVE_EC_P384
+        case NID_secp384r1:
+            group = we_ec_p384_group;
+            break;
+#endif
+        default:
+            break;
+    }
+
+    if (group == NULL) {
+        WOLFENGINE_ERROR_MSG("No EC group for curve name");
+    }
+
+    return group;
+}
+
+/**
+ * Create the shared OpenSSL groups for the supported curves.
+ *
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_ec_groups_init(void)
+{
+    int ret = 1;
+
+    WOLFENGINE_ENTER("we_ec_groups_init");
+
+#ifdef WE_HAVE_EC_P256
+    if (we_ec_p256_group == NULL) {
+        we_ec_p256_group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+        if (we_ec_p256_group == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("EC_GROUP_new_by_curve_name",
+                                       we_ec_p256_group);
+            ret = 0;
+        }
+    }
+#endif
+#ifdef WE_HAVE_EC_P384
+    if (ret == 1 && we_ec_p384_group == NULL) {
+        we_ec_p384_group = EC_GROUP_new_by_curve_name(NID_secp384r1);
+        if (we_ec_p384_group == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("EC_GROUP_new_by_curve_name",
+                                       we_ec_p384_group);
+            ret = 0;
+        }
+    }
+#endif
+
+    WOLFENGINE_LEAVE("we_ec_groups_init", ret);
+
+    return ret;
+}
+
+/**
+ * Free the shared OpenSSL groups.
+ */
+void we_ec_groups_free(void)
+{
+#ifdef WE_HAVE_EC_P256
+    EC_GROUP_free(we_ec_p256_group);
+    we_ec_p256_group = NULL;
+#endif
+#ifdef WE_HAVE_EC_P384
+    EC_GROUP_free(we_ec_p384_group);
+    we_ec_p384_group = NULL;
+#endif
+}
+#endif /* WE_HAVE_ECKEYGEN */
+
 /**
  * Data required to complete an ECC operation.
  */
@@ -226,18 +415,40 @@ typedef struct we_Ecc
 #endif
 #ifdef WE_HAVE_ECDH
     /* Peer's public key encoded in binary - uncompressed. */
-    unsigned char *peerKey;
+    unsigned char  peerKey[WE_EC_MAX_POINT_SZ];
     /* Length of peer's encoded public key. */
     int            peerKeyLen;
+    /* wolfSSL ECC key structure holding peer's validated public key. */
+    ecc_key        peer;
+#endif
+#ifdef WE_HAVE_ECDH_X963_KDF
+    /* KDF to apply to shared secret - EVP_PKEY_ECDH_KDF_NONE or _X9_63. */
+    int            kdfType;
+    /* Digest to use with KDF. */
+    const EVP_MD  *kdfMd;
+    /* Length of key to derive with KDF. */
+    int            kdfOutLen;
+    /* User keying material (shared info) for KDF. */
+    unsigned char *kdfUkm;
+    /* Length of user keying material. */
+    int            kdfUkmLen;
 #endif
 #ifdef WE_HAVE_ECKEYGEN
-    /* OpenSSL group indicating EC parameters. */
-    EC_GROUP      *group;
+    /* Shared OpenSSL group indicating EC parameters - not owned. */
+    const EC_GROUP *group;
+#endif
+#ifdef WE_HAVE_EC_PUB_CACHE
+    /* Key taken from the public key cache - returned on cleanup. */
+    ecc_key       *cached;
 #endif
     /* Indicates private key has been set into wolfSSL structure. */
     int            privKeySet:1;
     /* Indicates public key has been set into wolfSSL structure. */
     int            pubKeySet:1;
+#ifdef WE_HAVE_ECDH
+    /* Indicates peer's public key has been set into wolfSSL structure. */
+    int            peerKeySet:1;
+#endif
 } we_Ecc;
 
 /**
@@ -277,6 +488,22 @@ static int we_ec_init(EVP_PKEY_CTX *ctx)
         }
     }
 #endif /* !HAVE_FIPS || (HAVE_FIPS_VERSION && HAVE_FIPS_VERSION != 2) */
+#ifdef WE_HAVE_ECDH
+    if (ret == 1) {
+        /* Initialize the wolfSSL key object for the peer's public key. */
+        rc = wc_ecc_init(&ecc->peer);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
+            ret = 0;
+        }
+    }
+#endif
+#ifdef WE_HAVE_ECDH_X963_KDF
+    if (ret == 1) {
+        /* Default is to return the raw shared secret. */
+        ecc->kdfType = EVP_PKEY_ECDH_KDF_NONE;
+    }
+#endif
     if (ret == 1) {
         /* Set this key object to be returned when performing operations. */
         EVP_PKEY_CTX_set_data(ctx, ecc);
@@ -297,6 +524,8 @@ static int we_ec_init(EVP_PKEY_CTX *ctx)
 }
 
 #ifdef WE_HAVE_ECKEYGEN
+static void we_ec_cleanup(EVP_PKEY_CTX *ctx);
+
 #ifdef WE_HAVE_EC_P256
 /**
  * Initialize and set the data required to complete an EC P-256 operations.
@@ -319,13 +548,10 @@ static int we_ec_p256_init(EVP_PKEY_CTX *ctx)
         /* Setup P-256 curve. */
         ecc->curveId = ECC_SECP256R1;
         ecc->curveName = NID_X9_62_prime256v1;
-        ecc->group = EC_GROUP_new_by_curve_name(ecc->curveName);
+        ecc->group = we_ec_get_group(ecc->curveName);
         if (ecc->group == NULL) {
             /* Failed - free allocated data. */
-            WOLFENGINE_ERROR_FUNC_NULL("EC_GROUP_new_by_curve_name",
-                                       ecc->group);
-            wc_ecc_free(&ecc->key);
-            OPENSSL_free(ecc);
+            we_ec_cleanup(ctx);
             ret = 0;
         }
     }
@@ -358,13 +584,10 @@ static int we_ec_p384_init(EVP_PKEY_CTX *ctx)
         /* Setup P-384 curve. */
         ecc->curveId = ECC_SECP384R1;
         ecc->curveName = NID_secp384r1;
-        ecc->group = EC_GROUP_new_by_curve_name(ecc->curveName);
+        ecc->group = we_ec_get_group(ecc->curveName);
         if (ecc->group == NULL) {
             /* Failed - free allocated data. */
-            WOLFENGINE_ERROR_FUNC_NULL("EC_GROUP_new_by_curve_name",
-                                       ecc->group);
-            wc_ecc_free(&ecc->key);
-            OPENSSL_free(ecc);
+            we_ec_cleanup(ctx);
             ret = 0;
         }
     }
@@ -377,30 +600,6 @@ static int we_ec_p384_init(EVP_PKEY_CTX *ctx)
 #endif
 #endif
 
-/**
- * Copy the EVP public key method from/to EVP public key contexts.
- *
- * @param  dst  [in]  Destination public key context.
- * @param  src  [in]  Source public key context.
- * @returns  1 on success and 0 on failure.
- */
-#if OPENSSL_VERSION_NUMBER >= 0x30000000L
-static int we_ec_copy(EVP_PKEY_CTX *dst, const EVP_PKEY_CTX *src)
-#else
-static int we_ec_copy(EVP_PKEY_CTX *dst, EVP_PKEY_CTX *src)
-#endif
-{
-    WOLFENGINE_ENTER("we_ec_copy");
-
-    /* Nothing to copy as src is empty. */
-    (void)src;
-    (void)dst;
-
-    WOLFENGINE_LEAVE("we_ec_copy", 1);
-
-    return 1;
-}
-
 /**
  * Clean up the ECC operation data.
  *
@@ -414,13 +613,17 @@ static void we_ec_cleanup(EVP_PKEY_CTX *ctx)
     
     ecc = (we_Ecc *)EVP_PKEY_CTX_get_data(ctx);
     if (ecc != NULL) {
-#ifdef WE_HAVE_ECKEYGEN
-        EC_GROUP_free(ecc->group);
-        ecc->group = NULL;
+#ifdef WE_HAVE_EC_PUB_CACHE
+        if (ecc->cached != NULL) {
+            we_ec_pub_cache_put(ecc->cached);
+        }
 #endif
 #ifdef WE_HAVE_ECDH
-        OPENSSL_free(ecc->peerKey);
-        ecc->peerKey = NULL;
+        wc_ecc_free(&ecc->peer);
+#endif
+#ifdef WE_HAVE_ECDH_X963_KDF
+        OPENSSL_free(ecc->kdfUkm);
+        ecc->kdfUkm = NULL;
 #endif
         wc_ecc_free(&ecc->key);
         OPENSSL_free(ecc);
@@ -430,6 +633,159 @@ static void we_ec_cleanup(EVP_PKEY_CTX *ctx)
     WOLFENGINE_LEAVE("we_ec_cleanup", 1);
 }
 
+/**
+ * Copy the key from one wolfSSL ECC key to another using raw key data.
+ *
+ * @param  dst  [in]  Destination internal EC object with initialized key.
+ * @param  src  [in]  Source internal EC object with key set.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_ec_copy_key(we_Ecc *dst, we_Ecc *src)
+{
+    int ret = 1, rc;
+    unsigned char priv[MAX_ECC_BYTES];
+    unsigned char pub[1 + 2 * MAX_ECC_BYTES];
+    word32 privLen = sizeof(priv);
+    word32 pubLen = sizeof(pub);
+    int hasPriv = src->key.type != ECC_PUBLICKEY;
+    int hasPub = src->key.type != ECC_PRIVATEKEY_ONLY;
+
+    WOLFENGINE_ENTER("we_ec_copy_key");
+
+    if (hasPub) {
+        /* Export public key - uncompressed point. */
+        rc = wc_ecc_export_x963(&src->key, pub, &pubLen);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_export_x963", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1 && hasPriv) {
+        rc = wc_ecc_export_private_only(&src->key, priv, &privLen);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_export_private_only", rc);
+            ret = 0;
+        }
+        if (ret == 1) {
+            /* Import private key and public key when available. */
+            rc = wc_ecc_import_private_key_ex(priv, privLen,
+                                              hasPub ? pub : NULL,
+                                              hasPub ? pubLen : 0,
+                                              &dst->key, src->curveId);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("wc_ecc_import_private_key_ex", rc);
+                ret = 0;
+            }
+        }
+        /* Zeroize private key data. */
+        OPENSSL_cleanse(priv, sizeof(priv));
+    }
+    else if (ret == 1) {
+        rc = wc_ecc_import_x963_ex(pub, pubLen, &dst->key, src->curveId);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_import_x963_ex", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        dst->privKeySet = src->privKeySet && hasPriv;
+        dst->pubKeySet = src->pubKeySet && hasPub;
+    }
+
+    WOLFENGINE_LEAVE("we_ec_copy_key", ret);
+
+    return ret;
+}
+
+/**
+ * Copy the EVP public key method from/to EVP public key contexts.
+ *
+ * Settings, curve, peer key and the key already set into the wolfSSL object
+ * are copied so that the destination doesn't get the key from OpenSSL again.
+ *
+ * @param  dst  [in]  Destination public key context.
+ * @param  src  [in]  Source public key context.
+ * @returns  1 on success and 0 on failure.
+ */
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+static int we_ec_copy(EVP_PKEY_CTX *dst, const EVP_PKEY_CTX *src)
+#else
+static int we_ec_copy(EVP_PKEY_CTX *dst, EVP_PKEY_CTX *src)
+#endif
+{
+    int ret;
+    we_Ecc *srcEcc;
+    we_Ecc *dstEcc = NULL;
+
+    WOLFENGINE_ENTER("we_ec_copy");
+
+    /* Get the internal EC object of the source. */
+    ret = (srcEcc = (we_Ecc *)EVP_PKEY_CTX_get_data((EVP_PKEY_CTX *)src)) !=
+          NULL;
+    if (ret == 1) {
+        /* Create the internal EC object in destination context. */
+        ret = we_ec_init(dst);
+    }
+    if (ret == 1) {
+        dstEcc = (we_Ecc *)EVP_PKEY_CTX_get_data(dst);
+        dstEcc->curveId = srcEcc->curveId;
+        dstEcc->curveName = srcEcc->curveName;
+#ifdef WE_HAVE_ECDSA
+        dstEcc->md = srcEcc->md;
+#endif
+    }
+#ifdef WE_HAVE_ECKEYGEN
+    if (ret == 1) {
+        /* Group is shared and immutable. */
+        dstEcc->group = srcEcc->group;
+    }
+#endif
+#ifdef WE_HAVE_ECDH
+    if (ret == 1) {
+        XMEMCPY(dstEcc->peerKey, srcEcc->peerKey, srcEcc->peerKeyLen);
+        dstEcc->peerKeyLen = srcEcc->peerKeyLen;
+    }
+    if (ret == 1 && srcEcc->peerKeySet) {
+        /* Peer's public key was validated when set into source. */
+        ret = we_ec_import_peer(&dstEcc->peer, srcEcc->peer.dp->id,
+                                dstEcc->peerKey, dstEcc->peerKeyLen, 0);
+        if (ret == 1) {
+            dstEcc->peerKeySet = 1;
+        }
+    }
+#endif
+#ifdef WE_HAVE_ECDH_X963_KDF
+    if (ret == 1) {
+        dstEcc->kdfType = srcEcc->kdfType;
+        dstEcc->kdfMd = srcEcc->kdfMd;
+        dstEcc->kdfOutLen = srcEcc->kdfOutLen;
+    }
+    if (ret == 1 && srcEcc->kdfUkm != NULL) {
+        dstEcc->kdfUkm = (unsigned char *)OPENSSL_memdup(srcEcc->kdfUkm,
+                                                         srcEcc->kdfUkmLen);
+        if (dstEcc->kdfUkm == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_memdup", dstEcc->kdfUkm);
+            ret = 0;
+        }
+        else {
+            dstEcc->kdfUkmLen = srcEcc->kdfUkmLen;
+        }
+    }
+#endif
+    if (ret == 1 && (srcEcc->privKeySet || srcEcc->pubKeySet)) {
+        ret = we_ec_copy_key(dstEcc, srcEcc);
+    }
+
+    if (ret == 0 && dstEcc != NULL) {
+        /* Failed - free allocated data. */
+        we_ec_cleanup(dst);
+    }
+
+    WOLFENGINE_LEAVE("we_ec_copy", ret);
+
+    return ret;
+}
+
 #if defined(WE_HAVE_ECDSA) || defined(WE_HAVE_ECDH)
 /**
  * Get the EC key and curve id from the EVP public key.
@@ -496,12 +852,29 @@ static int we_ecdsa_sign(EVP_PKEY_CTX *ctx, unsigned char *sig, size_t *sigLen,
     word32 outLen;
     we_Ecc *ecc;
     EC_KEY *ecKey = NULL;
+    const char *keyId = NULL;
 
     WOLFENGINE_ENTER("we_ecdsa_sign");
 
     /* Get the internal EC key object. */
     ret = (ecc = (we_Ecc *)EVP_PKEY_CTX_get_data(ctx)) != NULL;
-    if (ret == 1 && !ecc->privKeySet) {
+#ifdef WE_HAVE_KEYD
+    if (ret == 1 && EVP_PKEY_CTX_get0_pkey(ctx) != NULL) {
+        /* Private key may be held by the key daemon. */
+        ecKey = (EC_KEY *)EVP_PKEY_get0_EC_KEY(EVP_PKEY_CTX_get0_pkey(ctx));
+        keyId = we_keyd_ec_key_id(ecKey);
+    }
+    if (ret == 1 && keyId != NULL) {
+        if (sig == NULL) {
+            /* Return signature size in bytes. */
+            *sigLen = ECDSA_size(ecKey);
+        }
+        else {
+            ret = we_keyd_ecdsa_sign(keyId, tbs, tbsLen, sig, sigLen);
+        }
+    }
+#endif
+    if (ret == 1 && keyId == NULL && !ecc->privKeySet) {
         /* Get the OpenSSL EC_KEY object and set curve id. */
         ret = we_ec_get_ec_key(ctx, &ecKey, ecc);
         if (ret == 1) {
@@ -514,11 +887,11 @@ static int we_ecdsa_sign(EVP_PKEY_CTX *ctx, unsigned char *sig, size_t *sigLen,
         }
     }
 
-    if (ret == 1 && sig == NULL) {
+    if (ret == 1 && keyId == NULL && sig == NULL) {
         /* Return signature size in bytes. */
         *sigLen = wc_ecc_sig_size(&ecc->key);
     }
-    if (ret == 1 && sig != NULL) {
+    if (ret == 1 && keyId == NULL && sig != NULL) {
         /* Sign the data with wolfSSL EC key object. */
         outLen = (word32)*sigLen;
         rc = wc_ecc_sign_hash(tbs, (word32)tbsLen, sig, &outLen, we_rng,
@@ -541,6 +914,12 @@ static int we_ecdsa_sign(EVP_PKEY_CTX *ctx, unsigned char *sig, size_t *sigLen,
 /**
  * Verify data with a public EC key.
  *
+ * When the public key cache is enabled, the wolfSSL key is looked up by the
+ * encoded public key so that keys verified with often are only imported
+ * once. The key found is kept by the context until it is cleaned up so that
+ * repeated verifications don't encode the public key or lock the cache. The
+ * cached key is shared by contexts and locked for each verification.
+ *
  * @param  ctx     [in]  Public key context of operation.
  * @param  sig     [in]  Signature data.
  * @param  sigLen  [in]  Length of signature data.
@@ -556,27 +935,57 @@ static int we_ecdsa_verify(EVP_PKEY_CTX *ctx, const unsigned char *sig,
     we_Ecc *ecc;
     EC_KEY *ecKey = NULL;
     int res;
+    ecc_key *pKey = NULL;
+    ecc_key *cached = NULL;
+    unsigned char pub[WE_EC_MAX_POINT_SZ];
+    size_t pubLen;
 
     WOLFENGINE_ENTER("we_ecdsa_verify");
 
     /* Get the internal EC key object. */
     ret = (ecc = (we_Ecc *)EVP_PKEY_CTX_get_data(ctx)) != NULL;
-    if (ret == 1 && !ecc->pubKeySet) {
+    if (ret == 1) {
+        cached = ecc->cached;
+    }
+    if (ret == 1 && cached == NULL && !ecc->pubKeySet) {
         /* Get the OpenSSL EC_KEY object and set curve id. */
         ret = we_ec_get_ec_key(ctx, &ecKey, ecc);
-        if (ret == 1) {
-            /* Set the public key into the wolfSSL object. */
-            ret = we_ec_set_public(&ecc->key, ecc->curveId, ecKey);
-        }
-        if (ret == 1) {
-            /* Only do this once as public will not change. */
-            ecc->pubKeySet = 1;
+        if (ret == 1 && we_ec_pub_cache_enabled()) {
+            /* Look up key by public key as an uncompressed point. */
+            pubLen = we_ec_key_pub2oct(ecKey, pub);
+            if (pubLen == 0) {
+                ret = 0;
+            }
+            else {
+                ret = we_ec_pub_cache_get(ecc->curveId, pub, (int)pubLen,
+                                          &cached);
+            }
+            if (ret == 1) {
+                /* Keep key for further verifications with context. */
+                ecc->cached = cached;
+            }
+        }
+        if (ret == 1 && cached == NULL) {
+            /* Set the public key into the wolfSSL object. */
+            ret = we_ec_set_public(&ecc->key, ecc->curveId, ecKey);
+            if (ret == 1) {
+                /* Only do this once as public will not change. */
+                ecc->pubKeySet = 1;
+            }
         }
     }
     if (ret == 1) {
+        pKey = (cached != NULL) ? cached : &ecc->key;
+        if (cached != NULL) {
+            /* Cached key shared with other contexts. */
+            we_ec_pub_cache_lock(cached);
+        }
         /* Verify the signature with the data using wolfSSL. */
         rc = wc_ecc_verify_hash(sig, (word32)sigLen, tbs, (word32)tbsLen, &res,
-                                &ecc->key);
+                                pKey);
+        if (cached != NULL) {
+            we_ec_pub_cache_unlock(cached);
+        }
         if (rc != 0) {
             WOLFENGINE_ERROR_FUNC("wc_ecc_verify_hash", rc);
             ret = 0;
@@ -646,6 +1055,13 @@ static int we_ec_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY *pkey)
         }
     }
 
+#ifdef WE_HAVE_EC_KEY_POOL
+    /* Take a pre-generated key when available. */
+    if (ret == 1 && we_ec_key_pool_get(ecc->curveId, &ecc->key)) {
+        WOLFENGINE_MSG("Using EC key from pool");
+    }
+    else
+#endif
     if (ret == 1) {
         /* Generate a new EC key with wolfSSL. */
         rc = wc_ecc_make_key_ex(we_rng, len, &ecc->key, ecc->curveId);
@@ -670,9 +1086,72 @@ static int we_ec_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY *pkey)
 #endif /* WE_HAVE_ECKEYGEN */
 
 #ifdef WE_HAVE_ECDH
+#ifdef WE_HAVE_ECDH_X963_KDF
+/**
+ * Calculate the shared secret and derive a key from it with the X9.63 KDF.
+ *
+ * The shared secret is only held in a stack buffer that is zeroized before
+ * returning.
+ *
+ * @param  ecc     [in]  Internal EC object with private and peer key set.
+ * @param  key     [in]  Buffer to hold derived key.
+ * @param  keyLen  [in]  Length of key to derive.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_ecdh_derive_x963_kdf(we_Ecc *ecc, unsigned char *key,
+                                   size_t keyLen)
+{
+    int ret = 1, rc;
+    unsigned char secret[MAX_ECC_BYTES];
+    word32 secretLen = sizeof(secret);
+    enum wc_HashType hashType;
+
+    WOLFENGINE_ENTER("we_ecdh_derive_x963_kdf");
+
+    hashType = (enum wc_HashType)we_nid_to_wc_hash_type(
+        EVP_MD_type(ecc->kdfMd));
+    if (hashType == WC_HASH_TYPE_NONE) {
+        WOLFENGINE_ERROR_MSG("Unsupported KDF digest");
+        ret = 0;
+    }
+    if (ret == 1) {
+#if !defined(HAVE_FIPS) || \
+    (defined(HAVE_FIPS_VERSION) && HAVE_FIPS_VERSION != 2)
+        /* Context may have been created on another thread. */
+        (void)wc_ecc_set_rng(&ecc->key, we_rng);
+#endif
+        /* Calculate shared secret using wolfSSL. */
+        rc = wc_ecc_shared_secret(&ecc->key, &ecc->peer, secret, &secretLen);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_shared_secret", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* Derive key from shared secret with user keying material. */
+        rc = wc_X963_KDF(hashType, secret, secretLen, ecc->kdfUkm,
+                         (word32)ecc->kdfUkmLen, key, (word32)keyLen);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_X963_KDF", rc);
+            ret = 0;
+        }
+    }
+
+    /* Zeroize shared secret. */
+    OPENSSL_cleanse(secret, sizeof(secret));
+
+    WOLFENGINE_LEAVE("we_ecdh_derive_x963_kdf", ret);
+
+    return ret;
+}
+#endif /* WE_HAVE_ECDH_X963_KDF */
+
 /**
  * Derive a secret from the private key and peer key in the public key context.
  *
+ * When the X9.63 KDF has been set then the derived key is returned instead of
+ * the shared secret.
+ *
  * @param  ctx     [in]      Public key context of operation.
  * @param  key     [in]      Buffer to hold secret/key.
  *                           NULL indicates that only length is returned.
@@ -685,7 +1164,7 @@ static int we_ecdh_derive(EVP_PKEY_CTX *ctx, unsigned char *key, size_t *keyLen)
     we_Ecc *ecc;
     EC_KEY *ecKey = NULL;
     word32 len = (word32)*keyLen;
-    ecc_key peer;
+    int useKdf = 0;
 
     WOLFENGINE_ENTER("we_ecdh_derive");
 
@@ -704,7 +1183,27 @@ static int we_ecdh_derive(EVP_PKEY_CTX *ctx, unsigned char *key, size_t *keyLen)
         }
     }
 
-    if (ret == 1 && key == NULL) {
+#ifdef WE_HAVE_ECDH_X963_KDF
+    if (ret == 1 && ecc->kdfType == EVP_PKEY_ECDH_KDF_X9_63) {
+        if (key == NULL) {
+            /* Return length of key to derive. */
+            *keyLen = (size_t)ecc->kdfOutLen;
+        }
+        else if (!ecc->peerKeySet) {
+            WOLFENGINE_ERROR_MSG("Peer key not set");
+            ret = 0;
+        }
+        else if (ecc->kdfMd == NULL || *keyLen != (size_t)ecc->kdfOutLen) {
+            WOLFENGINE_ERROR_MSG("KDF digest or output length not set");
+            ret = 0;
+        }
+        else {
+            ret = we_ecdh_derive_x963_kdf(ecc, key, *keyLen);
+        }
+        useKdf = 1;
+    }
+#endif
+    if (ret == 1 && !useKdf && key == NULL) {
         /* Return secret size in bytes. */
         rc = wc_ecc_get_curve_size_from_id(ecc->curveId);
         if (rc < 0) {
@@ -713,41 +1212,26 @@ static int we_ecdh_derive(EVP_PKEY_CTX *ctx, unsigned char *key, size_t *keyLen)
             *keyLen = (size_t)rc;
         }
     }
-    if (ret == 1 && key != NULL) {
-        /* Create a new wolfSSL ECC key and set peer's public key. */
-        rc = wc_ecc_init(&peer);
+    if (ret == 1 && !useKdf && key != NULL && !ecc->peerKeySet) {
+        WOLFENGINE_ERROR_MSG("Peer key not set");
+        ret = 0;
+    }
+    if (ret == 1 && !useKdf && key != NULL) {
+#if !defined(HAVE_FIPS) || \
+    (defined(HAVE_FIPS_VERSION) && HAVE_FIPS_VERSION != 2)
+        /* Context may have been created on another thread. */
+        (void)wc_ecc_set_rng(&ecc->key, we_rng);
+#endif
+        /* Calculate shared secret using wolfSSL. Peer's public key was
+         * imported and validated when set. */
+        rc = wc_ecc_shared_secret(&ecc->key, &ecc->peer, key, &len);
         if (rc != 0) {
-            WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
+            WOLFENGINE_ERROR_FUNC("wc_ecc_shared_secret", rc);
             ret = 0;
-        } else {
-            /* Format of peer's public key point:
-             *   0x04 | x | y - x and y ordinates are equal length.
-             */
-            unsigned char *x = ecc->peerKey + 1;
-            unsigned char *y = x + ((ecc->peerKeyLen - 1) / 2);
-
-            /* Import public key into wolfSSL object. */
-            rc = wc_ecc_import_unsigned(&peer, x, y, NULL, ecc->curveId);
-            if (rc != 0) {
-                WOLFENGINE_ERROR_FUNC("wc_ecc_import_unsigned", rc);
-                ret = 0;
-            }
-
-            if (ret == 1) {
-                /* Calculate shared secret using wolfSSL. */
-                rc = wc_ecc_shared_secret(&ecc->key, &peer, key, &len);
-                if (rc != 0) {
-                    WOLFENGINE_ERROR_FUNC("wc_ecc_shared_secret", rc);
-                    ret = 0;
-                }
-            }
-            if (ret == 1) {
-                /* Return length of secret. */
-                *keyLen = len;
-            }
-
-            /* Free the temporary peer key. */
-            wc_ecc_free(&peer);
+        }
+        if (ret == 1) {
+            /* Return length of secret. */
+            *keyLen = len;
         }
     }
 
@@ -761,6 +1245,7 @@ static int we_ecdh_derive(EVP_PKEY_CTX *ctx, unsigned char *key, size_t *keyLen)
  * Extra operations for working with ECC.
  * Supported operations include:
  *  - EVP_PKEY_CTRL_MD: set the method used when digesting.
+ *  - EVP_PKEY_CTRL_EC_KDF_*: KDF applied to ECDH shared secret (X9.63 only).
  *
  * @param  ctx   [in]  Public key context of operation.
  * @param  type  [in]  Type of operation to perform.
@@ -775,6 +1260,9 @@ static int we_ec_ctrl(EVP_PKEY_CTX *ctx, int type, int num, void *ptr)
 #ifdef WE_HAVE_ECDH
     EVP_PKEY *peerKey;
     EC_KEY *ecPeerKey = NULL;
+    unsigned char peerBuf[WE_EC_MAX_POINT_SZ];
+    int peerBufLen = 0;
+    int peerCurveId;
 #endif
 
     (void)num;
@@ -812,9 +1300,8 @@ static int we_ec_ctrl(EVP_PKEY_CTX *ctx, int type, int num, void *ptr)
                 /* Get wolfSSL EC id from NID. */
                 ret = we_ec_get_curve_id(num, &ecc->curveId);
                 if (ret == 1) {
-                    /* Replace the EC_GROUP object. */
-                    EC_GROUP_free(ecc->group);
-                    ecc->group = EC_GROUP_new_by_curve_name(ecc->curveName);
+                    /* Use the shared EC_GROUP object - no allocation. */
+                    ecc->group = we_ec_get_group(ecc->curveName);
                     ret = ecc->group != NULL;
                 }
                 break;
@@ -833,15 +1320,104 @@ static int we_ec_ctrl(EVP_PKEY_CTX *ctx, int type, int num, void *ptr)
                 ret = (ecPeerKey = EVP_PKEY_get0_EC_KEY(peerKey)) != NULL;
             #endif
                 if (ret == 1) {
-                    /* Replace the peerKey data. */
-                    OPENSSL_free(ecc->peerKey);
+                    ret = we_ec_get_curve_id(EC_GROUP_get_curve_name(
+                        EC_KEY_get0_group(ecPeerKey)), &peerCurveId);
+                }
+                if (ret == 1) {
                     /* Get the EC key public key as an uncompressed point. */
-                    ecc->peerKeyLen = (int)EC_KEY_key2buf(ecPeerKey,
-                        POINT_CONVERSION_UNCOMPRESSED, &ecc->peerKey, NULL);
-                    if (ecc->peerKeyLen <= 0) {
+                    peerBufLen = (int)we_ec_key_pub2oct(ecPeerKey, peerBuf);
+                    if (peerBufLen == 0) {
                         ret = 0;
                     }
                 }
+                /* OpenSSL sets the same peer twice - import only once. */
+                if (ret == 1 && (!ecc->peerKeySet ||
+                                 peerBufLen != ecc->peerKeyLen ||
+                                 XMEMCMP(peerBuf, ecc->peerKey,
+                                         peerBufLen) != 0)) {
+                    /* Replace the peerKey data. */
+                    XMEMCPY(ecc->peerKey, peerBuf, peerBufLen);
+                    ecc->peerKeyLen = peerBufLen;
+                    /* Import and validate once - used for every derive. */
+                    ecc->peerKeySet = 0;
+                    ret = we_ec_import_peer(&ecc->peer, peerCurveId,
+                                            ecc->peerKey, ecc->peerKeyLen, 1);
+                    if (ret == 1) {
+                        ecc->peerKeySet = 1;
+                    }
+                }
+                break;
+        #endif
+
+        #ifdef WE_HAVE_ECDH_X963_KDF
+            /* Set or get the KDF to apply to the shared secret. */
+            case EVP_PKEY_CTRL_EC_KDF_TYPE:
+                WOLFENGINE_MSG("received type: EVP_PKEY_CTRL_EC_KDF_TYPE");
+                if (num == -2) {
+                    ret = ecc->kdfType;
+                }
+                else if (num == EVP_PKEY_ECDH_KDF_NONE ||
+                         num == EVP_PKEY_ECDH_KDF_X9_63) {
+                    ecc->kdfType = num;
+                }
+                else {
+                    WOLFENGINE_ERROR_MSG("Unsupported KDF type");
+                    ret = 0;
+                }
+                break;
+
+            /* Set the digest to use with the KDF. */
+            case EVP_PKEY_CTRL_EC_KDF_MD:
+                WOLFENGINE_MSG("received type: EVP_PKEY_CTRL_EC_KDF_MD");
+                if (ptr == NULL || we_nid_to_wc_hash_type(
+                        EVP_MD_type((const EVP_MD *)ptr)) ==
+                        WC_HASH_TYPE_NONE) {
+                    WOLFENGINE_ERROR_MSG("Unsupported KDF digest");
+                    ret = 0;
+                }
+                else {
+                    ecc->kdfMd = (const EVP_MD *)ptr;
+                }
+                break;
+
+            /* Get the digest to use with the KDF. */
+            case EVP_PKEY_CTRL_GET_EC_KDF_MD:
+                WOLFENGINE_MSG("received type: EVP_PKEY_CTRL_GET_EC_KDF_MD");
+                *(const EVP_MD **)ptr = ecc->kdfMd;
+                break;
+
+            /* Set the length of key to derive with the KDF. */
+            case EVP_PKEY_CTRL_EC_KDF_OUTLEN:
+                WOLFENGINE_MSG("received type: EVP_PKEY_CTRL_EC_KDF_OUTLEN");
+                if (num <= 0) {
+                    WOLFENGINE_ERROR_MSG("Invalid KDF output length");
+                    ret = 0;
+                }
+                else {
+                    ecc->kdfOutLen = num;
+                }
+                break;
+
+            /* Get the length of key to derive with the KDF. */
+            case EVP_PKEY_CTRL_GET_EC_KDF_OUTLEN:
+                WOLFENGINE_MSG(
+                        "received type: EVP_PKEY_CTRL_GET_EC_KDF_OUTLEN");
+                *(int *)ptr = ecc->kdfOutLen;
+                break;
+
+            /* Set the user keying material - takes ownership of buffer. */
+            case EVP_PKEY_CTRL_EC_KDF_UKM:
+                WOLFENGINE_MSG("received type: EVP_PKEY_CTRL_EC_KDF_UKM");
+                OPENSSL_free(ecc->kdfUkm);
+                ecc->kdfUkm = (unsigned char *)ptr;
+                ecc->kdfUkmLen = (ptr != NULL) ? num : 0;
+                break;
+
+            /* Get the user keying material - returns length. */
+            case EVP_PKEY_CTRL_GET_EC_KDF_UKM:
+                WOLFENGINE_MSG("received type: EVP_PKEY_CTRL_GET_EC_KDF_UKM");
+                *(unsigned char **)ptr = ecc->kdfUkm;
+                ret = ecc->kdfUkmLen;
                 break;
         #endif
 
@@ -882,11 +1458,18 @@ int we_init_ecc_meths(void)
 
     WOLFENGINE_ENTER("we_init_ecc_meths");
 
-    we_ec_method = EVP_PKEY_meth_new(EVP_PKEY_EC, 0);
-    if (we_ec_method == NULL) {
+#ifdef WE_HAVE_ECKEYGEN
+    /* Groups are shared by all public key contexts. */
+    ret = we_ec_groups_init();
+#endif
+
+    if (ret == 1) {
+        we_ec_method = EVP_PKEY_meth_new(EVP_PKEY_EC, 0);
+    }
+    if (ret == 1 && we_ec_method == NULL) {
         WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_meth_new", we_ec_method);
         ret = 0;
-    } else {
+    } else if (ret == 1) {
         EVP_PKEY_meth_set_init(we_ec_method, we_ec_init);
         EVP_PKEY_meth_set_copy(we_ec_method, we_ec_copy);
         EVP_PKEY_meth_set_cleanup(we_ec_method, we_ec_cleanup);
@@ -959,9 +1542,10 @@ int we_init_ecc_meths(void)
             EVP_PKEY_meth_free(we_ec_p384_method);
             we_ec_p384_method = NULL;
         }
-    }
 #endif
+        we_ec_groups_free();
 #endif
+    }
 
     WOLFENGINE_LEAVE("we_init_ecc_meths", ret);
 
@@ -970,168 +1554,1438 @@ int we_init_ecc_meths(void)
 
 #endif /* WE_HAVE_EVP_PKEY */
 
-#ifdef WE_HAVE_EC_KEY
-/* Method for using wolfSSL thorugh the EC_KEY API. */
-EC_KEY_METHOD *we_ec_key_method = NULL;
+#ifdef WE_HAVE_ECDSA
+/**
+ * Get the EC key of a batch item.
+ *
+ * @param  items  [in]  ECDSA verify items of batch.
+ * @param  idx    [in]  Index of item.
+ * @returns  OpenSSL EC key or NULL when item doesn't have an EC key.
+ */
+static const void *we_ecdsa_batch_get_key(const void *items, size_t idx)
+{
+    const WE_ECDSA_VERIFY_ITEM *item =
+        &((const WE_ECDSA_VERIFY_ITEM *)items)[idx];
+    const EC_KEY *ec = NULL;
+
+    if (item->pkey != NULL && EVP_PKEY_base_id(item->pkey) == EVP_PKEY_EC) {
+        ec = EVP_PKEY_get0_EC_KEY(item->pkey);
+    }
+
+    return ec;
+}
 
 /**
- * Generate an EC key for the group specified in key object.
+ * Verify a range of batch entries sorted by key.
  *
- * @param  key  [in/out]  Elliptic curve key object.
- * @erturns 1 on success and 0 on faulure.
+ * The public key is imported once for each run of entries with the same key.
+ *
+ * @param  items    [in]   ECDSA verify items of batch.
+ * @param  entries  [in]   Entries sorted by key.
+ * @param  start    [in]   Index of first entry to verify.
+ * @param  end      [in]   Index after last entry to verify.
+ * @param  ok       [out]  Result of each item - 1 when verified.
  */
-static int we_ec_key_keygen(EC_KEY *key)
+static void we_ecdsa_batch_verify_range(const void *items,
+                                        const we_BatchEntry *entries,
+                                        size_t start, size_t end,
+                                        unsigned char *ok)
 {
-    int ret = 1, rc;
+    size_t i;
+    const we_BatchEntry *entry;
+    const WE_ECDSA_VERIFY_ITEM *item;
+    const EC_KEY *ec = NULL;
+    ecc_key key;
     int curveId;
-    ecc_key ecc;
-    ecc_key* pEcc = NULL;
-    int len = 0;
-
-    WOLFENGINE_ENTER("we_ec_key_keygen");
+    int keyInited = 0;
+    int keySet = 0;
+    int res;
 
-    /* Get the wolfSSL EC curve id for the group. */
-    ret = we_ec_get_curve_id(EC_GROUP_get_curve_name(EC_KEY_get0_group(key)),
-                             &curveId);
-    if (ret == 1) {
-        len = wc_ecc_get_curve_size_from_id(curveId);
-        if (len < 0) {
-            WOLFENGINE_ERROR_FUNC("wc_ecc_get_curve_size_from_id", len);
-            ret = 0;
+    for (i = start; i < end; i++) {
+        entry = &entries[i];
+        item = &((const WE_ECDSA_VERIFY_ITEM *)items)[entry->idx];
 
-        } else {
-            /* Initialize a wolfSSL EC key object. */
-            rc = wc_ecc_init(&ecc);
-            if (rc != 0) {
-                WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
-                ret = 0;
+        if (entry->key != ec || !keyInited) {
+            /* Import the public key of the next group. */
+            if (keyInited) {
+                wc_ecc_free(&key);
+                keyInited = 0;
+            }
+            ec = (const EC_KEY *)entry->key;
+            keySet = 0;
+            if (wc_ecc_init(&key) == 0) {
+                keyInited = 1;
+                keySet = (ec != NULL) &&
+                         we_ec_get_curve_id(EC_GROUP_get_curve_name(
+                             EC_KEY_get0_group(ec)), &curveId) &&
+                         we_ec_set_public(&key, curveId, (EC_KEY *)ec);
+            }
+        }
+        if (keySet && item->digest != NULL && item->sig != NULL) {
+            res = 0;
+            if (wc_ecc_verify_hash(item->sig, (word32)item->sigLen,
+                                   item->digest, (word32)item->digestLen,
+                                   &res, &key) == 0) {
+                ok[entry->idx] = (unsigned char)(res == 1);
             }
         }
     }
-    if (ret == 1) {
-        pEcc = &ecc;
 
-        /* Generate key. */
-        rc = wc_ecc_make_key_ex(we_rng, len, &ecc, curveId);
-        if (rc != 0) {
-            WOLFENGINE_ERROR_FUNC("wc_ecc_make_key_ex", rc);
-            ret = 0;
-        }
+    if (keyInited) {
+        wc_ecc_free(&key);
     }
-    if (ret == 1) {
-        /* Export new key into EC_KEY object. */
-        ret = we_ec_export_key(&ecc, len, key);
+}
+
+/**
+ * Verify a batch of ECDSA signatures in parallel.
+ *
+ * Each signature is verified individually. Items are grouped by key so that
+ * each public key is imported once per run of items on a thread, and the
+ * items are spread over batch->threads threads. See we_batch_verify().
+ *
+ * @param  batch  [in/out]  Batch of signatures to verify and result bitmap.
+ * @returns  1 when the batch was processed and 0 on failure.
+ */
+int we_ecdsa_batch_verify(WE_ECDSA_BATCH_VERIFY *batch)
+{
+    int ret = 1;
+
+    WOLFENGINE_ENTER("we_ecdsa_batch_verify");
+
+    if (batch == NULL || batch->results == NULL ||
+        (batch->items == NULL && batch->cnt > 0)) {
+        WOLFENGINE_ERROR_MSG("Invalid ECDSA batch verify parameters");
+        ret = 0;
     }
 
-    wc_ecc_free(pEcc);
+    if (ret == 1) {
+        ret = we_batch_verify(batch->items, batch->cnt, batch->threads,
+                              we_ecdsa_batch_get_key,
+                              we_ecdsa_batch_verify_range, batch->results);
+    }
 
-    WOLFENGINE_LEAVE("we_ec_key_keygen", ret);
+    WOLFENGINE_LEAVE("we_ecdsa_batch_verify", ret);
 
     return ret;
 }
+#endif /* WE_HAVE_ECDSA */
 
+#ifdef WE_HAVE_ECKEYGEN
 /**
- * Compute the EC secret for ECDH using wolfSSL.
- *
- * @param  psec     [out]  Pointer to buffer holding secret. Allocated with
- *                         OPENSSL_malloc().
- * @param  pseclen  [out]  Pointer to length of secret.
- * @param  pub_key  [in]   Public EC point from peer.
- * @param  ecdh     [in]   EC KEY with private key.
+ * Range of key pairs in a batch to generate.
  */
-static int we_ec_key_compute_key(unsigned char **psec, size_t *pseclen,
-                                 const EC_POINT *pub_key, const EC_KEY *ecdh)
+typedef struct we_EcKeygenBatchWork
 {
-    int ret, rc;
-    ecc_key key;
-    ecc_key peer;
-    ecc_key *pKey = NULL;
-    ecc_key *pPeer = NULL;
+    /* Batch being generated. */
+    WE_EC_KEYGEN_BATCH *batch;
+    /* OpenSSL group for EVP_PKEY objects. NULL when not required. */
     const EC_GROUP *group;
+    /* wolfSSL curve identifier. */
     int curveId;
-    word32 len;
-    int peerKeyLen;
-    unsigned char* peerKey = NULL;
-    unsigned char* secret = NULL;
+    /* Size of curve in bytes. */
+    int len;
+    /* Index of first key pair to generate. */
+    size_t start;
+    /* Index after last key pair to generate. */
+    size_t end;
+    /* Result - 1 when all key pairs in range generated. */
+    int ok;
+} we_EcKeygenBatchWork;
 
-    WOLFENGINE_ENTER("we_ec_key_compute_key");
+/**
+ * Create an EVP_PKEY object holding the key pair in the wolfSSL key.
+ *
+ * @param  key    [in]   wolfSSL ECC key with key pair.
+ * @param  group  [in]   OpenSSL group of key.
+ * @param  len    [in]   Size of curve in bytes.
+ * @param  pkey   [out]  New EVP_PKEY object.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_ec_keygen_batch_pkey(ecc_key *key, const EC_GROUP *group,
+                                   int len, EVP_PKEY **pkey)
+{
+    int ret;
+    EC_KEY *ec = NULL;
+    EVP_PKEY *p = NULL;
 
-    /* Get wolfSSL curve id for EC group. */
-    group = EC_KEY_get0_group(ecdh);
-    ret = we_ec_get_curve_id(EC_GROUP_get_curve_name(group), &curveId);
+    ret = (ec = EC_KEY_new()) != NULL;
     if (ret == 1) {
-        peerKeyLen = (int)EC_POINT_point2buf(group, pub_key,
-                                             POINT_CONVERSION_UNCOMPRESSED,
-                                             &peerKey, NULL);
-        ret = peerKey != NULL;
+        /* Group copied into EC_KEY. */
+        ret = EC_KEY_set_group(ec, group);
     }
     if (ret == 1) {
-        rc = wc_ecc_get_curve_size_from_id(curveId);
-        if (rc < 0) {
-            WOLFENGINE_ERROR_FUNC("wc_ecc_get_curve_size_from_id", rc);
-            ret = 0;
-        } else {
-            len = (word32)rc;
-        }
+        ret = we_ec_export_key(key, len, ec);
     }
     if (ret == 1) {
-        /* Allocate the buffer to hold secret. Freed externally. */
-        ret = (secret = (unsigned char *)OPENSSL_malloc(len)) != NULL;
+        ret = (p = EVP_PKEY_new()) != NULL;
     }
     if (ret == 1) {
-        /* Initialize the wolfSSL private key object. */
-        rc = wc_ecc_init(&key);
-        if (rc != 0) {
-            WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
-            ret = 0;
+        ret = EVP_PKEY_assign_EC_KEY(p, ec);
+        if (ret == 1) {
+            /* EVP_PKEY owns EC_KEY now. */
+            ec = NULL;
         }
     }
-#if !defined(HAVE_FIPS) || \
-    (defined(HAVE_FIPS_VERSION) && HAVE_FIPS_VERSION != 2)
     if (ret == 1) {
-        /* Set RNG for side-channel resistant code. */
-        rc = wc_ecc_set_rng(&key, we_rng);
-        if (rc != 0) {
-            WOLFENGINE_ERROR_FUNC("wc_ecc_set_rng", rc);
-            ret = 0;
-        }
+        *pkey = p;
+        p = NULL;
     }
-#endif /* !HAVE_FIPS || (HAVE_FIPS_VERSION && HAVE_FIPS_VERSION != 2) */
-    if (ret == 1) {
-        pKey = &key;
 
-        /* Set private key into wolfSSL key object. */
-        ret = we_ec_set_private(pKey, curveId, ecdh);
-    }
-    if (ret == 1) {
-        /* Initialize wolfSSL ECC key for peer's public key. */
-        rc = wc_ecc_init(&peer);
-        if (rc != 0) {
-            WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
-            ret = 0;
-        }
-    }
-    if (ret == 1) {
-        unsigned char *x = peerKey + 1;
-        unsigned char *y = x + ((peerKeyLen - 1) / 2);
+    EVP_PKEY_free(p);
+    EC_KEY_free(ec);
 
-        pPeer = &peer;
+    return ret;
+}
 
-        /* Import the public point into wolfSSL key object. */
-        rc = wc_ecc_import_unsigned(pPeer, x, y, NULL, curveId);
-        if (rc != 0) {
-            WOLFENGINE_ERROR_FUNC("wc_ecc_import_unsigned", rc);
-            ret = 0;
-        }
+/**
+ * Generate a range of key pairs in a batch.
+ *
+ * Each range uses its own random number generator. When wolfSSL is built
+ * with FP_ECC, the fixed-base table of the thread is reused for all key pairs
+ * in the range.
+ *
+ * @param  work  [in/out]  Range of key pairs to generate and result.
+ */
+static void we_ec_keygen_batch_range(we_EcKeygenBatchWork *work)
+{
+    int ret = 1, rc;
+    size_t i;
+    WC_RNG rng;
+    ecc_key key;
+    int rngInited = 0;
+    int keyInited;
+    unsigned char *x;
+    word32 xLen, yLen, dLen;
+    WE_EC_KEYGEN_BATCH *batch = work->batch;
+
+    rc = wc_InitRng(&rng);
+    if (rc != 0) {
+        WOLFENGINE_ERROR_FUNC("wc_InitRng", rc);
+        ret = 0;
     }
-    if (ret == 1) {
-        /* Calculate shared secret. */
-        rc = wc_ecc_shared_secret(pKey, pPeer, secret, &len);
+    else {
+        rngInited = 1;
+    }
+
+    for (i = work->start; ret == 1 && i < work->end; i++) {
+        keyInited = 0;
+        rc = wc_ecc_init(&key);
         if (rc != 0) {
-            WOLFENGINE_ERROR_FUNC("wc_ecc_shared_secret", rc);
+            WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
             ret = 0;
         }
+        else {
+            keyInited = 1;
+        }
+        if (ret == 1) {
+            rc = wc_ecc_make_key_ex(&rng, work->len, &key, work->curveId);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("wc_ecc_make_key_ex", rc);
+                ret = 0;
+            }
+        }
+        if (ret == 1 && batch->raw != NULL) {
+            /* x | y | d - each padded to the size of the curve. */
+            x = batch->raw + i * 3 * work->len;
+            xLen = yLen = dLen = (word32)work->len;
+            rc = wc_ecc_export_private_raw(&key, x, &xLen, x + work->len,
+                                           &yLen, x + 2 * work->len, &dLen);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("wc_ecc_export_private_raw", rc);
+                ret = 0;
+            }
+        }
+        if (ret == 1 && batch->pkeys != NULL) {
+            ret = we_ec_keygen_batch_pkey(&key, work->group, work->len,
+                                          &batch->pkeys[i]);
+        }
+        if (keyInited) {
+            wc_ecc_free(&key);
+        }
+    }
+
+    if (rngInited) {
+        wc_FreeRng(&rng);
+    }
+    work->ok = ret;
+}
+
+#ifdef WE_HAVE_THREADS
+/**
+ * Thread entry point to generate a range of key pairs.
+ *
+ * @param  arg  [in]  Range of key pairs to generate.
+ * @returns  NULL.
+ */
+static void *we_ec_keygen_batch_worker(void *arg)
+{
+    we_ec_keygen_batch_range((we_EcKeygenBatchWork *)arg);
+#ifdef FP_ECC
+    /* Free the fixed-base table cache of this thread. */
+    wc_ecc_fp_free();
+#endif
+
+    return NULL;
+}
+#endif /* WE_HAVE_THREADS */
+
+/**
+ * Generate a batch of EC key pairs.
+ *
+ * The curve lookup and the OpenSSL group are set up once for the batch. The
+ * key pairs are split evenly over the threads. On failure, no key pairs are
+ * returned.
+ *
+ * @param  batch  [in/out]  Batch parameters and output buffers.
+ * @returns  1 when all key pairs were generated and 0 on failure.
+ */
+int we_ec_keygen_batch(WE_EC_KEYGEN_BATCH *batch)
+{
+    int ret = 1;
+    size_t i;
+    int t;
+    int threads = 1;
+    int curveId = 0;
+    int len = 0;
+    EC_GROUP *group = NULL;
+    we_EcKeygenBatchWork work[MAX_BATCH_KEYGEN_THREADS];
+#ifdef WE_HAVE_THREADS
+    pthread_t thread[MAX_BATCH_KEYGEN_THREADS];
+    int started[MAX_BATCH_KEYGEN_THREADS];
+#endif
+
+    WOLFENGINE_ENTER("we_ec_keygen_batch");
+
+    if (batch == NULL ||
+        (batch->cnt > 0 && batch->raw == NULL && batch->pkeys == NULL)) {
+        WOLFENGINE_ERROR_MSG("Invalid EC batch keygen parameters");
+        ret = 0;
+    }
+    if (ret == 1) {
+        ret = we_ec_get_curve_id(batch->curveNid, &curveId);
+    }
+    if (ret == 1) {
+        len = wc_ecc_get_curve_size_from_id(curveId);
+        if (len <= 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_get_curve_size_from_id", len);
+            ret = 0;
+        }
+    }
+    if (ret == 1 && batch->pkeys != NULL) {
+        /* One group for the batch - copied into each EC_KEY. */
+        group = EC_GROUP_new_by_curve_name(batch->curveNid);
+        if (group == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("EC_GROUP_new_by_curve_name", group);
+            ret = 0;
+        }
+        for (i = 0; i < batch->cnt; i++) {
+            batch->pkeys[i] = NULL;
+        }
+    }
+
+    if (ret == 1 && batch->cnt > 0) {
+#ifdef WE_HAVE_THREADS
+        if (batch->threads > 1) {
+            threads = batch->threads;
+            if (threads > MAX_BATCH_KEYGEN_THREADS) {
+                threads = MAX_BATCH_KEYGEN_THREADS;
+            }
+            if ((size_t)threads > batch->cnt) {
+                threads = (int)batch->cnt;
+            }
+        }
+#endif
+        for (t = 0; t < threads; t++) {
+            work[t].batch = batch;
+            work[t].group = group;
+            work[t].curveId = curveId;
+            work[t].len = len;
+            work[t].start = (batch->cnt * t) / threads;
+            work[t].end = (batch->cnt * (t + 1)) / threads;
+            work[t].ok = 0;
+        }
+
+#ifdef WE_HAVE_THREADS
+        for (t = 1; t < threads; t++) {
+            started[t] = pthread_create(&thread[t], NULL,
+                                        we_ec_keygen_batch_worker,
+                                        &work[t]) == 0;
+            if (!started[t]) {
+                /* Generate range on calling thread instead. */
+                WOLFENGINE_ERROR_MSG("Failed to start batch keygen thread");
+                we_ec_keygen_batch_range(&work[t]);
+            }
+        }
+#endif
+        we_ec_keygen_batch_range(&work[0]);
+#ifdef WE_HAVE_THREADS
+        for (t = 1; t < threads; t++) {
+            if (started[t]) {
+                pthread_join(thread[t], NULL);
+            }
+        }
+#endif
+        for (t = 0; t < threads; t++) {
+            if (!work[t].ok) {
+                ret = 0;
+            }
+        }
+
+        if (ret == 0) {
+            /* Don't return a partial batch. */
+            if (batch->pkeys != NULL) {
+                for (i = 0; i < batch->cnt; i++) {
+                    EVP_PKEY_free(batch->pkeys[i]);
+                    batch->pkeys[i] = NULL;
+                }
+            }
+            if (batch->raw != NULL) {
+                OPENSSL_cleanse(batch->raw, batch->cnt * 3 * len);
+            }
+        }
+    }
+
+    EC_GROUP_free(group);
+
+    WOLFENGINE_LEAVE("we_ec_keygen_batch", ret);
+
+    return ret;
+}
+#endif /* WE_HAVE_ECKEYGEN */
+
+#ifdef WE_HAVE_ECDH
+/**
+ * Range of peers to derive secrets with.
+ */
+typedef struct we_EcdhMultiWork
+{
+    /* Peers, output secrets and number of threads. */
+    WE_ECDH_MULTI_DERIVE *derive;
+    /* Private key - big-endian, size of curve. */
+    const unsigned char *priv;
+    /* wolfSSL curve identifier. */
+    int curveId;
+    /* Size of curve in bytes. */
+    int len;
+    /* Index of first peer to derive secret with. */
+    size_t start;
+    /* Index after last peer to derive secret with. */
+    size_t end;
+    /* Result of each peer - 1 when secret derived. */
+    unsigned char *ok;
+} we_EcdhMultiWork;
+
+/**
+ * Derive the secrets with a range of peers.
+ *
+ * The private key is imported once for the range. Each peer's public key is
+ * imported and validated before use. Secrets of peers that fail are zeroized.
+ *
+ * @param  work  [in/out]  Range of peers and results.
+ */
+static void we_ecdh_multi_derive_range(we_EcdhMultiWork *work)
+{
+    int ret = 1, rc;
+    size_t i;
+    WC_RNG rng;
+    ecc_key key;
+    ecc_key peer;
+    int rngInited = 0;
+    int keyInited = 0;
+    int peerInited = 0;
+    word32 outLen;
+    unsigned char *secret;
+    const WE_ECDH_PEER *item;
+
+    rc = wc_InitRng(&rng);
+    if (rc != 0) {
+        WOLFENGINE_ERROR_FUNC("wc_InitRng", rc);
+        ret = 0;
+    }
+    else {
+        rngInited = 1;
+    }
+    if (ret == 1) {
+        rc = wc_ecc_init(&key);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
+            ret = 0;
+        }
+        else {
+            keyInited = 1;
+        }
+    }
+    if (ret == 1) {
+        rc = wc_ecc_init(&peer);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
+            ret = 0;
+        }
+        else {
+            peerInited = 1;
+        }
+    }
+    if (ret == 1) {
+        /* Import private key once for all peers in range. */
+        rc = wc_ecc_import_private_key_ex(work->priv, (word32)work->len, NULL,
+                                          0, &key, work->curveId);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_import_private_key_ex", rc);
+            ret = 0;
+        }
+    }
+#if !defined(HAVE_FIPS) || \
+    (defined(HAVE_FIPS_VERSION) && HAVE_FIPS_VERSION != 2)
+    if (ret == 1) {
+        /* Random number generator of this thread for blinding. */
+        rc = wc_ecc_set_rng(&key, &rng);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_set_rng", rc);
+            ret = 0;
+        }
+    }
+#endif /* !HAVE_FIPS || (HAVE_FIPS_VERSION && HAVE_FIPS_VERSION != 2) */
+
+    for (i = work->start; ret == 1 && i < work->end; i++) {
+        item = &work->derive->peers[i];
+        secret = work->derive->secrets + i * work->len;
+        work->ok[i] = (item->point != NULL) &&
+                      we_ec_import_peer(&peer, work->curveId, item->point,
+                                        (int)item->pointLen, 1);
+        if (work->ok[i]) {
+            outLen = (word32)work->len;
+            rc = wc_ecc_shared_secret(&key, &peer, secret, &outLen);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("wc_ecc_shared_secret", rc);
+            }
+            work->ok[i] = (rc == 0) && (outLen == (word32)work->len);
+        }
+        if (!work->ok[i]) {
+            OPENSSL_cleanse(secret, work->len);
+        }
+    }
+
+    if (peerInited) {
+        wc_ecc_free(&peer);
+    }
+    if (keyInited) {
+        wc_ecc_free(&key);
+    }
+    if (rngInited) {
+        wc_FreeRng(&rng);
+    }
+}
+
+#ifdef WE_HAVE_THREADS
+/**
+ * Thread entry point to derive the secrets with a range of peers.
+ *
+ * @param  arg  [in]  Range of peers.
+ * @returns  NULL.
+ */
+static void *we_ecdh_multi_derive_worker(void *arg)
+{
+    we_ecdh_multi_derive_range((we_EcdhMultiWork *)arg);
+
+    return NULL;
+}
+#endif /* WE_HAVE_THREADS */
+
+/**
+ * Derive the shared secrets of one private key with many peers.
+ *
+ * The private key is encoded once and imported once per thread. The peers
+ * are split evenly over the threads.
+ *
+ * @param  derive  [in/out]  Private key, peers, secrets and result bitmap.
+ * @returns  1 when the peers were processed and 0 on failure.
+ */
+int we_ecdh_multi_derive(WE_ECDH_MULTI_DERIVE *derive)
+{
+    int ret = 1;
+    size_t i;
+    int t;
+    int threads = 1;
+    int curveId = 0;
+    int len = 0;
+    const EC_KEY *ec = NULL;
+    unsigned char priv[MAX_ECC_BYTES];
+    unsigned char *ok = NULL;
+    we_EcdhMultiWork work[MAX_MULTI_DERIVE_THREADS];
+#ifdef WE_HAVE_THREADS
+    pthread_t thread[MAX_MULTI_DERIVE_THREADS];
+    int started[MAX_MULTI_DERIVE_THREADS];
+#endif
+
+    WOLFENGINE_ENTER("we_ecdh_multi_derive");
+
+    if (derive == NULL || derive->pkey == NULL || derive->results == NULL ||
+        (derive->cnt > 0 &&
+         (derive->peers == NULL || derive->secrets == NULL))) {
+        WOLFENGINE_ERROR_MSG("Invalid ECDH multi-peer derive parameters");
+        ret = 0;
+    }
+    if (ret == 1 && EVP_PKEY_base_id(derive->pkey) != EVP_PKEY_EC) {
+        WOLFENGINE_ERROR_MSG("Private key is not an EC key");
+        ret = 0;
+    }
+    if (ret == 1) {
+        ec = EVP_PKEY_get0_EC_KEY(derive->pkey);
+        if (ec == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_get0_EC_KEY", (EC_KEY *)ec);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        ret = we_ec_get_curve_id(EC_GROUP_get_curve_name(
+            EC_KEY_get0_group(ec)), &curveId);
+    }
+    if (ret == 1) {
+        len = wc_ecc_get_curve_size_from_id(curveId);
+        if (len <= 0 || len > MAX_ECC_BYTES) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_get_curve_size_from_id", len);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* Encode private key once - padded to the size of the curve. */
+        if (EC_KEY_priv2oct(ec, priv, sizeof(priv)) != (size_t)len) {
+            WOLFENGINE_ERROR_MSG("Failed to encode EC private key");
+            ret = 0;
+        }
+    }
+    if (ret == 1 && derive->cnt > 0) {
+        ok = (unsigned char *)OPENSSL_zalloc(derive->cnt);
+        if (ok == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_zalloc", ok);
+            ret = 0;
+        }
+    }
+
+    if (ret == 1 && derive->cnt > 0) {
+#ifdef WE_HAVE_THREADS
+        if (derive->threads > 1) {
+            threads = derive->threads;
+            if (threads > MAX_MULTI_DERIVE_THREADS) {
+                threads = MAX_MULTI_DERIVE_THREADS;
+            }
+            if ((size_t)threads > derive->cnt) {
+                threads = (int)derive->cnt;
+            }
+        }
+#endif
+        for (t = 0; t < threads; t++) {
+            work[t].derive = derive;
+            work[t].priv = priv;
+            work[t].curveId = curveId;
+            work[t].len = len;
+            work[t].start = (derive->cnt * t) / threads;
+            work[t].end = (derive->cnt * (t + 1)) / threads;
+            work[t].ok = ok;
+        }
+
+#ifdef WE_HAVE_THREADS
+        for (t = 1; t < threads; t++) {
+            started[t] = pthread_create(&thread[t], NULL,
+                                        we_ecdh_multi_derive_worker,
+                                        &work[t]) == 0;
+            if (!started[t]) {
+                /* Derive range on calling thread instead. */
+                WOLFENGINE_ERROR_MSG("Failed to start multi derive thread");
+                we_ecdh_multi_derive_range(&work[t]);
+            }
+        }
+#endif
+        we_ecdh_multi_derive_range(&work[0]);
+#ifdef WE_HAVE_THREADS
+        for (t = 1; t < threads; t++) {
+            if (started[t]) {
+                pthread_join(thread[t], NULL);
+            }
+        }
+#endif
+    }
+
+    if (ret == 1) {
+        XMEMSET(derive->results, 0, (derive->cnt + 7) / 8);
+        for (i = 0; i < derive->cnt; i++) {
+            if (ok[i] == 1) {
+                derive->results[i / 8] |= (unsigned char)(1 << (i % 8));
+            }
+            else {
+                /* Range failed before peer processed. */
+                OPENSSL_cleanse(derive->secrets + i * len, len);
+            }
+        }
+    }
+
+    /* Zeroize private key data. */
+    OPENSSL_cleanse(priv, sizeof(priv));
+    OPENSSL_free(ok);
+
+    WOLFENGINE_LEAVE("we_ecdh_multi_derive", ret);
+
+    return ret;
+}
+#endif /* WE_HAVE_ECDH */
+
+#ifdef WE_HAVE_EC_KEY
+/* Method for using wolfSSL thorugh the EC_KEY API. */
+EC_KEY_METHOD *we_ec_key_method = NULL;
+
+/**
+ * wolfSSL ECC keys imported from an EC_KEY object.
+ *
+ * Stored in the EC_KEY's ex_data so that repeated operations with the same key
+ * don't encode and import the key each time. Invalidated when the group,
+ * private key or public key of the EC_KEY object is set.
+ *
+ * Created when the EC_KEY method is set on the object, before the object can
+ * be shared between threads. The lock is held for reading while a key is used
+ * and for writing while a key is imported or discarded. wolfSSL keys hold
+ * state while in use so each key also has a mutex, held while it is used, that
+ * serializes operations on the key.
+ */
+typedef struct we_EcKeyCache {
+#ifdef WE_HAVE_THREADS
+    /* Protects importing and discarding the private and public keys. */
+    pthread_rwlock_t lock;
+    /* Serializes use of the private key. */
+    pthread_mutex_t privMutex;
+    /* Serializes use of the public key. */
+    pthread_mutex_t pubMutex;
+    /* Protects the peer key - held across compare, import and derive. */
+    pthread_mutex_t peerMutex;
+#endif
+    /* wolfSSL key with private key imported. */
+    ecc_key priv;
+    /* wolfSSL key with public key imported. */
+    ecc_key pub;
+    /* wolfSSL key with last ECDH peer's public key imported. */
+    ecc_key peer;
+    /* Last ECDH peer's public point - compared to skip import. */
+    EC_POINT *peerPt;
+    /* Indicates private key has been imported. */
+    int privSet:1;
+    /* Indicates public key has been imported. */
+    int pubSet:1;
+    /* Indicates peer's public key has been imported. */
+    int peerSet:1;
+} we_EcKeyCache;
+
+#ifdef WE_HAVE_THREADS
+#define WE_EC_KEY_CACHE_READ_LOCK(c)    pthread_rwlock_rdlock(&(c)->lock)
+#define WE_EC_KEY_CACHE_WRITE_LOCK(c)   pthread_rwlock_wrlock(&(c)->lock)
+#define WE_EC_KEY_CACHE_UNLOCK(c)       pthread_rwlock_unlock(&(c)->lock)
+#define WE_EC_KEY_PEER_LOCK(c)          pthread_mutex_lock(&(c)->peerMutex)
+#define WE_EC_KEY_PEER_UNLOCK(c)        pthread_mutex_unlock(&(c)->peerMutex)
+#define WE_EC_KEY_USE_LOCK(c, priv)                                     \
+    pthread_mutex_lock((priv) ? &(c)->privMutex : &(c)->pubMutex)
+#define WE_EC_KEY_USE_UNLOCK(c, priv)                                   \
+    pthread_mutex_unlock((priv) ? &(c)->privMutex : &(c)->pubMutex)
+#else
+/* Engine is only used from one thread at a time without thread support. */
+#define WE_EC_KEY_CACHE_READ_LOCK(c)
+#define WE_EC_KEY_CACHE_WRITE_LOCK(c)
+#define WE_EC_KEY_CACHE_UNLOCK(c)
+#define WE_EC_KEY_PEER_LOCK(c)
+#define WE_EC_KEY_PEER_UNLOCK(c)
+#define WE_EC_KEY_USE_LOCK(c, priv)
+#define WE_EC_KEY_USE_UNLOCK(c, priv)
+#endif
+
+/* Index of cached keys in EC_KEY ex_data. */
+static int we_ec_key_ex_idx = -1;
+
+/**
+ * Free the cached wolfSSL keys when the EC_KEY object is freed.
+ *
+ * @param  parent  [in]  EC_KEY object. Unused.
+ * @param  ptr     [in]  Cached keys. May be NULL.
+ * @param  ad      [in]  Extra data of EC_KEY object. Unused.
+ * @param  idx     [in]  Index of extra data. Unused.
+ * @param  argl    [in]  Long argument. Unused.
+ * @param  argp    [in]  Pointer argument. Unused.
+ */
+static void we_ec_key_cache_free(void *parent, void *ptr, CRYPTO_EX_DATA *ad,
+                                 int idx, long argl, void *argp)
+{
+    we_EcKeyCache *cache = (we_EcKeyCache *)ptr;
+
+    (void)parent;
+    (void)ad;
+    (void)idx;
+    (void)argl;
+    (void)argp;
+
+    if (cache != NULL) {
+        EC_POINT_free(cache->peerPt);
+        wc_ecc_free(&cache->peer);
+        wc_ecc_free(&cache->pub);
+        wc_ecc_free(&cache->priv);
+#ifdef WE_HAVE_THREADS
+        pthread_mutex_destroy(&cache->pubMutex);
+        pthread_mutex_destroy(&cache->privMutex);
+        pthread_mutex_destroy(&cache->peerMutex);
+        pthread_rwlock_destroy(&cache->lock);
+#endif
+        OPENSSL_free(cache);
+    }
+}
+
+/**
+ * Don't share the cached wolfSSL keys when the EC_KEY object is duplicated.
+ *
+ * The new EC_KEY object keeps its own cached keys, if any. The copy method
+ * creates them when missing.
+ *
+ * @param  to     [in]      Extra data of new EC_KEY object.
+ * @param  from   [in]      Extra data of EC_KEY object duplicated. Unused.
+ * @param  fromD  [in/out]  Pointer to cached keys to be set into new object.
+ * @param  idx    [in]      Index of extra data.
+ * @param  argl   [in]      Long argument. Unused.
+ * @param  argp   [in]      Pointer argument. Unused.
+ * @returns  1 always.
+ */
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+static int we_ec_key_cache_dup(CRYPTO_EX_DATA *to, const CRYPTO_EX_DATA *from,
+                               void **fromD, int idx, long argl, void *argp)
+#else
+static int we_ec_key_cache_dup(CRYPTO_EX_DATA *to, const CRYPTO_EX_DATA *from,
+                               void *fromD, int idx, long argl, void *argp)
+#endif
+{
+    (void)from;
+    (void)argl;
+    (void)argp;
+
+    *(void **)fromD = CRYPTO_get_ex_data(to, idx);
+
+    return 1;
+}
+
+/**
+ * Discard cached wolfSSL keys so that they are imported again on next use.
+ *
+ * Must be called with the cache lock held for writing.
+ *
+ * @param  cache  [in]  Cached keys.
+ * @param  priv   [in]  Discard private key.
+ * @param  pub    [in]  Discard public key.
+ */
+static void we_ec_key_cache_clear(we_EcKeyCache *cache, int priv, int pub)
+{
+    if (priv) {
+        wc_ecc_free(&cache->priv);
+        (void)wc_ecc_init(&cache->priv);
+#if !defined(HAVE_FIPS) || \
+    (defined(HAVE_FIPS_VERSION) && HAVE_FIPS_VERSION != 2)
+        (void)wc_ecc_set_rng(&cache->priv, we_rng);
+#endif
+        cache->privSet = 0;
+    }
+    if (pub) {
+        wc_ecc_free(&cache->pub);
+        (void)wc_ecc_init(&cache->pub);
+        cache->pubSet = 0;
+    }
+}
+
+/**
+ * Create the cached wolfSSL keys of an EC_KEY object.
+ *
+ * Called while the EC_KEY object is set up and not yet shared. When the
+ * object already has cached keys, they are discarded instead.
+ *
+ * @param  ecKey  [in]  OpenSSL EC key.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_ec_key_cache_new(EC_KEY *ecKey)
+{
+    int ret = 1, rc;
+    int locks = 0;
+    we_EcKeyCache *cache;
+
+    cache = (we_EcKeyCache *)EC_KEY_get_ex_data(ecKey, we_ec_key_ex_idx);
+    if (cache != NULL) {
+        WE_EC_KEY_CACHE_WRITE_LOCK(cache);
+        we_ec_key_cache_clear(cache, 1, 1);
+        WE_EC_KEY_CACHE_UNLOCK(cache);
+        cache = NULL;
+    }
+    else {
+        cache = (we_EcKeyCache *)OPENSSL_zalloc(sizeof(*cache));
+        if (cache == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_zalloc", cache);
+            ret = 0;
+        }
+#ifdef WE_HAVE_THREADS
+        if (ret == 1) {
+            rc = pthread_rwlock_init(&cache->lock, NULL);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("pthread_rwlock_init", rc);
+                ret = 0;
+            }
+            else {
+                locks = 1;
+            }
+        }
+        if (ret == 1) {
+            rc = pthread_mutex_init(&cache->peerMutex, NULL);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("pthread_mutex_init", rc);
+                ret = 0;
+            }
+            else {
+                locks = 2;
+            }
+        }
+        if (ret == 1) {
+            rc = pthread_mutex_init(&cache->privMutex, NULL);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("pthread_mutex_init", rc);
+                ret = 0;
+            }
+            else {
+                locks = 3;
+            }
+        }
+        if (ret == 1) {
+            rc = pthread_mutex_init(&cache->pubMutex, NULL);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("pthread_mutex_init", rc);
+                ret = 0;
+            }
+            else {
+                locks = 4;
+            }
+        }
+#endif
+        if (ret == 1) {
+            rc = wc_ecc_init(&cache->priv);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
+                ret = 0;
+            }
+        }
+        if (ret == 1) {
+            rc = wc_ecc_init(&cache->pub);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
+                wc_ecc_free(&cache->priv);
+                ret = 0;
+            }
+        }
+        if (ret == 1) {
+            rc = wc_ecc_init(&cache->peer);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
+                wc_ecc_free(&cache->pub);
+                wc_ecc_free(&cache->priv);
+                ret = 0;
+            }
+        }
+#if !defined(HAVE_FIPS) || \
+    (defined(HAVE_FIPS_VERSION) && HAVE_FIPS_VERSION != 2)
+        if (ret == 1) {
+            /* Set RNG for side-channel resistant code. */
+            rc = wc_ecc_set_rng(&cache->priv, we_rng);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("wc_ecc_set_rng", rc);
+            }
+        }
+#endif /* !HAVE_FIPS || (HAVE_FIPS_VERSION && HAVE_FIPS_VERSION != 2) */
+        if (ret == 1) {
+            rc = EC_KEY_set_ex_data(ecKey, we_ec_key_ex_idx, cache);
+            if (rc != 1) {
+                WOLFENGINE_ERROR_FUNC("EC_KEY_set_ex_data", rc);
+                we_ec_key_cache_free(NULL, cache, NULL, 0, 0, NULL);
+                cache = NULL;
+                ret = 0;
+            }
+        }
+        if (ret == 0 && cache != NULL) {
+#ifdef WE_HAVE_THREADS
+            if (locks == 4) {
+                pthread_mutex_destroy(&cache->pubMutex);
+            }
+            if (locks >= 3) {
+                pthread_mutex_destroy(&cache->privMutex);
+            }
+            if (locks >= 2) {
+                pthread_mutex_destroy(&cache->peerMutex);
+            }
+            if (locks >= 1) {
+                pthread_rwlock_destroy(&cache->lock);
+            }
+#endif
+            OPENSSL_free(cache);
+        }
+    }
+    (void)locks;
+
+    return ret;
+}
+
+/**
+ * Create the cached wolfSSL keys when the EC_KEY method is set on an object.
+ *
+ * @param  ecKey  [in]  OpenSSL EC key.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_ec_key_init(EC_KEY *ecKey)
+{
+    int ret;
+
+    WOLFENGINE_ENTER("we_ec_key_init");
+
+    ret = we_ec_key_cache_new(ecKey);
+
+    WOLFENGINE_LEAVE("we_ec_key_init", ret);
+
+    return ret;
+}
+
+/**
+ * Create or discard the cached wolfSSL keys of an EC_KEY object being copied
+ * into.
+ *
+ * @param  dest  [in]  OpenSSL EC key copied into.
+ * @param  src   [in]  OpenSSL EC key copied from. Unused.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_ec_key_copy(EC_KEY *dest, const EC_KEY *src)
+{
+    int ret;
+
+    WOLFENGINE_ENTER("we_ec_key_copy");
+
+    (void)src;
+
+    ret = we_ec_key_cache_new(dest);
+
+    WOLFENGINE_LEAVE("we_ec_key_copy", ret);
+
+    return ret;
+}
+
+/**
+ * Get the cached wolfSSL keys of an EC_KEY object.
+ *
+ * @param  ecKey  [in]  OpenSSL EC key.
+ * @returns  Cached keys on success and NULL on failure.
+ */
+static we_EcKeyCache *we_ec_key_get_cache(const EC_KEY *ecKey)
+{
+    we_EcKeyCache *cache;
+
+    cache = (we_EcKeyCache *)EC_KEY_get_ex_data(ecKey, we_ec_key_ex_idx);
+    if (cache == NULL) {
+        WOLFENGINE_ERROR_MSG("EC_KEY has no cached wolfSSL keys");
+    }
+
+    return cache;
+}
+
+/**
+ * Discard cached wolfSSL keys so that they are imported again on next use.
+ *
+ * @param  ecKey  [in]  OpenSSL EC key.
+ * @param  priv   [in]  Discard private key.
+ * @param  pub    [in]  Discard public key.
+ */
+static void we_ec_key_invalidate(const EC_KEY *ecKey, int priv, int pub)
+{
+    we_EcKeyCache *cache;
+
+    cache = (we_EcKeyCache *)EC_KEY_get_ex_data(ecKey, we_ec_key_ex_idx);
+    if (cache != NULL) {
+        WE_EC_KEY_CACHE_WRITE_LOCK(cache);
+        we_ec_key_cache_clear(cache, priv, pub);
+        WE_EC_KEY_CACHE_UNLOCK(cache);
+    }
+}
+
+/**
+ * Get a wolfSSL key of the EC_KEY object, importing the key when needed.
+ *
+ * On success, the cache lock is held for reading and the key's mutex is held
+ * so that only the calling thread uses the key. Both must be released with
+ * we_ec_key_release() when the key is no longer used. The calling thread's
+ * random number generator is set into the private key.
+ *
+ * @param  ecKey    [in]   OpenSSL EC key.
+ * @param  curveId  [in]   wolfSSL curve identifier.
+ * @param  priv     [in]   1 for the private key and 0 for the public key.
+ * @param  pCache   [out]  Cached keys to release.
+ * @returns  wolfSSL key on success and NULL on failure.
+ */
+static ecc_key *we_ec_key_get(const EC_KEY *ecKey, int curveId, int priv,
+                              we_EcKeyCache **pCache)
+{
+    ecc_key *key = NULL;
+    we_EcKeyCache *cache;
+    int set;
+
+    cache = we_ec_key_get_cache(ecKey);
+    if (cache != NULL) {
+        WE_EC_KEY_CACHE_READ_LOCK(cache);
+        set = priv ? cache->privSet : cache->pubSet;
+        if (!set) {
+            /* Import under the write lock - another thread may import first. */
+            WE_EC_KEY_CACHE_UNLOCK(cache);
+            WE_EC_KEY_CACHE_WRITE_LOCK(cache);
+            if (priv && !cache->privSet) {
+                if (we_ec_set_private(&cache->priv, curveId, ecKey) == 1) {
+                    cache->privSet = 1;
+                }
+                else {
+                    we_ec_key_cache_clear(cache, 1, 0);
+                }
+            }
+            else if (!priv && !cache->pubSet) {
+                if (we_ec_set_public(&cache->pub, curveId,
+                                     (EC_KEY *)ecKey) == 1) {
+                    cache->pubSet = 1;
+                }
+                else {
+                    we_ec_key_cache_clear(cache, 0, 1);
+                }
+            }
+            WE_EC_KEY_CACHE_UNLOCK(cache);
+            WE_EC_KEY_CACHE_READ_LOCK(cache);
+            set = priv ? cache->privSet : cache->pubSet;
+        }
+        if (set) {
+            WE_EC_KEY_USE_LOCK(cache, priv);
+            key = priv ? &cache->priv : &cache->pub;
+#if !defined(HAVE_FIPS) || \
+    (defined(HAVE_FIPS_VERSION) && HAVE_FIPS_VERSION != 2)
+            if (priv) {
+                /* Key may have been used last by another thread. */
+                (void)wc_ecc_set_rng(key, we_rng);
+            }
+#endif
+            *pCache = cache;
+        }
+        else {
+            WE_EC_KEY_CACHE_UNLOCK(cache);
+        }
+    }
+
+    return key;
+}
+
+/**
+ * Get the wolfSSL key with the private key of the EC_KEY object imported.
+ *
+ * @param  ecKey    [in]   OpenSSL EC key.
+ * @param  curveId  [in]   wolfSSL curve identifier.
+ * @param  pCache   [out]  Cached keys to release with we_ec_key_release().
+ * @returns  wolfSSL key on success and NULL on failure.
+ */
+static ecc_key *we_ec_key_get_private(const EC_KEY *ecKey, int curveId,
+                                      we_EcKeyCache **pCache)
+{
+    return we_ec_key_get(ecKey, curveId, 1, pCache);
+}
+
+/**
+ * Get the wolfSSL key with the public key of the EC_KEY object imported.
+ *
+ * @param  ecKey    [in]   OpenSSL EC key.
+ * @param  curveId  [in]   wolfSSL curve identifier.
+ * @param  pCache   [out]  Cached keys to release with we_ec_key_release().
+ * @returns  wolfSSL key on success and NULL on failure.
+ */
+static ecc_key *we_ec_key_get_public(EC_KEY *ecKey, int curveId,
+                                     we_EcKeyCache **pCache)
+{
+    return we_ec_key_get(ecKey, curveId, 0, pCache);
+}
+
+/**
+ * Release cached keys got with we_ec_key_get_private() or
+ * we_ec_key_get_public().
+ *
+ * @param  cache  [in]  Cached keys. May be NULL.
+ * @param  key    [in]  wolfSSL key that was got.
+ */
+static void we_ec_key_release(we_EcKeyCache *cache, ecc_key *key)
+{
+    if (cache != NULL) {
+        WE_EC_KEY_USE_UNLOCK(cache, key == &cache->priv);
+        WE_EC_KEY_CACHE_UNLOCK(cache);
+    }
+    (void)key;
+}
+
+/**
+ * Import the key of an EC_KEY object, using the wolfEngine EC_KEY method, into
+ * its cached wolfSSL keys now rather than on first use.
+ *
+ * @param  ecKey  [in]  OpenSSL EC key.
+ * @param  priv   [in]  1 to import the private key as well as the public key.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_ec_key_preload(EC_KEY *ecKey, int priv)
+{
+    int ret;
+    int curveId;
+    ecc_key *pKey;
+    we_EcKeyCache *cache = NULL;
+
+    WOLFENGINE_ENTER("we_ec_key_preload");
+
+    ret = we_ec_get_curve_id(EC_GROUP_get_curve_name(EC_KEY_get0_group(ecKey)),
+                             &curveId);
+    if (ret == 1 && priv) {
+        pKey = we_ec_key_get_private(ecKey, curveId, &cache);
+        if (pKey == NULL) {
+            WOLFENGINE_ERROR_MSG("Failed to import private key");
+            ret = 0;
+        }
+        we_ec_key_release(cache, pKey);
+        cache = NULL;
+    }
+    if (ret == 1) {
+        pKey = we_ec_key_get_public(ecKey, curveId, &cache);
+        if (pKey == NULL) {
+            WOLFENGINE_ERROR_MSG("Failed to import public key");
+            ret = 0;
+        }
+        we_ec_key_release(cache, pKey);
+    }
+
+    WOLFENGINE_LEAVE("we_ec_key_preload", ret);
+
+    return ret;
+}
+
+/**
+ * Discard cached wolfSSL keys when the group of the EC_KEY object is set.
+ *
+ * @param  ecKey  [in]  OpenSSL EC key.
+ * @param  group  [in]  New group. Unused.
+ * @returns  1 always.
+ */
+static int we_ec_key_set_group(EC_KEY *ecKey, const EC_GROUP *group)
+{
+    (void)group;
+
+    we_ec_key_invalidate(ecKey, 1, 1);
+
+    return 1;
+}
+
+/**
+ * Discard cached wolfSSL private key when the private key of the EC_KEY object
+ * is set.
+ *
+ * @param  ecKey  [in]  OpenSSL EC key.
+ * @param  priv   [in]  New private key. Unused.
+ * @returns  1 always.
+ */
+static int we_ec_key_set_private(EC_KEY *ecKey, const BIGNUM *priv)
+{
+    (void)priv;
+
+    we_ec_key_invalidate(ecKey, 1, 0);
+
+    return 1;
+}
+
+/**
+ * Discard cached wolfSSL public key when the public key of the EC_KEY object
+ * is set.
+ *
+ * @param  ecKey  [in]  OpenSSL EC key.
+ * @param  pub    [in]  New public key. Unused.
+ * @returns  1 always.
+ */
+static int we_ec_key_set_public(EC_KEY *ecKey, const EC_POINT *pub)
+{
+    (void)pub;
+
+    we_ec_key_invalidate(ecKey, 0, 1);
+
+    return 1;
+}
+
+/**
+ * Generate an EC key for the group specified in key object.
+ *
+ * @param  key  [in/out]  Elliptic curve key object.
+ * @erturns 1 on success and 0 on faulure.
+ */
+static int we_ec_key_keygen(EC_KEY *key)
+{
+    int ret = 1, rc;
+    int curveId;
+    we_EcKeyCache *cache = NULL;
+    int len = 0;
+
+    WOLFENGINE_ENTER("we_ec_key_keygen");
+
+    /* Get the wolfSSL EC curve id for the group. */
+    ret = we_ec_get_curve_id(EC_GROUP_get_curve_name(EC_KEY_get0_group(key)),
+                             &curveId);
+    if (ret == 1) {
+        len = wc_ecc_get_curve_size_from_id(curveId);
+        if (len < 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_get_curve_size_from_id", len);
+            ret = 0;
+
+        } else {
+            /* Generate into the cached wolfSSL key object. */
+            cache = we_ec_key_get_cache(key);
+            if (cache == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("we_ec_key_get_cache", cache);
+                ret = 0;
+            }
+        }
+    }
+    if (ret == 1) {
+        /* EC_KEY_oct2key() and EC_KEY_oct2priv() don't call the method's set
+         * functions so the lock is held until the key is exported. */
+        WE_EC_KEY_CACHE_WRITE_LOCK(cache);
+        we_ec_key_cache_clear(cache, 1, 1);
+
+#ifdef WE_HAVE_EC_KEY_POOL
+        /* Take a pre-generated key when available. */
+        if (we_ec_key_pool_get(curveId, &cache->priv)) {
+            WOLFENGINE_MSG("Using EC key from pool");
+            rc = 0;
+        }
+        else
+#endif
+        {
+            /* Generate key. */
+            rc = wc_ecc_make_key_ex(we_rng, len, &cache->priv, curveId);
+        }
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_make_key_ex", rc);
+            ret = 0;
+        }
+        else {
+            /* Generated key is ready for signing and deriving. Setting the
+             * key into the EC_KEY object may invalidate it - imported again on
+             * first use. */
+            cache->privSet = 1;
+        }
+    }
+    if (ret == 1) {
+        /* Export new key into EC_KEY object. */
+        ret = we_ec_export_key(&cache->priv, len, key);
+    }
+    if (cache != NULL) {
+        if (ret == 0) {
+            we_ec_key_cache_clear(cache, 1, 0);
+        }
+        WE_EC_KEY_CACHE_UNLOCK(cache);
+    }
+
+    WOLFENGINE_LEAVE("we_ec_key_keygen", ret);
+
+    return ret;
+}
+
+/**
+ * Compute the EC secret for ECDH using wolfSSL.
+ *
+ * The peer's public key is imported and validated once and kept with the
+ * EC_KEY object. Repeated derivations with the same peer point don't encode
+ * or import it again. The peer key is compared, imported and used under the
+ * peer lock so concurrent derivations with different peers are serialized.
+ *
+ * @param  psec     [out]  Pointer to buffer holding secret. Allocated with
+ *                         OPENSSL_malloc().
+ * @param  pseclen  [out]  Pointer to length of secret.
+ * @param  pub_key  [in]   Public EC point from peer.
+ * @param  ecdh     [in]   EC KEY with private key.
+ */
+static int we_ec_key_compute_key(unsigned char **psec, size_t *pseclen,
+                                 const EC_POINT *pub_key, const EC_KEY *ecdh)
+{
+    int ret, rc;
+    ecc_key *pKey = NULL;
+    we_EcKeyCache *cache = NULL;
+    const EC_GROUP *group;
+    int curveId;
+    word32 len;
+    size_t peerKeyLen;
+    unsigned char peerKey[WE_EC_MAX_POINT_SZ];
+    unsigned char* secret = NULL;
+
+    WOLFENGINE_ENTER("we_ec_key_compute_key");
+
+    /* Get wolfSSL curve id for EC group. */
+    group = EC_KEY_get0_group(ecdh);
+    ret = we_ec_get_curve_id(EC_GROUP_get_curve_name(group), &curveId);
+    if (ret == 1) {
+        rc = wc_ecc_get_curve_size_from_id(curveId);
+        if (rc < 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_get_curve_size_from_id", rc);
+            ret = 0;
+        } else {
+            len = (word32)rc;
+        }
+    }
+    if (ret == 1) {
+        /* Allocate the buffer to hold secret. Freed externally. */
+        ret = (secret = (unsigned char *)OPENSSL_malloc(len)) != NULL;
+    }
+    if (ret == 1) {
+        /* Get wolfSSL key object with private key set. */
+        pKey = we_ec_key_get_private(ecdh, curveId, &cache);
+        if (pKey == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("we_ec_key_get_private", pKey);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        WE_EC_KEY_PEER_LOCK(cache);
+        if (!cache->peerSet ||
+                EC_POINT_cmp(group, pub_key, cache->peerPt, NULL) != 0) {
+            WOLFENGINE_MSG("New peer public key - importing");
+            cache->peerSet = 0;
+            EC_POINT_free(cache->peerPt);
+            cache->peerPt = NULL;
+
+            peerKeyLen = EC_POINT_point2oct(group, pub_key,
+                                            POINT_CONVERSION_UNCOMPRESSED,
+                                            peerKey, sizeof(peerKey), NULL);
+            if (peerKeyLen == 0) {
+                WOLFENGINE_ERROR_FUNC("EC_POINT_point2oct", (int)peerKeyLen);
+                ret = 0;
+            }
+            if (ret == 1) {
+                /* Import and validate peer's public key. */
+                ret = we_ec_import_peer(&cache->peer, curveId, peerKey,
+                                        (int)peerKeyLen, 1);
+            }
+            if (ret == 1) {
+                cache->peerPt = EC_POINT_dup(pub_key, group);
+                if (cache->peerPt == NULL) {
+                    WOLFENGINE_ERROR_FUNC_NULL("EC_POINT_dup", cache->peerPt);
+                    ret = 0;
+                }
+            }
+            if (ret == 1) {
+                cache->peerSet = 1;
+            }
+        }
+        if (ret == 1) {
+            /* Calculate shared secret. */
+            rc = wc_ecc_shared_secret(pKey, &cache->peer, secret, &len);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("wc_ecc_shared_secret", rc);
+                ret = 0;
+            }
+        }
+        WE_EC_KEY_PEER_UNLOCK(cache);
     }
+    we_ec_key_release(cache, pKey);
     if (ret == 1) {
         *psec = secret;
         *pseclen = len;
@@ -1139,9 +2993,6 @@ static int we_ec_key_compute_key(unsigned char **psec, size_t *pseclen,
     else {
         OPENSSL_free(secret);
     }
-    OPENSSL_free(peerKey);
-    wc_ecc_free(pPeer);
-    wc_ecc_free(pKey);
 
     WOLFENGINE_LEAVE("we_ec_key_compute_key", ret);
 
@@ -1151,14 +3002,19 @@ static int we_ec_key_compute_key(unsigned char **psec, size_t *pseclen,
 /**
  * Sign data with a private EC key.
  *
+ * When kinv and r are passed, they are used instead of generating a random k.
+ * Otherwise, precomputed values are taken from the pool when available.
+ *
  * @param  type    [in]      Type of EC key. Ignored.
  * @param  dgst    [in]      Digest to be signed.
  * @param  dLen    [in]      Length of digest.
  * @param  sig     [in]      Buffer to hold signature data.
  *                           NULL indicates length of signature requested.
  * @param  sigLen  [in/out]  Length of signature buffer.
- * @param  kInv    [in]      Big number holding inverse of k. Ignored.
- * @param  r       [in]      Big number holding an r sig value. Ignored.
+ * @param  kInv    [in]      Big number holding inverse of k. May be NULL.
+ *                           Ignored without WOLFSSL_PUBLIC_MP.
+ * @param  r       [in]      Big number holding an r sig value. May be NULL.
+ *                           Ignored without WOLFSSL_PUBLIC_MP.
  * @parma  ecKey   [in]      EC key object.
  * @returns  1 on success and 0 on failure.
  */
@@ -1167,61 +3023,224 @@ static int we_ec_key_sign(int type, const unsigned char *dgst, int dLen,
                           const BIGNUM *kinv, const BIGNUM *r, EC_KEY *ecKey)
 {
     int ret, rc;
-    ecc_key key;
     ecc_key *pKey = NULL;
+    we_EcKeyCache *cache = NULL;
     const EC_GROUP *group;
     int curveId;
     word32 outLen;
+#ifdef WE_HAVE_ECDSA_SIGN_SETUP
+    int precomp = 0;
+    int sz;
+    unsigned char kinvBuf[WE_ECDSA_MAX_SZ];
+    unsigned char rBuf[WE_ECDSA_MAX_SZ];
+    unsigned char blindBuf[WE_ECDSA_MAX_SZ];
+    unsigned char *blind = NULL;
+#endif
+    const char *keyId = NULL;
+#ifdef WE_HAVE_KEYD
+    size_t remoteLen;
+#endif
 
     WOLFENGINE_ENTER("we_ec_key_sign");
 
     (void)type;
+#ifndef WE_HAVE_ECDSA_SIGN_SETUP
     (void)kinv;
     (void)r;
+#endif
 
     /* Get wolfSSL curve id for EC group. */
     group = EC_KEY_get0_group(ecKey);
     ret = we_ec_get_curve_id(EC_GROUP_get_curve_name(group), &curveId);
+#ifdef WE_HAVE_KEYD
     if (ret == 1) {
-        /* Initialize a wolfSSL key object. */
-        rc = wc_ecc_init(&key);
-        if (rc != 0) {
-            WOLFENGINE_ERROR_FUNC("we_ecc_init", rc);
-            ret = 0;
+        /* Private key may be held by the key daemon - kinv and r not used. */
+        keyId = we_keyd_ec_key_id(ecKey);
+    }
+    if (ret == 1 && keyId != NULL) {
+        if (sig == NULL) {
+            /* Return signature size in bytes. */
+            *sigLen = ECDSA_size(ecKey);
+        }
+        else {
+            remoteLen = *sigLen;
+            ret = we_keyd_ecdsa_sign(keyId, dgst, dLen, sig, &remoteLen);
+            if (ret == 1) {
+                *sigLen = (unsigned int)remoteLen;
+            }
         }
     }
-    if (ret == 1) {
-        pKey = &key;
-
-        /* Set private key into wolfSSL key object. */
-        ret = we_ec_set_private(&key, curveId, ecKey);
+#endif
+    if (ret == 1 && keyId == NULL) {
+        /* Get wolfSSL key object with private key set. */
+        pKey = we_ec_key_get_private(ecKey, curveId, &cache);
+        if (pKey == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("we_ec_key_get_private", pKey);
+            ret = 0;
+        }
     }
 
-    if (ret == 1 && sig == NULL) {
+    if (ret == 1 && keyId == NULL && sig == NULL) {
         /* Return signature size in bytes. */
-        *sigLen = wc_ecc_sig_size(&key);
+        *sigLen = wc_ecc_sig_size(pKey);
+    }
+#ifdef WE_HAVE_ECDSA_SIGN_SETUP
+    if (ret == 1 && keyId == NULL && sig != NULL) {
+        sz = wc_ecc_get_curve_size_from_id(curveId);
+        if (kinv != NULL && r != NULL) {
+            /* Use values from sign setup. */
+            if (BN_bn2binpad(kinv, kinvBuf, sz) < 0 ||
+                BN_bn2binpad(r, rBuf, sz) < 0) {
+                WOLFENGINE_ERROR_MSG("Invalid kinv or r");
+                ret = 0;
+            }
+            precomp = 1;
+        }
+#ifdef WE_HAVE_ECDSA_SIGN_POOL
+        else {
+            precomp = we_ecdsa_pool_get(curveId, kinvBuf, rBuf, blindBuf);
+            blind = blindBuf;
+        }
+#endif
     }
-    if (ret == 1 && sig != NULL) {
-        /* Sign hash with wolfSSL. */
+#endif
+    if (ret == 1 && keyId == NULL && sig != NULL) {
         outLen = *sigLen;
-        rc = wc_ecc_sign_hash(dgst, dLen, sig, &outLen, we_rng, &key);
-        if (rc != 0) {
-            WOLFENGINE_ERROR_FUNC("wc_ecc_sign_hash", rc);
-            ret = 0;
+#ifdef WE_HAVE_ECDSA_SIGN_SETUP
+        if (precomp) {
+            /* Only modular multiplications needed with precomputed values. */
+            ret = we_ecdsa_sign_precomp(pKey, we_rng, dgst, dLen, kinvBuf,
+                                        rBuf, blind, sig, &outLen);
+        }
+        else
+#endif
+        {
+            /* Sign hash with wolfSSL. */
+            rc = wc_ecc_sign_hash(dgst, dLen, sig, &outLen, we_rng, pKey);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("wc_ecc_sign_hash", rc);
+                ret = 0;
+            }
         }
         if (ret == 1) {
             /* Return actual size. */
             *sigLen = outLen;
         }
     }
-
-    wc_ecc_free(pKey);
+    we_ec_key_release(cache, pKey);
+#ifdef WE_HAVE_ECDSA_SIGN_SETUP
+    if (precomp) {
+        OPENSSL_cleanse(kinvBuf, sizeof(kinvBuf));
+        OPENSSL_cleanse(blindBuf, sizeof(blindBuf));
+    }
+#endif
 
     WOLFENGINE_LEAVE("we_ec_key_sign", ret);
 
     return ret;
 }
 
+#ifdef WE_HAVE_ECDSA_SIGN_SETUP
+/**
+ * Precompute k^-1 and r for a signature with the EC key.
+ *
+ * Values are taken from the pool when available. The values must be passed
+ * to only one signing operation.
+ *
+ * @param  ecKey  [in]      EC key object.
+ * @param  ctx    [in]      Big number context. Unused.
+ * @param  kinvp  [in/out]  On in, big number to free. May be NULL.
+ *                          On out, new big number holding inverse of k.
+ * @param  rp     [in/out]  On in, big number to free. May be NULL.
+ *                          On out, new big number holding r.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_ec_key_sign_setup(EC_KEY *ecKey, BN_CTX *ctx, BIGNUM **kinvp,
+                                BIGNUM **rp)
+{
+    int ret;
+    int curveId;
+    int sz = 0;
+    int havePair = 0;
+    BIGNUM *kinv = NULL;
+    BIGNUM *r = NULL;
+    unsigned char kinvBuf[WE_ECDSA_MAX_SZ];
+    unsigned char rBuf[WE_ECDSA_MAX_SZ];
+
+    WOLFENGINE_ENTER("we_ec_key_sign_setup");
+
+    (void)ctx;
+
+    ret = we_ec_get_curve_id(EC_GROUP_get_curve_name(EC_KEY_get0_group(ecKey)),
+                             &curveId);
+    if (ret == 1) {
+        sz = wc_ecc_get_curve_size_from_id(curveId);
+#ifdef WE_HAVE_ECDSA_SIGN_POOL
+        havePair = we_ecdsa_pool_get(curveId, kinvBuf, rBuf, NULL);
+#endif
+        if (!havePair) {
+            ret = we_ecdsa_precompute(curveId, we_rng, kinvBuf, rBuf, NULL);
+        }
+    }
+    if (ret == 1) {
+        kinv = BN_bin2bn(kinvBuf, sz, NULL);
+        r = BN_bin2bn(rBuf, sz, NULL);
+        if (kinv == NULL || r == NULL) {
+            WOLFENGINE_ERROR_MSG("Failed to convert kinv and r");
+            BN_clear_free(kinv);
+            BN_free(r);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* Replace any previous values. */
+        BN_clear_free(*kinvp);
+        BN_clear_free(*rp);
+        *kinvp = kinv;
+        *rp = r;
+    }
+
+    OPENSSL_cleanse(kinvBuf, sizeof(kinvBuf));
+
+    WOLFENGINE_LEAVE("we_ec_key_sign_setup", ret);
+
+    return ret;
+}
+#endif /* WE_HAVE_ECDSA_SIGN_SETUP */
+
+/**
+ * Sign data with a private EC key and return the signature as an object.
+ *
+ * @param  dgst   [in]  Digest to be signed.
+ * @param  dLen   [in]  Length of digest.
+ * @param  kinv   [in]  Big number holding inverse of k. May be NULL.
+ * @param  r      [in]  Big number holding an r sig value. May be NULL.
+ * @param  ecKey  [in]  EC key object.
+ * @returns  ECDSA signature object on success and NULL on failure.
+ */
+static ECDSA_SIG *we_ec_key_sign_sig(const unsigned char *dgst, int dLen,
+                                     const BIGNUM *kinv, const BIGNUM *r,
+                                     EC_KEY *ecKey)
+{
+    ECDSA_SIG *ecdsaSig = NULL;
+    unsigned char sig[ECC_MAX_SIG_SIZE];
+    unsigned int sigLen = sizeof(sig);
+    const unsigned char *p = sig;
+
+    WOLFENGINE_ENTER("we_ec_key_sign_sig");
+
+    if (we_ec_key_sign(0, dgst, dLen, sig, &sigLen, kinv, r, ecKey) == 1) {
+        ecdsaSig = d2i_ECDSA_SIG(NULL, &p, sigLen);
+        if (ecdsaSig == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("d2i_ECDSA_SIG", ecdsaSig);
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_ec_key_sign_sig", ecdsaSig != NULL);
+
+    return ecdsaSig;
+}
+
 /**
  * Verify data with a public EC key.
  *
@@ -1237,8 +3256,8 @@ static int we_ec_key_verify(int type, const unsigned char *dgst, int dLen,
 {
     int ret, rc;
     int res;
-    ecc_key key;
     ecc_key *pKey = NULL;
+    we_EcKeyCache *cache = NULL;
     const EC_GROUP *group;
     int curveId;
 
@@ -1250,34 +3269,27 @@ static int we_ec_key_verify(int type, const unsigned char *dgst, int dLen,
     group = EC_KEY_get0_group(ecKey);
     ret = we_ec_get_curve_id(EC_GROUP_get_curve_name(group), &curveId);
     if (ret == 1) {
-        /* Initialize a wolfSSL key object. */
-        rc = wc_ecc_init(&key);
-        if (rc != 0) {
-            WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
+        /* Get wolfSSL key object with public key set. */
+        pKey = we_ec_key_get_public(ecKey, curveId, &cache);
+        if (pKey == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("we_ec_key_get_public", pKey);
             ret = 0;
         }
     }
-    if (ret == 1) {
-        pKey = &key;
-
-        /* Set public key into wolfSSL key object. */
-        ret = we_ec_set_public(&key, curveId, ecKey);
-    }
     if (ret == 1) {
         /* Verify hash with wolfSSL. */
-        rc = wc_ecc_verify_hash(sig, sigLen, dgst, dLen, &res, &key);
+        rc = wc_ecc_verify_hash(sig, sigLen, dgst, dLen, &res, pKey);
         if (rc != 0) {
             WOLFENGINE_ERROR_FUNC("wc_ecc_verify_hash", rc);
             ret = 0;
         }
     }
+    we_ec_key_release(cache, pKey);
     if (ret == 1) {
         /* Verification result is 1 on success and 0 on failure. */
         ret = res;
     }
 
-    wc_ecc_free(pKey);
-
     WOLFENGINE_LEAVE("we_ec_key_verify", ret);
 
     return ret;
@@ -1294,14 +3306,37 @@ int we_init_ec_key_meths(void)
 
     WOLFENGINE_ENTER("we_init_ec_key_meths");
 
-    we_ec_key_method = EC_KEY_METHOD_new(NULL);
-    if (we_ec_key_method == NULL) {
-        WOLFENGINE_ERROR_FUNC_NULL("EC_KEY_METHOD_new", we_ec_key_method);
-        ret = 0;
-    } else {
+    if (we_ec_key_ex_idx < 0) {
+        /* Index for caching imported wolfSSL keys on EC_KEY objects. */
+        we_ec_key_ex_idx = EC_KEY_get_ex_new_index(0, NULL, NULL,
+                                                   we_ec_key_cache_dup,
+                                                   we_ec_key_cache_free);
+        if (we_ec_key_ex_idx < 0) {
+            WOLFENGINE_ERROR_FUNC("EC_KEY_get_ex_new_index", we_ec_key_ex_idx);
+            ret = 0;
+        }
+    }
+
+    if (ret == 1) {
+        we_ec_key_method = EC_KEY_METHOD_new(NULL);
+        if (we_ec_key_method == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("EC_KEY_METHOD_new", we_ec_key_method);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        EC_KEY_METHOD_set_init(we_ec_key_method, we_ec_key_init, NULL,
+                               we_ec_key_copy, we_ec_key_set_group,
+                               we_ec_key_set_private, we_ec_key_set_public);
         EC_KEY_METHOD_set_keygen(we_ec_key_method, we_ec_key_keygen);
         EC_KEY_METHOD_set_compute_key(we_ec_key_method, we_ec_key_compute_key);
-        EC_KEY_METHOD_set_sign(we_ec_key_method, we_ec_key_sign, NULL, NULL);
+#ifdef WE_HAVE_ECDSA_SIGN_SETUP
+        EC_KEY_METHOD_set_sign(we_ec_key_method, we_ec_key_sign,
+                               we_ec_key_sign_setup, we_ec_key_sign_sig);
+#else
+        EC_KEY_METHOD_set_sign(we_ec_key_method, we_ec_key_sign, NULL,
+                               we_ec_key_sign_sig);
+#endif
         EC_KEY_METHOD_set_verify(we_ec_key_method, we_ec_key_verify, NULL);
     }
 
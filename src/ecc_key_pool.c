@@ -0,0 +1,533 @@
+/* ecc_key_pool.c
+ *
+ * Copyright (C) 2019-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfengine.
+ *
+ * wolfengine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfengine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Needed for SCHED_IDLE. */
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include "internal.h"
+
+#ifdef WE_HAVE_EC_KEY_POOL
+
+#include <limits.h>
+#include <pthread.h>
+#ifdef __linux__
+    #include <sched.h>
+#endif
+
+/**
+ * Pre-generated EC key pair.
+ */
+typedef struct we_EcKeyPair {
+    /* x-ordinate of public key - big-endian, size of curve. */
+    unsigned char x[WE_EC_KEY_POOL_MAX_SZ];
+    /* y-ordinate of public key - big-endian, size of curve. */
+    unsigned char y[WE_EC_KEY_POOL_MAX_SZ];
+    /* Private key - big-endian, size of curve. */
+    unsigned char d[WE_EC_KEY_POOL_MAX_SZ];
+} we_EcKeyPair;
+
+/**
+ * Pool of pre-generated key pairs for one curve.
+ */
+typedef struct we_EcKeyPool {
+    /* wolfSSL curve identifier. */
+    int curveId;
+    /* Pre-generated key pairs. */
+    we_EcKeyPair *keys;
+    /* Number of key pairs available. */
+    int cnt;
+    /* Indicates the pool is being filled up to the high watermark. */
+    int refill;
+} we_EcKeyPool;
+
+/* Pools of key pairs - one for each supported curve. */
+static we_EcKeyPool we_ec_key_pool[] = {
+#ifdef WE_HAVE_EC_P256
+    { ECC_SECP256R1, NULL, 0, 0 },
+#endif
+#ifdef WE_HAVE_EC_P384
+    { ECC_SECP384R1, NULL, 0, 0 },
+#endif
+};
+#define WE_EC_KEY_POOL_CNT \
+    (int)(sizeof(we_ec_key_pool) / sizeof(*we_ec_key_pool))
+
+/* Protects pool data. */
+static pthread_mutex_t we_ec_key_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Signals the thread that a pool needs filling or that it must stop. */
+static pthread_cond_t we_ec_key_pool_cond = PTHREAD_COND_INITIALIZER;
+/* Thread generating key pairs for the pools. */
+static pthread_t we_ec_key_pool_thread;
+/* Indicates the thread is running. */
+static int we_ec_key_pool_running = 0;
+/* Number of key pairs to keep for each curve - high watermark. */
+static int we_ec_key_pool_size = 0;
+/* Refill a pool when it has this many key pairs or fewer.
+ * -1 indicates half the pool size. */
+static int we_ec_key_pool_low = -1;
+/* Indicates thread must stop. */
+static int we_ec_key_pool_stop = 0;
+/* Registers the fork handlers once. */
+static pthread_once_t we_ec_key_pool_once = PTHREAD_ONCE_INIT;
+/* Indicates the fork handlers were registered. */
+static int we_ec_key_pool_atfork = 0;
+
+/**
+ * Fork handler called in the parent before fork.
+ *
+ * Holds the mutex so that the pools are consistent in the child.
+ */
+static void we_ec_key_pool_prepare(void)
+{
+    pthread_mutex_lock(&we_ec_key_pool_mutex);
+}
+
+/**
+ * Fork handler called in the parent after fork.
+ */
+static void we_ec_key_pool_parent(void)
+{
+    pthread_mutex_unlock(&we_ec_key_pool_mutex);
+}
+
+/**
+ * Fork handler called in the child after fork.
+ *
+ * The child has a copy of the parent's key pairs. Handing them out would give
+ * the parent and child the same ephemeral keys, so they are disposed of. The
+ * pool thread does not exist in the child so the pools are no longer running.
+ * Setting the size again restarts the pools in the child.
+ */
+static void we_ec_key_pool_child(void)
+{
+    int i;
+
+    for (i = 0; i < WE_EC_KEY_POOL_CNT; i++) {
+        if (we_ec_key_pool[i].keys != NULL) {
+            OPENSSL_clear_free(we_ec_key_pool[i].keys,
+                               we_ec_key_pool_size * sizeof(we_EcKeyPair));
+        }
+        we_ec_key_pool[i].keys = NULL;
+        we_ec_key_pool[i].cnt = 0;
+        we_ec_key_pool[i].refill = 0;
+    }
+    we_ec_key_pool_running = 0;
+    we_ec_key_pool_stop = 0;
+    we_ec_key_pool_size = 0;
+    /* Only waiter was the pool thread which was not copied. */
+    pthread_cond_init(&we_ec_key_pool_cond, NULL);
+    pthread_mutex_unlock(&we_ec_key_pool_mutex);
+}
+
+/**
+ * Register the fork handlers.
+ */
+static void we_ec_key_pool_init_atfork(void)
+{
+    int rc;
+
+    rc = pthread_atfork(we_ec_key_pool_prepare, we_ec_key_pool_parent,
+                        we_ec_key_pool_child);
+    if (rc != 0) {
+        WOLFENGINE_ERROR_FUNC("pthread_atfork", rc);
+    }
+    else {
+        we_ec_key_pool_atfork = 1;
+    }
+}
+
+/**
+ * Get the low watermark for the pools.
+ *
+ * Must be called with the pool mutex held.
+ *
+ * @returns  Number of key pairs at or below which a pool is refilled.
+ */
+static int we_ec_key_pool_low_mark(void)
+{
+    int low = we_ec_key_pool_low;
+
+    if (low < 0) {
+        low = we_ec_key_pool_size / 2;
+    }
+    if (low >= we_ec_key_pool_size) {
+        low = we_ec_key_pool_size - 1;
+    }
+
+    return low;
+}
+
+/**
+ * Find the refilling pool with the fewest key pairs.
+ *
+ * Must be called with the pool mutex held.
+ *
+ * @returns  Pool to generate a key pair for or NULL when no pool is
+ *           refilling.
+ */
+static we_EcKeyPool *we_ec_key_pool_next(void)
+{
+    we_EcKeyPool *pool = NULL;
+    int i;
+    int minCnt = we_ec_key_pool_size;
+
+    for (i = 0; i < WE_EC_KEY_POOL_CNT; i++) {
+        if (we_ec_key_pool[i].refill && we_ec_key_pool[i].cnt < minCnt) {
+            minCnt = we_ec_key_pool[i].cnt;
+            pool = &we_ec_key_pool[i];
+        }
+    }
+
+    return pool;
+}
+
+/**
+ * Generate a key pair with wolfSSL.
+ *
+ * @param  curveId  [in]   wolfSSL curve identifier.
+ * @param  rng      [in]   Random number generator.
+ * @param  pair     [out]  Key pair data.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_ec_key_pool_gen(int curveId, WC_RNG *rng, we_EcKeyPair *pair)
+{
+    int ret = 1, rc;
+    int len;
+    ecc_key key;
+    word32 xLen, yLen, dLen;
+
+    len = wc_ecc_get_curve_size_from_id(curveId);
+    if (len <= 0 || len > WE_EC_KEY_POOL_MAX_SZ) {
+        WOLFENGINE_ERROR_FUNC("wc_ecc_get_curve_size_from_id", len);
+        ret = 0;
+    }
+    if (ret == 1) {
+        rc = wc_ecc_init(&key);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        rc = wc_ecc_make_key_ex(rng, len, &key, curveId);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_make_key_ex", rc);
+            ret = 0;
+        }
+        if (ret == 1) {
+            xLen = yLen = dLen = (word32)len;
+            /* Exported values are padded to the size of the curve. */
+            rc = wc_ecc_export_private_raw(&key, pair->x, &xLen, pair->y,
+                                           &yLen, pair->d, &dLen);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("wc_ecc_export_private_raw", rc);
+                ret = 0;
+            }
+        }
+        wc_ecc_free(&key);
+    }
+
+    return ret;
+}
+
+/**
+ * Thread function that fills the pools.
+ *
+ * Runs at idle priority, where supported, so that handshakes are not slowed
+ * down. Key pairs are generated without holding the mutex so that key
+ * generation is not blocked. Thread waits when no pool is below its low
+ * watermark.
+ *
+ * @param  arg  [in]  Unused.
+ * @returns  NULL always.
+ */
+static void *we_ec_key_pool_worker(void *arg)
+{
+    int rc;
+    int ok;
+    WC_RNG rng;
+    we_EcKeyPool *pool;
+    we_EcKeyPair pair;
+#if defined(__linux__) && defined(SCHED_IDLE)
+    struct sched_param param;
+#endif
+
+    (void)arg;
+
+    WOLFENGINE_ENTER("we_ec_key_pool_worker");
+
+#if defined(__linux__) && defined(SCHED_IDLE)
+    XMEMSET(&param, 0, sizeof(param));
+    rc = pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+    if (rc != 0) {
+        /* Not fatal - pool is filled at normal priority. */
+        WOLFENGINE_ERROR_FUNC("pthread_setschedparam", rc);
+    }
+#endif
+
+    /* Thread has its own random as the global random is not locked. */
+    rc = wc_InitRng(&rng);
+    if (rc != 0) {
+        WOLFENGINE_ERROR_FUNC("wc_InitRng", rc);
+    }
+    else {
+        pthread_mutex_lock(&we_ec_key_pool_mutex);
+        while (!we_ec_key_pool_stop) {
+            pool = we_ec_key_pool_next();
+            if (pool == NULL) {
+                pthread_cond_wait(&we_ec_key_pool_cond, &we_ec_key_pool_mutex);
+                continue;
+            }
+            pthread_mutex_unlock(&we_ec_key_pool_mutex);
+
+            ok = we_ec_key_pool_gen(pool->curveId, &rng, &pair);
+
+            pthread_mutex_lock(&we_ec_key_pool_mutex);
+            if (ok && pool->cnt < we_ec_key_pool_size) {
+                pool->keys[pool->cnt++] = pair;
+            }
+            if (pool->cnt >= we_ec_key_pool_size) {
+                /* High watermark reached. */
+                pool->refill = 0;
+            }
+        }
+        pthread_mutex_unlock(&we_ec_key_pool_mutex);
+
+        OPENSSL_cleanse(&pair, sizeof(pair));
+        wc_FreeRng(&rng);
+    }
+
+    WOLFENGINE_LEAVE("we_ec_key_pool_worker", 0);
+
+    return NULL;
+}
+
+/**
+ * Stop the pool thread and dispose of the key pairs.
+ */
+static void we_ec_key_pool_stop_thread(void)
+{
+    int i;
+    int running;
+
+    WOLFENGINE_ENTER("we_ec_key_pool_stop_thread");
+
+    /* Key generation stops taking key pairs once running is cleared. */
+    pthread_mutex_lock(&we_ec_key_pool_mutex);
+    running = we_ec_key_pool_running;
+    we_ec_key_pool_running = 0;
+    we_ec_key_pool_stop = 1;
+    pthread_cond_signal(&we_ec_key_pool_cond);
+    pthread_mutex_unlock(&we_ec_key_pool_mutex);
+
+    if (running) {
+        pthread_join(we_ec_key_pool_thread, NULL);
+    }
+
+    pthread_mutex_lock(&we_ec_key_pool_mutex);
+    we_ec_key_pool_stop = 0;
+    for (i = 0; i < WE_EC_KEY_POOL_CNT; i++) {
+        if (we_ec_key_pool[i].keys != NULL) {
+            OPENSSL_clear_free(we_ec_key_pool[i].keys,
+                               we_ec_key_pool_size * sizeof(we_EcKeyPair));
+        }
+        we_ec_key_pool[i].keys = NULL;
+        we_ec_key_pool[i].cnt = 0;
+        we_ec_key_pool[i].refill = 0;
+    }
+    pthread_mutex_unlock(&we_ec_key_pool_mutex);
+
+    WOLFENGINE_LEAVE("we_ec_key_pool_stop_thread", 1);
+}
+
+/**
+ * Set the number of key pairs to keep for each curve.
+ *
+ * The existing thread is stopped and key pairs disposed of. When the size is
+ * non-zero, the pools are allocated and a thread started to fill them.
+ *
+ * @param  size  [in]  Number of key pairs. 0 disables the pool.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_ec_key_pool_set_size(long size)
+{
+    int ret = 1;
+    int rc;
+    int i;
+
+    WOLFENGINE_ENTER("we_ec_key_pool_set_size");
+
+    if (size < 0 || size > INT_MAX / (long)sizeof(we_EcKeyPair)) {
+        WOLFENGINE_ERROR_MSG("Invalid EC key pool size");
+        ret = 0;
+    }
+    if (ret == 1 && size > 0) {
+        /* Pool must not be used in a child process after fork. */
+        rc = pthread_once(&we_ec_key_pool_once, we_ec_key_pool_init_atfork);
+        if (rc != 0 || !we_ec_key_pool_atfork) {
+            WOLFENGINE_ERROR_MSG("Failed to register EC key pool fork "
+                                 "handlers");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        we_ec_key_pool_stop_thread();
+
+        pthread_mutex_lock(&we_ec_key_pool_mutex);
+        we_ec_key_pool_size = (int)size;
+        for (i = 0; ret == 1 && size > 0 && i < WE_EC_KEY_POOL_CNT; i++) {
+            we_ec_key_pool[i].keys = (we_EcKeyPair *)OPENSSL_malloc(
+                size * sizeof(we_EcKeyPair));
+            if (we_ec_key_pool[i].keys == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_malloc",
+                                           we_ec_key_pool[i].keys);
+                ret = 0;
+            }
+            /* Fill new pools up to the high watermark. */
+            we_ec_key_pool[i].refill = 1;
+        }
+        if (ret == 1 && size > 0) {
+            rc = pthread_create(&we_ec_key_pool_thread, NULL,
+                                we_ec_key_pool_worker, NULL);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("pthread_create", rc);
+                ret = 0;
+            }
+            else {
+                we_ec_key_pool_running = 1;
+            }
+        }
+        pthread_mutex_unlock(&we_ec_key_pool_mutex);
+
+        if (ret == 0) {
+            we_ec_key_pool_stop_thread();
+            pthread_mutex_lock(&we_ec_key_pool_mutex);
+            we_ec_key_pool_size = 0;
+            pthread_mutex_unlock(&we_ec_key_pool_mutex);
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_ec_key_pool_set_size", ret);
+
+    return ret;
+}
+
+/**
+ * Set the low watermark of the pools.
+ *
+ * When a pool has this many key pairs or fewer, the thread fills it up to the
+ * pool size.
+ *
+ * @param  low  [in]  Number of key pairs. -1 indicates half the pool size.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_ec_key_pool_set_low(long low)
+{
+    int ret = 1;
+
+    WOLFENGINE_ENTER("we_ec_key_pool_set_low");
+
+    if (low < -1 || low > INT_MAX) {
+        WOLFENGINE_ERROR_MSG("Invalid EC key pool low watermark");
+        ret = 0;
+    }
+    if (ret == 1) {
+        pthread_mutex_lock(&we_ec_key_pool_mutex);
+        we_ec_key_pool_low = (int)low;
+        pthread_mutex_unlock(&we_ec_key_pool_mutex);
+    }
+
+    WOLFENGINE_LEAVE("we_ec_key_pool_set_low", ret);
+
+    return ret;
+}
+
+/**
+ * Stop the pool thread and free the pools.
+ */
+void we_ec_key_pool_free(void)
+{
+    we_ec_key_pool_stop_thread();
+    pthread_mutex_lock(&we_ec_key_pool_mutex);
+    we_ec_key_pool_size = 0;
+    we_ec_key_pool_low = -1;
+    pthread_mutex_unlock(&we_ec_key_pool_mutex);
+}
+
+/**
+ * Take a pre-generated key pair from the pool and import it.
+ *
+ * The key pair is removed from the pool and its copy zeroized so that it is
+ * handed out only once.
+ *
+ * @param  curveId  [in]   wolfSSL curve identifier.
+ * @param  key      [out]  Initialized wolfSSL ECC key to import into.
+ * @returns  1 when a key pair was imported and 0 when the pool is empty or
+ *           import failed.
+ */
+int we_ec_key_pool_get(int curveId, ecc_key *key)
+{
+    int ret = 0, rc;
+    int i;
+    we_EcKeyPair *slot;
+    we_EcKeyPair pair;
+
+    WOLFENGINE_ENTER("we_ec_key_pool_get");
+
+    pthread_mutex_lock(&we_ec_key_pool_mutex);
+    if (we_ec_key_pool_running) {
+        for (i = 0; i < WE_EC_KEY_POOL_CNT; i++) {
+            if (we_ec_key_pool[i].curveId == curveId &&
+                we_ec_key_pool[i].cnt > 0) {
+                slot = &we_ec_key_pool[i].keys[--we_ec_key_pool[i].cnt];
+                pair = *slot;
+                OPENSSL_cleanse(slot, sizeof(*slot));
+                if (!we_ec_key_pool[i].refill &&
+                    we_ec_key_pool[i].cnt <= we_ec_key_pool_low_mark()) {
+                    /* Low watermark reached - wake up thread to refill. */
+                    we_ec_key_pool[i].refill = 1;
+                    pthread_cond_signal(&we_ec_key_pool_cond);
+                }
+                ret = 1;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&we_ec_key_pool_mutex);
+
+    if (ret == 1) {
+        /* Import public and private key - no scalar multiplication. */
+        rc = wc_ecc_import_unsigned(key, pair.x, pair.y, pair.d, curveId);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_import_unsigned", rc);
+            ret = 0;
+        }
+        OPENSSL_cleanse(&pair, sizeof(pair));
+    }
+
+    WOLFENGINE_LEAVE("we_ec_key_pool_get", ret);
+
+    return ret;
+}
+
+#endif /* WE_HAVE_EC_KEY_POOL */
@@ -0,0 +1,564 @@
+/* ecc_pub_cache.c
+ *
+ * Copyright (C) 2019-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfengine.
+ *
+ * wolfengine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfengine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#include "internal.h"
+
+#ifdef WE_HAVE_EC_PUB_CACHE
+
+/* Maximum number of public keys that can be cached. */
+#define WE_EC_PUB_CACHE_MAX     65536
+
+#ifdef WE_HAVE_THREADS
+#include <pthread.h>
+
+/* Protects the cache list and hash table. */
+static pthread_mutex_t we_ec_pub_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define WE_EC_PUB_CACHE_LOCK()    pthread_mutex_lock(&we_ec_pub_cache_mutex)
+#define WE_EC_PUB_CACHE_UNLOCK()  pthread_mutex_unlock(&we_ec_pub_cache_mutex)
+#else
+/* Engine is only used from one thread at a time without thread support. */
+#define WE_EC_PUB_CACHE_LOCK()
+#define WE_EC_PUB_CACHE_UNLOCK()
+#endif
+
+/**
+ * Cached wolfSSL public key.
+ *
+ * An entry is shared by all contexts verifying with the public key. It stays
+ * in memory while referenced, even when evicted from the cache. wolfSSL keeps
+ * state in the key during a verification, so verifications with an entry are
+ * serialized.
+ */
+typedef struct we_EcPubEntry {
+    /* wolfSSL ECC key with public key imported - must be first. */
+    ecc_key key;
+    /* wolfSSL curve identifier. */
+    int curveId;
+    /* Public key as an uncompressed point: 0x04 | x | y. */
+    unsigned char pub[1 + 2 * MAX_ECC_BYTES];
+    /* Length of encoded public key. */
+    int pubLen;
+    /* Hash of curve and public key. */
+    word32 hash;
+    /* Number of users of entry. Protected by cache lock. */
+    int refs;
+    /* Indicates entry is in the cache list and hash table. */
+    int inCache;
+#ifdef WE_HAVE_THREADS
+    /* Serializes verifications with the key. */
+    pthread_mutex_t useMutex;
+#endif
+    /* Previous (more recently used) entry. */
+    struct we_EcPubEntry *prev;
+    /* Next (less recently used) entry. */
+    struct we_EcPubEntry *next;
+    /* Next entry in the same hash table bucket. */
+    struct we_EcPubEntry *hnext;
+} we_EcPubEntry;
+
+/* Most recently used entry. */
+static we_EcPubEntry *we_ec_pub_cache_head = NULL;
+/* Least recently used entry. */
+static we_EcPubEntry *we_ec_pub_cache_tail = NULL;
+/* Number of entries in the cache. */
+static int we_ec_pub_cache_cnt = 0;
+/* Maximum number of entries in the cache. 0 disables the cache. */
+static int we_ec_pub_cache_size = 0;
+/* Hash table of entries - lists chained through hnext. */
+static we_EcPubEntry **we_ec_pub_cache_table = NULL;
+/* Number of hash table buckets minus one - power of 2 minus one. */
+static word32 we_ec_pub_cache_mask = 0;
+
+/**
+ * Calculate the hash of a public key with FNV-1a.
+ *
+ * @param  curveId  [in]  wolfSSL curve identifier.
+ * @param  pub      [in]  Public key as an uncompressed point.
+ * @param  pubLen   [in]  Length of public key in bytes.
+ * @returns  Hash value.
+ */
+static word32 we_ec_pub_cache_hash(int curveId, const unsigned char *pub,
+                                   int pubLen)
+{
+    word32 hash = 0x811c9dc5U ^ (word32)curveId;
+    int i;
+
+    for (i = 0; i < pubLen; i++) {
+        hash = (hash ^ pub[i]) * 0x01000193U;
+    }
+
+    return hash;
+}
+
+/**
+ * Dispose of a cache entry.
+ *
+ * @param  entry  [in]  Cache entry.
+ */
+static void we_ec_pub_entry_free(we_EcPubEntry *entry)
+{
+#ifdef WE_HAVE_THREADS
+    pthread_mutex_destroy(&entry->useMutex);
+#endif
+    wc_ecc_free(&entry->key);
+    OPENSSL_free(entry);
+}
+
+/**
+ * Remove an entry from the most recently used list.
+ *
+ * Must be called with the cache locked.
+ *
+ * @param  entry  [in]  Cache entry in list.
+ */
+static void we_ec_pub_cache_detach(we_EcPubEntry *entry)
+{
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    }
+    else {
+        we_ec_pub_cache_head = entry->next;
+    }
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    }
+    else {
+        we_ec_pub_cache_tail = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+/**
+ * Put an entry at the front of the most recently used list.
+ *
+ * Must be called with the cache locked.
+ *
+ * @param  entry  [in]  Cache entry not in list.
+ */
+static void we_ec_pub_cache_attach(we_EcPubEntry *entry)
+{
+    entry->next = we_ec_pub_cache_head;
+    if (we_ec_pub_cache_head != NULL) {
+        we_ec_pub_cache_head->prev = entry;
+    }
+    else {
+        we_ec_pub_cache_tail = entry;
+    }
+    we_ec_pub_cache_head = entry;
+}
+
+/**
+ * Remove an entry from the cache list and hash table.
+ *
+ * The entry is freed by the caller when it has no users. Otherwise it is
+ * freed when the last user returns it. Must be called with the cache locked.
+ *
+ * @param  entry  [in]  Cache entry in list.
+ * @returns  1 when the entry is to be freed by the caller and 0 otherwise.
+ */
+static int we_ec_pub_cache_unlink(we_EcPubEntry *entry)
+{
+    we_EcPubEntry **bucket;
+
+    bucket = &we_ec_pub_cache_table[entry->hash & we_ec_pub_cache_mask];
+    while (*bucket != entry) {
+        bucket = &(*bucket)->hnext;
+    }
+    *bucket = entry->hnext;
+    entry->hnext = NULL;
+
+    we_ec_pub_cache_detach(entry);
+    entry->inCache = 0;
+    we_ec_pub_cache_cnt--;
+
+    return entry->refs == 0;
+}
+
+/**
+ * Find the entry for a public key in the hash table.
+ *
+ * Must be called with the cache locked.
+ *
+ * @param  hash     [in]  Hash of curve and public key.
+ * @param  curveId  [in]  wolfSSL curve identifier.
+ * @param  pub      [in]  Public key as an uncompressed point.
+ * @param  pubLen   [in]  Length of public key in bytes.
+ * @returns  Cache entry when found and NULL otherwise.
+ */
+static we_EcPubEntry *we_ec_pub_cache_find(word32 hash, int curveId,
+                                           const unsigned char *pub,
+                                           int pubLen)
+{
+    we_EcPubEntry *entry;
+
+    entry = we_ec_pub_cache_table[hash & we_ec_pub_cache_mask];
+    for (; entry != NULL; entry = entry->hnext) {
+        if (entry->hash == hash && entry->curveId == curveId &&
+            entry->pubLen == pubLen &&
+            XMEMCMP(entry->pub, pub, pubLen) == 0) {
+            break;
+        }
+    }
+
+    return entry;
+}
+
+/**
+ * Find the entry for a public key and take a reference to it.
+ *
+ * The entry becomes the most recently used. Must be called with the cache
+ * locked.
+ *
+ * @param  hash     [in]  Hash of curve and public key.
+ * @param  curveId  [in]  wolfSSL curve identifier.
+ * @param  pub      [in]  Public key as an uncompressed point.
+ * @param  pubLen   [in]  Length of public key in bytes.
+ * @returns  Cache entry when found and NULL otherwise.
+ */
+static we_EcPubEntry *we_ec_pub_cache_ref(word32 hash, int curveId,
+                                          const unsigned char *pub,
+                                          int pubLen)
+{
+    we_EcPubEntry *entry;
+
+    entry = we_ec_pub_cache_find(hash, curveId, pub, pubLen);
+    if (entry != NULL) {
+        entry->refs++;
+        if (entry != we_ec_pub_cache_head) {
+            we_ec_pub_cache_detach(entry);
+            we_ec_pub_cache_attach(entry);
+        }
+    }
+
+    return entry;
+}
+
+/**
+ * Remove all entries from the cache and dispose of them.
+ *
+ * Entries that are in use are disposed of when they are returned.
+ */
+static void we_ec_pub_cache_clear(void)
+{
+    we_EcPubEntry *entry;
+    we_EcPubEntry *unused = NULL;
+
+    WE_EC_PUB_CACHE_LOCK();
+    while ((entry = we_ec_pub_cache_head) != NULL) {
+        if (we_ec_pub_cache_unlink(entry)) {
+            entry->next = unused;
+            unused = entry;
+        }
+    }
+    WE_EC_PUB_CACHE_UNLOCK();
+
+    while ((entry = unused) != NULL) {
+        unused = entry->next;
+        we_ec_pub_entry_free(entry);
+    }
+}
+
+/**
+ * Set the maximum number of public keys to cache.
+ *
+ * Cached keys are disposed of. The hash table has at least as many buckets as
+ * keys.
+ *
+ * @param  size  [in]  Number of keys. 0 disables the cache.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_ec_pub_cache_set_size(long size)
+{
+    int ret = 1;
+    word32 buckets = 1;
+    we_EcPubEntry **table = NULL;
+
+    WOLFENGINE_ENTER("we_ec_pub_cache_set_size");
+
+    if (size < 0 || size > WE_EC_PUB_CACHE_MAX) {
+        WOLFENGINE_ERROR_MSG("Invalid EC public key cache size");
+        ret = 0;
+    }
+    if (ret == 1 && size > 0) {
+        while (buckets < (word32)size) {
+            buckets <<= 1;
+        }
+        table = (we_EcPubEntry **)OPENSSL_zalloc(buckets * sizeof(*table));
+        if (table == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_zalloc", table);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        we_ec_pub_cache_clear();
+        WE_EC_PUB_CACHE_LOCK();
+        OPENSSL_free(we_ec_pub_cache_table);
+        we_ec_pub_cache_table = table;
+        we_ec_pub_cache_mask = buckets - 1;
+        we_ec_pub_cache_size = (int)size;
+        WE_EC_PUB_CACHE_UNLOCK();
+    }
+
+    WOLFENGINE_LEAVE("we_ec_pub_cache_set_size", ret);
+
+    return ret;
+}
+
+/**
+ * Dispose of all cached public keys and disable the cache.
+ */
+void we_ec_pub_cache_free(void)
+{
+    we_ec_pub_cache_clear();
+    WE_EC_PUB_CACHE_LOCK();
+    OPENSSL_free(we_ec_pub_cache_table);
+    we_ec_pub_cache_table = NULL;
+    we_ec_pub_cache_mask = 0;
+    we_ec_pub_cache_size = 0;
+    WE_EC_PUB_CACHE_UNLOCK();
+}
+
+/**
+ * Indicates whether the cache is enabled.
+ *
+ * @returns  1 when enabled and 0 otherwise.
+ */
+int we_ec_pub_cache_enabled(void)
+{
+    return we_ec_pub_cache_size > 0;
+}
+
+/**
+ * Import a public key into a new entry.
+ *
+ * @param  hash     [in]  Hash of curve and public key.
+ * @param  curveId  [in]  wolfSSL curve identifier.
+ * @param  pub      [in]  Public key as an uncompressed point.
+ * @param  pubLen   [in]  Length of public key in bytes.
+ * @returns  Entry with one reference on success and NULL on failure.
+ */
+static we_EcPubEntry *we_ec_pub_entry_new(word32 hash, int curveId,
+                                          const unsigned char *pub,
+                                          int pubLen)
+{
+    int ret = 1, rc;
+    we_EcPubEntry *entry;
+
+    entry = (we_EcPubEntry *)OPENSSL_zalloc(sizeof(*entry));
+    if (entry == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_zalloc", entry);
+        ret = 0;
+    }
+    if (ret == 1) {
+        rc = wc_ecc_init(&entry->key);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
+            OPENSSL_free(entry);
+            entry = NULL;
+            ret = 0;
+        }
+    }
+#ifdef WE_HAVE_THREADS
+    if (ret == 1) {
+        rc = pthread_mutex_init(&entry->useMutex, NULL);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("pthread_mutex_init", rc);
+            wc_ecc_free(&entry->key);
+            OPENSSL_free(entry);
+            entry = NULL;
+            ret = 0;
+        }
+    }
+#endif
+    if (ret == 1) {
+        rc = wc_ecc_import_x963_ex(pub, pubLen, &entry->key, curveId);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_import_x963_ex", rc);
+            we_ec_pub_entry_free(entry);
+            entry = NULL;
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        entry->curveId = curveId;
+        XMEMCPY(entry->pub, pub, pubLen);
+        entry->pubLen = pubLen;
+        entry->hash = hash;
+        entry->refs = 1;
+    }
+
+    return entry;
+}
+
+/**
+ * Get a wolfSSL key with the public key imported.
+ *
+ * The key is shared with other users of the same public key and must be
+ * returned with we_ec_pub_cache_put(). Use the key between
+ * we_ec_pub_cache_lock() and we_ec_pub_cache_unlock().
+ *
+ * @param  curveId  [in]   wolfSSL curve identifier.
+ * @param  pub      [in]   Public key as an uncompressed point.
+ * @param  pubLen   [in]   Length of public key in bytes.
+ * @param  key      [out]  wolfSSL key. NULL when cache is disabled.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_ec_pub_cache_get(int curveId, const unsigned char *pub, int pubLen,
+                        ecc_key **key)
+{
+    int ret = 1;
+    int enabled;
+    word32 hash = 0;
+    we_EcPubEntry *entry = NULL;
+    we_EcPubEntry *found;
+    we_EcPubEntry *unused = NULL;
+    we_EcPubEntry *evict;
+    int imported = 0;
+
+    WOLFENGINE_ENTER("we_ec_pub_cache_get");
+
+    *key = NULL;
+
+    if (pubLen <= 0 || pubLen > (int)sizeof(entry->pub)) {
+        WOLFENGINE_ERROR_MSG("Invalid EC public key length");
+        ret = 0;
+    }
+    if (ret == 1) {
+        hash = we_ec_pub_cache_hash(curveId, pub, pubLen);
+
+        WE_EC_PUB_CACHE_LOCK();
+        enabled = we_ec_pub_cache_size > 0;
+        if (enabled) {
+            entry = we_ec_pub_cache_ref(hash, curveId, pub, pubLen);
+        }
+        WE_EC_PUB_CACHE_UNLOCK();
+
+        if (enabled && entry == NULL) {
+            /* Import outside lock so lookups of other keys don't wait. */
+            WOLFENGINE_MSG("EC public key not cached - importing");
+            entry = we_ec_pub_entry_new(hash, curveId, pub, pubLen);
+            if (entry == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("we_ec_pub_entry_new", entry);
+                ret = 0;
+            }
+            imported = (entry != NULL);
+        }
+        if (imported) {
+            WE_EC_PUB_CACHE_LOCK();
+            found = NULL;
+            if (we_ec_pub_cache_size > 0) {
+                found = we_ec_pub_cache_ref(hash, curveId, pub, pubLen);
+            }
+            if (found != NULL) {
+                /* Imported by another user meanwhile - share theirs. */
+                unused = entry;
+                entry = found;
+            }
+            else if (we_ec_pub_cache_size > 0) {
+                entry->hnext = we_ec_pub_cache_table[hash &
+                                                     we_ec_pub_cache_mask];
+                we_ec_pub_cache_table[hash & we_ec_pub_cache_mask] = entry;
+                we_ec_pub_cache_attach(entry);
+                entry->inCache = 1;
+                we_ec_pub_cache_cnt++;
+
+                while (we_ec_pub_cache_cnt > we_ec_pub_cache_size) {
+                    evict = we_ec_pub_cache_tail;
+                    if (we_ec_pub_cache_unlink(evict)) {
+                        evict->next = unused;
+                        unused = evict;
+                    }
+                }
+            }
+            /* Cache disabled meanwhile - entry only used by caller. */
+            WE_EC_PUB_CACHE_UNLOCK();
+        }
+    }
+    if (ret == 1 && entry != NULL) {
+        *key = &entry->key;
+    }
+
+    while ((evict = unused) != NULL) {
+        unused = evict->next;
+        we_ec_pub_entry_free(evict);
+    }
+
+    WOLFENGINE_LEAVE("we_ec_pub_cache_get", ret);
+
+    return ret;
+}
+
+/**
+ * Lock a key from we_ec_pub_cache_get() for a verification.
+ *
+ * @param  key  [in]  wolfSSL key.
+ */
+void we_ec_pub_cache_lock(ecc_key *key)
+{
+#ifdef WE_HAVE_THREADS
+    pthread_mutex_lock(&((we_EcPubEntry *)key)->useMutex);
+#else
+    (void)key;
+#endif
+}
+
+/**
+ * Unlock a key locked with we_ec_pub_cache_lock().
+ *
+ * @param  key  [in]  wolfSSL key.
+ */
+void we_ec_pub_cache_unlock(ecc_key *key)
+{
+#ifdef WE_HAVE_THREADS
+    pthread_mutex_unlock(&((we_EcPubEntry *)key)->useMutex);
+#else
+    (void)key;
+#endif
+}
+
+/**
+ * Return a key, from we_ec_pub_cache_get(), to the cache.
+ *
+ * The key is disposed of when it is no longer cached and has no other users.
+ *
+ * @param  key  [in]  wolfSSL key.
+ */
+void we_ec_pub_cache_put(ecc_key *key)
+{
+    we_EcPubEntry *entry = (we_EcPubEntry *)key;
+    int unused;
+
+    WOLFENGINE_ENTER("we_ec_pub_cache_put");
+
+    WE_EC_PUB_CACHE_LOCK();
+    entry->refs--;
+    unused = (entry->refs == 0 && !entry->inCache);
+    WE_EC_PUB_CACHE_UNLOCK();
+
+    if (unused) {
+        we_ec_pub_entry_free(entry);
+    }
+
+    WOLFENGINE_LEAVE("we_ec_pub_cache_put", 1);
+}
+
+#endif /* WE_HAVE_EC_PUB_CACHE */
@@ -0,0 +1,888 @@
+/* ecdsa_precomp.c
+ *
+ * Copyright (C) 2019-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfengine.
+ *
+ * wolfengine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfengine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#include "internal.h"
+
+#ifdef WE_HAVE_ECDSA_SIGN_SETUP
+
+/**
+ * Generate a random blinding value in the range 1..n-1.
+ *
+ * Eight extra bytes are generated so that the reduction modulo n has
+ * negligible bias.
+ *
+ * @param  rng  [in]   Random number generator.
+ * @param  n    [in]   Order of the curve.
+ * @param  sz   [in]   Size of the curve in bytes.
+ * @param  b    [out]  Blinding value.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_ecdsa_gen_blind(WC_RNG *rng, mp_int *n, int sz, mp_int *b)
+{
+    int ret = 1, rc;
+    unsigned char buf[WE_ECDSA_MAX_SZ + 8];
+
+    rc = wc_RNG_GenerateBlock(rng, buf, (word32)sz + 8);
+    if (rc != 0) {
+        WOLFENGINE_ERROR_FUNC("wc_RNG_GenerateBlock", rc);
+        ret = 0;
+    }
+    if (ret == 1) {
+        rc = mp_read_unsigned_bin(b, buf, sz + 8);
+        if (rc == MP_OKAY) {
+            rc = mp_mod(b, n, b);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_mod", rc);
+            ret = 0;
+        }
+        else if (mp_iszero(b)) {
+            WOLFENGINE_ERROR_MSG("ECDSA blinding value is zero");
+            ret = 0;
+        }
+    }
+
+    OPENSSL_cleanse(buf, sizeof(buf));
+
+    return ret;
+}
+
+/**
+ * Invert a value modulo the order of the curve in constant time.
+ *
+ * The order is prime so, by Fermat's little theorem, a^-1 = a^(n-2) mod n.
+ * Unlike mp_invmod, the time taken does not depend on the value of a.
+ *
+ * @param  a  [in]   Value to invert. Must be non-zero and less than n.
+ * @param  n  [in]   Order of the curve.
+ * @param  r  [out]  a^-1 mod n.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_ecdsa_invmod(mp_int *a, mp_int *n, mp_int *r)
+{
+    int ret = 1, rc;
+    mp_int e;
+
+    rc = mp_init(&e);
+    if (rc != MP_OKAY) {
+        WOLFENGINE_ERROR_FUNC("mp_init", rc);
+        ret = 0;
+    }
+    else {
+        rc = mp_sub_d(n, 2, &e);
+        if (rc == MP_OKAY) {
+            rc = mp_exptmod(a, &e, n, r);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_exptmod", rc);
+            ret = 0;
+        }
+        mp_free(&e);
+    }
+
+    return ret;
+}
+
+/**
+ * Precompute the per-signature values of an ECDSA signature.
+ *
+ * An ephemeral key (k, kG) is generated and r = x(kG) mod n is calculated.
+ * k is multiplied by a random blinding value b before it is inverted so the
+ * inversion does not operate on k directly. When blind is not NULL,
+ * (k.b)^-1 mod n and b are returned for we_ecdsa_sign_precomp. Otherwise
+ * the blinding is removed and k^-1 mod n is returned.
+ *
+ * The values do not depend on the private key and must only be used for one
+ * signature.
+ *
+ * @param  curveId  [in]   wolfSSL curve identifier.
+ * @param  rng      [in]   Random number generator to generate k with.
+ * @param  kinv     [out]  Buffer to hold (k.b)^-1 mod n, or k^-1 mod n when
+ *                         blind is NULL, as a big-endian byte array the size
+ *                         of the curve.
+ * @param  r        [out]  Buffer to hold r as a big-endian byte array the
+ *                         size of the curve.
+ * @param  blind    [out]  Buffer to hold b as a big-endian byte array the
+ *                         size of the curve. May be NULL.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_ecdsa_precompute(int curveId, WC_RNG *rng, unsigned char *kinv,
+                        unsigned char *r, unsigned char *blind)
+{
+    int ret = 1, rc;
+    int sz;
+    int init = 0;
+    ecc_key eph;
+    mp_int k, x, n, t, b;
+    unsigned char buf[1 + 2 * WE_ECDSA_MAX_SZ];
+    word32 len;
+
+    WOLFENGINE_ENTER("we_ecdsa_precompute");
+
+    sz = wc_ecc_get_curve_size_from_id(curveId);
+    if (sz <= 0 || sz > WE_ECDSA_MAX_SZ) {
+        WOLFENGINE_ERROR_MSG("Unsupported curve for ECDSA precomputation");
+        ret = 0;
+    }
+    if (ret == 1) {
+        rc = wc_ecc_init(&eph);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_init", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        rc = mp_init_multi(&k, &x, &n, &t, &b, NULL);
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_init_multi", rc);
+            wc_ecc_free(&eph);
+            ret = 0;
+        }
+        else {
+            init = 1;
+        }
+    }
+    if (ret == 1) {
+        /* Ephemeral key pair: k is the private key and kG the public. */
+        rc = wc_ecc_make_key_ex(rng, sz, &eph, curveId);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_make_key_ex", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        len = sizeof(buf);
+        rc = wc_ecc_export_private_only(&eph, buf, &len);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_export_private_only", rc);
+            ret = 0;
+        }
+        else {
+            rc = mp_read_unsigned_bin(&k, buf, (int)len);
+            if (rc != MP_OKAY) {
+                WOLFENGINE_ERROR_FUNC("mp_read_unsigned_bin", rc);
+                ret = 0;
+            }
+        }
+    }
+    if (ret == 1) {
+        /* Uncompressed point: 0x04 | x | y. */
+        len = sizeof(buf);
+        rc = wc_ecc_export_x963(&eph, buf, &len);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_export_x963", rc);
+            ret = 0;
+        }
+        else {
+            rc = mp_read_unsigned_bin(&x, buf + 1, sz);
+            if (rc != MP_OKAY) {
+                WOLFENGINE_ERROR_FUNC("mp_read_unsigned_bin", rc);
+                ret = 0;
+            }
+        }
+    }
+    if (ret == 1) {
+        rc = mp_read_radix(&n, eph.dp->order, MP_RADIX_HEX);
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_read_radix", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* r = x mod n */
+        rc = mp_mod(&x, &n, &x);
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_mod", rc);
+            ret = 0;
+        }
+        else if (mp_iszero(&x)) {
+            WOLFENGINE_ERROR_MSG("ECDSA r is zero");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        ret = we_ecdsa_gen_blind(rng, &n, sz, &b);
+    }
+    if (ret == 1) {
+        /* t = (k.b)^-1 mod n */
+        rc = mp_mulmod(&k, &b, &n, &t);
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_mulmod", rc);
+            ret = 0;
+        }
+        else {
+            ret = we_ecdsa_invmod(&t, &n, &t);
+        }
+    }
+    if (ret == 1 && blind == NULL) {
+        /* kinv = (k.b)^-1 . b = k^-1 mod n */
+        rc = mp_mulmod(&t, &b, &n, &t);
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_mulmod", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        rc = mp_to_unsigned_bin_len(&t, kinv, sz);
+        if (rc == MP_OKAY) {
+            rc = mp_to_unsigned_bin_len(&x, r, sz);
+        }
+        if (rc == MP_OKAY && blind != NULL) {
+            rc = mp_to_unsigned_bin_len(&b, blind, sz);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_to_unsigned_bin_len", rc);
+            ret = 0;
+        }
+    }
+
+    OPENSSL_cleanse(buf, sizeof(buf));
+    if (init) {
+        mp_forcezero(&k);
+        mp_forcezero(&t);
+        mp_forcezero(&b);
+        mp_free(&x);
+        mp_free(&n);
+        wc_ecc_free(&eph);
+    }
+
+    WOLFENGINE_LEAVE("we_ecdsa_precompute", ret);
+
+    return ret;
+}
+
+/**
+ * Sign a digest using precomputed values.
+ *
+ * Calculates s = (k.b)^-1 . (b.e + (b.r).d) mod n which equals
+ * k^-1 . (e + r.d) mod n. The private key is only multiplied by the blinded
+ * value b.r. When no blinding value is passed in, a random one is generated
+ * and k^-1 is converted to (k.b)^-1 with a constant time inversion of b.
+ * Only modular multiplications are performed when a blinding value is
+ * passed in as the point multiplication was done when precomputing.
+ *
+ * @param  key      [in]      wolfSSL ECC key with private key set.
+ * @param  rng      [in]      Random number generator for blinding.
+ * @param  dgst     [in]      Digest to be signed.
+ * @param  dLen     [in]      Length of digest.
+ * @param  kinv     [in]      (k.b)^-1 mod n, or k^-1 mod n when blind is NULL,
+ *                            as a big-endian byte array the size of the curve.
+ * @param  r        [in]      r as a big-endian byte array the size of the
+ *                            curve.
+ * @param  blind    [in]      b as a big-endian byte array the size of the
+ *                            curve. May be NULL.
+ * @param  sig      [out]     Buffer to hold DER encoded signature.
+ * @param  sigLen   [in/out]  On in, size of buffer.
+ *                            On out, length of signature in bytes.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_ecdsa_sign_precomp(ecc_key *key, WC_RNG *rng, const unsigned char *dgst,
+                          int dLen, const unsigned char *kinv,
+                          const unsigned char *r, const unsigned char *blind,
+                          unsigned char *sig, word32 *sigLen)
+{
+    int ret = 1, rc;
+    int sz = key->dp->size;
+    int orderBits = 0;
+    int init = 0;
+    mp_int e, d, n, k, rr, s, b, x;
+    unsigned char buf[WE_ECDSA_MAX_SZ];
+    word32 len;
+
+    WOLFENGINE_ENTER("we_ecdsa_sign_precomp");
+
+    rc = mp_init_multi(&e, &d, &n, &k, &rr, &s);
+    if (rc == MP_OKAY) {
+        rc = mp_init_multi(&b, &x, NULL, NULL, NULL, NULL);
+        if (rc != MP_OKAY) {
+            mp_free(&e);
+            mp_free(&d);
+            mp_free(&n);
+            mp_free(&k);
+            mp_free(&rr);
+            mp_free(&s);
+        }
+    }
+    if (rc != MP_OKAY) {
+        WOLFENGINE_ERROR_FUNC("mp_init_multi", rc);
+        ret = 0;
+    }
+    else {
+        init = 1;
+    }
+    if (ret == 1) {
+        rc = mp_read_radix(&n, key->dp->order, MP_RADIX_HEX);
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_read_radix", rc);
+            ret = 0;
+        }
+        else {
+            orderBits = mp_count_bits(&n);
+        }
+    }
+    if (ret == 1) {
+        len = sizeof(buf);
+        rc = wc_ecc_export_private_only(key, buf, &len);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_export_private_only", rc);
+            ret = 0;
+        }
+        else {
+            rc = mp_read_unsigned_bin(&d, buf, (int)len);
+            if (rc != MP_OKAY) {
+                WOLFENGINE_ERROR_FUNC("mp_read_unsigned_bin", rc);
+                ret = 0;
+            }
+        }
+    }
+    if (ret == 1) {
+        rc = mp_read_unsigned_bin(&k, kinv, sz);
+        if (rc == MP_OKAY) {
+            rc = mp_read_unsigned_bin(&rr, r, sz);
+        }
+        if (rc == MP_OKAY && blind != NULL) {
+            rc = mp_read_unsigned_bin(&b, blind, sz);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_read_unsigned_bin", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1 && (mp_iszero(&k) || mp_iszero(&rr) ||
+                     mp_cmp(&k, &n) != MP_LT || mp_cmp(&rr, &n) != MP_LT)) {
+        WOLFENGINE_ERROR_MSG("Invalid precomputed ECDSA values");
+        ret = 0;
+    }
+    if (ret == 1 && blind != NULL &&
+            (mp_iszero(&b) || mp_cmp(&b, &n) != MP_LT)) {
+        WOLFENGINE_ERROR_MSG("Invalid ECDSA blinding value");
+        ret = 0;
+    }
+    if (ret == 1 && blind == NULL) {
+        /* k = k^-1 . b^-1 = (k.b)^-1 mod n for a new random b. */
+        ret = we_ecdsa_gen_blind(rng, &n, sz, &b);
+        if (ret == 1) {
+            ret = we_ecdsa_invmod(&b, &n, &x);
+        }
+        if (ret == 1) {
+            rc = mp_mulmod(&k, &x, &n, &k);
+            if (rc != MP_OKAY) {
+                WOLFENGINE_ERROR_FUNC("mp_mulmod", rc);
+                ret = 0;
+            }
+        }
+    }
+    if (ret == 1) {
+        /* e is the leftmost bits of the digest, up to the size of order. */
+        if (dLen > (orderBits + 7) / 8) {
+            dLen = (orderBits + 7) / 8;
+        }
+        rc = mp_read_unsigned_bin(&e, dgst, dLen);
+        if (rc == MP_OKAY && dLen * 8 > orderBits) {
+            rc = mp_div_2d(&e, dLen * 8 - orderBits, &e, NULL);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_read_unsigned_bin", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* s = (k.b)^-1 . (b.e + (b.r).d) mod n */
+        rc = mp_mulmod(&rr, &b, &n, &x);
+        if (rc == MP_OKAY) {
+            rc = mp_mulmod(&x, &d, &n, &s);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_mulmod(&e, &b, &n, &x);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_add(&s, &x, &s);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_mulmod(&s, &k, &n, &d);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_mulmod", rc);
+            ret = 0;
+        }
+        else if (mp_iszero(&d)) {
+            WOLFENGINE_ERROR_MSG("ECDSA s is zero");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        rc = mp_to_unsigned_bin_len(&d, buf, sz);
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_to_unsigned_bin_len", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* Encode r and s as DER. */
+        rc = wc_ecc_rs_raw_to_sig(r, sz, buf, sz, sig, sigLen);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_ecc_rs_raw_to_sig", rc);
+            ret = 0;
+        }
+    }
+
+    OPENSSL_cleanse(buf, sizeof(buf));
+    if (init) {
+        mp_forcezero(&d);
+        mp_forcezero(&k);
+        mp_forcezero(&s);
+        mp_forcezero(&b);
+        mp_forcezero(&x);
+        mp_free(&e);
+        mp_free(&n);
+        mp_free(&rr);
+    }
+
+    WOLFENGINE_LEAVE("we_ecdsa_sign_precomp", ret);
+
+    return ret;
+}
+
+#ifdef WE_HAVE_ECDSA_SIGN_POOL
+
+#include <limits.h>
+#include <pthread.h>
+
+/**
+ * Precomputed values for one ECDSA signature.
+ */
+typedef struct we_EcdsaPair {
+    /* (k.b)^-1 mod n as a big-endian byte array the size of the curve. */
+    unsigned char kinv[WE_ECDSA_MAX_SZ];
+    /* r as a big-endian byte array the size of the curve. */
+    unsigned char r[WE_ECDSA_MAX_SZ];
+    /* Blinding value b as a big-endian byte array the size of the curve. */
+    unsigned char blind[WE_ECDSA_MAX_SZ];
+} we_EcdsaPair;
+
+/**
+ * Pool of precomputed values for one curve.
+ */
+typedef struct we_EcdsaPool {
+    /* wolfSSL curve identifier. */
+    int curveId;
+    /* Precomputed values. */
+    we_EcdsaPair *pairs;
+    /* Number of precomputed values available. */
+    int cnt;
+} we_EcdsaPool;
+
+/* Pools of precomputed values - one for each supported curve. */
+static we_EcdsaPool we_ecdsa_pool[] = {
+#ifdef WE_HAVE_EC_P256
+    { ECC_SECP256R1, NULL, 0 },
+#endif
+#ifdef WE_HAVE_EC_P384
+    { ECC_SECP384R1, NULL, 0 },
+#endif
+};
+#define WE_ECDSA_POOL_CNT \
+    (int)(sizeof(we_ecdsa_pool) / sizeof(*we_ecdsa_pool))
+
+/* Protects pool data. */
+static pthread_mutex_t we_ecdsa_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Signals the thread that the pool needs filling or that it must stop. */
+static pthread_cond_t we_ecdsa_pool_cond = PTHREAD_COND_INITIALIZER;
+/* Thread precomputing values for the pools. */
+static pthread_t we_ecdsa_pool_thread;
+/* Indicates the thread is running. */
+static int we_ecdsa_pool_running = 0;
+/* Number of precomputed values to keep for each curve. */
+static int we_ecdsa_pool_size = 0;
+/* Indicates thread must stop. */
+static int we_ecdsa_pool_stop = 0;
+/* Registers the fork handlers once. */
+static pthread_once_t we_ecdsa_pool_once = PTHREAD_ONCE_INIT;
+/* Indicates the fork handlers were registered. */
+static int we_ecdsa_pool_atfork = 0;
+
+/**
+ * Fork handler called in the parent before fork.
+ *
+ * Holds the mutex so that the pools are consistent in the child.
+ */
+static void we_ecdsa_pool_prepare(void)
+{
+    pthread_mutex_lock(&we_ecdsa_pool_mutex);
+}
+
+/**
+ * Fork handler called in the parent after fork.
+ */
+static void we_ecdsa_pool_parent(void)
+{
+    pthread_mutex_unlock(&we_ecdsa_pool_mutex);
+}
+
+/**
+ * Fork handler called in the child after fork.
+ *
+ * The child has a copy of the parent's precomputed values. Using them would
+ * reuse k in both processes and reveal the private key, so they are disposed
+ * of. The pool thread does not exist in the child so the pools are no longer
+ * running. Setting the size again restarts the pools in the child.
+ */
+static void we_ecdsa_pool_child(void)
+{
+    int i;
+
+    for (i = 0; i < WE_ECDSA_POOL_CNT; i++) {
+        if (we_ecdsa_pool[i].pairs != NULL) {
+            OPENSSL_clear_free(we_ecdsa_pool[i].pairs,
+                               we_ecdsa_pool_size * sizeof(we_EcdsaPair));
+        }
+        we_ecdsa_pool[i].pairs = NULL;
+        we_ecdsa_pool[i].cnt = 0;
+    }
+    we_ecdsa_pool_running = 0;
+    we_ecdsa_pool_stop = 0;
+    we_ecdsa_pool_size = 0;
+    /* Only waiter was the pool thread which was not copied. */
+    pthread_cond_init(&we_ecdsa_pool_cond, NULL);
+    pthread_mutex_unlock(&we_ecdsa_pool_mutex);
+}
+
+/**
+ * Register the fork handlers.
+ */
+static void we_ecdsa_pool_init_atfork(void)
+{
+    int rc;
+
+    rc = pthread_atfork(we_ecdsa_pool_prepare, we_ecdsa_pool_parent,
+                        we_ecdsa_pool_child);
+    if (rc != 0) {
+        WOLFENGINE_ERROR_FUNC("pthread_atfork", rc);
+    }
+    else {
+        we_ecdsa_pool_atfork = 1;
+    }
+}
+
+/**
+ * Find the pool with the fewest precomputed values.
+ *
+ * Must be called with the pool mutex held.
+ *
+ * @returns  Pool to precompute values for or NULL when all pools are full.
+ */
+static we_EcdsaPool *we_ecdsa_pool_next(void)
+{
+    we_EcdsaPool *pool = NULL;
+    int i;
+    int minCnt = we_ecdsa_pool_size;
+
+    for (i = 0; i < WE_ECDSA_POOL_CNT; i++) {
+        if (we_ecdsa_pool[i].cnt < minCnt) {
+            minCnt = we_ecdsa_pool[i].cnt;
+            pool = &we_ecdsa_pool[i];
+        }
+    }
+
+    return pool;
+}
+
+/**
+ * Thread function that fills the pools.
+ *
+ * Values are precomputed without holding the mutex so that signing is not
+ * blocked. Thread waits when all pools are full.
+ *
+ * @param  arg  [in]  Unused.
+ * @returns  NULL always.
+ */
+static void *we_ecdsa_pool_worker(void *arg)
+{
+    int rc;
+    int ok;
+    WC_RNG rng;
+    we_EcdsaPool *pool;
+    we_EcdsaPair pair;
+
+    (void)arg;
+
+    WOLFENGINE_ENTER("we_ecdsa_pool_worker");
+
+    /* Thread has its own random as the global random is not locked. */
+    rc = wc_InitRng(&rng);
+    if (rc != 0) {
+        WOLFENGINE_ERROR_FUNC("wc_InitRng", rc);
+    }
+    else {
+        pthread_mutex_lock(&we_ecdsa_pool_mutex);
+        while (!we_ecdsa_pool_stop) {
+            pool = we_ecdsa_pool_next();
+            if (pool == NULL) {
+                pthread_cond_wait(&we_ecdsa_pool_cond, &we_ecdsa_pool_mutex);
+                continue;
+            }
+            pthread_mutex_unlock(&we_ecdsa_pool_mutex);
+
+            ok = we_ecdsa_precompute(pool->curveId, &rng, pair.kinv, pair.r,
+                                     pair.blind);
+
+            pthread_mutex_lock(&we_ecdsa_pool_mutex);
+            if (ok && pool->cnt < we_ecdsa_pool_size) {
+                pool->pairs[pool->cnt++] = pair;
+            }
+        }
+        pthread_mutex_unlock(&we_ecdsa_pool_mutex);
+
+        OPENSSL_cleanse(&pair, sizeof(pair));
+        wc_FreeRng(&rng);
+    }
+
+    WOLFENGINE_LEAVE("we_ecdsa_pool_worker", 0);
+
+    return NULL;
+}
+
+/**
+ * Stop the pool thread and dispose of the precomputed values.
+ */
+static void we_ecdsa_pool_stop_thread(void)
+{
+    int i;
+    int running;
+
+    WOLFENGINE_ENTER("we_ecdsa_pool_stop_thread");
+
+    /* Signing stops taking values once running is cleared. */
+    pthread_mutex_lock(&we_ecdsa_pool_mutex);
+    running = we_ecdsa_pool_running;
+    we_ecdsa_pool_running = 0;
+    we_ecdsa_pool_stop = 1;
+    pthread_cond_signal(&we_ecdsa_pool_cond);
+    pthread_mutex_unlock(&we_ecdsa_pool_mutex);
+
+    if (running) {
+        pthread_join(we_ecdsa_pool_thread, NULL);
+    }
+
+    pthread_mutex_lock(&we_ecdsa_pool_mutex);
+    we_ecdsa_pool_stop = 0;
+    for (i = 0; i < WE_ECDSA_POOL_CNT; i++) {
+        if (we_ecdsa_pool[i].pairs != NULL) {
+            OPENSSL_clear_free(we_ecdsa_pool[i].pairs,
+                               we_ecdsa_pool_size * sizeof(we_EcdsaPair));
+        }
+        we_ecdsa_pool[i].pairs = NULL;
+        we_ecdsa_pool[i].cnt = 0;
+    }
+    pthread_mutex_unlock(&we_ecdsa_pool_mutex);
+
+    WOLFENGINE_LEAVE("we_ecdsa_pool_stop_thread", 1);
+}
+
+/**
+ * Set the number of precomputed values to keep for each curve.
+ *
+ * The existing thread is stopped and values disposed of. When the size is
+ * non-zero, the pools are allocated and a thread started to fill them.
+ *
+ * @param  size  [in]  Number of precomputed values. 0 disables the pool.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_ecdsa_pool_set_size(long size)
+{
+    int ret = 1;
+    int rc;
+    int i;
+
+    WOLFENGINE_ENTER("we_ecdsa_pool_set_size");
+
+    if (size < 0 || size > INT_MAX / (long)sizeof(we_EcdsaPair)) {
+        WOLFENGINE_ERROR_MSG("Invalid ECDSA sign pool size");
+        ret = 0;
+    }
+    if (ret == 1 && size > 0) {
+        /* Pool must not be used in a child process after fork. */
+        rc = pthread_once(&we_ecdsa_pool_once, we_ecdsa_pool_init_atfork);
+        if (rc != 0 || !we_ecdsa_pool_atfork) {
+            WOLFENGINE_ERROR_MSG("Failed to register ECDSA pool fork handlers");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        we_ecdsa_pool_stop_thread();
+
+        pthread_mutex_lock(&we_ecdsa_pool_mutex);
+        we_ecdsa_pool_size = (int)size;
+        for (i = 0; ret == 1 && size > 0 && i < WE_ECDSA_POOL_CNT; i++) {
+            we_ecdsa_pool[i].pairs = (we_EcdsaPair *)OPENSSL_malloc(
+                size * sizeof(we_EcdsaPair));
+            if (we_ecdsa_pool[i].pairs == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_malloc",
+                                           we_ecdsa_pool[i].pairs);
+                ret = 0;
+            }
+        }
+        if (ret == 1 && size > 0) {
+            rc = pthread_create(&we_ecdsa_pool_thread, NULL,
+                                we_ecdsa_pool_worker, NULL);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("pthread_create", rc);
+                ret = 0;
+            }
+            else {
+                we_ecdsa_pool_running = 1;
+            }
+        }
+        pthread_mutex_unlock(&we_ecdsa_pool_mutex);
+
+        if (ret == 0) {
+            we_ecdsa_pool_free();
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_ecdsa_pool_set_size", ret);
+
+    return ret;
+}
+
+/**
+ * Stop the pool thread and free the pools.
+ */
+void we_ecdsa_pool_free(void)
+{
+    we_ecdsa_pool_stop_thread();
+    pthread_mutex_lock(&we_ecdsa_pool_mutex);
+    we_ecdsa_pool_size = 0;
+    pthread_mutex_unlock(&we_ecdsa_pool_mutex);
+}
+
+/**
+ * Remove the blinding from precomputed values: k^-1 = (k.b)^-1 . b mod n.
+ *
+ * @param  curveId  [in]      wolfSSL curve identifier.
+ * @param  kinv     [in/out]  On in, (k.b)^-1 mod n. On out, k^-1 mod n.
+ *                            Big-endian byte arrays the size of the curve.
+ * @param  blind    [in]      b as a big-endian byte array the size of the
+ *                            curve.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_ecdsa_unblind(int curveId, unsigned char *kinv,
+                            const unsigned char *blind)
+{
+    int ret = 1, rc;
+    int sz;
+    int idx;
+    mp_int k, b, n;
+
+    sz = wc_ecc_get_curve_size_from_id(curveId);
+    idx = wc_ecc_get_curve_idx(curveId);
+    rc = mp_init_multi(&k, &b, &n, NULL, NULL, NULL);
+    if (rc != MP_OKAY) {
+        WOLFENGINE_ERROR_FUNC("mp_init_multi", rc);
+        ret = 0;
+    }
+    else {
+        rc = mp_read_radix(&n, wc_ecc_get_curve_params(idx)->order,
+                           MP_RADIX_HEX);
+        if (rc == MP_OKAY) {
+            rc = mp_read_unsigned_bin(&k, kinv, sz);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_read_unsigned_bin(&b, blind, sz);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_mulmod(&k, &b, &n, &k);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_to_unsigned_bin_len(&k, kinv, sz);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_mulmod", rc);
+            ret = 0;
+        }
+        mp_forcezero(&k);
+        mp_forcezero(&b);
+        mp_free(&n);
+    }
+
+    return ret;
+}
+
+/**
+ * Take precomputed values for a signature from the pool.
+ *
+ * The values are removed from the pool so that they are used only once.
+ * When blind is NULL, the blinding is removed and k^-1 mod n is returned.
+ *
+ * @param  curveId  [in]   wolfSSL curve identifier.
+ * @param  kinv     [out]  Buffer of WE_ECDSA_MAX_SZ bytes to hold (k.b)^-1
+ *                         mod n, or k^-1 mod n when blind is NULL.
+ * @param  r        [out]  Buffer of WE_ECDSA_MAX_SZ bytes to hold r.
+ * @param  blind    [out]  Buffer of WE_ECDSA_MAX_SZ bytes to hold b.
+ *                         May be NULL.
+ * @returns  1 when values were taken and 0 when the pool is empty.
+ */
+int we_ecdsa_pool_get(int curveId, unsigned char *kinv, unsigned char *r,
+                      unsigned char *blind)
+{
+    int ret = 0;
+    int i;
+    we_EcdsaPair *pair;
+    unsigned char b[WE_ECDSA_MAX_SZ];
+
+    WOLFENGINE_ENTER("we_ecdsa_pool_get");
+
+    pthread_mutex_lock(&we_ecdsa_pool_mutex);
+    if (we_ecdsa_pool_running) {
+        for (i = 0; i < WE_ECDSA_POOL_CNT; i++) {
+            if (we_ecdsa_pool[i].curveId == curveId &&
+                we_ecdsa_pool[i].cnt > 0) {
+                pair = &we_ecdsa_pool[i].pairs[--we_ecdsa_pool[i].cnt];
+                XMEMCPY(kinv, pair->kinv, sizeof(pair->kinv));
+                XMEMCPY(r, pair->r, sizeof(pair->r));
+                XMEMCPY(b, pair->blind, sizeof(pair->blind));
+                OPENSSL_cleanse(pair, sizeof(*pair));
+                /* Wake up thread to refill pool. */
+                pthread_cond_signal(&we_ecdsa_pool_cond);
+                ret = 1;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&we_ecdsa_pool_mutex);
+
+    if (ret == 1 && blind != NULL) {
+        XMEMCPY(blind, b, sizeof(b));
+    }
+    else if (ret == 1) {
+        /* Don't hold the mutex while removing the blinding. */
+        ret = we_ecdsa_unblind(curveId, kinv, b);
+    }
+    OPENSSL_cleanse(b, sizeof(b));
+
+    WOLFENGINE_LEAVE("we_ecdsa_pool_get", ret);
+
+    return ret;
+}
+
+#endif /* WE_HAVE_ECDSA_SIGN_POOL */
+
+#endif /* WE_HAVE_ECDSA_SIGN_SETUP */
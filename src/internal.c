@@ -27,6 +27,9 @@
 static const int we_pkey_nids[] = {
 #ifdef WE_HAVE_RSA
     NID_rsaEncryption,
+#ifdef WE_HAVE_RSA_PSS
+    NID_rsassaPss,
+#endif
 #endif
 #ifdef WE_HAVE_ECC
     NID_X9_62_id_ecPublicKey,
@@ -60,6 +63,146 @@ int we_pkey_get_nids(const int **nids)
  * Random number generator
  */
 
+#ifdef WE_HAVE_THREADS
+
+#include <pthread.h>
+
+/**
+ * Random number generator of a thread.
+ */
+typedef struct we_ThreadRng {
+    /* wolfSSL random number generator. */
+    WC_RNG rng;
+    /* Next random number generator not used by a thread. */
+    struct we_ThreadRng *next;
+} we_ThreadRng;
+
+/* Protects the list of unused random number generators. */
+static pthread_mutex_t we_rng_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Creates the thread key once. */
+static pthread_once_t we_rng_once = PTHREAD_ONCE_INIT;
+/* Thread key holding the thread's random number generator. */
+static pthread_key_t we_rng_key;
+/* Indicates the thread key was created. */
+static int we_rng_key_ok = 0;
+/* Random number generators of threads that have exited. */
+static we_ThreadRng *we_rng_unused = NULL;
+
+/**
+ * Keep the random number generator of an exiting thread for reuse.
+ *
+ * wolfSSL key objects may still reference it so it isn't freed.
+ *
+ * @param  ptr  [in]  Random number generator of thread.
+ */
+static void we_rng_release(void *ptr)
+{
+    we_ThreadRng *tRng = (we_ThreadRng *)ptr;
+
+    pthread_mutex_lock(&we_rng_mutex);
+    tRng->next = we_rng_unused;
+    we_rng_unused = tRng;
+    pthread_mutex_unlock(&we_rng_mutex);
+}
+
+/**
+ * Create the thread key of random number generators.
+ */
+static void we_rng_init_once(void)
+{
+    we_rng_key_ok = pthread_key_create(&we_rng_key, we_rng_release) == 0;
+}
+
+/**
+ * Get the calling thread's random number generator.
+ *
+ * Created, or reused from an exited thread, on first use by a thread.
+ *
+ * @returns  Random number generator on success and NULL on failure.
+ */
+WC_RNG* we_rng_get(void)
+{
+    int rc;
+    int found = 0;
+    we_ThreadRng *tRng = NULL;
+
+    if (pthread_once(&we_rng_once, we_rng_init_once) == 0 && we_rng_key_ok) {
+        tRng = (we_ThreadRng *)pthread_getspecific(we_rng_key);
+        found = (tRng != NULL);
+    }
+    if (we_rng_key_ok && !found) {
+        pthread_mutex_lock(&we_rng_mutex);
+        tRng = we_rng_unused;
+        if (tRng != NULL) {
+            we_rng_unused = tRng->next;
+        }
+        pthread_mutex_unlock(&we_rng_mutex);
+
+        if (tRng == NULL) {
+            tRng = (we_ThreadRng *)OPENSSL_zalloc(sizeof(*tRng));
+            if (tRng == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_zalloc", tRng);
+            }
+            else {
+                rc = wc_InitRng(&tRng->rng);
+                if (rc != 0) {
+                    WOLFENGINE_ERROR_FUNC("wc_InitRng", rc);
+                    OPENSSL_free(tRng);
+                    tRng = NULL;
+                }
+            }
+        }
+        if (tRng != NULL) {
+            rc = pthread_setspecific(we_rng_key, tRng);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("pthread_setspecific", rc);
+                we_rng_release(tRng);
+                tRng = NULL;
+            }
+        }
+    }
+
+    return (tRng == NULL) ? NULL : &tRng->rng;
+}
+
+/**
+ * Initialize the calling thread's random number generator object.
+ *
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_init_random()
+{
+    int ret;
+
+    WOLFENGINE_ENTER("we_init_random");
+
+    ret = we_rng_get() != NULL;
+
+    WOLFENGINE_LEAVE("we_init_random", ret);
+
+    return ret;
+}
+
+/**
+ * Free the random number generators of threads that have exited.
+ *
+ * Threads still running keep theirs.
+ */
+static void we_final_random(void)
+{
+    we_ThreadRng *tRng;
+
+    pthread_mutex_lock(&we_rng_mutex);
+    while ((tRng = we_rng_unused) != NULL) {
+        we_rng_unused = tRng->next;
+        wc_FreeRng(&tRng->rng);
+        OPENSSL_free(tRng);
+    }
+    pthread_mutex_unlock(&we_rng_mutex);
+}
+
+#else
+
 /* Global random number generator. */
 static WC_RNG we_globalRng;
 /* Pointer to global random number generator. */
@@ -92,6 +235,19 @@ static int we_init_random()
     return ret;
 }
 
+/**
+ * Free the global random number generator object.
+ */
+static void we_final_random(void)
+{
+    if (we_globalRngInited) {
+        wc_FreeRng(&we_globalRng);
+        we_globalRngInited = 0;
+    }
+}
+
+#endif /* WE_HAVE_THREADS */
+
 #endif /* WE_HAVE_ECC || WE_HAVE_AESGCM || WE_HAVE_RSA */
 
 /** List of supported digest algorithms. */
@@ -126,18 +282,17 @@ static const int we_digest_nids[] = {
 };
 
 /**
- * Convert an OpenSSL hash NID to a wolfCrypt hash OID.
+ * Convert an OpenSSL hash NID to a wolfCrypt hash type.
  *
  * @param  nid  [in]  OpenSSL NID to convert.
- * @return  Returns the OID if a NID -> OID mapping exists and a negative value
- *          if it doesn't.
+ * @return  Returns the hash type if a NID -> hash type mapping exists and
+ *          WC_HASH_TYPE_NONE if it doesn't.
  */
-int we_nid_to_wc_hash_oid(int nid)
+int we_nid_to_wc_hash_type(int nid)
 {
     int hashType = WC_HASH_TYPE_NONE;
-    int ret;
 
-    WOLFENGINE_ENTER("we_nid_to_wc_hash_oid");
+    WOLFENGINE_ENTER("we_nid_to_wc_hash_type");
 
     switch (nid) {
 #ifdef WE_HAVE_SHA1
@@ -184,11 +339,32 @@ int we_nid_to_wc_hash_oid(int nid)
         case NID_sha3_512:
             hashType = WC_HASH_TYPE_SHA3_512;
             break;
+#endif
         default:
             break;
-#endif
     }
 
+    WOLFENGINE_LEAVE("we_nid_to_wc_hash_type", hashType);
+
+    return hashType;
+}
+
+/**
+ * Convert an OpenSSL hash NID to a wolfCrypt hash OID.
+ *
+ * @param  nid  [in]  OpenSSL NID to convert.
+ * @return  Returns the OID if a NID -> OID mapping exists and a negative value
+ *          if it doesn't.
+ */
+int we_nid_to_wc_hash_oid(int nid)
+{
+    int hashType;
+    int ret;
+
+    WOLFENGINE_ENTER("we_nid_to_wc_hash_oid");
+
+    hashType = we_nid_to_wc_hash_type(nid);
+
     ret = wc_HashGetOID(hashType);
     if (ret < 0) {
         WOLFENGINE_ERROR_FUNC("wc_HashGetOID", ret);
@@ -458,6 +634,11 @@ static int we_pkey(ENGINE *e, EVP_PKEY_METHOD **pkey, const int **nids,
         case NID_rsaEncryption:
             *pkey = we_rsa_pkey_method;
             break;
+#ifdef WE_HAVE_RSA_PSS
+        case NID_rsassaPss:
+            *pkey = we_rsa_pss_pkey_method;
+            break;
+#endif /* WE_HAVE_RSA_PSS */
 #endif /* WE_HAVE_RSA */
         case NID_X9_62_id_ecPublicKey:
             *pkey = we_ec_method;
@@ -630,12 +811,37 @@ static int wolfengine_destroy(ENGINE *e)
 
     (void)e;
 
+#ifdef WE_HAVE_KEYSTORE
+    /* Keys use the RSA and EC_KEY methods - free before them. */
+    we_keystore_free();
+#endif
+#ifdef WE_HAVE_KEYD
+    we_keyd_free();
+#endif
 #ifdef WE_HAVE_RSA
+#ifdef WE_HAVE_RSA_KEYGEN_THREADS
+    we_rsa_prime_pool_free();
+#endif
+#ifdef WE_HAVE_RSA_PARALLEL_CRT
+    we_rsa_crt_free();
+#endif
     RSA_meth_free(we_rsa_method);
     we_rsa_method = NULL;
 #endif /* WE_HAVE_RSA */
 #ifdef WE_HAVE_ECC
     /* we_ec_method is freed by OpenSSL_cleanup(). */
+#ifdef WE_HAVE_ECDSA_SIGN_POOL
+    we_ecdsa_pool_free();
+#endif
+#ifdef WE_HAVE_EC_PUB_CACHE
+    we_ec_pub_cache_free();
+#endif
+#ifdef WE_HAVE_EC_KEY_POOL
+    we_ec_key_pool_free();
+#endif
+#if defined(WE_HAVE_EVP_PKEY) && defined(WE_HAVE_ECKEYGEN)
+    we_ec_groups_free();
+#endif
 #ifdef WE_HAVE_EC_KEY
     EC_KEY_METHOD_free(we_ec_key_method);
     we_ec_key_method = NULL;
@@ -722,10 +928,7 @@ static int wolfengine_destroy(ENGINE *e)
     we_sha3_512_md = NULL;
 #endif
 #if defined(WE_HAVE_ECC) || defined(WE_HAVE_AESGCM) || defined(WE_HAVE_RSA)
-    if (we_globalRngInited) {
-        wc_FreeRng(&we_globalRng);
-        we_globalRngInited = 0;
-    }
+    we_final_random();
 #endif
 
     WOLFENGINE_LEAVE("wolfengine_destroy", 1);
@@ -733,8 +936,24 @@ static int wolfengine_destroy(ENGINE *e)
     return 1;
 }
 
-#define WOLFENGINE_CMD_ENABLE_DEBUG     ENGINE_CMD_BASE
-#define WOLFENGINE_CMD_SET_LOGGING_CB   (ENGINE_CMD_BASE + 1)
+#define WOLFENGINE_CMD_ENABLE_DEBUG           ENGINE_CMD_BASE
+#define WOLFENGINE_CMD_SET_LOGGING_CB         (ENGINE_CMD_BASE + 1)
+#define WOLFENGINE_CMD_RSA_PRIME_POOL_SIZE    (ENGINE_CMD_BASE + 2)
+#define WOLFENGINE_CMD_RSA_PRIME_POOL_THREADS (ENGINE_CMD_BASE + 3)
+#define WOLFENGINE_CMD_RSA_KEYGEN_THREADS     (ENGINE_CMD_BASE + 4)
+#define WOLFENGINE_CMD_RSA_PARALLEL_CRT       (ENGINE_CMD_BASE + 5)
+#define WOLFENGINE_CMD_RSA_PARALLEL_CRT_CPU   (ENGINE_CMD_BASE + 6)
+#define WOLFENGINE_CMD_RSA_BATCH_VERIFY       (ENGINE_CMD_BASE + 7)
+#define WOLFENGINE_CMD_ECDSA_SIGN_POOL_SIZE   (ENGINE_CMD_BASE + 8)
+#define WOLFENGINE_CMD_EC_PUB_CACHE_SIZE      (ENGINE_CMD_BASE + 9)
+#define WOLFENGINE_CMD_EC_KEY_POOL_SIZE       (ENGINE_CMD_BASE + 10)
+#define WOLFENGINE_CMD_EC_KEY_POOL_LOW        (ENGINE_CMD_BASE + 11)
+#define WOLFENGINE_CMD_ECDSA_BATCH_VERIFY     (ENGINE_CMD_BASE + 12)
+#define WOLFENGINE_CMD_EC_KEYGEN_BATCH        (ENGINE_CMD_BASE + 13)
+#define WOLFENGINE_CMD_ECDH_MULTI_DERIVE      (ENGINE_CMD_BASE + 14)
+#define WOLFENGINE_CMD_KEYSTORE_DIR           (ENGINE_CMD_BASE + 15)
+#define WOLFENGINE_CMD_KEYD_SOCKET            (ENGINE_CMD_BASE + 16)
+#define WOLFENGINE_CMD_RSA_PRIME_POOL_USED    (ENGINE_CMD_BASE + 17)
 
 /**
  * wolfEngine control command list.
@@ -752,10 +971,77 @@ static int wolfengine_destroy(ENGINE *e)
  *                have defined WOLFENGINE_DEBUG or used --enable-debug.
  *                (1 = enable, 0 = disable)
  *
+ * rsa_prime_pool_size - Number of RSA primes to keep ready for each of
+ *                       2048, 3072 and 4096-bit key generation.
+ *                       Requires wolfSSL built with WOLFSSL_PUBLIC_MP.
+ *                       (0 = disable pool)
+ *
+ * rsa_prime_pool_threads - Number of background threads that generate
+ *                          primes for the RSA prime pool. Requires wolfSSL
+ *                          built with WOLFSSL_PUBLIC_MP.
+ *                          (0 = disable pool)
+ *
+ * rsa_keygen_threads - Number of threads that search for the primes when
+ *                      generating an RSA key on demand. Requires wolfSSL
+ *                      built with WOLFSSL_PUBLIC_MP.
+ *                      (0 or 1 = single threaded wolfCrypt key generation)
+ *
+ * rsa_parallel_crt - Perform the two CRT exponentiations of RSA PKCS #1 v1.5
+ *                    signing in parallel on a helper thread. Requires wolfSSL
+ *                    built with WOLFSSL_PUBLIC_MP.
+ *                    (1 = enable, 0 = disable)
+ *
+ * rsa_parallel_crt_cpu - CPU to pin the parallel CRT helper thread to.
+ *                        (-1 = not pinned)
+ *
+ * ecdsa_sign_pool_size - Number of precomputed (k^-1, r) values to keep for
+ *                        each of P-256 and P-384 ECDSA signing with EC_KEY.
+ *                        Requires wolfSSL built with WOLFSSL_PUBLIC_MP.
+ *                        (0 = disable pool)
+ *
+ * ec_pub_cache_size - Number of imported EC public keys to keep, most
+ *                     recently used first, for ECDSA verification with
+ *                     EVP_PKEY.
+ *                     (0 = disable cache)
+ *
+ * ec_key_pool_size - Number of pre-generated key pairs to keep for each of
+ *                    P-256 and P-384 EC key generation. Filled by a
+ *                    background thread at idle priority.
+ *                    (0 = disable pool)
+ *
+ * ec_key_pool_low - Refill a curve's EC key pool, up to ec_key_pool_size,
+ *                   when it has this many key pairs or fewer.
+ *                   (-1 = half the pool size)
+ *
+ * keystore_dir - Directory of DER key files loaded by
+ *                ENGINE_load_private_key() and ENGINE_load_public_key(). The
+ *                key identifier is the file name. Keys are decoded once and
+ *                kept. Setting discards loaded keys.
+ *                (not set = key identifier is the path of the file)
+ *
+ * keyd_socket - Unix socket of the key daemon. Keys loaded by
+ *               ENGINE_load_private_key() are then held by the daemon and
+ *               signing and decryption with them are forwarded to it.
+ *               Setting discards loaded keys.
+ *               (not set = keys loaded from files)
+ *
  * INTERNAL COMMANDS (not listed here, as not NUMERIC, STRING, or NO_INPUT):
  * "set_logging_cb" - Sets the wolfEngine loggging callback, function pointer
  *                    passed in must match wolfEngine_Logging_cb prototype
  *                    from we_logging.h.
+ * "rsa_batch_verify" - Verifies a batch of RSA PKCS #1 v1.5 signatures
+ *                      individually and in parallel, pointer passed in must
+ *                      be a WE_RSA_BATCH_VERIFY from wolfengine.h.
+ * "ecdsa_batch_verify" - Verifies a batch of ECDSA signatures individually
+ *                        and in parallel, pointer passed in must be a
+ *                        WE_ECDSA_BATCH_VERIFY from wolfengine.h.
+ * "ec_keygen_batch" - Generates a batch of EC key pairs, pointer passed in
+ *                     must be a WE_EC_KEYGEN_BATCH from wolfengine.h.
+ * "ecdh_multi_derive" - Derives ECDH secrets of one private key with many
+ *                       peers, pointer passed in must be a
+ *                       WE_ECDH_MULTI_DERIVE from wolfengine.h.
+ * "rsa_prime_pool_used" - Gets the number of RSA keys generated from the
+ *                         prime pool, pointer passed in must be a long.
  *
  */
 static ENGINE_CMD_DEFN wolfengine_cmd_defns[] = {
@@ -768,6 +1054,94 @@ static ENGINE_CMD_DEFN wolfengine_cmd_defns[] = {
       "set_logging_cb",
       "Set wolfEngine logging callback",
       ENGINE_CMD_FLAG_INTERNAL },
+#ifdef WE_HAVE_RSA_KEYGEN_THREADS
+    { WOLFENGINE_CMD_RSA_PRIME_POOL_SIZE,
+      "rsa_prime_pool_size",
+      "Number of RSA primes to keep per key size (0=disable)",
+      ENGINE_CMD_FLAG_NUMERIC },
+    { WOLFENGINE_CMD_RSA_PRIME_POOL_THREADS,
+      "rsa_prime_pool_threads",
+      "Number of threads generating RSA primes (0=disable)",
+      ENGINE_CMD_FLAG_NUMERIC },
+    { WOLFENGINE_CMD_RSA_KEYGEN_THREADS,
+      "rsa_keygen_threads",
+      "Number of threads searching for RSA primes on keygen",
+      ENGINE_CMD_FLAG_NUMERIC },
+#endif
+#ifdef WE_HAVE_RSA_PARALLEL_CRT
+    { WOLFENGINE_CMD_RSA_PARALLEL_CRT,
+      "rsa_parallel_crt",
+      "Parallel CRT for RSA signing (1=enable, 0=disable)",
+      ENGINE_CMD_FLAG_NUMERIC },
+    { WOLFENGINE_CMD_RSA_PARALLEL_CRT_CPU,
+      "rsa_parallel_crt_cpu",
+      "CPU to pin parallel CRT helper thread to (-1=not pinned)",
+      ENGINE_CMD_FLAG_NUMERIC },
+#endif
+#ifdef WE_HAVE_RSA
+    { WOLFENGINE_CMD_RSA_BATCH_VERIFY,
+      "rsa_batch_verify",
+      "Verify a batch of RSA signatures",
+      ENGINE_CMD_FLAG_INTERNAL },
+#endif
+#ifdef WE_HAVE_ECDSA_SIGN_POOL
+    { WOLFENGINE_CMD_ECDSA_SIGN_POOL_SIZE,
+      "ecdsa_sign_pool_size",
+      "Number of precomputed ECDSA sign values per curve (0=disable)",
+      ENGINE_CMD_FLAG_NUMERIC },
+#endif
+#ifdef WE_HAVE_EC_PUB_CACHE
+    { WOLFENGINE_CMD_EC_PUB_CACHE_SIZE,
+      "ec_pub_cache_size",
+      "Number of EC public keys to cache for verify (0=disable)",
+      ENGINE_CMD_FLAG_NUMERIC },
+#endif
+#ifdef WE_HAVE_EC_KEY_POOL
+    { WOLFENGINE_CMD_EC_KEY_POOL_SIZE,
+      "ec_key_pool_size",
+      "Number of pre-generated EC keys per curve (0=disable)",
+      ENGINE_CMD_FLAG_NUMERIC },
+    { WOLFENGINE_CMD_EC_KEY_POOL_LOW,
+      "ec_key_pool_low",
+      "Refill EC key pool at this many keys (-1=half of size)",
+      ENGINE_CMD_FLAG_NUMERIC },
+#endif
+#if defined(WE_HAVE_ECC) && defined(WE_HAVE_ECDSA)
+    { WOLFENGINE_CMD_ECDSA_BATCH_VERIFY,
+      "ecdsa_batch_verify",
+      "Verify a batch of ECDSA signatures",
+      ENGINE_CMD_FLAG_INTERNAL },
+#endif
+#if defined(WE_HAVE_ECC) && defined(WE_HAVE_ECKEYGEN)
+    { WOLFENGINE_CMD_EC_KEYGEN_BATCH,
+      "ec_keygen_batch",
+      "Generate a batch of EC key pairs",
+      ENGINE_CMD_FLAG_INTERNAL },
+#endif
+#if defined(WE_HAVE_ECC) && defined(WE_HAVE_ECDH)
+    { WOLFENGINE_CMD_ECDH_MULTI_DERIVE,
+      "ecdh_multi_derive",
+      "Derive ECDH secrets with many peers",
+      ENGINE_CMD_FLAG_INTERNAL },
+#endif
+#ifdef WE_HAVE_KEYSTORE
+    { WOLFENGINE_CMD_KEYSTORE_DIR,
+      "keystore_dir",
+      "Directory of DER key files to load by file name",
+      ENGINE_CMD_FLAG_STRING },
+#endif
+#ifdef WE_HAVE_KEYD
+    { WOLFENGINE_CMD_KEYD_SOCKET,
+      "keyd_socket",
+      "Unix socket of key daemon holding private keys",
+      ENGINE_CMD_FLAG_STRING },
+#endif
+#ifdef WE_HAVE_RSA_KEYGEN_THREADS
+    { WOLFENGINE_CMD_RSA_PRIME_POOL_USED,
+      "rsa_prime_pool_used",
+      "Get number of RSA keys generated from prime pool",
+      ENGINE_CMD_FLAG_INTERNAL },
+#endif
 
     /* last element MUST be NULL/0 entry, do not remove */
     {0, NULL, NULL, 0}
@@ -823,6 +1197,82 @@ static int wolfengine_ctrl(ENGINE* e, int cmd, long i, void* p,
                 WOLFENGINE_MSG("wolfEngine user logging callback registered");
             }
             break;
+#ifdef WE_HAVE_RSA_KEYGEN_THREADS
+        case WOLFENGINE_CMD_RSA_PRIME_POOL_SIZE:
+            ret = we_rsa_prime_pool_set_size(i);
+            break;
+        case WOLFENGINE_CMD_RSA_PRIME_POOL_THREADS:
+            ret = we_rsa_prime_pool_set_threads(i);
+            break;
+        case WOLFENGINE_CMD_RSA_KEYGEN_THREADS:
+            ret = we_rsa_keygen_set_threads(i);
+            break;
+#endif
+#ifdef WE_HAVE_RSA_PARALLEL_CRT
+        case WOLFENGINE_CMD_RSA_PARALLEL_CRT:
+            ret = we_rsa_crt_set_parallel(i);
+            break;
+        case WOLFENGINE_CMD_RSA_PARALLEL_CRT_CPU:
+            ret = we_rsa_crt_set_cpu(i);
+            break;
+#endif
+#ifdef WE_HAVE_RSA
+        case WOLFENGINE_CMD_RSA_BATCH_VERIFY:
+            ret = we_rsa_batch_verify((WE_RSA_BATCH_VERIFY *)p);
+            break;
+#endif
+#ifdef WE_HAVE_ECDSA_SIGN_POOL
+        case WOLFENGINE_CMD_ECDSA_SIGN_POOL_SIZE:
+            ret = we_ecdsa_pool_set_size(i);
+            break;
+#endif
+#ifdef WE_HAVE_EC_PUB_CACHE
+        case WOLFENGINE_CMD_EC_PUB_CACHE_SIZE:
+            ret = we_ec_pub_cache_set_size(i);
+            break;
+#endif
+#ifdef WE_HAVE_EC_KEY_POOL
+        case WOLFENGINE_CMD_EC_KEY_POOL_SIZE:
+            ret = we_ec_key_pool_set_size(i);
+            break;
+        case WOLFENGINE_CMD_EC_KEY_POOL_LOW:
+            ret = we_ec_key_pool_set_low(i);
+            break;
+#endif
+#if defined(WE_HAVE_ECC) && defined(WE_HAVE_ECDSA)
+        case WOLFENGINE_CMD_ECDSA_BATCH_VERIFY:
+            ret = we_ecdsa_batch_verify((WE_ECDSA_BATCH_VERIFY *)p);
+            break;
+#endif
+#if defined(WE_HAVE_ECC) && defined(WE_HAVE_ECKEYGEN)
+        case WOLFENGINE_CMD_EC_KEYGEN_BATCH:
+            ret = we_ec_keygen_batch((WE_EC_KEYGEN_BATCH *)p);
+            break;
+#endif
+#if defined(WE_HAVE_ECC) && defined(WE_HAVE_ECDH)
+        case WOLFENGINE_CMD_ECDH_MULTI_DERIVE:
+            ret = we_ecdh_multi_derive((WE_ECDH_MULTI_DERIVE *)p);
+            break;
+#endif
+#ifdef WE_HAVE_KEYSTORE
+        case WOLFENGINE_CMD_KEYSTORE_DIR:
+            ret = we_keystore_set_dir((const char *)p);
+            break;
+#endif
+#ifdef WE_HAVE_KEYD
+        case WOLFENGINE_CMD_KEYD_SOCKET:
+            ret = we_keyd_set_socket((const char *)p);
+            if (ret == 1) {
+                /* Loaded keys are held locally or by another daemon. */
+                we_keystore_flush();
+            }
+            break;
+#endif
+#ifdef WE_HAVE_RSA_KEYGEN_THREADS
+        case WOLFENGINE_CMD_RSA_PRIME_POOL_USED:
+            ret = we_rsa_prime_pool_get_used((long *)p);
+            break;
+#endif
         default:
             WOLFENGINE_ERROR_MSG("Invalid wolfEngine control command");
             ret = 0;
@@ -892,6 +1342,16 @@ int wolfengine_bind(ENGINE *e, const char *id)
     if (ret == 1 && ENGINE_set_EC(e, we_ec()) == 0) {
         ret = 0;
     }
+#endif
+#ifdef WE_HAVE_KEYSTORE
+    if (ret == 1 &&
+            ENGINE_set_load_privkey_function(e, we_keystore_load_privkey) == 0) {
+        ret = 0;
+    }
+    if (ret == 1 &&
+            ENGINE_set_load_pubkey_function(e, we_keystore_load_pubkey) == 0) {
+        ret = 0;
+    }
 #endif
     if (ret == 1 && ENGINE_set_destroy_function(e, wolfengine_destroy) == 0) {
         ret = 0;
@@ -0,0 +1,892 @@
+/* keyd_client.c
+ *
+ * Copyright (C) 2019-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfEngine.
+ *
+ * wolfEngine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfengine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#include "internal.h"
+
+#ifdef WE_HAVE_KEYD
+
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* Number of connections to the key daemon shared by the threads. */
+#define WE_KEYD_CONN_CNT    4
+
+/**
+ * Request waiting for its response from the key daemon.
+ *
+ * Lives on the stack of the calling thread until the response is delivered
+ * or the connection fails.
+ */
+typedef struct we_KeydWait {
+    /* Sequence number of request. */
+    unsigned int seq;
+    /* Buffer to hold response data. */
+    unsigned char *out;
+    /* On in, size of buffer in bytes. On delivery, length of data. */
+    size_t outLen;
+    /* Status of response - WE_KEYD_STATUS_*. */
+    int status;
+    /* Response delivered or connection failed. */
+    int done;
+    /* Response received from daemon. */
+    int ok;
+    /* Next outstanding request on connection. */
+    struct we_KeydWait *next;
+} we_KeydWait;
+
+/**
+ * Connection to the key daemon.
+ *
+ * A connection is shared by threads and has many requests outstanding. Each
+ * request has a sequence number and the daemon returns responses in the order
+ * operations complete. One of the waiting threads reads responses and hands
+ * them to the waiting request with the same sequence number.
+ */
+typedef struct we_KeydConn {
+    /* Protects the fields below except while a request is written. */
+    pthread_mutex_t mutex;
+    /* Serializes writes so each request is contiguous on the socket. */
+    pthread_mutex_t writeMutex;
+    /* Signalled when a response is delivered or no thread is reading. */
+    pthread_cond_t cond;
+    /* Socket connected to daemon. -1 when not connected. */
+    int fd;
+    /* Sequence number of next request. */
+    unsigned int seq;
+    /* Generation of socket path connected to. */
+    unsigned int gen;
+    /* Requests waiting for a response. */
+    we_KeydWait *waiting;
+    /* Number of threads with a request on the connection. */
+    int users;
+    /* A thread is reading responses. */
+    int reading;
+    /* Stream failed - remade when no thread is using connection. */
+    int broken;
+} we_KeydConn;
+
+/* Connections shared by the threads. */
+static we_KeydConn we_keyd_conns[WE_KEYD_CONN_CNT];
+/* Index of connection to give to next thread. */
+static unsigned int we_keyd_next_conn = 0;
+
+/* Protects the socket path. */
+static pthread_mutex_t we_keyd_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Path of daemon's Unix socket. NULL when not forwarding. */
+static char *we_keyd_path = NULL;
+/* Changed whenever the path is set so that connections are remade. */
+static unsigned int we_keyd_gen = 0;
+
+/* One-time creation of the thread key and ex_data indices. */
+static pthread_once_t we_keyd_once = PTHREAD_ONCE_INIT;
+/* Thread key of connection index plus one. Kept for the life of the
+ * process. */
+static pthread_key_t we_keyd_conn_key;
+/* Indicates the thread key and fork handlers were created. */
+static int we_keyd_conn_key_ok = 0;
+#ifdef WE_HAVE_RSA
+/* Index of key identifier in RSA ex_data. */
+static int we_keyd_rsa_idx = -1;
+#endif
+#ifdef WE_HAVE_ECC
+/* Index of key identifier in EC_KEY ex_data. */
+static int we_keyd_ec_idx = -1;
+#endif
+
+/**
+ * Lock the connections before fork so that they are consistent in the child.
+ */
+static void we_keyd_atfork_prepare(void)
+{
+    int i;
+
+    for (i = 0; i < WE_KEYD_CONN_CNT; i++) {
+        pthread_mutex_lock(&we_keyd_conns[i].mutex);
+    }
+}
+
+/**
+ * Unlock the connections in the parent after fork.
+ */
+static void we_keyd_atfork_parent(void)
+{
+    int i;
+
+    for (i = WE_KEYD_CONN_CNT - 1; i >= 0; i--) {
+        pthread_mutex_unlock(&we_keyd_conns[i].mutex);
+    }
+}
+
+/**
+ * Drop the connections in the child after fork.
+ *
+ * The sockets are shared with the parent and responses would go to either
+ * process. The threads waiting on them don't exist in the child. The child
+ * connects again when it next uses the daemon.
+ */
+static void we_keyd_atfork_child(void)
+{
+    int i;
+    we_KeydConn *conn;
+
+    for (i = WE_KEYD_CONN_CNT - 1; i >= 0; i--) {
+        conn = &we_keyd_conns[i];
+        if (conn->fd >= 0) {
+            close(conn->fd);
+            conn->fd = -1;
+        }
+        conn->waiting = NULL;
+        conn->users = 0;
+        conn->reading = 0;
+        conn->broken = 0;
+        pthread_mutex_init(&conn->writeMutex, NULL);
+        pthread_cond_init(&conn->cond, NULL);
+        pthread_mutex_unlock(&conn->mutex);
+    }
+}
+
+/**
+ * Free the key identifier when the RSA or EC_KEY object is freed.
+ *
+ * @param  parent  [in]  RSA or EC_KEY object. Unused.
+ * @param  ptr     [in]  Key identifier. May be NULL.
+ * @param  ad      [in]  Extra data of object. Unused.
+ * @param  idx     [in]  Index of extra data. Unused.
+ * @param  argl    [in]  Long argument. Unused.
+ * @param  argp    [in]  Pointer argument. Unused.
+ */
+static void we_keyd_id_free(void *parent, void *ptr, CRYPTO_EX_DATA *ad,
+                            int idx, long argl, void *argp)
+{
+    (void)parent;
+    (void)ad;
+    (void)idx;
+    (void)argl;
+    (void)argp;
+
+    OPENSSL_free(ptr);
+}
+
+/**
+ * Initialize the connections, create the thread key of connection indices,
+ * register the fork handlers and create the ex_data indices.
+ */
+static void we_keyd_init_once(void)
+{
+    int i;
+
+    for (i = 0; i < WE_KEYD_CONN_CNT; i++) {
+        pthread_mutex_init(&we_keyd_conns[i].mutex, NULL);
+        pthread_mutex_init(&we_keyd_conns[i].writeMutex, NULL);
+        pthread_cond_init(&we_keyd_conns[i].cond, NULL);
+        we_keyd_conns[i].fd = -1;
+    }
+    we_keyd_conn_key_ok = pthread_key_create(&we_keyd_conn_key, NULL) == 0 &&
+                          pthread_atfork(we_keyd_atfork_prepare,
+                                         we_keyd_atfork_parent,
+                                         we_keyd_atfork_child) == 0;
+#ifdef WE_HAVE_RSA
+    we_keyd_rsa_idx = RSA_get_ex_new_index(0, NULL, NULL, NULL,
+                                           we_keyd_id_free);
+#endif
+#ifdef WE_HAVE_ECC
+    we_keyd_ec_idx = EC_KEY_get_ex_new_index(0, NULL, NULL, NULL,
+                                             we_keyd_id_free);
+#endif
+}
+
+/**
+ * Set the path of the key daemon's socket.
+ *
+ * Keys loaded from the keystore after this have their private key operations
+ * performed by the daemon.
+ *
+ * @param  path  [in]  Path of Unix socket. NULL stops forwarding.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_keyd_set_socket(const char *path)
+{
+    int ret = 1;
+    char *copy = NULL;
+
+    WOLFENGINE_ENTER("we_keyd_set_socket");
+
+    if (pthread_once(&we_keyd_once, we_keyd_init_once) != 0 ||
+        !we_keyd_conn_key_ok) {
+        WOLFENGINE_ERROR_MSG("Failed to initialize key daemon client");
+        ret = 0;
+    }
+    if (ret == 1 && path != NULL) {
+        if (XSTRLEN(path) >= sizeof(((struct sockaddr_un *)0)->sun_path)) {
+            WOLFENGINE_ERROR_MSG("Key daemon socket path too long");
+            ret = 0;
+        }
+        if (ret == 1) {
+            copy = OPENSSL_strdup(path);
+            if (copy == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_strdup", copy);
+                ret = 0;
+            }
+        }
+    }
+    if (ret == 1) {
+        pthread_mutex_lock(&we_keyd_mutex);
+        OPENSSL_free(we_keyd_path);
+        we_keyd_path = copy;
+        we_keyd_gen++;
+        pthread_mutex_unlock(&we_keyd_mutex);
+    }
+
+    WOLFENGINE_LEAVE("we_keyd_set_socket", ret);
+
+    return ret;
+}
+
+/**
+ * Stop forwarding to the key daemon.
+ *
+ * Connections are closed when next used after requests in flight complete.
+ */
+void we_keyd_free(void)
+{
+    pthread_mutex_lock(&we_keyd_mutex);
+    OPENSSL_free(we_keyd_path);
+    we_keyd_path = NULL;
+    we_keyd_gen++;
+    pthread_mutex_unlock(&we_keyd_mutex);
+}
+
+/**
+ * Check whether keys are to be loaded from the key daemon.
+ *
+ * @returns  1 when a socket path is set and 0 otherwise.
+ */
+int we_keyd_enabled(void)
+{
+    int enabled;
+
+    pthread_mutex_lock(&we_keyd_mutex);
+    enabled = (we_keyd_path != NULL);
+    pthread_mutex_unlock(&we_keyd_mutex);
+
+    return enabled;
+}
+
+/**
+ * Get the calling thread's connection to the key daemon, connecting when
+ * required.
+ *
+ * Threads are spread over the connections. A connection that failed, or is to
+ * an old socket path, is remade once no thread is using it. The connection is
+ * returned with the calling thread counted as a user.
+ *
+ * @returns  Connection object on success and NULL on failure.
+ */
+static we_KeydConn *we_keyd_get_conn(void)
+{
+    int ret = 1;
+    we_KeydConn *conn = NULL;
+    struct sockaddr_un addr;
+    unsigned int gen = 0;
+    size_t idx;
+
+    WOLFENGINE_ENTER("we_keyd_get_conn");
+
+    XMEMSET(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    pthread_mutex_lock(&we_keyd_mutex);
+    if (we_keyd_path == NULL) {
+        WOLFENGINE_ERROR_MSG("No key daemon socket set");
+        ret = 0;
+    }
+    else {
+        XMEMCPY(addr.sun_path, we_keyd_path, XSTRLEN(we_keyd_path));
+        gen = we_keyd_gen;
+    }
+    idx = (size_t)pthread_getspecific(we_keyd_conn_key);
+    if (ret == 1 && idx == 0) {
+        /* First use by thread - give it the next connection. */
+        idx = (we_keyd_next_conn++ % WE_KEYD_CONN_CNT) + 1;
+        if (pthread_setspecific(we_keyd_conn_key, (void *)idx) != 0) {
+            WOLFENGINE_ERROR_MSG("Failed to set thread connection");
+            ret = 0;
+        }
+    }
+    pthread_mutex_unlock(&we_keyd_mutex);
+
+    if (ret == 1) {
+        conn = &we_keyd_conns[idx - 1];
+        pthread_mutex_lock(&conn->mutex);
+        /* Wait for requests in flight before remaking connection. */
+        while (conn->fd >= 0 && (conn->broken || conn->gen != gen) &&
+               conn->users > 0) {
+            pthread_cond_wait(&conn->cond, &conn->mutex);
+        }
+        if (conn->fd >= 0 && (conn->broken || conn->gen != gen)) {
+            close(conn->fd);
+            conn->fd = -1;
+            conn->broken = 0;
+        }
+        if (conn->fd < 0) {
+            conn->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (conn->fd < 0) {
+                WOLFENGINE_ERROR_MSG("Failed to create key daemon socket");
+                ret = 0;
+            }
+            if (ret == 1 && connect(conn->fd, (struct sockaddr *)&addr,
+                                    sizeof(addr)) != 0) {
+                WOLFENGINE_ERROR_MSG("Failed to connect to key daemon");
+                close(conn->fd);
+                conn->fd = -1;
+                ret = 0;
+            }
+            if (ret == 1) {
+                conn->gen = gen;
+            }
+        }
+        if (ret == 1) {
+            conn->users++;
+        }
+        pthread_mutex_unlock(&conn->mutex);
+    }
+
+    WOLFENGINE_LEAVE("we_keyd_get_conn", ret);
+
+    return (ret == 1) ? conn : NULL;
+}
+
+/**
+ * Finish using a connection.
+ *
+ * @param  conn  [in]  Connection object.
+ */
+static void we_keyd_put_conn(we_KeydConn *conn)
+{
+    pthread_mutex_lock(&conn->mutex);
+    conn->users--;
+    if (conn->users == 0) {
+        /* Connection may be waiting to be remade. */
+        pthread_cond_broadcast(&conn->cond);
+    }
+    pthread_mutex_unlock(&conn->mutex);
+}
+
+/**
+ * Fail all outstanding requests on a connection after the stream is lost.
+ *
+ * The socket is shut down so that blocked reads and writes return. It is
+ * closed when no thread is using the connection. Call with the connection's
+ * mutex locked.
+ *
+ * @param  conn  [in]  Connection object.
+ */
+static void we_keyd_conn_fail(we_KeydConn *conn)
+{
+    we_KeydWait *wait;
+
+    for (wait = conn->waiting; wait != NULL; wait = wait->next) {
+        wait->done = 1;
+        wait->ok = 0;
+    }
+    conn->waiting = NULL;
+    if (!conn->broken) {
+        shutdown(conn->fd, SHUT_RDWR);
+        conn->broken = 1;
+    }
+    pthread_cond_broadcast(&conn->cond);
+}
+
+/**
+ * Write all of the buffer to the socket.
+ *
+ * @param  fd   [in]  Socket.
+ * @param  buf  [in]  Data to write.
+ * @param  len  [in]  Length of data in bytes.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_keyd_write_all(int fd, const unsigned char *buf, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        /* Don't raise SIGPIPE in the application when the daemon has gone. */
+        n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+
+    return len == 0;
+}
+
+/**
+ * Read exactly the length of data from the socket.
+ *
+ * @param  fd   [in]   Socket.
+ * @param  buf  [out]  Buffer to hold data.
+ * @param  len  [in]   Length of data in bytes.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_keyd_read_all(int fd, unsigned char *buf, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        n = recv(fd, buf, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+
+    return len == 0;
+}
+
+/**
+ * Read one response from the connection and deliver it to the request
+ * waiting for it.
+ *
+ * Called without the connection's mutex locked by the one thread reading.
+ * Response data is read straight into the waiting request's buffer.
+ *
+ * @param  conn  [in]  Connection object.
+ */
+static void we_keyd_read_rsp(we_KeydConn *conn)
+{
+    int ret;
+    unsigned char rsp[WE_KEYD_RSP_HDR_SZ];
+    unsigned int seq;
+    size_t len = 0;
+    we_KeydWait *wait = NULL;
+    we_KeydWait **prev;
+
+    ret = we_keyd_read_all(conn->fd, rsp, sizeof(rsp));
+    if (ret == 0) {
+        WOLFENGINE_ERROR_MSG("Failed to receive key daemon response");
+    }
+    if (ret == 1) {
+        seq = WE_KEYD_GET32(rsp + WE_KEYD_RSP_SEQ);
+        len = WE_KEYD_GET32(rsp + WE_KEYD_RSP_DATA_LEN);
+
+        /* Take request off the outstanding list while filling buffer. */
+        pthread_mutex_lock(&conn->mutex);
+        for (prev = &conn->waiting; *prev != NULL; prev = &(*prev)->next) {
+            if ((*prev)->seq == seq) {
+                wait = *prev;
+                *prev = wait->next;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&conn->mutex);
+
+        if (wait == NULL || len > wait->outLen) {
+            WOLFENGINE_ERROR_MSG("Invalid key daemon response");
+            ret = 0;
+        }
+    }
+    if (ret == 1 && len > 0) {
+        ret = we_keyd_read_all(conn->fd, wait->out, len);
+        if (ret == 0) {
+            WOLFENGINE_ERROR_MSG("Failed to receive key daemon response");
+        }
+    }
+
+    pthread_mutex_lock(&conn->mutex);
+    if (wait != NULL) {
+        wait->done = 1;
+        wait->ok = ret;
+        wait->status = rsp[WE_KEYD_RSP_STATUS];
+        wait->outLen = len;
+    }
+    if (ret == 0) {
+        /* Unknown state of stream - start again when no longer in use. */
+        we_keyd_conn_fail(conn);
+    }
+    else {
+        pthread_cond_broadcast(&conn->cond);
+    }
+    pthread_mutex_unlock(&conn->mutex);
+}
+
+/**
+ * Wait for the response to a request.
+ *
+ * When no thread is reading responses on the connection, the calling thread
+ * reads them until its own is delivered. Called with the connection's mutex
+ * locked.
+ *
+ * @param  conn  [in]      Connection object.
+ * @param  wait  [in/out]  Request waiting for response.
+ * @returns  1 when the response was received and 0 on failure.
+ */
+static int we_keyd_wait(we_KeydConn *conn, we_KeydWait *wait)
+{
+    while (!wait->done) {
+        if (!conn->reading) {
+            conn->reading = 1;
+            pthread_mutex_unlock(&conn->mutex);
+            we_keyd_read_rsp(conn);
+            pthread_mutex_lock(&conn->mutex);
+            conn->reading = 0;
+            /* Let another waiting thread take over reading. */
+            pthread_cond_broadcast(&conn->cond);
+        }
+        else {
+            pthread_cond_wait(&conn->cond, &conn->mutex);
+        }
+    }
+
+    return wait->ok;
+}
+
+/**
+ * Perform an operation with a key held by the key daemon.
+ *
+ * The request is sent in one write and the calling thread waits for the
+ * response with the request's sequence number. Other threads send requests on
+ * the same connection while this one is outstanding. On a failure to
+ * communicate, all requests outstanding on the connection fail and the
+ * connection is remade on a later operation.
+ *
+ * @param  id       [in]      Identifier of key.
+ * @param  op       [in]      Operation - WE_KEYD_OP_*.
+ * @param  padding  [in]      RSA padding mode.
+ * @param  mdNid    [in]      NID of signature digest. 0 for none.
+ * @param  mgf1Nid  [in]      NID of MGF1 digest. 0 for none.
+ * @param  saltLen  [in]      PSS salt length.
+ * @param  in       [in]      Data of operation. May be NULL when inLen is 0.
+ * @param  inLen    [in]      Length of data in bytes.
+ * @param  out      [out]     Buffer to hold result.
+ * @param  outLen   [in/out]  On in, size of buffer in bytes.
+ *                            On out, length of result in bytes.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_keyd_call(const char *id, int op, int padding, int mdNid,
+                        int mgf1Nid, int saltLen, const unsigned char *in,
+                        size_t inLen, unsigned char *out, size_t *outLen)
+{
+    int ret = 1;
+    int rc;
+    we_KeydConn *conn = NULL;
+    we_KeydWait wait;
+    unsigned char req[WE_KEYD_REQ_HDR_SZ + WE_KEYD_MAX_ID_SZ +
+                      WE_KEYD_MAX_DATA_SZ];
+    size_t idLen = 0;
+
+    WOLFENGINE_ENTER("we_keyd_call");
+
+    if (id != NULL) {
+        idLen = XSTRLEN(id);
+    }
+    if (idLen == 0 || idLen > WE_KEYD_MAX_ID_SZ ||
+        inLen > WE_KEYD_MAX_DATA_SZ) {
+        WOLFENGINE_ERROR_MSG("Key daemon request too large");
+        ret = 0;
+    }
+    if (ret == 1) {
+        conn = we_keyd_get_conn();
+        if (conn == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("we_keyd_get_conn", conn);
+            ret = 0;
+        }
+    }
+
+    if (ret == 1) {
+        XMEMSET(&wait, 0, sizeof(wait));
+        wait.out = out;
+        wait.outLen = *outLen;
+
+        /* Outstanding before sending so the response always finds it. */
+        pthread_mutex_lock(&conn->mutex);
+        wait.seq = conn->seq++;
+        wait.next = conn->waiting;
+        conn->waiting = &wait;
+        pthread_mutex_unlock(&conn->mutex);
+
+        /* Encode request into one buffer so it is sent in one write. */
+        XMEMSET(req, 0, WE_KEYD_REQ_HDR_SZ);
+        WE_KEYD_PUT32(req + WE_KEYD_REQ_SEQ, wait.seq);
+        req[WE_KEYD_REQ_OP] = (unsigned char)op;
+        req[WE_KEYD_REQ_PADDING] = (unsigned char)padding;
+        req[WE_KEYD_REQ_ID_LEN] = (unsigned char)idLen;
+        WE_KEYD_PUT32(req + WE_KEYD_REQ_MD_NID, mdNid);
+        WE_KEYD_PUT32(req + WE_KEYD_REQ_MGF1_NID, mgf1Nid);
+        WE_KEYD_PUT32(req + WE_KEYD_REQ_SALT_LEN, saltLen);
+        WE_KEYD_PUT32(req + WE_KEYD_REQ_DATA_LEN, inLen);
+        XMEMCPY(req + WE_KEYD_REQ_HDR_SZ, id, idLen);
+        if (inLen > 0) {
+            XMEMCPY(req + WE_KEYD_REQ_HDR_SZ + idLen, in, inLen);
+        }
+        /* Connection's mutex not held so responses are read while sending. */
+        pthread_mutex_lock(&conn->writeMutex);
+        rc = we_keyd_write_all(conn->fd, req,
+                               WE_KEYD_REQ_HDR_SZ + idLen + inLen);
+        pthread_mutex_unlock(&conn->writeMutex);
+
+        pthread_mutex_lock(&conn->mutex);
+        if (rc == 0) {
+            WOLFENGINE_ERROR_MSG("Failed to send key daemon request");
+            /* Part of request may have been sent - stream out of step. */
+            if (!wait.done) {
+                we_keyd_conn_fail(conn);
+            }
+        }
+        ret = we_keyd_wait(conn, &wait);
+        pthread_mutex_unlock(&conn->mutex);
+    }
+    if (ret == 1 && wait.status != WE_KEYD_STATUS_OK) {
+        /* Connection still in step - keep it. */
+        WOLFENGINE_ERROR_MSG("Key daemon operation failed");
+        ret = 0;
+    }
+    else if (ret == 1) {
+        *outLen = wait.outLen;
+    }
+
+    if (conn != NULL) {
+        we_keyd_put_conn(conn);
+        OPENSSL_cleanse(req + WE_KEYD_REQ_HDR_SZ, idLen + inLen);
+    }
+
+    WOLFENGINE_LEAVE("we_keyd_call", ret);
+
+    return ret;
+}
+
+/**
+ * Get the public key of a key held by the key daemon.
+ *
+ * @param  id  [in]  Identifier of key.
+ * @returns  Public key on success and NULL on failure.
+ */
+EVP_PKEY *we_keyd_get_public(const char *id)
+{
+    EVP_PKEY *pkey = NULL;
+    unsigned char der[WE_KEYD_MAX_DATA_SZ];
+    size_t derLen = sizeof(der);
+    const unsigned char *p = der;
+
+    WOLFENGINE_ENTER("we_keyd_get_public");
+
+    if (we_keyd_call(id, WE_KEYD_OP_PUBKEY, 0, 0, 0, 0, NULL, 0, der,
+                     &derLen) == 1) {
+        pkey = d2i_PUBKEY(NULL, &p, (long)derLen);
+        if (pkey == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("d2i_PUBKEY", pkey);
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_keyd_get_public", pkey != NULL);
+
+    return pkey;
+}
+
+/**
+ * Mark the key as held by the key daemon.
+ *
+ * Private key operations with the key are forwarded to the daemon.
+ *
+ * @param  pkey  [in]  Key with public key only.
+ * @param  id    [in]  Identifier of key in daemon.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_keyd_set_key_id(EVP_PKEY *pkey, const char *id)
+{
+    int ret = 1;
+    char *copy;
+
+    WOLFENGINE_ENTER("we_keyd_set_key_id");
+
+    copy = OPENSSL_strdup(id);
+    if (copy == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_strdup", copy);
+        ret = 0;
+    }
+    if (ret == 1) {
+        switch (EVP_PKEY_base_id(pkey)) {
+#ifdef WE_HAVE_RSA
+            case EVP_PKEY_RSA:
+                ret = we_keyd_rsa_idx >= 0 &&
+                      RSA_set_ex_data((RSA *)EVP_PKEY_get0_RSA(pkey),
+                                      we_keyd_rsa_idx, copy) == 1;
+                break;
+#endif
+#ifdef WE_HAVE_ECC
+            case EVP_PKEY_EC:
+                ret = we_keyd_ec_idx >= 0 &&
+                      EC_KEY_set_ex_data((EC_KEY *)EVP_PKEY_get0_EC_KEY(pkey),
+                                         we_keyd_ec_idx, copy) == 1;
+                break;
+#endif
+            default:
+                WOLFENGINE_ERROR_MSG("Key type not supported by key daemon");
+                ret = 0;
+                break;
+        }
+        if (ret == 0) {
+            OPENSSL_free(copy);
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_keyd_set_key_id", ret);
+
+    return ret;
+}
+
+#ifdef WE_HAVE_RSA
+/**
+ * Get the identifier of an RSA key held by the key daemon.
+ *
+ * @param  rsa  [in]  RSA key object. May be NULL.
+ * @returns  Key identifier when held by daemon and NULL otherwise.
+ */
+const char *we_keyd_rsa_key_id(const RSA *rsa)
+{
+    const char *id = NULL;
+
+    if (rsa != NULL && we_keyd_rsa_idx >= 0) {
+        id = (const char *)RSA_get_ex_data(rsa, we_keyd_rsa_idx);
+    }
+
+    return id;
+}
+
+/**
+ * Sign with an RSA key held by the key daemon.
+ *
+ * @param  id       [in]      Identifier of key.
+ * @param  padding  [in]      RSA padding mode - PKCS #1 v1.5 or PSS.
+ * @param  md       [in]      Signature digest. NULL when data signed as is.
+ * @param  mgf1Md   [in]      PSS MGF1 digest. NULL for signature digest.
+ * @param  saltLen  [in]      PSS salt length.
+ * @param  tbs      [in]      Digest to sign.
+ * @param  tbsLen   [in]      Length of digest in bytes.
+ * @param  sig      [out]     Buffer to hold signature.
+ * @param  sigLen   [in/out]  On in, size of buffer in bytes.
+ *                            On out, length of signature in bytes.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_keyd_rsa_sign(const char *id, int padding, const EVP_MD *md,
+                     const EVP_MD *mgf1Md, int saltLen,
+                     const unsigned char *tbs, size_t tbsLen,
+                     unsigned char *sig, size_t *sigLen)
+{
+    int ret;
+
+    WOLFENGINE_ENTER("we_keyd_rsa_sign");
+
+    ret = we_keyd_call(id, WE_KEYD_OP_RSA_SIGN, padding,
+                       (md != NULL) ? EVP_MD_type(md) : 0,
+                       (mgf1Md != NULL) ? EVP_MD_type(mgf1Md) : 0, saltLen,
+                       tbs, tbsLen, sig, sigLen);
+
+    WOLFENGINE_LEAVE("we_keyd_rsa_sign", ret);
+
+    return ret;
+}
+
+/**
+ * Decrypt with an RSA key held by the key daemon.
+ *
+ * @param  id       [in]      Identifier of key.
+ * @param  padding  [in]      RSA padding mode.
+ * @param  in       [in]      Data to decrypt.
+ * @param  inLen    [in]      Length of data in bytes.
+ * @param  out      [out]     Buffer to hold plaintext.
+ * @param  outLen   [in/out]  On in, size of buffer in bytes.
+ *                            On out, length of plaintext in bytes.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_keyd_rsa_decrypt(const char *id, int padding, const unsigned char *in,
+                        size_t inLen, unsigned char *out, size_t *outLen)
+{
+    int ret;
+
+    WOLFENGINE_ENTER("we_keyd_rsa_decrypt");
+
+    ret = we_keyd_call(id, WE_KEYD_OP_RSA_DECRYPT, padding, 0, 0, 0, in, inLen,
+                       out, outLen);
+
+    WOLFENGINE_LEAVE("we_keyd_rsa_decrypt", ret);
+
+    return ret;
+}
+#endif /* WE_HAVE_RSA */
+
+#ifdef WE_HAVE_ECC
+/**
+ * Get the identifier of an EC key held by the key daemon.
+ *
+ * @param  ecKey  [in]  EC key object. May be NULL.
+ * @returns  Key identifier when held by daemon and NULL otherwise.
+ */
+const char *we_keyd_ec_key_id(const EC_KEY *ecKey)
+{
+    const char *id = NULL;
+
+    if (ecKey != NULL && we_keyd_ec_idx >= 0) {
+        id = (const char *)EC_KEY_get_ex_data(ecKey, we_keyd_ec_idx);
+    }
+
+    return id;
+}
+
+/**
+ * Sign a digest with an EC key held by the key daemon.
+ *
+ * @param  id       [in]      Identifier of key.
+ * @param  dgst     [in]      Digest to sign.
+ * @param  dgstLen  [in]      Length of digest in bytes.
+ * @param  sig      [out]     Buffer to hold DER encoded signature.
+ * @param  sigLen   [in/out]  On in, size of buffer in bytes.
+ *                            On out, length of signature in bytes.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_keyd_ecdsa_sign(const char *id, const unsigned char *dgst,
+                       size_t dgstLen, unsigned char *sig, size_t *sigLen)
+{
+    int ret;
+
+    WOLFENGINE_ENTER("we_keyd_ecdsa_sign");
+
+    ret = we_keyd_call(id, WE_KEYD_OP_ECDSA_SIGN, 0, 0, 0, 0, dgst, dgstLen,
+                       sig, sigLen);
+
+    WOLFENGINE_LEAVE("we_keyd_ecdsa_sign", ret);
+
+    return ret;
+}
+#endif /* WE_HAVE_ECC */
+
+#endif /* WE_HAVE_KEYD */
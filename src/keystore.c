@@ -0,0 +1,585 @@
+/* keystore.c
+ *
+ * Copyright (C) 2019-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfEngine.
+ *
+ * wolfEngine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfengine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#include "internal.h"
+
+#ifdef WE_HAVE_KEYSTORE
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef WE_HAVE_THREADS
+#include <pthread.h>
+
+/* Protects the keystore list. */
+static pthread_mutex_t we_keystore_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define WE_KEYSTORE_LOCK()      pthread_mutex_lock(&we_keystore_mutex)
+#define WE_KEYSTORE_UNLOCK()    pthread_mutex_unlock(&we_keystore_mutex)
+#else
+/* Engine is only used from one thread at a time without thread support. */
+#define WE_KEYSTORE_LOCK()
+#define WE_KEYSTORE_UNLOCK()
+#endif
+
+/* Largest key file that will be loaded. */
+#define WE_KEYSTORE_MAX_FILE_SZ     (64 * 1024)
+
+/**
+ * Key loaded into the keystore.
+ *
+ * The key is decoded once and every load returns it with a new reference.
+ * The engine's RSA and EC_KEY methods serialize operations on a key, so the
+ * threads that load it share it.
+ */
+typedef struct we_KeyStoreEntry {
+    /* Identifier the key was loaded with. Owned. */
+    char *id;
+    /* Key with wolfSSL key data decoded. Holds a reference. */
+    EVP_PKEY *pkey;
+    /* Indicates the private key is available. */
+    int priv;
+    /* Next entry in list. */
+    struct we_KeyStoreEntry *next;
+} we_KeyStoreEntry;
+
+/* List of loaded keys. */
+static we_KeyStoreEntry *we_keystore_head = NULL;
+/* Directory holding key files. NULL means the identifier is the path. */
+static char *we_keystore_dir = NULL;
+
+/**
+ * Dispose of a keystore entry and its reference to the key.
+ *
+ * @param  entry  [in]  Keystore entry to free.
+ */
+static void we_keystore_entry_free(we_KeyStoreEntry *entry)
+{
+    EVP_PKEY_free(entry->pkey);
+    OPENSSL_free(entry->id);
+    OPENSSL_free(entry);
+}
+
+/**
+ * Remove all keys from the keystore and dispose of them.
+ *
+ * Must be called with the keystore locked.
+ */
+static void we_keystore_clear(void)
+{
+    we_KeyStoreEntry *entry;
+
+    while (we_keystore_head != NULL) {
+        entry = we_keystore_head;
+        we_keystore_head = entry->next;
+        we_keystore_entry_free(entry);
+    }
+}
+
+/**
+ * Set the directory that key files are loaded from.
+ *
+ * Keys already loaded are discarded. Keys handed out remain valid.
+ *
+ * @param  dir  [in]  Directory of DER key files. NULL means the identifier is
+ *                    the path of the file.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_keystore_set_dir(const char *dir)
+{
+    int ret = 1;
+    char *copy = NULL;
+
+    WOLFENGINE_ENTER("we_keystore_set_dir");
+
+    if (dir != NULL) {
+        copy = OPENSSL_strdup(dir);
+        if (copy == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_strdup", copy);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        WE_KEYSTORE_LOCK();
+        we_keystore_clear();
+        OPENSSL_free(we_keystore_dir);
+        we_keystore_dir = copy;
+        WE_KEYSTORE_UNLOCK();
+    }
+
+    WOLFENGINE_LEAVE("we_keystore_set_dir", ret);
+
+    return ret;
+}
+
+/**
+ * Discard the keys loaded so that they are loaded again when next requested.
+ *
+ * Keys handed out remain valid.
+ */
+void we_keystore_flush(void)
+{
+    WE_KEYSTORE_LOCK();
+    we_keystore_clear();
+    WE_KEYSTORE_UNLOCK();
+}
+
+/**
+ * Dispose of all keys in the keystore.
+ */
+void we_keystore_free(void)
+{
+    WE_KEYSTORE_LOCK();
+    we_keystore_clear();
+    OPENSSL_free(we_keystore_dir);
+    we_keystore_dir = NULL;
+    WE_KEYSTORE_UNLOCK();
+}
+
+/**
+ * Find the entry for a key in the keystore.
+ *
+ * Must be called with the keystore locked.
+ *
+ * @param  id    [in]  Identifier of key.
+ * @param  priv  [in]  1 when the private key is required.
+ * @returns  Keystore entry when found and NULL otherwise.
+ */
+static we_KeyStoreEntry *we_keystore_find(const char *id, int priv)
+{
+    we_KeyStoreEntry *entry;
+
+    for (entry = we_keystore_head; entry != NULL; entry = entry->next) {
+        /* A private key entry can serve the public key too. */
+        if ((entry->priv || !priv) && XSTRLEN(entry->id) == XSTRLEN(id) &&
+            XSTRNCMP(entry->id, id, XSTRLEN(id)) == 0) {
+            break;
+        }
+    }
+
+    return entry;
+}
+
+/**
+ * Convert the key to use the wolfEngine methods and decode it into wolfSSL.
+ *
+ * Keys of other types, and keys the engine doesn't handle directly, are
+ * returned as decoded by OpenSSL.
+ *
+ * @param  pkey  [in]  Key decoded by OpenSSL. Freed on success.
+ * @param  priv  [in]  1 when the key holds the private key.
+ * @returns  Key using the wolfEngine methods on success and NULL on failure.
+ */
+static EVP_PKEY *we_keystore_engine_key(EVP_PKEY *pkey, int priv)
+{
+    int ret = 1;
+    EVP_PKEY *engKey = NULL;
+#ifdef WE_HAVE_RSA
+    RSA *rsa;
+#endif
+#ifdef WE_HAVE_EC_KEY
+    EC_KEY *ecKey;
+#endif
+
+    WOLFENGINE_ENTER("we_keystore_engine_key");
+
+    switch (EVP_PKEY_base_id(pkey)) {
+#ifdef WE_HAVE_RSA
+        case EVP_PKEY_RSA:
+            /* Method's init creates the wolfSSL key data. */
+            rsa = EVP_PKEY_get1_RSA(pkey);
+            if (rsa == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_get1_RSA", rsa);
+                ret = 0;
+            }
+            if (ret == 1) {
+                RSA_set_method(rsa, we_rsa_method);
+                ret = we_rsa_preload(rsa, priv);
+            }
+            if (ret == 1) {
+                engKey = EVP_PKEY_new();
+                if (engKey == NULL) {
+                    WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_new", engKey);
+                    ret = 0;
+                }
+            }
+            if (ret == 1) {
+                ret = EVP_PKEY_assign_RSA(engKey, rsa);
+                if (ret != 1) {
+                    WOLFENGINE_ERROR_FUNC("EVP_PKEY_assign_RSA", ret);
+                    ret = 0;
+                }
+            }
+            if (ret == 0) {
+                RSA_free(rsa);
+            }
+            break;
+#endif
+#ifdef WE_HAVE_EC_KEY
+        case EVP_PKEY_EC:
+            /* Imported wolfSSL keys cached in the EC_KEY's ex_data. */
+            ecKey = EVP_PKEY_get1_EC_KEY(pkey);
+            if (ecKey == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_get1_EC_KEY", ecKey);
+                ret = 0;
+            }
+            if (ret == 1) {
+                ret = EC_KEY_set_method(ecKey, we_ec_key_method);
+                if (ret != 1) {
+                    WOLFENGINE_ERROR_FUNC("EC_KEY_set_method", ret);
+                    ret = 0;
+                }
+            }
+            if (ret == 1) {
+                ret = we_ec_key_preload(ecKey, priv);
+            }
+            if (ret == 1) {
+                engKey = EVP_PKEY_new();
+                if (engKey == NULL) {
+                    WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_new", engKey);
+                    ret = 0;
+                }
+            }
+            if (ret == 1) {
+                ret = EVP_PKEY_assign_EC_KEY(engKey, ecKey);
+                if (ret != 1) {
+                    WOLFENGINE_ERROR_FUNC("EVP_PKEY_assign_EC_KEY", ret);
+                    ret = 0;
+                }
+            }
+            if (ret == 0) {
+                EC_KEY_free(ecKey);
+            }
+            break;
+#endif
+        default:
+            /* Operations use the engine's EVP_PKEY methods when registered. */
+            engKey = pkey;
+            pkey = NULL;
+            break;
+    }
+
+    if (ret == 1) {
+        EVP_PKEY_free(pkey);
+    }
+    else {
+        EVP_PKEY_free(engKey);
+        engKey = NULL;
+    }
+
+    WOLFENGINE_LEAVE("we_keystore_engine_key", ret);
+
+    return engKey;
+}
+
+/**
+ * Decode a DER encoded key.
+ *
+ * @param  der     [in]  DER encoding of key.
+ * @param  derLen  [in]  Length of DER encoding in bytes.
+ * @param  priv    [in]  1 for a private key and 0 for a public key.
+ * @returns  Key decoded by OpenSSL on success and NULL on failure.
+ */
+static EVP_PKEY *we_keystore_decode(const unsigned char *der, size_t derLen,
+                                    int priv)
+{
+    const unsigned char *p = der;
+    EVP_PKEY *key;
+
+    WOLFENGINE_ENTER("we_keystore_decode");
+
+    if (priv) {
+        /* PKCS #8 or traditional private key - public key included. */
+        key = d2i_AutoPrivateKey(NULL, &p, (long)derLen);
+    }
+    else {
+        /* SubjectPublicKeyInfo. */
+        key = d2i_PUBKEY(NULL, &p, (long)derLen);
+    }
+    if (key == NULL) {
+        WOLFENGINE_ERROR_MSG("Failed to decode DER key");
+    }
+
+    WOLFENGINE_LEAVE("we_keystore_decode", key != NULL);
+
+    return key;
+}
+
+/**
+ * Load a DER encoded key from a file.
+ *
+ * The file is mapped into memory to be decoded and unmapped after.
+ *
+ * @param  path   [in]   Path of DER encoded key file.
+ * @param  priv   [in]   1 to load a private key and 0 for a public key.
+ * @param  pkey   [out]  Key decoded by OpenSSL.
+ * @param  isPriv [out]  1 when the key holds the private key.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_keystore_load_file(const char *path, int priv, EVP_PKEY **pkey,
+                                 int *isPriv)
+{
+    int ret = 1;
+    int fd;
+    struct stat st;
+    void *map = MAP_FAILED;
+    EVP_PKEY *key = NULL;
+
+    WOLFENGINE_ENTER("we_keystore_load_file");
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        WOLFENGINE_ERROR_MSG("Failed to open key file");
+        ret = 0;
+    }
+    if (ret == 1 && (fstat(fd, &st) != 0 || st.st_size <= 0 ||
+                     st.st_size > WE_KEYSTORE_MAX_FILE_SZ)) {
+        WOLFENGINE_ERROR_MSG("Invalid key file size");
+        ret = 0;
+    }
+    if (ret == 1) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            WOLFENGINE_ERROR_MSG("Failed to map key file");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        *isPriv = 0;
+        if (!priv) {
+            key = we_keystore_decode((unsigned char *)map, (size_t)st.st_size,
+                                     0);
+        }
+        if (key == NULL) {
+            *isPriv = 1;
+            key = we_keystore_decode((unsigned char *)map, (size_t)st.st_size,
+                                     1);
+        }
+        if (key == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("we_keystore_decode", key);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        *pkey = key;
+    }
+
+    if (map != MAP_FAILED) {
+        munmap(map, (size_t)st.st_size);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    WOLFENGINE_LEAVE("we_keystore_load_file", ret);
+
+    return ret;
+}
+
+/**
+ * Get a key from the keystore, loading it the first time it is requested.
+ *
+ * The key is decoded and imported into wolfSSL once. Later requests return
+ * the same key with a new reference.
+ *
+ * @param  id    [in]  Identifier of key - file name in keystore directory or
+ *                     path when no directory set.
+ * @param  priv  [in]  1 when the private key is required.
+ * @returns  Key with a reference owned by the caller on success and NULL on
+ *           failure.
+ */
+static EVP_PKEY *we_keystore_get(const char *id, int priv)
+{
+    int ret = 1;
+    we_KeyStoreEntry *entry;
+    EVP_PKEY *key = NULL;
+    EVP_PKEY *pkey = NULL;
+    char *path = NULL;
+    size_t len;
+    int remote = 0;
+    int keyPriv = 0;
+
+    WOLFENGINE_ENTER("we_keystore_get");
+
+    if (id == NULL) {
+        WOLFENGINE_ERROR_MSG("No key identifier");
+        ret = 0;
+    }
+
+#ifdef WE_HAVE_KEYD
+    if (ret == 1) {
+        /* Private keys held by key daemon when its socket is set. */
+        remote = we_keyd_enabled();
+    }
+#endif
+
+    if (ret == 1) {
+        WE_KEYSTORE_LOCK();
+
+        entry = we_keystore_find(id, priv);
+        if (entry != NULL) {
+            pkey = entry->pkey;
+        }
+        else {
+            if (!remote && we_keystore_dir != NULL) {
+                /* Identifier must name a file in the keystore directory. */
+                if (XSTRSTR(id, "/") != NULL) {
+                    WOLFENGINE_ERROR_MSG("Key identifier is not a file name");
+                    ret = 0;
+                }
+                if (ret == 1) {
+                    len = XSTRLEN(we_keystore_dir) + 1 + XSTRLEN(id) + 1;
+                    path = (char *)OPENSSL_malloc(len);
+                    if (path == NULL) {
+                        WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_malloc", path);
+                        ret = 0;
+                    }
+                }
+                if (ret == 1) {
+                    BIO_snprintf(path, len, "%s/%s", we_keystore_dir, id);
+                }
+            }
+            if (ret == 1) {
+                entry = (we_KeyStoreEntry *)OPENSSL_zalloc(sizeof(*entry));
+                if (entry == NULL) {
+                    WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_zalloc", entry);
+                    ret = 0;
+                }
+            }
+            if (ret == 1) {
+                entry->id = OPENSSL_strdup(id);
+                if (entry->id == NULL) {
+                    WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_strdup", entry->id);
+                    ret = 0;
+                }
+            }
+#ifdef WE_HAVE_KEYD
+            if (ret == 1 && remote) {
+                /* Only the public key comes from the daemon. */
+                key = we_keyd_get_public(id);
+                if (key == NULL) {
+                    WOLFENGINE_ERROR_FUNC_NULL("we_keyd_get_public", key);
+                    ret = 0;
+                }
+                entry->priv = 1;
+            }
+#endif
+            if (ret == 1 && !remote) {
+                ret = we_keystore_load_file((path != NULL) ? path : id, priv,
+                                            &key, &keyPriv);
+                entry->priv = keyPriv;
+            }
+            if (ret == 1) {
+                entry->pkey = we_keystore_engine_key(key, keyPriv);
+                if (entry->pkey == NULL) {
+                    WOLFENGINE_ERROR_FUNC_NULL("we_keystore_engine_key",
+                                               entry->pkey);
+                    EVP_PKEY_free(key);
+                    ret = 0;
+                }
+            }
+#ifdef WE_HAVE_KEYD
+            if (ret == 1 && remote) {
+                /* Private key operations forwarded to the daemon. */
+                ret = we_keyd_set_key_id(entry->pkey, id);
+            }
+#endif
+            if (ret == 1) {
+                entry->next = we_keystore_head;
+                we_keystore_head = entry;
+                pkey = entry->pkey;
+            }
+            else if (entry != NULL) {
+                we_keystore_entry_free(entry);
+            }
+        }
+        if (pkey != NULL && EVP_PKEY_up_ref(pkey) != 1) {
+            WOLFENGINE_ERROR_MSG("Failed to reference keystore key");
+            pkey = NULL;
+        }
+
+        WE_KEYSTORE_UNLOCK();
+    }
+
+    OPENSSL_free(path);
+
+    WOLFENGINE_LEAVE("we_keystore_get", pkey != NULL);
+
+    return pkey;
+}
+
+/**
+ * Load a private key from the keystore.
+ *
+ * @param  e         [in]  Engine object. Unused.
+ * @param  id        [in]  Identifier of key.
+ * @param  uiMethod  [in]  UI method for passwords. Unused - DER keys are not
+ *                         encrypted.
+ * @param  cbData    [in]  Callback data for UI method. Unused.
+ * @returns  Key on success and NULL on failure.
+ */
+EVP_PKEY *we_keystore_load_privkey(ENGINE *e, const char *id,
+                                   UI_METHOD *uiMethod, void *cbData)
+{
+    EVP_PKEY *pkey;
+
+    WOLFENGINE_ENTER("we_keystore_load_privkey");
+
+    (void)e;
+    (void)uiMethod;
+    (void)cbData;
+
+    pkey = we_keystore_get(id, 1);
+
+    WOLFENGINE_LEAVE("we_keystore_load_privkey", pkey != NULL);
+
+    return pkey;
+}
+
+/**
+ * Load a public key from the keystore.
+ *
+ * @param  e         [in]  Engine object. Unused.
+ * @param  id        [in]  Identifier of key.
+ * @param  uiMethod  [in]  UI method for passwords. Unused.
+ * @param  cbData    [in]  Callback data for UI method. Unused.
+ * @returns  Key on success and NULL on failure.
+ */
+EVP_PKEY *we_keystore_load_pubkey(ENGINE *e, const char *id,
+                                  UI_METHOD *uiMethod, void *cbData)
+{
+    EVP_PKEY *pkey;
+
+    WOLFENGINE_ENTER("we_keystore_load_pubkey");
+
+    (void)e;
+    (void)uiMethod;
+    (void)cbData;
+
+    pkey = we_keystore_get(id, 0);
+
+    WOLFENGINE_LEAVE("we_keystore_load_pubkey", pkey != NULL);
+
+    return pkey;
+}
+
+#endif /* WE_HAVE_KEYSTORE */
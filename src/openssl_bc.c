@@ -173,26 +173,31 @@ void EVP_CIPHER_meth_free(EVP_CIPHER *cipher)
     OPENSSL_free(cipher);
 }
 
-size_t EC_KEY_priv2buf(const EC_KEY *eckey, unsigned char **pbuf)
+size_t EC_KEY_priv2oct(const EC_KEY *eckey, unsigned char *buf, size_t len)
 {
-    const BIGNUM *priv_key_bn = NULL;
-    size_t priv_len = 0;
-    unsigned char *priv_key_buf = NULL;
+    const EC_GROUP *group;
+    const BIGNUM *priv_key_bn;
+    size_t buf_len;
+    size_t priv_len;
 
+    group = EC_KEY_get0_group(eckey);
     priv_key_bn = EC_KEY_get0_private_key(eckey);
-    priv_len = BN_num_bytes(priv_key_bn);
-
-    if (priv_len == 0)
+    if (group == NULL || priv_key_bn == NULL)
         return 0;
 
-    priv_key_buf = OPENSSL_malloc(priv_len);
-    if (priv_key_buf == NULL)
+    buf_len = (EC_GROUP_get_degree(group) + 7) / 8;
+    if (buf == NULL)
+        return buf_len;
+
+    priv_len = BN_num_bytes(priv_key_bn);
+    if (len < buf_len || priv_len > buf_len)
         return 0;
-    
-    BN_bn2bin(priv_key_bn, priv_key_buf);
-    *pbuf = priv_key_buf;
 
-    return priv_len;
+    /* Front pad with zeros to length of order. */
+    memset(buf, 0, buf_len - priv_len);
+    BN_bn2bin(priv_key_bn, buf + buf_len - priv_len);
+
+    return buf_len;
 }
 
 void OPENSSL_clear_free(void *str, size_t num)
@@ -204,46 +209,6 @@ void OPENSSL_clear_free(void *str, size_t num)
     OPENSSL_free(str);
 }
 
-static size_t EC_POINT_point2buf(const EC_GROUP *group, const EC_POINT *point,
-                                 point_conversion_form_t form,
-                                 unsigned char **pbuf, BN_CTX *ctx)
-{
-    size_t len;
-    unsigned char *buf;
-
-    len = EC_POINT_point2oct(group, point, form, NULL, 0, NULL);
-    if (len == 0)
-        return 0;
-    if ((buf = OPENSSL_malloc(len)) == NULL) {
-        return 0;
-    }
-    len = EC_POINT_point2oct(group, point, form, buf, len, ctx);
-    if (len == 0) {
-        OPENSSL_free(buf);
-        return 0;
-    }
-    *pbuf = buf;
-    return len;
-}
-
-size_t EC_KEY_key2buf(const EC_KEY *key, point_conversion_form_t form,
-                      unsigned char **pbuf, BN_CTX *ctx)
-{
-    const EC_GROUP *group;
-    const EC_POINT *pub_key;
-
-    if (key == NULL)
-        return 0;
-
-    group = EC_KEY_get0_group(key);
-    pub_key = EC_KEY_get0_public_key(key);
-
-    if (pub_key == NULL || group == NULL)
-        return 0;
-
-    return EC_POINT_point2buf(group, pub_key, form, pbuf, ctx);
-}
-
 RSA *EVP_PKEY_get0_RSA(EVP_PKEY *pkey)
 {
     if (pkey->type != EVP_PKEY_RSA)
@@ -328,6 +293,67 @@ void RSA_get0_key(const RSA *r,
         *d = r->d;
 }
 
+int RSA_set0_key(RSA *r, BIGNUM *n, BIGNUM *e, BIGNUM *d)
+{
+    if ((r->n == NULL && n == NULL) || (r->e == NULL && e == NULL))
+        return 0;
+
+    if (n != NULL) {
+        BN_free(r->n);
+        r->n = n;
+    }
+    if (e != NULL) {
+        BN_free(r->e);
+        r->e = e;
+    }
+    if (d != NULL) {
+        BN_clear_free(r->d);
+        r->d = d;
+    }
+
+    return 1;
+}
+
+int RSA_set0_factors(RSA *r, BIGNUM *p, BIGNUM *q)
+{
+    if ((r->p == NULL && p == NULL) || (r->q == NULL && q == NULL))
+        return 0;
+
+    if (p != NULL) {
+        BN_clear_free(r->p);
+        r->p = p;
+    }
+    if (q != NULL) {
+        BN_clear_free(r->q);
+        r->q = q;
+    }
+
+    return 1;
+}
+
+int RSA_set0_crt_params(RSA *r, BIGNUM *dmp1, BIGNUM *dmq1, BIGNUM *iqmp)
+{
+    if ((r->dmp1 == NULL && dmp1 == NULL) ||
+        (r->dmq1 == NULL && dmq1 == NULL) ||
+        (r->iqmp == NULL && iqmp == NULL))
+        return 0;
+
+    if (dmp1 != NULL) {
+        BN_clear_free(r->dmp1);
+        r->dmp1 = dmp1;
+    }
+    if (dmq1 != NULL) {
+        BN_clear_free(r->dmq1);
+        r->dmq1 = dmq1;
+    }
+    if (iqmp != NULL) {
+        BN_clear_free(r->iqmp);
+        r->iqmp = iqmp;
+    }
+
+    return 1;
+}
+
 int RSA_meth_set_init(RSA_METHOD *meth, int (*init) (RSA *rsa))
 {
     meth->init = init;
@@ -370,6 +396,29 @@ int RSA_meth_set_priv_dec(RSA_METHOD *meth,
     return 1;
 }
 
+/* Sign and verify are only called when RSA_FLAG_SIGN_VER is set. */
+int RSA_meth_set_sign(RSA_METHOD *meth,
+                      int (*sign) (int type, const unsigned char *m,
+                                   unsigned int m_length,
+                                   unsigned char *sigret, unsigned int *siglen,
+                                   const RSA *rsa))
+{
+    meth->rsa_sign = sign;
+    meth->flags |= RSA_FLAG_SIGN_VER;
+    return 1;
+}
+
+int RSA_meth_set_verify(RSA_METHOD *meth,
+                        int (*verify) (int dtype, const unsigned char *m,
+                                       unsigned int m_length,
+                                       const unsigned char *sigbuf,
+                                       unsigned int siglen, const RSA *rsa))
+{
+    meth->rsa_verify = verify;
+    meth->flags |= RSA_FLAG_SIGN_VER;
+    return 1;
+}
+
 int RSA_meth_set_finish(RSA_METHOD *meth, int (*finish) (RSA *rsa))
 {
     meth->finish = finish;
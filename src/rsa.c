@@ -23,9 +23,18 @@
 
 #ifdef WE_HAVE_RSA
 
-/* Maximum DER digest size, taken from wolfSSL. Sum of the maximum size of the
-   encoded digest, algorithm tag, and sequence tag. */
-#define MAX_DER_DIGEST_SZ 98
+#ifdef WE_HAVE_THREADS
+#include <pthread.h>
+#endif
+
+/* Length of the DigestInfo prefix for hashes with a 9 byte OID. */
+#define DIGEST_INFO_PREFIX_SZ 19
+/* Maximum DigestInfo size - longest prefix followed by largest digest. */
+#define MAX_DIGEST_INFO_SZ (DIGEST_INFO_PREFIX_SZ + WC_MAX_DIGEST_SIZE)
+/* Length of concatenated MD5 and SHA-1 digests signed in TLS 1.0/1.1. */
+#define MD5_SHA1_DIGEST_SZ 36
+/* Maximum RSA signature size in bytes. */
+#define MAX_RSA_SIG_SZ (RSA_MAX_SIZE / 8)
 /* The default RSA key/modulus size in bits. */
 #define DEFAULT_KEY_BITS 2048
 /* The default RSA public exponent, e. */
@@ -40,16 +49,40 @@ typedef struct we_Rsa
     RsaKey key;
     /* Stored by control command EVP_PKEY_CTRL_MD. */
     EVP_MD *md;
+    /* Stored by control command EVP_PKEY_CTRL_RSA_MGF1_MD. */
+    EVP_MD *mdMGF1;
+    /* Stored by control command EVP_PKEY_CTRL_RSA_OAEP_MD. */
+    EVP_MD *oaepMd;
+    /* Stored by control command EVP_PKEY_CTRL_RSA_OAEP_LABEL. Owned. */
+    unsigned char *label;
+    /* Length of OAEP label in bytes. */
+    int labelLen;
     /* Padding mode */
     int padMode;
+    /* PSS salt length. May be one of OpenSSL's special RSA_PSS_SALTLEN_*
+       values. */
+    int saltLen;
     /* The public exponent ("e"). */
     long pubExp;
     /* The key/modulus size in bits. */
     int bits;
+#ifdef WE_HAVE_RSA_MULTI_PRIME
+    /* Additional primes of a multi-prime private key. Owned. */
+    we_RsaMultiPrime *multiPrime;
+    /* Number of primes to generate. Set by EVP_PKEY_CTRL_RSA_KEYGEN_PRIMES. */
+    int primes;
+#endif
     /* Indicates private key has been set into wolfSSL structure. */
     int privKeySet:1;
     /* Indicates public key has been set into wolfSSL structure. */
     int pubKeySet:1;
+#ifdef WE_HAVE_THREADS
+    /* Serializes operations with the RSA method. The RSA object may be shared
+     * by threads and wolfSSL keeps state in the key during an operation. */
+    pthread_mutex_t useMutex;
+    /* Indicates useMutex was initialized. */
+    int useMutexInit;
+#endif
 } we_Rsa;
 
 /** RSA direct method - RSA using wolfSSL for the implementation. */
@@ -114,22 +147,43 @@ static int we_set_private_key(RSA *rsaKey, we_Rsa *engineRsa)
     unsigned char *privDer = NULL;
     int privDerLen = 0;
     word32 idx = 0;
+    int multiPrime = 0;
 
     WOLFENGINE_ENTER("we_set_private_key");
 
-    privDerLen = i2d_RSAPrivateKey(rsaKey, &privDer);
-    if (privDerLen == 0) {
-        WOLFENGINE_ERROR_FUNC("i2d_RSAPrivateKey", privDerLen);
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    /* wolfCrypt can't decode the DER encoding of a multi-prime key. */
+    if (RSA_get_multi_prime_extra_count(rsaKey) > 0) {
+        multiPrime = 1;
+#ifdef WE_HAVE_RSA_MULTI_PRIME
+        rc = we_rsa_multi_prime_load(rsaKey, &engineRsa->key,
+                                     &engineRsa->multiPrime);
+        if (rc == 0) {
+            WOLFENGINE_ERROR_FUNC("we_rsa_multi_prime_load", rc);
+            ret = 0;
+        }
+#else
+        WOLFENGINE_ERROR_MSG("Multi-prime RSA requires WOLFSSL_PUBLIC_MP");
         ret = 0;
+#endif
     }
+#endif
 
-    if (ret == 1) {
-        rc = wc_RsaPrivateKeyDecode(privDer, &idx, &engineRsa->key,
-                                    privDerLen);
-        if (rc != 0) {
-            WOLFENGINE_ERROR_FUNC("wc_RsaPrivateKeyDecode", rc);
+    if (ret == 1 && !multiPrime) {
+        privDerLen = i2d_RSAPrivateKey(rsaKey, &privDer);
+        if (privDerLen == 0) {
+            WOLFENGINE_ERROR_FUNC("i2d_RSAPrivateKey", privDerLen);
             ret = 0;
         }
+
+        if (ret == 1) {
+            rc = wc_RsaPrivateKeyDecode(privDer, &idx, &engineRsa->key,
+                                        privDerLen);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("wc_RsaPrivateKeyDecode", rc);
+                ret = 0;
+            }
+        }
     }
 
     if (ret == 1) {
@@ -183,6 +237,19 @@ static int we_rsa_init(RSA *rsa)
     }
 #endif /* WC_RSA_BLINDING */
 
+#ifdef WE_HAVE_THREADS
+    if (ret == 1) {
+        rc = pthread_mutex_init(&engineRsa->useMutex, NULL);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("pthread_mutex_init", rc);
+            ret = 0;
+        }
+        else {
+            engineRsa->useMutexInit = 1;
+        }
+    }
+#endif
+
     if (ret == 1) {
         rc = RSA_set_app_data(rsa, engineRsa);
         if (rc != 1) {
@@ -192,6 +259,11 @@ static int we_rsa_init(RSA *rsa)
     }
 
     if (ret == 0 && engineRsa != NULL) {
+#ifdef WE_HAVE_THREADS
+        if (engineRsa->useMutexInit) {
+            pthread_mutex_destroy(&engineRsa->useMutex);
+        }
+#endif
         OPENSSL_free(engineRsa);
     }
 
@@ -213,6 +285,14 @@ static int we_rsa_finish(RSA *rsa)
     engineRsa = RSA_get_app_data(rsa);
     if (engineRsa != NULL) {
         wc_FreeRsaKey(&engineRsa->key);
+#ifdef WE_HAVE_RSA_MULTI_PRIME
+        we_rsa_multi_prime_free(engineRsa->multiPrime);
+#endif
+#ifdef WE_HAVE_THREADS
+        if (engineRsa->useMutexInit) {
+            pthread_mutex_destroy(&engineRsa->useMutex);
+        }
+#endif
         OPENSSL_free(engineRsa);
         RSA_set_app_data(rsa, NULL);
     }
@@ -222,6 +302,168 @@ static int we_rsa_finish(RSA *rsa)
     return 1;
 }
 
+/**
+ * Decode the key of an RSA object, using the wolfEngine RSA method, into
+ * wolfSSL now rather than on first use.
+ *
+ * @param  rsa   [in]  RSA object with wolfEngine RSA method set.
+ * @param  priv  [in]  1 to decode the private key and 0 for the public key.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_rsa_preload(RSA *rsa, int priv)
+{
+    int ret = 1;
+    we_Rsa *engineRsa;
+
+    WOLFENGINE_ENTER("we_rsa_preload");
+
+    engineRsa = (we_Rsa *)RSA_get_app_data(rsa);
+    if (engineRsa == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("RSA_get_app_data", engineRsa);
+        ret = 0;
+    }
+    if (ret == 1 && priv && !engineRsa->privKeySet) {
+        ret = we_set_private_key(rsa, engineRsa);
+        if (ret == 1) {
+            /* Private key holds the public key too. */
+            engineRsa->pubKeySet = 1;
+        }
+    }
+    else if (ret == 1 && !priv && !engineRsa->pubKeySet) {
+        ret = we_set_public_key(rsa, engineRsa);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_preload", ret);
+
+    return ret;
+}
+
+/**
+ * Take the wolfSSL key of an RSA object for an operation with the RSA method.
+ *
+ * Keys from the keystore are one RSA object shared by all the threads that
+ * load them. Operations on the object are serialized and the calling thread's
+ * random is used for blinding.
+ *
+ * @param  rsa  [in]  wolfEngine RSA object.
+ */
+static void we_rsa_key_lock(we_Rsa *rsa)
+{
+#ifdef WE_HAVE_THREADS
+    pthread_mutex_lock(&rsa->useMutex);
+#endif
+#ifdef WC_RSA_BLINDING
+    /* Random of thread that created key may be in use by that thread. */
+    (void)wc_RsaSetRNG(&rsa->key, we_rng);
+#endif
+    (void)rsa;
+}
+
+/**
+ * Finish using the wolfSSL key of an RSA object.
+ *
+ * @param  rsa  [in]  wolfEngine RSA object locked with we_rsa_key_lock().
+ */
+static void we_rsa_key_unlock(we_Rsa *rsa)
+{
+#ifdef WE_HAVE_THREADS
+    pthread_mutex_unlock(&rsa->useMutex);
+#endif
+    (void)rsa;
+}
+
+/**
+ * Check that the private key can be used by wolfCrypt.
+ *
+ * The additional primes of a multi-prime key are only used by the engine's
+ * PKCS #1 v1.5 signing and raw private key operations.
+ *
+ * @param  rsa  [in]  wolfEngine RSA object with private key set.
+ * @returns  1 when wolfCrypt can use the key and 0 otherwise.
+ */
+static int we_rsa_check_two_prime(we_Rsa *rsa)
+{
+    int ret = 1;
+
+#ifdef WE_HAVE_RSA_MULTI_PRIME
+    if (rsa->multiPrime != NULL) {
+        WOLFENGINE_ERROR_MSG("Operation not supported with multi-prime RSA key");
+        ret = 0;
+    }
+#else
+    (void)rsa;
+#endif
+
+    return ret;
+}
+
+/**
+ * Check whether the raw private key operation is performed by the engine
+ * rather than wolfCrypt - multi-prime keys and parallel CRT.
+ *
+ * @param  rsa  [in]  wolfEngine RSA object.
+ * @returns  1 when the engine performs the operation and 0 otherwise.
+ */
+static int we_rsa_private_in_engine(we_Rsa *rsa)
+{
+    int ret = 0;
+
+#ifdef WE_HAVE_RSA_MULTI_PRIME
+    if (rsa->multiPrime != NULL) {
+        ret = 1;
+    }
+#endif
+#ifdef WE_HAVE_RSA_PARALLEL_CRT
+    if (ret == 0 && rsa->key.type == RSA_PRIVATE &&
+        we_rsa_crt_parallel_enabled()) {
+        ret = 1;
+    }
+#endif
+    (void)rsa;
+
+    return ret;
+}
+
+/**
+ * Perform the raw RSA private key operation in the engine.
+ *
+ * Only call when we_rsa_private_in_engine() returns 1.
+ *
+ * @param  rsa     [in]   wolfEngine RSA object with private key set.
+ * @param  in      [in]   Input data - padded message.
+ * @param  inLen   [in]   Length of input data in bytes.
+ * @param  out     [out]  Buffer to hold result.
+ * @param  outLen  [in]   Size of output buffer - must be size of modulus.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_private_raw(we_Rsa *rsa, const unsigned char *in,
+                              word32 inLen, unsigned char *out, word32 outLen)
+{
+    int ret = 0;
+
+#ifdef WE_HAVE_RSA_MULTI_PRIME
+    if (rsa->multiPrime != NULL) {
+        ret = we_rsa_multi_prime_private(&rsa->key, rsa->multiPrime, in, inLen,
+                                         out, outLen, we_rng);
+    }
+    else
+#endif
+    {
+#ifdef WE_HAVE_RSA_PARALLEL_CRT
+        ret = we_rsa_crt_private(&rsa->key, in, inLen, out, outLen, we_rng);
+#else
+        WOLFENGINE_ERROR_MSG("RSA private key operation not in engine");
+        (void)rsa;
+        (void)in;
+        (void)inLen;
+        (void)out;
+        (void)outLen;
+#endif
+    }
+
+    return ret;
+}
+
 /**
  * Perform an RSA public encryption operation.
  *
@@ -238,6 +480,7 @@ static int we_rsa_pub_enc(int flen, const unsigned char *from,
     int ret = 1;
     int rc = 0;
     we_Rsa *engineRsa = NULL;
+    int locked = 0;
 
     WOLFENGINE_ENTER("we_rsa_pub_enc");
 
@@ -247,6 +490,11 @@ static int we_rsa_pub_enc(int flen, const unsigned char *from,
         ret = -1;
     }
 
+    if (ret == 1) {
+        we_rsa_key_lock(engineRsa);
+        locked = 1;
+    }
+
     if (ret == 1 && !engineRsa->pubKeySet) {
         rc = we_set_public_key(rsa, engineRsa);
         if (rc == 0) {
@@ -302,6 +550,10 @@ static int we_rsa_pub_enc(int flen, const unsigned char *from,
         }
     }
 
+    if (locked) {
+        we_rsa_key_unlock(engineRsa);
+    }
+
     WOLFENGINE_LEAVE("we_rsa_pub_enc", ret);
 
     return ret;
@@ -323,6 +575,11 @@ static int we_rsa_priv_dec(int flen, const unsigned char *from,
     int ret = 1;
     int rc = 0;
     we_Rsa *engineRsa = NULL;
+    const char *keyId = NULL;
+#ifdef WE_HAVE_KEYD
+    size_t outLen;
+#endif
+    int locked = 0;
 
     WOLFENGINE_ENTER("we_rsa_priv_dec");
 
@@ -332,7 +589,30 @@ static int we_rsa_priv_dec(int flen, const unsigned char *from,
         ret = -1;
     }
 
-    if (ret == 1 && !engineRsa->privKeySet) {
+#ifdef WE_HAVE_KEYD
+    if (ret == 1) {
+        /* Private key may be held by the key daemon. */
+        keyId = we_keyd_rsa_key_id(rsa);
+    }
+    if (ret == 1 && keyId != NULL) {
+        outLen = RSA_size(rsa);
+        if (we_keyd_rsa_decrypt(keyId, padding, from, flen, to,
+                                &outLen) != 1) {
+            WOLFENGINE_ERROR_FUNC("we_keyd_rsa_decrypt", 0);
+            ret = -1;
+        }
+        else {
+            ret = (int)outLen;
+        }
+    }
+#endif
+
+    if (ret == 1 && keyId == NULL) {
+        we_rsa_key_lock(engineRsa);
+        locked = 1;
+    }
+
+    if (ret == 1 && keyId == NULL && !engineRsa->privKeySet) {
         rc = we_set_private_key(rsa, engineRsa);
         if (rc == 0) {
             WOLFENGINE_ERROR_FUNC("we_set_private_key", rc);
@@ -340,7 +620,12 @@ static int we_rsa_priv_dec(int flen, const unsigned char *from,
         }
     }
 
-    if (ret == 1) {
+    if (ret == 1 && keyId == NULL && padding != RSA_NO_PADDING &&
+        !we_rsa_check_two_prime(engineRsa)) {
+        ret = -1;
+    }
+
+    if (ret == 1 && keyId == NULL) {
         switch (padding) {
             case RSA_PKCS1_PADDING:
                 /* PKCS 1 v1.5 padding using block type 2. */
@@ -369,9 +654,16 @@ static int we_rsa_priv_dec(int flen, const unsigned char *from,
                 }
                 break;
             case RSA_NO_PADDING:
-                rc = wc_RsaPrivateDecrypt_ex(from, flen, to, RSA_size(rsa),
-                                             &engineRsa->key, WC_RSA_NO_PAD,
-                                             WC_HASH_TYPE_NONE, 0, NULL, 0);
+                if (we_rsa_private_in_engine(engineRsa)) {
+                    rc = we_rsa_private_raw(engineRsa, from, flen, to,
+                                            RSA_size(rsa));
+                    rc = (rc == 1) ? RSA_size(rsa) : RSA_BUFFER_E;
+                }
+                else {
+                    rc = wc_RsaPrivateDecrypt_ex(from, flen, to, RSA_size(rsa),
+                                                 &engineRsa->key, WC_RSA_NO_PAD,
+                                                 WC_HASH_TYPE_NONE, 0, NULL, 0);
+                }
                 if (rc < 0) {
                     WOLFENGINE_ERROR_FUNC("wc_RsaPrivateDecrypt_ex", rc);
                     ret = -1;
@@ -386,11 +678,290 @@ static int we_rsa_priv_dec(int flen, const unsigned char *from,
         }
     }
 
+    if (locked) {
+        we_rsa_key_unlock(engineRsa);
+    }
+
     WOLFENGINE_LEAVE("we_rsa_priv_dec", ret);
 
     return ret;
 }
 
+/**
+ * Sign data using PKCS #1 v1.5 padding (block type 1).
+ *
+ * When the key is multi-prime, or the parallel CRT helper thread is enabled
+ * and the private key is set, the data is padded here and the private key
+ * operation is performed by the engine.
+ *
+ * @param  rsa     [in]   wolfEngine RSA object.
+ * @param  in      [in]   Data to sign - DigestInfo or raw data.
+ * @param  inLen   [in]   Length of data in bytes.
+ * @param  out     [out]  Buffer to hold signature.
+ * @param  outLen  [in]   Size of signature buffer in bytes.
+ * @returns  Length of signature on success and negative on failure.
+ */
+static int we_rsa_pkcs1_sign(we_Rsa *rsa, const unsigned char *in,
+                             word32 inLen, unsigned char *out, word32 outLen)
+{
+    int ret;
+    int keyLen;
+
+    if (we_rsa_private_in_engine(rsa)) {
+        keyLen = wc_RsaEncryptSize(&rsa->key);
+        if (keyLen <= 0 || (word32)keyLen > outLen ||
+            inLen + 11 > (word32)keyLen) {
+            ret = RSA_BUFFER_E;
+        }
+        else {
+            /* EM = 0x00 || 0x01 || PS (0xff...) || 0x00 || T */
+            out[0] = 0x00;
+            out[1] = 0x01;
+            XMEMSET(out + 2, 0xff, keyLen - inLen - 3);
+            out[keyLen - inLen - 1] = 0x00;
+            XMEMCPY(out + keyLen - inLen, in, inLen);
+
+            if (we_rsa_private_raw(rsa, out, keyLen, out, keyLen) == 1) {
+                ret = keyLen;
+            }
+            else {
+                ret = RSA_BUFFER_E;
+            }
+        }
+    }
+    else {
+        ret = wc_RsaSSL_Sign(in, inLen, out, outLen, &rsa->key, we_rng);
+    }
+
+    return ret;
+}
+
+/*
+ * DER encoding of DigestInfo up to, and including, the OCTET STRING header of
+ * the digest. See RFC 8017, Section 9.2, Note 1.
+ */
+#ifdef WE_HAVE_SHA1
+static const unsigned char we_digest_info_sha1[] = {
+    0x30, 0x21, 0x30, 0x09, 0x06, 0x05, 0x2b, 0x0e, 0x03, 0x02, 0x1a, 0x05,
+    0x00, 0x04, 0x14
+};
+#endif
+#ifdef WE_HAVE_SHA224
+static const unsigned char we_digest_info_sha224[] = {
+    0x30, 0x2d, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03,
+    0x04, 0x02, 0x04, 0x05, 0x00, 0x04, 0x1c
+};
+#endif
+#ifdef WE_HAVE_SHA256
+static const unsigned char we_digest_info_sha256[] = {
+    0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03,
+    0x04, 0x02, 0x01, 0x05, 0x00, 0x04, 0x20
+};
+#endif
+#ifdef WE_HAVE_SHA384
+static const unsigned char we_digest_info_sha384[] = {
+    0x30, 0x41, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03,
+    0x04, 0x02, 0x02, 0x05, 0x00, 0x04, 0x30
+};
+#endif
+#ifdef WE_HAVE_SHA512
+static const unsigned char we_digest_info_sha512[] = {
+    0x30, 0x51, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03,
+    0x04, 0x02, 0x03, 0x05, 0x00, 0x04, 0x40
+};
+#endif
+#ifdef WE_HAVE_SHA3_224
+static const unsigned char we_digest_info_sha3_224[] = {
+    0x30, 0x2d, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03,
+    0x04, 0x02, 0x07, 0x05, 0x00, 0x04, 0x1c
+};
+#endif
+#ifdef WE_HAVE_SHA3_256
+static const unsigned char we_digest_info_sha3_256[] = {
+    0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03,
+    0x04, 0x02, 0x08, 0x05, 0x00, 0x04, 0x20
+};
+#endif
+#ifdef WE_HAVE_SHA3_384
+static const unsigned char we_digest_info_sha3_384[] = {
+    0x30, 0x41, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03,
+    0x04, 0x02, 0x09, 0x05, 0x00, 0x04, 0x30
+};
+#endif
+#ifdef WE_HAVE_SHA3_512
+static const unsigned char we_digest_info_sha3_512[] = {
+    0x30, 0x51, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03,
+    0x04, 0x02, 0x0a, 0x05, 0x00, 0x04, 0x40
+};
+#endif
+
+/**
+ * Get the DigestInfo prefix for a digest.
+ *
+ * The last byte of the prefix is the length of the digest.
+ *
+ * @param  nid        [in]   OpenSSL NID of digest.
+ * @param  prefixLen  [out]  Length of prefix in bytes.
+ * @returns  Prefix on success and NULL when digest not supported.
+ */
+static const unsigned char *we_digest_info_prefix(int nid, size_t *prefixLen)
+{
+    const unsigned char *prefix = NULL;
+
+    switch (nid) {
+#ifdef WE_HAVE_SHA1
+        case NID_sha1:
+            prefix = we_digest_info_sha1;
+            *prefixLen = sizeof(we_digest_info_sha1);
+            break;
+#endif
+#ifdef WE_HAVE_SHA224
+        case NID_sha224:
+            prefix = we_digest_info_sha224;
+            *prefixLen = sizeof(we_digest_info_sha224);
+            break;
+#endif
+#ifdef WE_HAVE_SHA256
+        case NID_sha256:
+            prefix = we_digest_info_sha256;
+            *prefixLen = sizeof(we_digest_info_sha256);
+            break;
+#endif
+#ifdef WE_HAVE_SHA384
+        case NID_sha384:
+            prefix = we_digest_info_sha384;
+            *prefixLen = sizeof(we_digest_info_sha384);
+            break;
+#endif
+#ifdef WE_HAVE_SHA512
+        case NID_sha512:
+            prefix = we_digest_info_sha512;
+            *prefixLen = sizeof(we_digest_info_sha512);
+            break;
+#endif
+#ifdef WE_HAVE_SHA3_224
+        case NID_sha3_224:
+            prefix = we_digest_info_sha3_224;
+            *prefixLen = sizeof(we_digest_info_sha3_224);
+            break;
+#endif
+#ifdef WE_HAVE_SHA3_256
+        case NID_sha3_256:
+            prefix = we_digest_info_sha3_256;
+            *prefixLen = sizeof(we_digest_info_sha3_256);
+            break;
+#endif
+#ifdef WE_HAVE_SHA3_384
+        case NID_sha3_384:
+            prefix = we_digest_info_sha3_384;
+            *prefixLen = sizeof(we_digest_info_sha3_384);
+            break;
+#endif
+#ifdef WE_HAVE_SHA3_512
+        case NID_sha3_512:
+            prefix = we_digest_info_sha3_512;
+            *prefixLen = sizeof(we_digest_info_sha3_512);
+            break;
+#endif
+        default:
+            break;
+    }
+
+    return prefix;
+}
+
+/**
+ * Encode a digest as a DER DigestInfo.
+ *
+ * @param  nid           [in]   OpenSSL NID of digest.
+ * @param  digest        [in]   Buffer holding the digest.
+ * @param  digestLen     [in]   Length of digest buffer.
+ * @param  encodedDigest [out]  Buffer to hold encoded digest. Must be at least
+ *                              MAX_DIGEST_INFO_SZ bytes.
+ * @returns Length of encoded digest on success and 0 on failure.
+ */
+static int we_der_encode_digest(int nid, const unsigned char *digest,
+                                size_t digestLen, unsigned char *encodedDigest)
+{
+    int ret = 0;
+    const unsigned char *prefix;
+    size_t prefixLen = 0;
+
+    WOLFENGINE_ENTER("we_der_encode_digest");
+
+    prefix = we_digest_info_prefix(nid, &prefixLen);
+    if (prefix == NULL) {
+        WOLFENGINE_ERROR_MSG("Digest not supported for PKCS #1 v1.5");
+    }
+    else if (digestLen != prefix[prefixLen - 1]) {
+        WOLFENGINE_ERROR_MSG("Digest length doesn't match digest");
+    }
+    else {
+        XMEMCPY(encodedDigest, prefix, prefixLen);
+        XMEMCPY(encodedDigest + prefixLen, digest, digestLen);
+        ret = (int)(prefixLen + digestLen);
+    }
+
+    WOLFENGINE_LEAVE("we_der_encode_digest", ret);
+
+    return ret;
+}
+
+/**
+ * Verify a PKCS #1 v1.5 signature against the expected prefix and data.
+ *
+ * The recovered data is checked in place - no encoding is performed.
+ *
+ * @param  key        [in]  wolfSSL RSA key with public key set.
+ * @param  sig        [in]  Signature data.
+ * @param  sigLen     [in]  Length of signature data.
+ * @param  prefix     [in]  Expected DigestInfo prefix. May be NULL.
+ * @param  prefixLen  [in]  Length of prefix in bytes.
+ * @param  tbs        [in]  Expected data following prefix.
+ * @param  tbsLen     [in]  Length of expected data in bytes.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_pkcs1_verify_key(RsaKey *key, const unsigned char *sig,
+                                   size_t sigLen, const unsigned char *prefix,
+                                   size_t prefixLen, const unsigned char *tbs,
+                                   size_t tbsLen)
+{
+    int ret = 1;
+    int rc;
+    unsigned char decryptedSig[MAX_RSA_SIG_SZ];
+
+    WOLFENGINE_ENTER("we_rsa_pkcs1_verify_key");
+
+    rc = wc_RsaSSL_Verify(sig, (word32)sigLen, decryptedSig,
+                          (word32)sizeof(decryptedSig), key);
+    if (rc <= 0) {
+        WOLFENGINE_ERROR_FUNC("wc_RsaSSL_Verify", rc);
+        ret = 0;
+    }
+    if (ret == 1 && (size_t)rc != prefixLen + tbsLen) {
+        WOLFENGINE_ERROR_MSG("Recovered data length doesn't match");
+        ret = 0;
+    }
+    if (ret == 1 && prefixLen > 0) {
+        rc = XMEMCMP(decryptedSig, prefix, prefixLen);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("XMEMCMP", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        rc = XMEMCMP(decryptedSig + prefixLen, tbs, tbsLen);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("XMEMCMP", rc);
+            ret = 0;
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_pkcs1_verify_key", ret);
+
+    return ret;
+}
+
 /**
  * Perform an RSA private encryption operation.
  *
@@ -408,6 +979,11 @@ static int we_rsa_priv_enc(int flen, const unsigned char *from,
     int rc = 0;
     we_Rsa *engineRsa = NULL;
     word32 toLen;
+    const char *keyId = NULL;
+#ifdef WE_HAVE_KEYD
+    size_t outLen;
+#endif
+    int locked = 0;
 
     WOLFENGINE_ENTER("we_rsa_priv_enc");
 
@@ -417,22 +993,50 @@ static int we_rsa_priv_enc(int flen, const unsigned char *from,
         ret = -1;
     }
 
-    if (ret == 1 && !engineRsa->pubKeySet) {
-        rc = we_set_public_key(rsa, engineRsa);
+#ifdef WE_HAVE_KEYD
+    if (ret == 1) {
+        /* Private key may be held by the key daemon. */
+        keyId = we_keyd_rsa_key_id(rsa);
+    }
+    if (ret == 1 && keyId != NULL) {
+        /* Data is a DigestInfo or raw data - sign as is. */
+        outLen = RSA_size(rsa);
+        if (padding != RSA_PKCS1_PADDING) {
+            WOLFENGINE_ERROR_MSG("we_rsa_priv_enc: unsupported padding");
+            ret = -1;
+        }
+        else if (we_keyd_rsa_sign(keyId, padding, NULL, NULL, 0, from, flen,
+                                  to, &outLen) != 1) {
+            WOLFENGINE_ERROR_FUNC("we_keyd_rsa_sign", 0);
+            ret = -1;
+        }
+        else {
+            ret = (int)outLen;
+        }
+    }
+#endif
+
+    if (ret == 1 && keyId == NULL) {
+        we_rsa_key_lock(engineRsa);
+        locked = 1;
+    }
+
+    if (ret == 1 && keyId == NULL && !engineRsa->privKeySet) {
+        rc = we_set_private_key(rsa, engineRsa);
         if (rc == 0) {
-            WOLFENGINE_ERROR_FUNC("we_set_public_key", rc);
+            WOLFENGINE_ERROR_FUNC("we_set_private_key", rc);
             ret = -1;
         }
     }
 
-    if (ret == 1) {
+    if (ret == 1 && keyId == NULL) {
         switch (padding) {
             case RSA_PKCS1_PADDING:
                 /* PKCS 1 v1.5 padding using block type 1. */
-                rc = wc_RsaSSL_Sign(from, flen, to, RSA_size(rsa),
-                                    &engineRsa->key, we_rng);
+                rc = we_rsa_pkcs1_sign(engineRsa, from, flen, to,
+                                       RSA_size(rsa));
                 if (rc < 0) {
-                    WOLFENGINE_ERROR_FUNC("wc_RsaSSL_Sign", rc);
+                    WOLFENGINE_ERROR_FUNC("we_rsa_pkcs1_sign", rc);
                     ret = -1;
                 }
                 else {
@@ -441,10 +1045,16 @@ static int we_rsa_priv_enc(int flen, const unsigned char *from,
                 break;
             case RSA_NO_PADDING:
                 toLen = RSA_size(rsa);
-                rc = wc_RsaDirect((byte*)from, flen, to, &toLen, &engineRsa->key,
-                                  RSA_PRIVATE_ENCRYPT,
-                                  we_rng);
-                if (rc < 0) {
+                if (we_rsa_private_in_engine(engineRsa)) {
+                    rc = we_rsa_private_raw(engineRsa, from, flen, to, toLen);
+                    rc = (rc == 1) ? (int)toLen : RSA_BUFFER_E;
+                }
+                else {
+                    rc = wc_RsaDirect((byte*)from, flen, to, &toLen,
+                                      &engineRsa->key, RSA_PRIVATE_ENCRYPT,
+                                      we_rng);
+                }
+                if (rc < 0) {
                     WOLFENGINE_ERROR_FUNC("wc_RsaDirect", rc);
                     ret = -1;
                 }
@@ -458,6 +1068,10 @@ static int we_rsa_priv_enc(int flen, const unsigned char *from,
         }
     }
 
+    if (locked) {
+        we_rsa_key_unlock(engineRsa);
+    }
+
     WOLFENGINE_LEAVE("we_rsa_priv_enc", ret);
 
     return ret;
@@ -480,6 +1094,7 @@ static int we_rsa_pub_dec(int flen, const unsigned char *from,
     int rc = 0;
     we_Rsa *engineRsa = NULL;
     word32 toLen;
+    int locked = 0;
 
     WOLFENGINE_ENTER("we_rsa_pub_dec");
 
@@ -489,6 +1104,11 @@ static int we_rsa_pub_dec(int flen, const unsigned char *from,
         ret = -1;
     }
 
+    if (ret == 1) {
+        we_rsa_key_lock(engineRsa);
+        locked = 1;
+    }
+
     if (ret == 1 && !engineRsa->pubKeySet) {
         rc = we_set_public_key(rsa, engineRsa);
         if (rc == 0) {
@@ -529,11 +1149,317 @@ static int we_rsa_pub_dec(int flen, const unsigned char *from,
         }
     }
 
+    if (locked) {
+        we_rsa_key_unlock(engineRsa);
+    }
+
     WOLFENGINE_LEAVE("we_rsa_pub_dec", ret);
 
     return ret;
 }
 
+/**
+ * Sign a digest using PKCS #1 v1.5 padding.
+ *
+ * The DigestInfo is built from a static prefix and padded and exponentiated
+ * by wolfCrypt in one operation.
+ *
+ * @param  type    [in]   OpenSSL NID of digest.
+ * @param  m       [in]   Digest to sign.
+ * @param  mLen    [in]   Length of digest in bytes.
+ * @param  sigRet  [out]  Buffer to hold signature.
+ * @param  sigLen  [out]  Length of signature in bytes.
+ * @param  rsa     [in]   RSA context of operation.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_sign(int type, const unsigned char *m, unsigned int mLen,
+                       unsigned char *sigRet, unsigned int *sigLen,
+                       const RSA *rsa)
+{
+    int ret = 1;
+    int rc = 0;
+    we_Rsa *engineRsa = NULL;
+    unsigned char encodedDigest[MAX_DIGEST_INFO_SZ];
+    const unsigned char *tbs = m;
+    int tbsLen = (int)mLen;
+    const char *keyId = NULL;
+#ifdef WE_HAVE_KEYD
+    size_t outLen;
+#endif
+    int locked = 0;
+
+    WOLFENGINE_ENTER("we_rsa_sign");
+
+    engineRsa = (we_Rsa *)RSA_get_app_data(rsa);
+    if (engineRsa == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("RSA_get_app_data", engineRsa);
+        ret = 0;
+    }
+
+#ifdef WE_HAVE_KEYD
+    if (ret == 1) {
+        /* Private key may be held by the key daemon. */
+        keyId = we_keyd_rsa_key_id(rsa);
+    }
+#endif
+
+    if (ret == 1 && keyId == NULL) {
+        we_rsa_key_lock(engineRsa);
+        locked = 1;
+    }
+
+    if (ret == 1 && keyId == NULL && !engineRsa->privKeySet) {
+        rc = we_set_private_key((RSA *)rsa, engineRsa);
+        if (rc == 0) {
+            WOLFENGINE_ERROR_FUNC("we_set_private_key", rc);
+            ret = 0;
+        }
+    }
+
+    if (ret == 1) {
+        if (type == NID_md5_sha1) {
+            /* TLS 1.0/1.1 signs the MD5 and SHA-1 digests without encoding. */
+            if (mLen != MD5_SHA1_DIGEST_SZ) {
+                WOLFENGINE_ERROR_MSG("Invalid MD5-SHA1 digest length");
+                ret = 0;
+            }
+        }
+        else {
+            tbsLen = we_der_encode_digest(type, m, mLen, encodedDigest);
+            if (tbsLen == 0) {
+                WOLFENGINE_ERROR_FUNC("we_der_encode_digest", tbsLen);
+                ret = 0;
+            }
+            tbs = encodedDigest;
+        }
+    }
+
+#ifdef WE_HAVE_KEYD
+    if (ret == 1 && keyId != NULL) {
+        /* DigestInfo is already encoded - daemon signs it as is. */
+        outLen = RSA_size(rsa);
+        if (we_keyd_rsa_sign(keyId, RSA_PKCS1_PADDING, NULL, NULL, 0, tbs,
+                             (size_t)tbsLen, sigRet, &outLen) != 1) {
+            WOLFENGINE_ERROR_FUNC("we_keyd_rsa_sign", 0);
+            ret = 0;
+        }
+        else {
+            *sigLen = (unsigned int)outLen;
+        }
+    }
+#endif
+
+    if (ret == 1 && keyId == NULL) {
+        rc = we_rsa_pkcs1_sign(engineRsa, tbs, (word32)tbsLen, sigRet,
+                               (word32)RSA_size(rsa));
+        if (rc <= 0) {
+            WOLFENGINE_ERROR_FUNC("we_rsa_pkcs1_sign", rc);
+            ret = 0;
+        }
+        else {
+            *sigLen = (unsigned int)rc;
+        }
+    }
+
+    if (locked) {
+        we_rsa_key_unlock(engineRsa);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_sign", ret);
+
+    return ret;
+}
+
+/**
+ * Verify a PKCS #1 v1.5 signature of a digest.
+ *
+ * The recovered DigestInfo is compared against the static prefix and digest
+ * in place.
+ *
+ * @param  type    [in]  OpenSSL NID of digest.
+ * @param  m       [in]  Digest that was signed.
+ * @param  mLen    [in]  Length of digest in bytes.
+ * @param  sigBuf  [in]  Signature data.
+ * @param  sigLen  [in]  Length of signature in bytes.
+ * @param  rsa     [in]  RSA context of operation.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_verify(int type, const unsigned char *m, unsigned int mLen,
+                         const unsigned char *sigBuf, unsigned int sigLen,
+                         const RSA *rsa)
+{
+    int ret = 1;
+    int rc = 0;
+    we_Rsa *engineRsa = NULL;
+    const unsigned char *prefix = NULL;
+    size_t prefixLen = 0;
+    int locked = 0;
+
+    WOLFENGINE_ENTER("we_rsa_verify");
+
+    engineRsa = (we_Rsa *)RSA_get_app_data(rsa);
+    if (engineRsa == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("RSA_get_app_data", engineRsa);
+        ret = 0;
+    }
+
+    if (ret == 1) {
+        we_rsa_key_lock(engineRsa);
+        locked = 1;
+    }
+
+    if (ret == 1 && !engineRsa->pubKeySet) {
+        rc = we_set_public_key((RSA *)rsa, engineRsa);
+        if (rc == 0) {
+            WOLFENGINE_ERROR_FUNC("we_set_public_key", rc);
+            ret = 0;
+        }
+    }
+
+    if (ret == 1 && sigLen != (unsigned int)RSA_size(rsa)) {
+        WOLFENGINE_ERROR_MSG("Invalid signature length");
+        ret = 0;
+    }
+
+    if (ret == 1 && type != NID_md5_sha1) {
+        prefix = we_digest_info_prefix(type, &prefixLen);
+        if (prefix == NULL) {
+            WOLFENGINE_ERROR_MSG("Digest not supported for PKCS #1 v1.5");
+            ret = 0;
+        }
+    }
+
+    if (ret == 1) {
+        ret = we_rsa_pkcs1_verify_key(&engineRsa->key, sigBuf, sigLen, prefix,
+                                      prefixLen, m, mLen);
+    }
+
+    if (locked) {
+        we_rsa_key_unlock(engineRsa);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_verify", ret);
+
+    return ret;
+}
+
+/**
+ * Get the RSA key of a batch item.
+ *
+ * @param  items  [in]  RSA verify items of batch.
+ * @param  idx    [in]  Index of item.
+ * @returns  OpenSSL RSA key or NULL when item doesn't have an RSA key.
+ */
+static const void *we_rsa_batch_get_key(const void *items, size_t idx)
+{
+    const WE_RSA_VERIFY_ITEM *item = &((const WE_RSA_VERIFY_ITEM *)items)[idx];
+    const RSA *rsa = NULL;
+
+    if (item->pkey != NULL && EVP_PKEY_base_id(item->pkey) == EVP_PKEY_RSA) {
+        rsa = EVP_PKEY_get0_RSA(item->pkey);
+    }
+
+    return rsa;
+}
+
+/**
+ * Verify a range of batch entries sorted by key.
+ *
+ * The public key is decoded once for each run of entries with the same key.
+ *
+ * @param  items    [in]   RSA verify items of batch.
+ * @param  entries  [in]   Entries sorted by key.
+ * @param  start    [in]   Index of first entry to verify.
+ * @param  end      [in]   Index after last entry to verify.
+ * @param  ok       [out]  Result of each item - 1 when verified.
+ */
+static void we_rsa_batch_verify_range(const void *items,
+                                      const we_BatchEntry *entries,
+                                      size_t start, size_t end,
+                                      unsigned char *ok)
+{
+    size_t i;
+    const we_BatchEntry *entry;
+    const WE_RSA_VERIFY_ITEM *item;
+    const RSA *rsa = NULL;
+    we_Rsa engineRsa;
+    int keyInited = 0;
+    int keySet = 0;
+    const unsigned char *prefix;
+    size_t prefixLen;
+
+    for (i = start; i < end; i++) {
+        entry = &entries[i];
+        item = &((const WE_RSA_VERIFY_ITEM *)items)[entry->idx];
+
+        if (entry->key != rsa || !keyInited) {
+            /* Decode the public key of the next group. */
+            if (keyInited) {
+                wc_FreeRsaKey(&engineRsa.key);
+                keyInited = 0;
+            }
+            XMEMSET(&engineRsa, 0, sizeof(engineRsa));
+            rsa = (const RSA *)entry->key;
+            keySet = 0;
+            if (wc_InitRsaKey(&engineRsa.key, NULL) == 0) {
+                keyInited = 1;
+                keySet = (rsa != NULL) &&
+                         we_set_public_key((RSA *)rsa, &engineRsa);
+            }
+        }
+        if (keySet) {
+            prefix = NULL;
+            prefixLen = 0;
+            if (item->md != NULL) {
+                prefix = we_digest_info_prefix(EVP_MD_type(item->md),
+                                               &prefixLen);
+            }
+            if (item->md == NULL || prefix != NULL) {
+                ok[entry->idx] = (unsigned char)we_rsa_pkcs1_verify_key(
+                    &engineRsa.key, item->sig, item->sigLen, prefix,
+                    prefixLen, item->digest, item->digestLen);
+            }
+        }
+    }
+
+    if (keyInited) {
+        wc_FreeRsaKey(&engineRsa.key);
+    }
+}
+
+/**
+ * Verify a batch of RSA PKCS #1 v1.5 signatures in parallel.
+ *
+ * Each signature is verified individually. Items are grouped by key so that
+ * each public key is decoded once per run of items on a thread, and the
+ * items are spread over batch->threads threads. See we_batch_verify().
+ *
+ * @param  batch  [in/out]  Batch of signatures to verify and result bitmap.
+ * @returns  1 when the batch was processed and 0 on failure.
+ */
+int we_rsa_batch_verify(WE_RSA_BATCH_VERIFY *batch)
+{
+    int ret = 1;
+
+    WOLFENGINE_ENTER("we_rsa_batch_verify");
+
+    if (batch == NULL || batch->results == NULL ||
+        (batch->items == NULL && batch->cnt > 0)) {
+        WOLFENGINE_ERROR_MSG("Invalid RSA batch verify parameters");
+        ret = 0;
+    }
+
+    if (ret == 1) {
+        ret = we_batch_verify(batch->items, batch->cnt, batch->threads,
+                              we_rsa_batch_get_key, we_rsa_batch_verify_range,
+                              batch->results);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_batch_verify", ret);
+
+    return ret;
+}
+
 /**
  * Initialize the RSA method.
  *
@@ -557,6 +1483,8 @@ int we_init_rsa_meth(void)
         RSA_meth_set_pub_dec(we_rsa_method, we_rsa_pub_dec);
         RSA_meth_set_priv_enc(we_rsa_method, we_rsa_priv_enc);
         RSA_meth_set_priv_dec(we_rsa_method, we_rsa_priv_dec);
+        RSA_meth_set_sign(we_rsa_method, we_rsa_sign);
+        RSA_meth_set_verify(we_rsa_method, we_rsa_verify);
         RSA_meth_set_finish(we_rsa_method, we_rsa_finish);
     }
 
@@ -574,6 +1502,10 @@ int we_init_rsa_meth(void)
 
 /** EVP public key method - RSA using wolfSSL for the implementation. */
 EVP_PKEY_METHOD *we_rsa_pkey_method = NULL;
+#ifdef WE_HAVE_RSA_PSS
+/** EVP public key method - RSA-PSS using wolfSSL for the implementation. */
+EVP_PKEY_METHOD *we_rsa_pss_pkey_method = NULL;
+#endif
 
 /**
  * Initialize and set the data required to complete an RSA operation.
@@ -607,6 +1539,11 @@ static int we_rsa_pkey_init(EVP_PKEY_CTX *ctx)
         EVP_PKEY_CTX_set_data(ctx, rsa);
         rsa->pubExp = DEFAULT_PUB_EXP;
         rsa->bits = DEFAULT_KEY_BITS;
+        rsa->padMode = RSA_PKCS1_PADDING;
+        rsa->saltLen = RSA_PSS_SALTLEN_AUTO;
+#ifdef WE_HAVE_RSA_MULTI_PRIME
+        rsa->primes = 2;
+#endif
     }
 
     if (ret == 0 && rsa != NULL) {
@@ -618,6 +1555,32 @@ static int we_rsa_pkey_init(EVP_PKEY_CTX *ctx)
     return ret;
 }
 
+#ifdef WE_HAVE_RSA_PSS
+/**
+ * Initialize and set the data required to complete an RSA-PSS operation.
+ *
+ * @param  ctx  [in]  Public key context of operation.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_pss_pkey_init(EVP_PKEY_CTX *ctx)
+{
+    int ret;
+    we_Rsa *rsa;
+
+    WOLFENGINE_ENTER("we_rsa_pss_pkey_init");
+
+    ret = we_rsa_pkey_init(ctx);
+    if (ret == 1) {
+        rsa = (we_Rsa *)EVP_PKEY_CTX_get_data(ctx);
+        rsa->padMode = RSA_PKCS1_PSS_PADDING;
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_pss_pkey_init", ret);
+
+    return ret;
+}
+#endif /* WE_HAVE_RSA_PSS */
+
 /**
  * Clean up the RSA operation data.
  *
@@ -631,14 +1594,107 @@ static void we_rsa_pkey_cleanup(EVP_PKEY_CTX *ctx)
 
     if (rsa != NULL) {
         wc_FreeRsaKey(&rsa->key);
+#ifdef WE_HAVE_RSA_MULTI_PRIME
+        we_rsa_multi_prime_free(rsa->multiPrime);
+#endif
+        OPENSSL_free(rsa->label);
         OPENSSL_free(rsa);
         EVP_PKEY_CTX_set_data(ctx, NULL);
     }
 }
 
+#ifdef WOLFSSL_PUBLIC_MP
+/**
+ * Convert a wolfSSL multi-precision number to an OpenSSL BIGNUM.
+ *
+ * @param  mp  [in]  wolfSSL number.
+ * @returns  New OpenSSL number on success and NULL on failure.
+ */
+BIGNUM *we_mp_to_bn(mp_int *mp)
+{
+    BIGNUM *bn = NULL;
+    int rc;
+    int len;
+    unsigned char buf[RSA_MAX_SIZE / 8];
+
+    len = mp_unsigned_bin_size(mp);
+    if (len > (int)sizeof(buf)) {
+        WOLFENGINE_ERROR_MSG("Number too big for RSA key");
+    }
+    else {
+        rc = mp_to_unsigned_bin_len(mp, buf, len);
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_to_unsigned_bin_len", rc);
+        }
+        else {
+            bn = BN_bin2bn(buf, len, NULL);
+            if (bn == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("BN_bin2bn", bn);
+            }
+        }
+    }
+    OPENSSL_cleanse(buf, sizeof(buf));
+
+    return bn;
+}
+
+/**
+ * Copy the decoded key from one wolfSSL RSA key to another.
+ *
+ * @param  dst  [in]  Initialized wolfSSL RSA key to copy into.
+ * @param  src  [in]  wolfSSL RSA key to copy.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_copy_key(RsaKey *dst, RsaKey *src)
+{
+    int ret = 1;
+    int rc;
+
+    WOLFENGINE_ENTER("we_rsa_copy_key");
+
+    rc = mp_copy(&src->n, &dst->n);
+    if (rc == MP_OKAY) {
+        rc = mp_copy(&src->e, &dst->e);
+    }
+    if (rc == MP_OKAY && src->type == RSA_PRIVATE) {
+        rc = mp_copy(&src->d, &dst->d);
+        if (rc == MP_OKAY) {
+            rc = mp_copy(&src->p, &dst->p);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_copy(&src->q, &dst->q);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_copy(&src->dP, &dst->dP);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_copy(&src->dQ, &dst->dQ);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_copy(&src->u, &dst->u);
+        }
+    }
+    if (rc != MP_OKAY) {
+        WOLFENGINE_ERROR_FUNC("mp_copy", rc);
+        ret = 0;
+    }
+    else {
+        dst->type = src->type;
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_copy_key", ret);
+
+    return ret;
+}
+#endif /* WOLFSSL_PUBLIC_MP */
+
 /**
  * Copy the EVP public key method from/to EVP public key contexts.
  *
+ * Settings are copied and the decoded wolfSSL key is duplicated so that the
+ * destination doesn't decode the key again. When wolfSSL's mp API is not
+ * public, the destination decodes the key on first use.
+ *
  * @param  dst  [in]  Destination public key context.
  * @param  src  [in]  Source public key context.
  * @returns  1 on success and 0 on failure.
@@ -650,11 +1706,70 @@ static int we_rsa_pkey_copy(EVP_PKEY_CTX *dst, EVP_PKEY_CTX *src)
 #endif
 {
     int ret = 1;
+    we_Rsa *srcRsa;
+    we_Rsa *dstRsa = NULL;
+#ifdef WOLFSSL_PUBLIC_MP
+    int copyKey = 0;
+#endif
 
-    (void)dst;
-    (void)src;
- 
     WOLFENGINE_ENTER("we_rsa_pkey_copy");
+
+    srcRsa = (we_Rsa *)EVP_PKEY_CTX_get_data((EVP_PKEY_CTX *)src);
+    if (srcRsa == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_CTX_get_data", srcRsa);
+        ret = 0;
+    }
+
+    if (ret == 1) {
+        ret = we_rsa_pkey_init(dst);
+    }
+    if (ret == 1) {
+        dstRsa = (we_Rsa *)EVP_PKEY_CTX_get_data(dst);
+        dstRsa->md = srcRsa->md;
+        dstRsa->mdMGF1 = srcRsa->mdMGF1;
+        dstRsa->oaepMd = srcRsa->oaepMd;
+        dstRsa->padMode = srcRsa->padMode;
+        dstRsa->saltLen = srcRsa->saltLen;
+        dstRsa->pubExp = srcRsa->pubExp;
+        dstRsa->bits = srcRsa->bits;
+#ifdef WE_HAVE_RSA_MULTI_PRIME
+        dstRsa->primes = srcRsa->primes;
+#endif
+        if (srcRsa->label != NULL && srcRsa->labelLen > 0) {
+            dstRsa->label = (unsigned char *)OPENSSL_malloc(srcRsa->labelLen);
+            if (dstRsa->label == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_malloc", dstRsa->label);
+                ret = 0;
+            }
+            else {
+                XMEMCPY(dstRsa->label, srcRsa->label, srcRsa->labelLen);
+                dstRsa->labelLen = srcRsa->labelLen;
+            }
+        }
+    }
+#ifdef WOLFSSL_PUBLIC_MP
+    if (ret == 1) {
+        copyKey = srcRsa->privKeySet || srcRsa->pubKeySet;
+#ifdef WE_HAVE_RSA_MULTI_PRIME
+        /* Additional primes aren't copied - key loaded again on first use. */
+        if (srcRsa->multiPrime != NULL) {
+            copyKey = 0;
+        }
+#endif
+    }
+    if (copyKey) {
+        ret = we_rsa_copy_key(&dstRsa->key, &srcRsa->key);
+        if (ret == 1) {
+            dstRsa->privKeySet = srcRsa->privKeySet;
+            dstRsa->pubKeySet = srcRsa->pubKeySet;
+        }
+    }
+#endif
+
+    if (ret == 0 && dstRsa != NULL) {
+        we_rsa_pkey_cleanup(dst);
+    }
+
     WOLFENGINE_LEAVE("we_rsa_pkey_copy", ret);
 
     return ret;
@@ -665,9 +1780,11 @@ static int we_rsa_pkey_copy(EVP_PKEY_CTX *dst, EVP_PKEY_CTX *src)
  *
  * @param  ctx   [in]  Public key context of operation.
  * @param  pkey  [in]  EVP public key to hold result.
+ * @param  type  [in]  EVP public key type to assign - EVP_PKEY_RSA or
+ *                     EVP_PKEY_RSA_PSS.
  * @returns  1 on success and 0 on failure.
  */
-static int we_rsa_pkey_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY *pkey)
+static int we_rsa_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY *pkey, int type)
 {
     int ret = 1;
     int rc = 0;
@@ -677,7 +1794,7 @@ static int we_rsa_pkey_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY *pkey)
     const unsigned char *p = NULL;
     int derLen = 0;
 
-    WOLFENGINE_ENTER("we_rsa_pkey_keygen");
+    WOLFENGINE_ENTER("we_rsa_keygen");
 
     engineRsa = (we_Rsa *)EVP_PKEY_CTX_get_data(ctx);
     if (engineRsa == NULL) {
@@ -685,58 +1802,87 @@ static int we_rsa_pkey_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY *pkey)
         ret = 0;
     }
 
-    if (ret == 1) {
+#ifdef WE_HAVE_RSA_MULTI_PRIME
+    if (ret == 1 && engineRsa->primes > 2) {
+        /* wolfCrypt only generates two-prime keys. */
+        ret = we_rsa_multi_prime_keygen(engineRsa->bits, engineRsa->primes,
+                                        engineRsa->pubExp, &rsa);
+        if (ret == 0) {
+            WOLFENGINE_ERROR_FUNC("we_rsa_multi_prime_keygen", ret);
+        }
+    }
+#endif
+
+#ifdef WE_HAVE_RSA_KEYGEN_THREADS
+    if (ret == 1 && rsa == NULL) {
+        /* Use primes from the pool when available. */
+        rc = we_rsa_prime_pool_keygen(engineRsa->bits, engineRsa->pubExp,
+                                      &rsa);
+        if (rc == 0) {
+            WOLFENGINE_MSG("Prime pool not used, generating key on demand");
+        }
+    }
+    if (ret == 1 && rsa == NULL) {
+        /* Search for primes on multiple threads when configured. */
+        rc = we_rsa_parallel_keygen(engineRsa->bits, engineRsa->pubExp, &rsa);
+        if (rc == 0) {
+            WOLFENGINE_MSG("Parallel prime search failed, using wolfCrypt");
+        }
+    }
+#endif
+
+    if (ret == 1 && rsa == NULL) {
         rc = wc_MakeRsaKey(&engineRsa->key, engineRsa->bits, engineRsa->pubExp,
                            we_rng);
         if (rc != 0) {
             WOLFENGINE_ERROR_FUNC("wc_MakeRsaKey", rc);
             ret = 0;
         }
-    }
 
-    if (ret == 1) {
-        /* Get required length for DER buffer. */
-        derLen = wc_RsaKeyToDer(&engineRsa->key, NULL, 0);
-        if (derLen <= 0) {
-            WOLFENGINE_ERROR_FUNC("wc_RsaKeyToDer", derLen);
-            ret = 0;
+        if (ret == 1) {
+            /* Get required length for DER buffer. */
+            derLen = wc_RsaKeyToDer(&engineRsa->key, NULL, 0);
+            if (derLen <= 0) {
+                WOLFENGINE_ERROR_FUNC("wc_RsaKeyToDer", derLen);
+                ret = 0;
+            }
         }
-    }
 
-    if (ret == 1) {
-        der = (unsigned char *)OPENSSL_malloc(derLen);
-        if (der == NULL) {
-            WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_malloc", der);
-            ret = 0;
+        if (ret == 1) {
+            der = (unsigned char *)OPENSSL_malloc(derLen);
+            if (der == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_malloc", der);
+                ret = 0;
+            }
         }
-    }
 
-    if (ret == 1) {
-        derLen = wc_RsaKeyToDer(&engineRsa->key, der, derLen);
-        if (derLen <= 0) {
-            WOLFENGINE_ERROR_FUNC("wc_RsaKeyToDer", derLen);
-            ret = 0;
+        if (ret == 1) {
+            derLen = wc_RsaKeyToDer(&engineRsa->key, der, derLen);
+            if (derLen <= 0) {
+                WOLFENGINE_ERROR_FUNC("wc_RsaKeyToDer", derLen);
+                ret = 0;
+            }
         }
-    }
 
-    if (ret == 1) {
-        /*
-         * The pointer passed to d2i_RSAPrivateKey will get advanced to the
-         * end of the buffer, so we save the original pointer in order to free
-         * the buffer later.
-         */
-        p = (const unsigned char *)der;
-        rsa = d2i_RSAPrivateKey(NULL, &p, derLen);
-        if (rsa == NULL) {
-            WOLFENGINE_ERROR_FUNC_NULL("d2i_RSAPrivateKey", rsa);
-            ret = 0;
+        if (ret == 1) {
+            /*
+             * The pointer passed to d2i_RSAPrivateKey will get advanced to the
+             * end of the buffer, so we save the original pointer in order to free
+             * the buffer later.
+             */
+            p = (const unsigned char *)der;
+            rsa = d2i_RSAPrivateKey(NULL, &p, derLen);
+            if (rsa == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("d2i_RSAPrivateKey", rsa);
+                ret = 0;
+            }
         }
     }
 
     if (ret == 1) {
-        ret = EVP_PKEY_assign_RSA(pkey, rsa);
+        ret = EVP_PKEY_assign(pkey, type, rsa);
         if (ret == 0) {
-            WOLFENGINE_ERROR_FUNC("EVP_PKEY_assign_RSA", ret);
+            WOLFENGINE_ERROR_FUNC("EVP_PKEY_assign", ret);
         }
     }
 
@@ -747,14 +1893,45 @@ static int we_rsa_pkey_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY *pkey)
         RSA_free(rsa);
     }
 
-    WOLFENGINE_LEAVE("we_rsa_pkey_keygen", ret);
+    WOLFENGINE_LEAVE("we_rsa_keygen", ret);
 
     return ret;
 }
 
+/**
+ * Generate an RSA key.
+ *
+ * @param  ctx   [in]  Public key context of operation.
+ * @param  pkey  [in]  EVP public key to hold result.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_pkey_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY *pkey)
+{
+    return we_rsa_keygen(ctx, pkey, EVP_PKEY_RSA);
+}
+
+#ifdef WE_HAVE_RSA_PSS
+/**
+ * Generate an RSA key restricted to PSS signatures.
+ *
+ * @param  ctx   [in]  Public key context of operation.
+ * @param  pkey  [in]  EVP public key to hold result.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_pss_pkey_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY *pkey)
+{
+    return we_rsa_keygen(ctx, pkey, EVP_PKEY_RSA_PSS);
+}
+#endif /* WE_HAVE_RSA_PSS */
+
 /**
  * Extra operations for working with RSA.
  * Supported operations include:
+ *  - EVP_PKEY_CTRL_RSA_PADDING: set the padding mode.
+ *  - EVP_PKEY_CTRL_RSA_PSS_SALTLEN: set the PSS salt length.
+ *  - EVP_PKEY_CTRL_RSA_MGF1_MD: set the digest used with MGF1.
+ *  - EVP_PKEY_CTRL_RSA_OAEP_MD: set the digest used with OAEP.
+ *  - EVP_PKEY_CTRL_RSA_OAEP_LABEL: set the OAEP label (takes ownership).
  *  - EVP_PKEY_CTRL_MD: set the method used when digesting.
  *
  * @param  ctx   [in]  Public key context of operation.
@@ -781,12 +1958,116 @@ static int we_rsa_pkey_ctrl(EVP_PKEY_CTX *ctx, int type, int num, void *ptr)
     if (ret == 1) {
         switch (type) {
             case EVP_PKEY_CTRL_RSA_PADDING:
-                /* TODO: Make sign/verify use padding mode. */
-                rsa->padMode = num;
+                switch (num) {
+                    case RSA_PKCS1_PADDING:
+                    case RSA_PKCS1_OAEP_PADDING:
+                    case RSA_NO_PADDING:
+#ifdef WE_HAVE_RSA_PSS
+                    case RSA_PKCS1_PSS_PADDING:
+#endif
+                        rsa->padMode = num;
+                        break;
+                    default:
+                        WOLFENGINE_ERROR_MSG("Unsupported RSA padding mode.");
+                        ret = 0;
+                        break;
+                }
                 break;
             case EVP_PKEY_CTRL_GET_RSA_PADDING:
                 *(int *)ptr = rsa->padMode;
                 break;
+#ifdef WE_HAVE_RSA_PSS
+            case EVP_PKEY_CTRL_RSA_PSS_SALTLEN:
+                if (rsa->padMode != RSA_PKCS1_PSS_PADDING) {
+                    WOLFENGINE_ERROR_MSG("Salt length requires PSS padding.");
+                    ret = 0;
+                }
+                else if (num < RSA_PSS_SALTLEN_MAX) {
+                    WOLFENGINE_ERROR_MSG("Invalid PSS salt length.");
+                    ret = 0;
+                }
+                else {
+                    rsa->saltLen = num;
+                }
+                break;
+            case EVP_PKEY_CTRL_GET_RSA_PSS_SALTLEN:
+                if (rsa->padMode != RSA_PKCS1_PSS_PADDING) {
+                    WOLFENGINE_ERROR_MSG("Salt length requires PSS padding.");
+                    ret = 0;
+                }
+                else {
+                    *(int *)ptr = rsa->saltLen;
+                }
+                break;
+#endif /* WE_HAVE_RSA_PSS */
+            case EVP_PKEY_CTRL_RSA_MGF1_MD:
+                if (rsa->padMode != RSA_PKCS1_PSS_PADDING &&
+                    rsa->padMode != RSA_PKCS1_OAEP_PADDING) {
+                    WOLFENGINE_ERROR_MSG("MGF1 digest requires PSS or OAEP "
+                                         "padding.");
+                    ret = 0;
+                }
+                else {
+                    rsa->mdMGF1 = (EVP_MD*)ptr;
+                }
+                break;
+            case EVP_PKEY_CTRL_GET_RSA_MGF1_MD:
+                /* MGF1 uses the signature or OAEP digest unless set
+                   explicitly. */
+                if (rsa->mdMGF1 != NULL) {
+                    *(EVP_MD **)ptr = rsa->mdMGF1;
+                }
+                else if (rsa->padMode == RSA_PKCS1_OAEP_PADDING) {
+                    *(EVP_MD **)ptr = (rsa->oaepMd != NULL) ? rsa->oaepMd :
+                                      (EVP_MD *)EVP_sha1();
+                }
+                else {
+                    *(EVP_MD **)ptr = rsa->md;
+                }
+                break;
+            case EVP_PKEY_CTRL_RSA_OAEP_MD:
+                if (rsa->padMode != RSA_PKCS1_OAEP_PADDING) {
+                    WOLFENGINE_ERROR_MSG("OAEP digest requires OAEP padding.");
+                    ret = 0;
+                }
+                else {
+                    rsa->oaepMd = (EVP_MD*)ptr;
+                }
+                break;
+            case EVP_PKEY_CTRL_GET_RSA_OAEP_MD:
+                if (rsa->padMode != RSA_PKCS1_OAEP_PADDING) {
+                    WOLFENGINE_ERROR_MSG("OAEP digest requires OAEP padding.");
+                    ret = 0;
+                }
+                else if (rsa->oaepMd != NULL) {
+                    *(EVP_MD **)ptr = rsa->oaepMd;
+                }
+                else {
+                    *(EVP_MD **)ptr = (EVP_MD *)EVP_sha1();
+                }
+                break;
+            case EVP_PKEY_CTRL_RSA_OAEP_LABEL:
+                if (rsa->padMode != RSA_PKCS1_OAEP_PADDING) {
+                    WOLFENGINE_ERROR_MSG("OAEP label requires OAEP padding.");
+                    ret = 0;
+                }
+                else {
+                    /* Take ownership of label - free any previous one. */
+                    OPENSSL_free(rsa->label);
+                    rsa->label = (unsigned char *)ptr;
+                    rsa->labelLen = (ptr != NULL) ? num : 0;
+                }
+                break;
+            case EVP_PKEY_CTRL_GET_RSA_OAEP_LABEL:
+                if (rsa->padMode != RSA_PKCS1_OAEP_PADDING) {
+                    WOLFENGINE_ERROR_MSG("OAEP label requires OAEP padding.");
+                    ret = 0;
+                }
+                else {
+                    *(unsigned char **)ptr = rsa->label;
+                    ret = rsa->labelLen;
+                }
+                break;
             case EVP_PKEY_CTRL_MD:
                 rsa->md = (EVP_MD*)ptr;
                 break;
@@ -797,9 +2078,21 @@ static int we_rsa_pkey_ctrl(EVP_PKEY_CTX *ctx, int type, int num, void *ptr)
                 break;
 #if OPENSSL_VERSION_NUMBER >= 0x1010100fL
             case EVP_PKEY_CTRL_RSA_KEYGEN_PRIMES:
+#ifdef WE_HAVE_RSA_MULTI_PRIME
+                /* Checked against key size when generating. */
+                if (num < 2 || num > WE_RSA_MAX_PRIMES) {
+                    WOLFENGINE_ERROR_MSG("Number of RSA primes not in range.");
+                    ret = 0;
+                }
+                else {
+                    rsa->primes = num;
+                    ret = 1;
+                }
+#else
                 /* wolfCrypt can only do key generation with 2 primes. */
                 WOLFENGINE_ERROR_MSG("wolfCrypt does not support multi-prime RSA.");
                 ret = 0;
+#endif
                 break;
 #endif
             case EVP_PKEY_CTRL_RSA_KEYGEN_BITS:
@@ -839,48 +2132,274 @@ static int we_rsa_pkey_ctrl(EVP_PKEY_CTX *ctx, int type, int num, void *ptr)
 }
 
 /**
- * Encode a digest in DER format.
+ * Get the wolfCrypt MGF1 identifier for a wolfCrypt hash type.
  *
- * @param  md            [in]   EVP_MD structure containing the hash type.
- * @param  digest        [in]   Buffer holding the digest.
- * @param  digestLen     [in]   Length of digest buffer.
- * @param  encodedDigest [out]  Buffer containing encoded digest. If NULL,
-                                memory will be allocated and caller must free.
- * @returns Length of encoded digest on success and 0 on failure.
+ * @param  hashType  [in]  wolfCrypt hash type.
+ * @returns  MGF1 identifier on success and WC_MGF1NONE when not supported.
+ */
+static int we_mgf1_from_hash_type(int hashType)
+{
+    int mgf;
+
+    switch (hashType) {
+        case WC_HASH_TYPE_SHA:
+            mgf = WC_MGF1SHA1;
+            break;
+        case WC_HASH_TYPE_SHA224:
+            mgf = WC_MGF1SHA224;
+            break;
+        case WC_HASH_TYPE_SHA256:
+            mgf = WC_MGF1SHA256;
+            break;
+        case WC_HASH_TYPE_SHA384:
+            mgf = WC_MGF1SHA384;
+            break;
+        case WC_HASH_TYPE_SHA512:
+            mgf = WC_MGF1SHA512;
+            break;
+        default:
+            mgf = WC_MGF1NONE;
+            break;
+    }
+
+    return mgf;
+}
+
+#ifdef WE_HAVE_RSA_PSS
+/**
+ * Get the wolfCrypt parameters for a PSS operation.
+ *
+ * OpenSSL's special salt length values are converted to wolfCrypt's. Salts
+ * longer than the digest need wolfSSL built with WOLFSSL_PSS_LONG_SALT and
+ * recovering the salt length on verify needs WOLFSSL_PSS_SALT_LEN_DISCOVER.
+ *
+ * @param  rsa       [in]   wolfEngine RSA object.
+ * @param  sign      [in]   1 when signing and 0 when verifying.
+ * @param  hashType  [out]  wolfCrypt hash type of digest.
+ * @param  mgf       [out]  wolfCrypt MGF1 identifier.
+ * @param  saltLen   [out]  Salt length to pass to wolfCrypt.
+ * @returns  1 on success and 0 on failure.
  */
-static int we_der_encode_digest(const EVP_MD *md, const unsigned char *digest,
-                                size_t digestLen, unsigned char **encodedDigest)
+static int we_rsa_pss_params(we_Rsa *rsa, int sign, int *hashType, int *mgf,
+                             int *saltLen)
 {
     int ret = 1;
-    int hashOID = 0;
+    const EVP_MD *mdMGF1;
 
-    WOLFENGINE_ENTER("we_der_encode_digest");
+    WOLFENGINE_ENTER("we_rsa_pss_params");
+
+    if (rsa->md == NULL) {
+        WOLFENGINE_ERROR_MSG("PSS padding requires a digest.");
+        ret = 0;
+    }
 
-    if (*encodedDigest == NULL) {
-        *encodedDigest = (unsigned char *)OPENSSL_malloc(MAX_DER_DIGEST_SZ);
-        if (*encodedDigest == NULL) {
-            WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_malloc", *encodedDigest);
+    if (ret == 1) {
+        *hashType = we_nid_to_wc_hash_type(EVP_MD_type(rsa->md));
+        if (*hashType == WC_HASH_TYPE_NONE) {
+            WOLFENGINE_ERROR_FUNC("we_nid_to_wc_hash_type", *hashType);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        mdMGF1 = (rsa->mdMGF1 != NULL) ? rsa->mdMGF1 : rsa->md;
+        *mgf = we_mgf1_from_hash_type(
+            we_nid_to_wc_hash_type(EVP_MD_type(mdMGF1)));
+        if (*mgf == WC_MGF1NONE) {
+            WOLFENGINE_ERROR_MSG("Unsupported MGF1 digest.");
             ret = 0;
         }
     }
 
     if (ret == 1) {
-        hashOID = we_nid_to_wc_hash_oid(EVP_MD_type(md));
-        if (hashOID <= 0) {
-            WOLFENGINE_ERROR_FUNC("we_nid_to_wc_hash_oid", hashOID);
+        switch (rsa->saltLen) {
+            case RSA_PSS_SALTLEN_DIGEST:
+                *saltLen = RSA_PSS_SALT_LEN_DEFAULT;
+                break;
+            case RSA_PSS_SALTLEN_AUTO:
+                if (!sign) {
+            #ifdef WOLFSSL_PSS_SALT_LEN_DISCOVER
+                    *saltLen = RSA_PSS_SALT_LEN_DISCOVER;
+            #else
+                    *saltLen = RSA_PSS_SALT_LEN_DEFAULT;
+            #endif
+                    break;
+                }
+            #ifndef WOLFSSL_PSS_LONG_SALT
+                /* Any salt length is valid - use the digest length. */
+                *saltLen = RSA_PSS_SALT_LEN_DEFAULT;
+                break;
+            #endif
+                /* fall-through */
+            case RSA_PSS_SALTLEN_MAX:
+            #ifdef WOLFSSL_PSS_LONG_SALT
+                *saltLen = wc_RsaEncryptSize(&rsa->key) - EVP_MD_size(rsa->md)
+                           - 2;
+            #else
+                WOLFENGINE_ERROR_MSG("Maximum PSS salt length not supported.");
+                ret = 0;
+            #endif
+                break;
+            default:
+                *saltLen = rsa->saltLen;
+                break;
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_pss_params", ret);
+
+    return ret;
+}
+
+/**
+ * Sign a digest with a private RSA key using PSS padding.
+ *
+ * @param  rsa     [in]      wolfEngine RSA object with private key set.
+ * @param  sig     [in]      Buffer to hold signature data.
+ * @param  sigLen  [in/out]  Length of signature buffer.
+ * @param  tbs     [in]      Digest to sign.
+ * @param  tbsLen  [in]      Length of digest.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_pss_sign(we_Rsa *rsa, unsigned char *sig, size_t *sigLen,
+                           const unsigned char *tbs, size_t tbsLen)
+{
+    int ret;
+    int rc;
+    int hashType = WC_HASH_TYPE_NONE;
+    int mgf = WC_MGF1NONE;
+    int saltLen = 0;
+
+    WOLFENGINE_ENTER("we_rsa_pss_sign");
+
+    ret = we_rsa_check_two_prime(rsa);
+    if (ret == 1) {
+        ret = we_rsa_pss_params(rsa, 1, &hashType, &mgf, &saltLen);
+    }
+    if (ret == 1) {
+        rc = wc_RsaPSS_Sign_ex(tbs, (word32)tbsLen, sig, (word32)*sigLen,
+                               (enum wc_HashType)hashType, mgf, saltLen,
+                               &rsa->key, we_rng);
+        if (rc <= 0) {
+            WOLFENGINE_ERROR_FUNC("wc_RsaPSS_Sign_ex", rc);
             ret = 0;
         }
+        else {
+            *sigLen = rc;
+        }
     }
 
+    WOLFENGINE_LEAVE("we_rsa_pss_sign", ret);
+
+    return ret;
+}
+
+/**
+ * Verify a PSS signature with a public RSA key.
+ *
+ * @param  rsa     [in]  wolfEngine RSA object with public key set.
+ * @param  sig     [in]  Signature data.
+ * @param  sigLen  [in]  Length of signature data.
+ * @param  tbs     [in]  Digest that was signed.
+ * @param  tbsLen  [in]  Length of digest.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_pss_verify(we_Rsa *rsa, const unsigned char *sig,
+                             size_t sigLen, const unsigned char *tbs,
+                             size_t tbsLen)
+{
+    int ret;
+    int rc;
+    int hashType = WC_HASH_TYPE_NONE;
+    int mgf = WC_MGF1NONE;
+    int saltLen = 0;
+    unsigned char *decryptedSig = NULL;
+
+    WOLFENGINE_ENTER("we_rsa_pss_verify");
+
+    ret = we_rsa_pss_params(rsa, 0, &hashType, &mgf, &saltLen);
     if (ret == 1) {
-        ret = wc_EncodeSignature(*encodedDigest, digest, (word32)digestLen,
-                                 hashOID);
-        if (ret == 0) {
-            WOLFENGINE_ERROR_FUNC("wc_EncodeSignature", ret);
+        decryptedSig = (unsigned char *)OPENSSL_malloc(sigLen);
+        if (decryptedSig == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_malloc", decryptedSig);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        rc = wc_RsaPSS_Verify_ex((byte *)sig, (word32)sigLen, decryptedSig,
+                                 (word32)sigLen, (enum wc_HashType)hashType,
+                                 mgf, saltLen, &rsa->key);
+        if (rc <= 0) {
+            WOLFENGINE_ERROR_FUNC("wc_RsaPSS_Verify_ex", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* Check the salted hash in the signature matches the digest. */
+        rc = wc_RsaPSS_CheckPadding_ex(tbs, (word32)tbsLen, decryptedSig,
+                                       (word32)rc, (enum wc_HashType)hashType,
+                                       saltLen,
+                                       wc_RsaEncryptSize(&rsa->key) * 8);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_RsaPSS_CheckPadding_ex", rc);
+            ret = 0;
         }
     }
 
-    WOLFENGINE_LEAVE("we_der_encode_digest", ret);
+    if (decryptedSig != NULL) {
+        OPENSSL_free(decryptedSig);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_pss_verify", ret);
+
+    return ret;
+}
+#endif /* WE_HAVE_RSA_PSS */
+
+/**
+ * Set the key from the EVP_PKEY into the wolfEngine RSA object when not
+ * already set.
+ *
+ * @param  ctx   [in]  Public key context of operation.
+ * @param  rsa   [in]  wolfEngine RSA object.
+ * @param  priv  [in]  1 to set the private key and 0 for the public key.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_pkey_set_key(EVP_PKEY_CTX *ctx, we_Rsa *rsa, int priv)
+{
+    int ret = 1;
+    EVP_PKEY *pkey = NULL;
+    RSA *rsaKey = NULL;
+
+    WOLFENGINE_ENTER("we_rsa_pkey_set_key");
+
+    if ((priv && !rsa->privKeySet) || (!priv && !rsa->pubKeySet)) {
+        pkey = EVP_PKEY_CTX_get0_pkey(ctx);
+        if (pkey == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_CTX_get0_pkey", pkey);
+            ret = 0;
+        }
+        if (ret == 1) {
+            rsaKey = (RSA*)EVP_PKEY_get0_RSA(pkey);
+            if (rsaKey == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_get0_RSA", rsaKey);
+                ret = 0;
+            }
+        }
+        if (ret == 1 && priv) {
+            ret = we_set_private_key(rsaKey, rsa);
+            if (ret == 0) {
+                WOLFENGINE_ERROR_FUNC("we_set_private_key", ret);
+            }
+        }
+        else if (ret == 1) {
+            ret = we_set_public_key(rsaKey, rsa);
+            if (ret == 0) {
+                WOLFENGINE_ERROR_FUNC("we_set_public_key", ret);
+            }
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_pkey_set_key", ret);
 
     return ret;
 }
@@ -902,12 +2421,14 @@ static int we_rsa_pkey_sign(EVP_PKEY_CTX *ctx, unsigned char *sig,
 {
     int ret = 1;
     we_Rsa *rsa = NULL;
-    EVP_PKEY *pkey = NULL;
-    RSA *rsaKey = NULL;
-    unsigned char *encodedDigest = NULL;
+    unsigned char encodedDigest[MAX_DIGEST_INFO_SZ];
     int encodedDigestLen = 0;
     int len;
     int actualSigLen = 0;
+#ifdef WE_HAVE_KEYD
+    const RSA *rsaKey = NULL;
+#endif
+    const char *keyId = NULL;
 
     WOLFENGINE_ENTER("we_rsa_pkey_sign");
 
@@ -917,29 +2438,30 @@ static int we_rsa_pkey_sign(EVP_PKEY_CTX *ctx, unsigned char *sig,
         ret = 0;
     }
 
-    /* Set up private key */
-    if (ret == 1 && !rsa->privKeySet) {
-        pkey = EVP_PKEY_CTX_get0_pkey(ctx);
-        if (pkey == NULL) {
-            WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_CTX_get0_pkey", pkey);
-            ret = 0;
-        }
-        if (ret == 1) {
-            rsaKey = (RSA*)EVP_PKEY_get0_RSA(pkey);
-            if (rsaKey == NULL) {
-                WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_get0_RSA", rsaKey);
-                ret = 0;
-            }
+#ifdef WE_HAVE_KEYD
+    if (ret == 1 && EVP_PKEY_CTX_get0_pkey(ctx) != NULL) {
+        /* Private key may be held by the key daemon. */
+        rsaKey = EVP_PKEY_get0_RSA(EVP_PKEY_CTX_get0_pkey(ctx));
+        keyId = we_keyd_rsa_key_id(rsaKey);
+    }
+    if (ret == 1 && keyId != NULL) {
+        if (sig == NULL) {
+            /* Return signature size in bytes. */
+            *sigLen = RSA_size(rsaKey);
         }
-        if (ret == 1) {
-            ret = we_set_private_key(rsaKey, rsa);
-            if (ret == 0) {
-                WOLFENGINE_ERROR_FUNC("we_set_private_key", ret);
-            }
+        else {
+            ret = we_keyd_rsa_sign(keyId, rsa->padMode, rsa->md, rsa->mdMGF1,
+                                   rsa->saltLen, tbs, tbsLen, sig, sigLen);
         }
     }
+#endif
 
-    if (ret == 1) {
+    /* Set up private key */
+    if (ret == 1 && keyId == NULL) {
+        ret = we_rsa_pkey_set_key(ctx, rsa, 1);
+    }
+
+    if (ret == 1 && keyId == NULL) {
         if (sig == NULL) {
             len = wc_SignatureGetSize(WC_SIGNATURE_TYPE_RSA, &rsa->key,
                                       sizeof(rsa->key));
@@ -952,12 +2474,18 @@ static int we_rsa_pkey_sign(EVP_PKEY_CTX *ctx, unsigned char *sig,
                 *sigLen = len;
             }
         }
+#ifdef WE_HAVE_RSA_PSS
+        else if (rsa->padMode == RSA_PKCS1_PSS_PADDING) {
+            ret = we_rsa_pss_sign(rsa, sig, sigLen, tbs, tbsLen);
+        }
+#endif
         else {
             if (rsa->md != NULL) {
                 /* In this case, OpenSSL expects a proper PKCS #1 v1.5
                    signature. */
-                encodedDigestLen = we_der_encode_digest(rsa->md, tbs, tbsLen,
-                                                        &encodedDigest);
+                encodedDigestLen = we_der_encode_digest(EVP_MD_type(rsa->md),
+                                                        tbs, tbsLen,
+                                                        encodedDigest);
                 if (encodedDigestLen == 0) {
                     WOLFENGINE_ERROR_FUNC("we_der_encode_digest",
                                           encodedDigestLen);
@@ -969,11 +2497,11 @@ static int we_rsa_pkey_sign(EVP_PKEY_CTX *ctx, unsigned char *sig,
                 }
             }
             if (ret == 1) {
-                actualSigLen = wc_RsaSSL_Sign(tbs, (word32)tbsLen, sig,
-                                              (word32)*sigLen, &rsa->key,
-                                              we_rng);
+                actualSigLen = we_rsa_pkcs1_sign(rsa, tbs,
+                                                 (word32)tbsLen, sig,
+                                                 (word32)*sigLen);
                 if (actualSigLen <= 0) {
-                    WOLFENGINE_ERROR_FUNC("wc_RsaSSL_Sign", actualSigLen);
+                    WOLFENGINE_ERROR_FUNC("we_rsa_pkcs1_sign", actualSigLen);
                     ret = 0;
                 }
                 else {
@@ -983,11 +2511,50 @@ static int we_rsa_pkey_sign(EVP_PKEY_CTX *ctx, unsigned char *sig,
         }
     }
 
-    if (encodedDigest != NULL) {
-        OPENSSL_free(encodedDigest);
+    WOLFENGINE_LEAVE("we_rsa_pkey_sign", ret);
+
+    return ret;
+}
+
+/**
+ * Verify a PKCS #1 v1.5 signature with a public RSA key.
+ *
+ * When a digest is set, the DigestInfo prefix and digest are compared in place
+ * against the recovered data.
+ *
+ * @param  rsa     [in]  wolfEngine RSA object with public key set.
+ * @param  sig     [in]  Signature data.
+ * @param  sigLen  [in]  Length of signature data.
+ * @param  tbs     [in]  To Be Signed data.
+ * @param  tbsLen  [in]  Length of To Be Signed data.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_pkcs1_verify(we_Rsa *rsa, const unsigned char *sig,
+                               size_t sigLen, const unsigned char *tbs,
+                               size_t tbsLen)
+{
+    int ret = 1;
+    const unsigned char *prefix = NULL;
+    size_t prefixLen = 0;
+
+    WOLFENGINE_ENTER("we_rsa_pkcs1_verify");
+
+    if (rsa->md != NULL) {
+        /* In this case, we have a proper DER-encoded signature, not just
+           arbitrary signed data, so we must compare with the DigestInfo. */
+        prefix = we_digest_info_prefix(EVP_MD_type(rsa->md), &prefixLen);
+        if (prefix == NULL) {
+            WOLFENGINE_ERROR_MSG("Digest not supported for PKCS #1 v1.5");
+            ret = 0;
+        }
     }
 
-    WOLFENGINE_LEAVE("we_rsa_pkey_sign", ret);
+    if (ret == 1) {
+        ret = we_rsa_pkcs1_verify_key(&rsa->key, sig, sigLen, prefix,
+                                      prefixLen, tbs, tbsLen);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_pkcs1_verify", ret);
 
     return ret;
 }
@@ -1007,13 +2574,7 @@ static int we_rsa_pkey_verify(EVP_PKEY_CTX *ctx, const unsigned char *sig,
                          size_t tbsLen)
 {
     int ret = 1;
-    int rc = 0;
     we_Rsa *rsa = NULL;
-    EVP_PKEY *pkey = NULL;
-    RSA *rsaKey = NULL;
-    unsigned char *decryptedSig = NULL;
-    unsigned char *encodedDigest = NULL;
-    int encodedDigestLen = 0;
 
     WOLFENGINE_ENTER("we_rsa_pkey_verify");
 
@@ -1024,76 +2585,253 @@ static int we_rsa_pkey_verify(EVP_PKEY_CTX *ctx, const unsigned char *sig,
     }
 
     /* Set up public key */
-    if (ret == 1 && !rsa->pubKeySet) {
-        pkey = EVP_PKEY_CTX_get0_pkey(ctx);
-        if (pkey == NULL) {
-            WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_CTX_get0_pkey", pkey);
-            ret = 0;
-        }
-        if (ret == 1) {
-            rsaKey = (RSA*)EVP_PKEY_get0_RSA(pkey);
-            if (rsaKey == NULL) {
-                WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_get0_RSA", rsaKey);
-                ret = 0;
-            }
-        }
-        if (ret == 1) {
-            ret = we_set_public_key(rsaKey, rsa);
-            if (ret == 0) {
-                WOLFENGINE_ERROR_FUNC("we_set_public_key", ret);
-            }
+    if (ret == 1) {
+        ret = we_rsa_pkey_set_key(ctx, rsa, 0);
+    }
+
+    if (ret == 1) {
+        switch (rsa->padMode) {
+#ifdef WE_HAVE_RSA_PSS
+            case RSA_PKCS1_PSS_PADDING:
+                ret = we_rsa_pss_verify(rsa, sig, sigLen, tbs, tbsLen);
+                break;
+#endif
+            default:
+                ret = we_rsa_pkcs1_verify(rsa, sig, sigLen, tbs, tbsLen);
+                break;
         }
     }
 
+    WOLFENGINE_LEAVE("we_rsa_pkey_verify", ret);
+
+    return ret;
+}
+
+/**
+ * Get the wolfCrypt parameters for an OAEP operation.
+ *
+ * The OAEP digest defaults to SHA-1 and MGF1 defaults to the OAEP digest.
+ *
+ * @param  rsa       [in]   wolfEngine RSA object.
+ * @param  hashType  [out]  wolfCrypt hash type of OAEP digest.
+ * @param  mgf       [out]  wolfCrypt MGF1 identifier.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_oaep_params(we_Rsa *rsa, int *hashType, int *mgf)
+{
+    int ret = 1;
+    const EVP_MD *md;
+    const EVP_MD *mdMGF1;
+
+    WOLFENGINE_ENTER("we_rsa_oaep_params");
+
+    md = (rsa->oaepMd != NULL) ? rsa->oaepMd : EVP_sha1();
+    mdMGF1 = (rsa->mdMGF1 != NULL) ? rsa->mdMGF1 : md;
+
+    *hashType = we_nid_to_wc_hash_type(EVP_MD_type(md));
+    if (*hashType == WC_HASH_TYPE_NONE) {
+        WOLFENGINE_ERROR_MSG("Unsupported OAEP digest.");
+        ret = 0;
+    }
     if (ret == 1) {
-        decryptedSig = (unsigned char *)OPENSSL_malloc(MAX_DER_DIGEST_SZ);
-        if (decryptedSig == NULL) {
-            WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_malloc", decryptedSig);
+        *mgf = we_mgf1_from_hash_type(
+            we_nid_to_wc_hash_type(EVP_MD_type(mdMGF1)));
+        if (*mgf == WC_MGF1NONE) {
+            WOLFENGINE_ERROR_MSG("Unsupported MGF1 digest.");
             ret = 0;
         }
     }
 
+    WOLFENGINE_LEAVE("we_rsa_oaep_params", ret);
+
+    return ret;
+}
+
+/**
+ * Encrypt data with a public RSA key.
+ *
+ * @param  ctx     [in]      Public key context of operation.
+ * @param  out     [out]     Buffer to hold ciphertext.
+ *                           NULL indicates length of ciphertext requested.
+ * @param  outLen  [in/out]  Length of ciphertext buffer.
+ * @param  in      [in]      Plaintext to encrypt.
+ * @param  inLen   [in]      Length of plaintext.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_pkey_encrypt(EVP_PKEY_CTX *ctx, unsigned char *out,
+                               size_t *outLen, const unsigned char *in,
+                               size_t inLen)
+{
+    int ret = 1;
+    int rc = 0;
+    we_Rsa *rsa = NULL;
+    int hashType = WC_HASH_TYPE_NONE;
+    int mgf = WC_MGF1NONE;
+
+    WOLFENGINE_ENTER("we_rsa_pkey_encrypt");
+
+    rsa = (we_Rsa *)EVP_PKEY_CTX_get_data(ctx);
+    if (rsa == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_CTX_get_data", rsa);
+        ret = 0;
+    }
+
+    /* Set up public key */
     if (ret == 1) {
-        rc = wc_RsaSSL_Verify(sig, (word32)sigLen, decryptedSig,
-                               (word32)sigLen, &rsa->key);
+        ret = we_rsa_pkey_set_key(ctx, rsa, 0);
+    }
+
+    if (ret == 1 && out == NULL) {
+        rc = wc_RsaEncryptSize(&rsa->key);
         if (rc <= 0) {
-            WOLFENGINE_ERROR_FUNC("wc_RsaSSL_Verify", rc);
+            WOLFENGINE_ERROR_FUNC("wc_RsaEncryptSize", rc);
             ret = 0;
         }
-        if (ret == 1) {
-            if (rsa->md != NULL) {
-                /* In this case, we have a proper DER-encoded signature, not
-                   just arbitrary signed data, so we must compare with the
-                   encoded digest. */
-                encodedDigestLen = we_der_encode_digest(rsa->md, tbs, tbsLen,
-                                                        &encodedDigest);
-                if (encodedDigestLen == 0) {
-                    WOLFENGINE_ERROR_FUNC("we_der_encode_digest",
-                                          (int)encodedDigestLen);
-                    ret = 0;
-                }
-                else {
-                    tbs = encodedDigest;
-                    tbsLen = encodedDigestLen;
+        else {
+            /* Return ciphertext size in bytes. */
+            *outLen = rc;
+        }
+    }
+    else if (ret == 1) {
+        switch (rsa->padMode) {
+            case RSA_PKCS1_PADDING:
+                /* PKCS 1 v1.5 padding using block type 2. */
+                rc = wc_RsaPublicEncrypt(in, (word32)inLen, out,
+                                         (word32)*outLen, &rsa->key, we_rng);
+                break;
+            case RSA_PKCS1_OAEP_PADDING:
+                ret = we_rsa_oaep_params(rsa, &hashType, &mgf);
+                if (ret == 1) {
+                    rc = wc_RsaPublicEncrypt_ex(in, (word32)inLen, out,
+                                                (word32)*outLen, &rsa->key,
+                                                we_rng, WC_RSA_OAEP_PAD,
+                                                (enum wc_HashType)hashType, mgf,
+                                                rsa->label, rsa->labelLen);
                 }
-            }
-
-            rc = XMEMCMP(tbs, decryptedSig, tbsLen);
-            if (rc != 0) {
-                WOLFENGINE_ERROR_FUNC("XMEMCMP", rc);
+                break;
+            case RSA_NO_PADDING:
+                rc = wc_RsaPublicEncrypt_ex(in, (word32)inLen, out,
+                                            (word32)*outLen, &rsa->key, we_rng,
+                                            WC_RSA_NO_PAD, WC_HASH_TYPE_NONE, 0,
+                                            NULL, 0);
+                break;
+            default:
+                WOLFENGINE_ERROR_MSG("we_rsa_pkey_encrypt: unknown padding");
                 ret = 0;
-            }
+                break;
+        }
+        if (ret == 1 && rc < 0) {
+            WOLFENGINE_ERROR_FUNC("wc_RsaPublicEncrypt", rc);
+            ret = 0;
+        }
+        else if (ret == 1) {
+            *outLen = rc;
         }
     }
 
-    if (decryptedSig != NULL) {
-        OPENSSL_free(decryptedSig);
+    WOLFENGINE_LEAVE("we_rsa_pkey_encrypt", ret);
+
+    return ret;
+}
+
+/**
+ * Decrypt data with a private RSA key.
+ *
+ * @param  ctx     [in]      Public key context of operation.
+ * @param  out     [out]     Buffer to hold plaintext.
+ *                           NULL indicates length of plaintext requested.
+ * @param  outLen  [in/out]  Length of plaintext buffer.
+ * @param  in      [in]      Ciphertext to decrypt.
+ * @param  inLen   [in]      Length of ciphertext.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_pkey_decrypt(EVP_PKEY_CTX *ctx, unsigned char *out,
+                               size_t *outLen, const unsigned char *in,
+                               size_t inLen)
+{
+    int ret = 1;
+    int rc = 0;
+    we_Rsa *rsa = NULL;
+    int hashType = WC_HASH_TYPE_NONE;
+    int mgf = WC_MGF1NONE;
+
+    WOLFENGINE_ENTER("we_rsa_pkey_decrypt");
+
+    rsa = (we_Rsa *)EVP_PKEY_CTX_get_data(ctx);
+    if (rsa == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_CTX_get_data", rsa);
+        ret = 0;
+    }
+
+    /* Set up private key */
+    if (ret == 1) {
+        ret = we_rsa_pkey_set_key(ctx, rsa, 1);
+    }
+    if (ret == 1 && rsa->padMode != RSA_NO_PADDING) {
+        ret = we_rsa_check_two_prime(rsa);
     }
 
-    if (encodedDigest != NULL) {
-        OPENSSL_free(encodedDigest);
+    if (ret == 1 && out == NULL) {
+        rc = wc_RsaEncryptSize(&rsa->key);
+        if (rc <= 0) {
+            WOLFENGINE_ERROR_FUNC("wc_RsaEncryptSize", rc);
+            ret = 0;
+        }
+        else {
+            /* Plaintext is never longer than the modulus. */
+            *outLen = rc;
+        }
+    }
+    else if (ret == 1) {
+        switch (rsa->padMode) {
+            case RSA_PKCS1_PADDING:
+                /* PKCS 1 v1.5 padding using block type 2. */
+                rc = wc_RsaPrivateDecrypt(in, (word32)inLen, out,
+                                          (word32)*outLen, &rsa->key);
+                break;
+            case RSA_PKCS1_OAEP_PADDING:
+                ret = we_rsa_oaep_params(rsa, &hashType, &mgf);
+                if (ret == 1) {
+                    rc = wc_RsaPrivateDecrypt_ex(in, (word32)inLen, out,
+                                                 (word32)*outLen, &rsa->key,
+                                                 WC_RSA_OAEP_PAD,
+                                                 (enum wc_HashType)hashType,
+                                                 mgf, rsa->label,
+                                                 rsa->labelLen);
+                }
+                break;
+            case RSA_NO_PADDING:
+                if (we_rsa_private_in_engine(rsa)) {
+                    rc = wc_RsaEncryptSize(&rsa->key);
+                    if (rc > 0 && we_rsa_private_raw(rsa, in, (word32)inLen,
+                            out, (word32)*outLen) != 1) {
+                        rc = RSA_BUFFER_E;
+                    }
+                }
+                else {
+                    rc = wc_RsaPrivateDecrypt_ex(in, (word32)inLen, out,
+                                                 (word32)*outLen, &rsa->key,
+                                                 WC_RSA_NO_PAD,
+                                                 WC_HASH_TYPE_NONE, 0, NULL,
+                                                 0);
+                }
+                break;
+            default:
+                WOLFENGINE_ERROR_MSG("we_rsa_pkey_decrypt: unknown padding");
+                ret = 0;
+                break;
+        }
+        if (ret == 1 && rc < 0) {
+            WOLFENGINE_ERROR_FUNC("wc_RsaPrivateDecrypt", rc);
+            ret = 0;
+        }
+        else if (ret == 1) {
+            *outLen = rc;
+        }
     }
 
+    WOLFENGINE_LEAVE("we_rsa_pkey_decrypt", ret);
+
     return ret;
 }
 
@@ -1116,12 +2854,38 @@ int we_init_rsa_pkey_meth(void)
         EVP_PKEY_meth_set_init(we_rsa_pkey_method, we_rsa_pkey_init);
         EVP_PKEY_meth_set_sign(we_rsa_pkey_method, NULL, we_rsa_pkey_sign);
         EVP_PKEY_meth_set_verify(we_rsa_pkey_method, NULL, we_rsa_pkey_verify);
+        EVP_PKEY_meth_set_encrypt(we_rsa_pkey_method, NULL,
+                                  we_rsa_pkey_encrypt);
+        EVP_PKEY_meth_set_decrypt(we_rsa_pkey_method, NULL,
+                                  we_rsa_pkey_decrypt);
         EVP_PKEY_meth_set_cleanup(we_rsa_pkey_method, we_rsa_pkey_cleanup);
         EVP_PKEY_meth_set_ctrl(we_rsa_pkey_method, we_rsa_pkey_ctrl, NULL);
         EVP_PKEY_meth_set_copy(we_rsa_pkey_method, we_rsa_pkey_copy);
         EVP_PKEY_meth_set_keygen(we_rsa_pkey_method, NULL, we_rsa_pkey_keygen);
     }
 
+#ifdef WE_HAVE_RSA_PSS
+    if (ret == 1) {
+        we_rsa_pss_pkey_method = EVP_PKEY_meth_new(EVP_PKEY_RSA_PSS, 0);
+        if (we_rsa_pss_pkey_method == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("EVP_PKEY_meth_new",
+                                       we_rsa_pss_pkey_method);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        EVP_PKEY_meth_set_init(we_rsa_pss_pkey_method, we_rsa_pss_pkey_init);
+        EVP_PKEY_meth_set_sign(we_rsa_pss_pkey_method, NULL, we_rsa_pkey_sign);
+        EVP_PKEY_meth_set_verify(we_rsa_pss_pkey_method, NULL,
+                                 we_rsa_pkey_verify);
+        EVP_PKEY_meth_set_cleanup(we_rsa_pss_pkey_method, we_rsa_pkey_cleanup);
+        EVP_PKEY_meth_set_ctrl(we_rsa_pss_pkey_method, we_rsa_pkey_ctrl, NULL);
+        EVP_PKEY_meth_set_copy(we_rsa_pss_pkey_method, we_rsa_pkey_copy);
+        EVP_PKEY_meth_set_keygen(we_rsa_pss_pkey_method, NULL,
+                                 we_rsa_pss_pkey_keygen);
+    }
+#endif /* WE_HAVE_RSA_PSS */
+
     if (ret == 0 && we_rsa_pkey_method != NULL) {
         EVP_PKEY_meth_free(we_rsa_pkey_method);
         we_rsa_pkey_method = NULL;
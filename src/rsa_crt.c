@@ -0,0 +1,585 @@
+/* rsa_crt.c
+ *
+ * Copyright (C) 2019-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfengine.
+ *
+ * wolfengine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfengine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Needed for pthread_setaffinity_np(). */
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include "internal.h"
+
+#ifdef WE_HAVE_RSA_PARALLEL_CRT
+
+#include <limits.h>
+#include <pthread.h>
+#ifdef __linux__
+    #include <sched.h>
+#endif
+#include <wolfssl/wolfcrypt/wolfmath.h>
+
+/**
+ * Modular exponentiation to be performed by the helper thread.
+ */
+typedef struct we_CrtJob {
+    /* Base of exponentiation. */
+    mp_int *base;
+    /* Exponent. */
+    mp_int *exp;
+    /* Modulus. */
+    mp_int *mod;
+    /* Result. */
+    mp_int *res;
+    /* Return code of mp_exptmod. */
+    int rc;
+    /* Indicates job has been completed. */
+    int done;
+} we_CrtJob;
+
+/* Serializes starting and stopping the helper thread. Held across the join
+ * so that the thread can't be started again before the old one has exited. */
+static pthread_mutex_t we_crt_ctrl_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Protects helper thread data. */
+static pthread_mutex_t we_crt_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Signals the helper thread that a job is posted or that it must stop. */
+static pthread_cond_t we_crt_job_cond = PTHREAD_COND_INITIALIZER;
+/* Signals the caller that the job is complete. */
+static pthread_cond_t we_crt_done_cond = PTHREAD_COND_INITIALIZER;
+/* Helper thread. */
+static pthread_t we_crt_thread;
+/* Indicates helper thread is running. */
+static int we_crt_running = 0;
+/* Indicates helper thread must stop. */
+static int we_crt_stop = 0;
+/* Indicates a caller is using the helper thread. */
+static int we_crt_busy = 0;
+/* Job posted for helper thread. */
+static we_CrtJob *we_crt_job = NULL;
+/* CPU to pin the helper thread to. -1 indicates not pinned. */
+static int we_crt_cpu = -1;
+/* Indicates the helper thread was running in the parent before fork and is
+ * to be started in the child when next used. */
+static int we_crt_restart = 0;
+/* Registers the fork handlers once. */
+static pthread_once_t we_crt_once = PTHREAD_ONCE_INIT;
+/* Indicates the fork handlers were registered. */
+static int we_crt_atfork = 0;
+
+/**
+ * Helper thread function that performs one half of the CRT exponentiation.
+ *
+ * Posted jobs are always completed before stopping so that no caller is left
+ * waiting.
+ *
+ * @param  arg  [in]  Unused.
+ * @returns  NULL always.
+ */
+static void *we_crt_worker(void *arg)
+{
+    we_CrtJob *job;
+
+    (void)arg;
+
+    WOLFENGINE_ENTER("we_crt_worker");
+
+    pthread_mutex_lock(&we_crt_mutex);
+    while (!we_crt_stop || we_crt_job != NULL) {
+        if (we_crt_job == NULL) {
+            pthread_cond_wait(&we_crt_job_cond, &we_crt_mutex);
+            continue;
+        }
+        job = we_crt_job;
+        we_crt_job = NULL;
+        pthread_mutex_unlock(&we_crt_mutex);
+
+        job->rc = mp_exptmod(job->base, job->exp, job->mod, job->res);
+
+        pthread_mutex_lock(&we_crt_mutex);
+        job->done = 1;
+        pthread_cond_broadcast(&we_crt_done_cond);
+    }
+    pthread_mutex_unlock(&we_crt_mutex);
+
+    WOLFENGINE_LEAVE("we_crt_worker", 0);
+
+    return NULL;
+}
+
+/**
+ * Pin the helper thread to the configured CPU.
+ *
+ * Must be called with the mutex held and helper thread running.
+ *
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_crt_pin(void)
+{
+    int ret = 1;
+#ifdef __linux__
+    int rc;
+    cpu_set_t cpus;
+
+    if (we_crt_cpu >= 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET(we_crt_cpu, &cpus);
+        rc = pthread_setaffinity_np(we_crt_thread, sizeof(cpus), &cpus);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("pthread_setaffinity_np", rc);
+            ret = 0;
+        }
+    }
+#else
+    if (we_crt_cpu >= 0) {
+        WOLFENGINE_ERROR_MSG("Pinning threads not supported on platform");
+        ret = 0;
+    }
+#endif
+
+    return ret;
+}
+
+/**
+ * Start the helper thread.
+ *
+ * Must be called with the mutex held and helper thread not running.
+ *
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_crt_start(void)
+{
+    int ret = 1;
+    int rc;
+
+    we_crt_stop = 0;
+    rc = pthread_create(&we_crt_thread, NULL, we_crt_worker, NULL);
+    if (rc != 0) {
+        WOLFENGINE_ERROR_FUNC("pthread_create", rc);
+        ret = 0;
+    }
+    else {
+        we_crt_running = 1;
+        /* Failing to pin is not fatal - helper thread still works. */
+        (void)we_crt_pin();
+    }
+
+    return ret;
+}
+
+/**
+ * Fork handler called in the parent before fork.
+ *
+ * Holds the mutexes so that the helper thread data is consistent in the
+ * child.
+ */
+static void we_crt_prepare(void)
+{
+    pthread_mutex_lock(&we_crt_ctrl_mutex);
+    pthread_mutex_lock(&we_crt_mutex);
+}
+
+/**
+ * Fork handler called in the parent after fork.
+ */
+static void we_crt_parent(void)
+{
+    pthread_mutex_unlock(&we_crt_mutex);
+    pthread_mutex_unlock(&we_crt_ctrl_mutex);
+}
+
+/**
+ * Fork handler called in the child after fork.
+ *
+ * The helper thread doesn't exist in the child, so a job posted to it would
+ * never complete. It is marked as not running and started again when the
+ * child next checks whether parallel CRT is enabled.
+ */
+static void we_crt_child(void)
+{
+    we_crt_restart = we_crt_running;
+    we_crt_running = 0;
+    we_crt_stop = 0;
+    we_crt_busy = 0;
+    we_crt_job = NULL;
+    /* Only waiters were threads that were not copied. */
+    pthread_cond_init(&we_crt_job_cond, NULL);
+    pthread_cond_init(&we_crt_done_cond, NULL);
+    pthread_mutex_unlock(&we_crt_mutex);
+    pthread_mutex_unlock(&we_crt_ctrl_mutex);
+}
+
+/**
+ * Register the fork handlers.
+ */
+static void we_crt_init_atfork(void)
+{
+    int rc;
+
+    rc = pthread_atfork(we_crt_prepare, we_crt_parent, we_crt_child);
+    if (rc != 0) {
+        WOLFENGINE_ERROR_FUNC("pthread_atfork", rc);
+    }
+    else {
+        we_crt_atfork = 1;
+    }
+}
+
+/**
+ * Enable or disable the parallel CRT helper thread.
+ *
+ * Calls are serialized. Disabling returns after the helper thread has exited.
+ *
+ * @param  enable  [in]  1 to start helper thread and 0 to stop it.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_rsa_crt_set_parallel(long enable)
+{
+    int ret = 1;
+    int rc;
+    int join = 0;
+
+    WOLFENGINE_ENTER("we_rsa_crt_set_parallel");
+
+    if (enable) {
+        rc = pthread_once(&we_crt_once, we_crt_init_atfork);
+        if (rc != 0 || !we_crt_atfork) {
+            WOLFENGINE_ERROR_MSG("Failed to register parallel CRT fork "
+                                 "handlers");
+            ret = 0;
+        }
+    }
+
+    if (ret == 1) {
+        pthread_mutex_lock(&we_crt_ctrl_mutex);
+        pthread_mutex_lock(&we_crt_mutex);
+        we_crt_restart = 0;
+        if (enable && !we_crt_running) {
+            ret = we_crt_start();
+        }
+        else if (!enable && we_crt_running) {
+            we_crt_stop = 1;
+            we_crt_running = 0;
+            pthread_cond_broadcast(&we_crt_job_cond);
+            join = 1;
+        }
+        pthread_mutex_unlock(&we_crt_mutex);
+        if (join) {
+            /* Helper completes posted jobs before exiting. */
+            pthread_join(we_crt_thread, NULL);
+        }
+        pthread_mutex_unlock(&we_crt_ctrl_mutex);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_crt_set_parallel", ret);
+
+    return ret;
+}
+
+/**
+ * Set the CPU that the parallel CRT helper thread is pinned to.
+ *
+ * @param  cpu  [in]  CPU number. -1 indicates thread is not pinned.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_rsa_crt_set_cpu(long cpu)
+{
+    int ret = 1;
+
+    WOLFENGINE_ENTER("we_rsa_crt_set_cpu");
+
+    if (cpu < -1 || cpu > INT_MAX) {
+        WOLFENGINE_ERROR_MSG("Invalid CPU number");
+        ret = 0;
+    }
+    if (ret == 1) {
+        pthread_mutex_lock(&we_crt_mutex);
+        we_crt_cpu = (int)cpu;
+        if (we_crt_running) {
+            ret = we_crt_pin();
+        }
+        pthread_mutex_unlock(&we_crt_mutex);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_crt_set_cpu", ret);
+
+    return ret;
+}
+
+/**
+ * Stop the parallel CRT helper thread.
+ */
+void we_rsa_crt_free(void)
+{
+    we_rsa_crt_set_parallel(0);
+    pthread_mutex_lock(&we_crt_mutex);
+    we_crt_cpu = -1;
+    pthread_mutex_unlock(&we_crt_mutex);
+}
+
+/**
+ * Check whether the parallel CRT helper thread is running.
+ *
+ * In a child process of one with the helper thread running, the helper thread
+ * is started on the first call.
+ *
+ * @returns  1 when running and 0 otherwise.
+ */
+int we_rsa_crt_parallel_enabled(void)
+{
+    int ret;
+
+    pthread_mutex_lock(&we_crt_mutex);
+    if (we_crt_restart) {
+        we_crt_restart = 0;
+        (void)we_crt_start();
+    }
+    ret = we_crt_running;
+    pthread_mutex_unlock(&we_crt_mutex);
+
+    return ret;
+}
+
+/**
+ * Calculate res = base ^ exp mod mod on the helper thread and, at the same
+ * time, res2 = base2 ^ exp2 mod mod2 on the calling thread.
+ *
+ * When the helper thread is busy with another caller, both are calculated on
+ * the calling thread.
+ *
+ * @param  base   [in]   Base of exponentiation on helper thread.
+ * @param  exp    [in]   Exponent of exponentiation on helper thread.
+ * @param  mod    [in]   Modulus of exponentiation on helper thread.
+ * @param  res    [out]  Result of exponentiation on helper thread.
+ * @param  base2  [in]   Base of exponentiation on calling thread.
+ * @param  exp2   [in]   Exponent of exponentiation on calling thread.
+ * @param  mod2   [in]   Modulus of exponentiation on calling thread.
+ * @param  res2   [out]  Result of exponentiation on calling thread.
+ * @returns  MP_OKAY on success and other value on failure.
+ */
+static int we_crt_exptmod_pair(mp_int *base, mp_int *exp, mp_int *mod,
+                               mp_int *res, mp_int *base2, mp_int *exp2,
+                               mp_int *mod2, mp_int *res2)
+{
+    int rc;
+    int posted = 0;
+    we_CrtJob job;
+
+    job.base = base;
+    job.exp = exp;
+    job.mod = mod;
+    job.res = res;
+    job.rc = MP_OKAY;
+    job.done = 0;
+
+    pthread_mutex_lock(&we_crt_mutex);
+    if (we_crt_running && !we_crt_busy) {
+        we_crt_busy = 1;
+        we_crt_job = &job;
+        pthread_cond_signal(&we_crt_job_cond);
+        posted = 1;
+    }
+    pthread_mutex_unlock(&we_crt_mutex);
+
+    rc = mp_exptmod(base2, exp2, mod2, res2);
+
+    if (posted) {
+        pthread_mutex_lock(&we_crt_mutex);
+        while (!job.done) {
+            pthread_cond_wait(&we_crt_done_cond, &we_crt_mutex);
+        }
+        we_crt_busy = 0;
+        pthread_mutex_unlock(&we_crt_mutex);
+    }
+    else {
+        job.rc = mp_exptmod(base, exp, mod, res);
+    }
+
+    if (rc == MP_OKAY) {
+        rc = job.rc;
+    }
+
+    return rc;
+}
+
+/**
+ * Perform the RSA private key operation using CRT with the two half
+ * exponentiations done in parallel.
+ *
+ * The input is blinded and the result is checked with the public key before
+ * being returned.
+ *
+ * @param  key     [in]   wolfSSL RSA key with private key set.
+ * @param  in      [in]   Input data - padded message.
+ * @param  inLen   [in]   Length of input data in bytes.
+ * @param  out     [out]  Buffer to hold result.
+ * @param  outLen  [in]   Size of output buffer - must be size of modulus.
+ * @param  rng     [in]   Random number generator for blinding.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_rsa_crt_private(RsaKey *key, const unsigned char *in, word32 inLen,
+                       unsigned char *out, word32 outLen, WC_RNG *rng)
+{
+    int ret = 1;
+    int rc;
+    int inited = 0;
+    mp_int c, m, r, rInv, m1, m2;
+    mp_int cp, cq;
+    unsigned char rnd[RSA_MAX_SIZE / 8];
+    word32 nSz;
+
+    WOLFENGINE_ENTER("we_rsa_crt_private");
+
+    nSz = (word32)mp_unsigned_bin_size(&key->n);
+    if (key->type != RSA_PRIVATE || nSz > outLen || nSz > sizeof(rnd) ||
+        inLen > nSz) {
+        WOLFENGINE_ERROR_MSG("Invalid parameters for parallel CRT");
+        ret = 0;
+    }
+
+    if (ret == 1) {
+        rc = mp_init_multi(&c, &m, &r, &rInv, &m1, &m2);
+        if (rc == MP_OKAY) {
+            rc = mp_init_multi(&cp, &cq, NULL, NULL, NULL, NULL);
+            if (rc != MP_OKAY) {
+                mp_clear(&c); mp_clear(&m); mp_clear(&r);
+                mp_clear(&rInv); mp_clear(&m1); mp_clear(&m2);
+            }
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_init_multi", rc);
+            ret = 0;
+        }
+        else {
+            inited = 1;
+        }
+    }
+    if (ret == 1) {
+        rc = mp_read_unsigned_bin(&c, in, inLen);
+        if (rc == MP_OKAY && mp_cmp(&c, &key->n) != MP_LT) {
+            rc = BAD_FUNC_ARG;
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_MSG("Input not less than modulus");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* Blind: c' = c * r^e mod n. Keep c to check result. */
+        do {
+            rc = wc_RNG_GenerateBlock(rng, rnd, nSz);
+            if (rc == 0) {
+                rc = mp_read_unsigned_bin(&r, rnd, nSz);
+            }
+            if (rc == 0) {
+                rc = mp_mod(&r, &key->n, &r);
+            }
+        }
+        while (rc == 0 && mp_iszero(&r));
+        if (rc == MP_OKAY) {
+            rc = mp_invmod(&r, &key->n, &rInv);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_exptmod(&r, &key->e, &key->n, &m);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_mulmod(&c, &m, &key->n, &m);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_MSG("Failed to blind input");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* m1 = c'^dP mod p on helper thread, m2 = c'^dQ mod q here. */
+        rc = mp_mod(&m, &key->p, &cp);
+        if (rc == MP_OKAY) {
+            rc = mp_mod(&m, &key->q, &cq);
+        }
+        if (rc == MP_OKAY) {
+            rc = we_crt_exptmod_pair(&cp, &key->dP, &key->p, &m1,
+                                     &cq, &key->dQ, &key->q, &m2);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("we_crt_exptmod_pair", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* h = (m1 - m2) * u mod p. m2 < q may be larger than p, so reduce it
+           first and keep the difference non-negative. */
+        rc = mp_mod(&m2, &key->p, &cp);
+        if (rc == MP_OKAY && mp_cmp(&m1, &cp) == MP_LT) {
+            rc = mp_add(&m1, &key->p, &m1);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_sub(&m1, &cp, &m1);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_mulmod(&m1, &key->u, &key->p, &m1);
+        }
+        /* m = m2 + q * h */
+        if (rc == MP_OKAY) {
+            rc = mp_mul(&m1, &key->q, &m1);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_add(&m1, &m2, &m);
+        }
+        /* Unblind: m = m * r^-1 mod n */
+        if (rc == MP_OKAY) {
+            rc = mp_mulmod(&m, &rInv, &key->n, &m);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_MSG("Failed to recombine CRT results");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* Check result with public key to protect against faults. */
+        rc = mp_exptmod(&m, &key->e, &key->n, &m2);
+        if (rc != MP_OKAY || mp_cmp(&m2, &c) != MP_EQ) {
+            WOLFENGINE_ERROR_MSG("Parallel CRT result check failed");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        rc = mp_to_unsigned_bin_len(&m, out, (int)nSz);
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_to_unsigned_bin_len", rc);
+            ret = 0;
+        }
+    }
+
+    if (inited) {
+        mp_forcezero(&cq);
+        mp_forcezero(&cp);
+        mp_forcezero(&m2);
+        mp_forcezero(&m1);
+        mp_forcezero(&rInv);
+        mp_forcezero(&r);
+        mp_forcezero(&m);
+        mp_clear(&c);
+    }
+    OPENSSL_cleanse(rnd, sizeof(rnd));
+
+    WOLFENGINE_LEAVE("we_rsa_crt_private", ret);
+
+    return ret;
+}
+
+#endif /* WE_HAVE_RSA_PARALLEL_CRT */
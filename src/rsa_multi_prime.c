@@ -0,0 +1,747 @@
+/* rsa_multi_prime.c
+ *
+ * Copyright (C) 2019-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfengine.
+ *
+ * wolfengine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfengine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#include "internal.h"
+
+#ifdef WE_HAVE_RSA_MULTI_PRIME
+
+#include <wolfssl/wolfcrypt/wolfmath.h>
+
+/* Maximum number of primes in addition to p and q. */
+#define WE_RSA_MAX_EXTRA_PRIMES     (WE_RSA_MAX_PRIMES - 2)
+/* Number of Miller-Rabin rounds when generating primes. FIPS 186-4,
+ * Table C.3 requires at most 7 rounds for primes of 512 bits or more. */
+#define WE_RSA_MP_PRIME_TESTS       8
+
+/**
+ * Primes, in addition to p and q, of a multi-prime RSA private key.
+ *
+ * See RFC 8017, 3.2.
+ */
+struct we_RsaMultiPrime {
+    /* Number of additional primes. */
+    int cnt;
+    /* Additional primes: r_i. */
+    mp_int r[WE_RSA_MAX_EXTRA_PRIMES];
+    /* CRT exponents: d_i = d mod (r_i - 1). */
+    mp_int d[WE_RSA_MAX_EXTRA_PRIMES];
+    /* CRT coefficients: t_i = (r_1 * ... * r_(i-1))^-1 mod r_i. */
+    mp_int t[WE_RSA_MAX_EXTRA_PRIMES];
+};
+
+/**
+ * Get the maximum number of primes allowed for a modulus size.
+ *
+ * Same limits as OpenSSL so that keys are interoperable.
+ *
+ * @param  bits  [in]  Size of modulus in bits.
+ * @returns  Maximum number of primes.
+ */
+int we_rsa_multi_prime_max(int bits)
+{
+    int ret;
+
+    if (bits < 1024) {
+        ret = 2;
+    }
+    else if (bits < 4096) {
+        ret = 3;
+    }
+    else {
+        ret = 4;
+    }
+    if (ret > WE_RSA_MAX_PRIMES) {
+        ret = WE_RSA_MAX_PRIMES;
+    }
+
+    return ret;
+}
+
+/**
+ * Convert an OpenSSL BIGNUM to a wolfSSL multi-precision number.
+ *
+ * @param  bn  [in]   OpenSSL number.
+ * @param  mp  [out]  wolfSSL number. Must be initialized.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_bn_to_mp(const BIGNUM *bn, mp_int *mp)
+{
+    int ret = 1;
+    int rc;
+    int len;
+    unsigned char buf[RSA_MAX_SIZE / 8];
+
+    len = BN_num_bytes(bn);
+    if (len > (int)sizeof(buf)) {
+        WOLFENGINE_ERROR_MSG("Number too big for RSA key");
+        ret = 0;
+    }
+    if (ret == 1) {
+        BN_bn2bin(bn, buf);
+        rc = mp_read_unsigned_bin(mp, buf, len);
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_read_unsigned_bin", rc);
+            ret = 0;
+        }
+    }
+    OPENSSL_cleanse(buf, sizeof(buf));
+
+    return ret;
+}
+
+/**
+ * Free the additional primes of a multi-prime RSA key.
+ *
+ * @param  mp  [in]  Additional primes. May be NULL.
+ */
+void we_rsa_multi_prime_free(we_RsaMultiPrime *mp)
+{
+    int i;
+
+    if (mp != NULL) {
+        for (i = 0; i < WE_RSA_MAX_EXTRA_PRIMES; i++) {
+            mp_forcezero(&mp->t[i]);
+            mp_forcezero(&mp->d[i]);
+            mp_forcezero(&mp->r[i]);
+        }
+        OPENSSL_free(mp);
+    }
+}
+
+/**
+ * Load a multi-prime OpenSSL RSA private key.
+ *
+ * n, e, d, p, q, dP, dQ and u are set into the wolfSSL key and the
+ * additional primes are returned separately as wolfCrypt only supports
+ * two-prime keys.
+ *
+ * @param  rsa  [in]   OpenSSL RSA key with more than two primes.
+ * @param  key  [in]   wolfSSL RSA key. Must be initialized.
+ * @param  mp   [out]  Additional primes. Free with we_rsa_multi_prime_free().
+ * @returns  1 on success and 0 on failure.
+ */
+int we_rsa_multi_prime_load(const RSA *rsa, RsaKey *key, we_RsaMultiPrime **mp)
+{
+    int ret = 1;
+    int i;
+    int cnt;
+    const BIGNUM *n = NULL, *e = NULL, *d = NULL;
+    const BIGNUM *primes[WE_RSA_MAX_PRIMES];
+    const BIGNUM *exps[WE_RSA_MAX_PRIMES];
+    const BIGNUM *coeffs[WE_RSA_MAX_PRIMES - 1];
+    we_RsaMultiPrime *extra = NULL;
+
+    WOLFENGINE_ENTER("we_rsa_multi_prime_load");
+
+    cnt = RSA_get_multi_prime_extra_count(rsa);
+    if (cnt <= 0 || cnt > WE_RSA_MAX_EXTRA_PRIMES) {
+        WOLFENGINE_ERROR_MSG("Unsupported number of RSA primes");
+        ret = 0;
+    }
+    if (ret == 1) {
+        RSA_get0_key(rsa, &n, &e, &d);
+        if (RSA_get0_multi_prime_factors(rsa, primes) != 1 ||
+            RSA_get0_multi_prime_crt_params(rsa, exps, coeffs) != 1 ||
+            n == NULL || e == NULL || d == NULL) {
+            WOLFENGINE_ERROR_MSG("Multi-prime RSA key incomplete");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        extra = (we_RsaMultiPrime *)OPENSSL_zalloc(sizeof(*extra));
+        if (extra == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_zalloc", extra);
+            ret = 0;
+        }
+    }
+    for (i = 0; ret == 1 && i < WE_RSA_MAX_EXTRA_PRIMES; i++) {
+        if (mp_init_multi(&extra->r[i], &extra->d[i], &extra->t[i], NULL,
+                          NULL, NULL) != MP_OKAY) {
+            WOLFENGINE_ERROR_MSG("Failed to initialize numbers");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        ret = we_bn_to_mp(n, &key->n) && we_bn_to_mp(e, &key->e) &&
+              we_bn_to_mp(d, &key->d) && we_bn_to_mp(primes[0], &key->p) &&
+              we_bn_to_mp(primes[1], &key->q) &&
+              we_bn_to_mp(exps[0], &key->dP) &&
+              we_bn_to_mp(exps[1], &key->dQ) &&
+              we_bn_to_mp(coeffs[0], &key->u);
+    }
+    for (i = 0; ret == 1 && i < cnt; i++) {
+        ret = we_bn_to_mp(primes[i + 2], &extra->r[i]) &&
+              we_bn_to_mp(exps[i + 2], &extra->d[i]) &&
+              we_bn_to_mp(coeffs[i + 1], &extra->t[i]);
+    }
+    if (ret == 1) {
+        extra->cnt = cnt;
+        key->type = RSA_PRIVATE;
+        we_rsa_multi_prime_free(*mp);
+        *mp = extra;
+    }
+    else {
+        we_rsa_multi_prime_free(extra);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_multi_prime_load", ret);
+
+    return ret;
+}
+
+/**
+ * Perform the RSA private key operation with a multi-prime key.
+ *
+ * Uses the CRT recombination of RFC 8017, 5.1.2. The input is blinded and
+ * the result is checked with the public key before being returned.
+ *
+ * @param  key     [in]   wolfSSL RSA key with p, q, dP, dQ and u set.
+ * @param  mp      [in]   Additional primes of key.
+ * @param  in      [in]   Input data - padded message.
+ * @param  inLen   [in]   Length of input data in bytes.
+ * @param  out     [out]  Buffer to hold result.
+ * @param  outLen  [in]   Size of output buffer - must be size of modulus.
+ * @param  rng     [in]   Random number generator for blinding.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_rsa_multi_prime_private(RsaKey *key, we_RsaMultiPrime *mp,
+                               const unsigned char *in, word32 inLen,
+                               unsigned char *out, word32 outLen, WC_RNG *rng)
+{
+    int ret = 1;
+    int rc;
+    int i;
+    int inited = 0;
+    mp_int c, m, r, rInv, s, h;
+    mp_int mi, prod;
+    unsigned char rnd[RSA_MAX_SIZE / 8];
+    word32 nSz;
+
+    WOLFENGINE_ENTER("we_rsa_multi_prime_private");
+
+    nSz = (word32)mp_unsigned_bin_size(&key->n);
+    if (key->type != RSA_PRIVATE || nSz > outLen || nSz > sizeof(rnd) ||
+        inLen > nSz) {
+        WOLFENGINE_ERROR_MSG("Invalid parameters for multi-prime RSA");
+        ret = 0;
+    }
+
+    if (ret == 1) {
+        rc = mp_init_multi(&c, &m, &r, &rInv, &s, &h);
+        if (rc == MP_OKAY) {
+            rc = mp_init_multi(&mi, &prod, NULL, NULL, NULL, NULL);
+            if (rc != MP_OKAY) {
+                mp_clear(&c); mp_clear(&m); mp_clear(&r);
+                mp_clear(&rInv); mp_clear(&s); mp_clear(&h);
+            }
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_init_multi", rc);
+            ret = 0;
+        }
+        else {
+            inited = 1;
+        }
+    }
+    if (ret == 1) {
+        rc = mp_read_unsigned_bin(&c, in, inLen);
+        if (rc == MP_OKAY && mp_cmp(&c, &key->n) != MP_LT) {
+            rc = BAD_FUNC_ARG;
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_MSG("Input not less than modulus");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* Blind: c' = c * r^e mod n. Keep c to check result. */
+        do {
+            rc = wc_RNG_GenerateBlock(rng, rnd, nSz);
+            if (rc == 0) {
+                rc = mp_read_unsigned_bin(&r, rnd, nSz);
+            }
+            if (rc == 0) {
+                rc = mp_mod(&r, &key->n, &r);
+            }
+        }
+        while (rc == 0 && mp_iszero(&r));
+        if (rc == MP_OKAY) {
+            rc = mp_invmod(&r, &key->n, &rInv);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_exptmod(&r, &key->e, &key->n, &m);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_mulmod(&c, &m, &key->n, &m);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_MSG("Failed to blind input");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* Two-prime part: m_1 = c'^dP mod p, m_2 = c'^dQ mod q,
+         * h = (m_1 - m_2) * u mod p, s = m_2 + q * h. */
+        rc = mp_mod(&m, &key->p, &mi);
+        if (rc == MP_OKAY) {
+            rc = mp_exptmod(&mi, &key->dP, &key->p, &h);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_mod(&m, &key->q, &mi);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_exptmod(&mi, &key->dQ, &key->q, &s);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_mod(&s, &key->p, &mi);
+        }
+        if (rc == MP_OKAY && mp_cmp(&h, &mi) == MP_LT) {
+            rc = mp_add(&h, &key->p, &h);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_sub(&h, &mi, &h);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_mulmod(&h, &key->u, &key->p, &h);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_mul(&h, &key->q, &h);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_add(&s, &h, &s);
+        }
+        /* R = p * q */
+        if (rc == MP_OKAY) {
+            rc = mp_mul(&key->p, &key->q, &prod);
+        }
+        /* Each additional prime: m_i = c'^d_i mod r_i,
+         * h = (m_i - s) * t_i mod r_i, s = s + R * h, R = R * r_i. */
+        for (i = 0; rc == MP_OKAY && i < mp->cnt; i++) {
+            rc = mp_mod(&m, &mp->r[i], &mi);
+            if (rc == MP_OKAY) {
+                rc = mp_exptmod(&mi, &mp->d[i], &mp->r[i], &h);
+            }
+            if (rc == MP_OKAY) {
+                rc = mp_mod(&s, &mp->r[i], &mi);
+            }
+            if (rc == MP_OKAY && mp_cmp(&h, &mi) == MP_LT) {
+                rc = mp_add(&h, &mp->r[i], &h);
+            }
+            if (rc == MP_OKAY) {
+                rc = mp_sub(&h, &mi, &h);
+            }
+            if (rc == MP_OKAY) {
+                rc = mp_mulmod(&h, &mp->t[i], &mp->r[i], &h);
+            }
+            if (rc == MP_OKAY) {
+                rc = mp_mul(&h, &prod, &h);
+            }
+            if (rc == MP_OKAY) {
+                rc = mp_add(&s, &h, &s);
+            }
+            if (rc == MP_OKAY) {
+                rc = mp_mul(&prod, &mp->r[i], &prod);
+            }
+        }
+        /* Unblind: s = s * r^-1 mod n */
+        if (rc == MP_OKAY) {
+            rc = mp_mulmod(&s, &rInv, &key->n, &s);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_MSG("Failed to recombine CRT results");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* Check result with public key to protect against faults. */
+        rc = mp_exptmod(&s, &key->e, &key->n, &m);
+        if (rc != MP_OKAY || mp_cmp(&m, &c) != MP_EQ) {
+            WOLFENGINE_ERROR_MSG("Multi-prime RSA result check failed");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        rc = mp_to_unsigned_bin_len(&s, out, (int)nSz);
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_to_unsigned_bin_len", rc);
+            ret = 0;
+        }
+    }
+
+    if (inited) {
+        mp_forcezero(&prod);
+        mp_forcezero(&mi);
+        mp_forcezero(&h);
+        mp_forcezero(&s);
+        mp_forcezero(&rInv);
+        mp_forcezero(&r);
+        mp_forcezero(&m);
+        mp_clear(&c);
+    }
+    OPENSSL_cleanse(rnd, sizeof(rnd));
+
+    WOLFENGINE_LEAVE("we_rsa_multi_prime_private", ret);
+
+    return ret;
+}
+
+/**
+ * Generate a probable prime of an exact number of bits for a multi-prime RSA
+ * key.
+ *
+ * Candidates have the top two bits set and must be coprime to e - 1.
+ *
+ * @param  rng    [in]   Random number generator to use for candidates.
+ * @param  bits   [in]   Size of prime in bits.
+ * @param  e      [in]   Public exponent.
+ * @param  prime  [out]  Prime. Must be initialized.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_multi_prime_gen(WC_RNG *rng, int bits, mp_int *e,
+                                  mp_int *prime)
+{
+    int ret = 1;
+    int rc;
+    int isPrime = 0;
+    int sz = (bits + 7) / 8;
+    int shift = sz * 8 - bits;
+    int inited = 0;
+    unsigned char buf[RSA_MAX_SIZE / 16];
+    mp_int tmp;
+
+    WOLFENGINE_ENTER("we_rsa_multi_prime_gen");
+
+    if (sz > (int)sizeof(buf) || bits < 16) {
+        WOLFENGINE_ERROR_MSG("Invalid prime size");
+        ret = 0;
+    }
+    if (ret == 1) {
+        rc = mp_init(&tmp);
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_init", rc);
+            ret = 0;
+        }
+        else {
+            inited = 1;
+        }
+    }
+    while (ret == 1 && !isPrime) {
+        rc = wc_RNG_GenerateBlock(rng, buf, (word32)sz);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_RNG_GenerateBlock", rc);
+            ret = 0;
+            break;
+        }
+        /* Exact size with top two bits set and odd. */
+        buf[0] &= (unsigned char)(0xff >> shift);
+        if (shift == 7) {
+            buf[0] |= 0x01;
+            buf[1] |= 0x80;
+        }
+        else {
+            buf[0] |= (unsigned char)(0xc0 >> shift);
+        }
+        buf[sz - 1] |= 0x01;
+
+        rc = mp_read_unsigned_bin(prime, buf, sz);
+        if (rc == MP_OKAY) {
+            rc = mp_prime_is_prime_ex(prime, WE_RSA_MP_PRIME_TESTS, &isPrime,
+                                      rng);
+        }
+        if (rc == MP_OKAY && isPrime) {
+            /* gcd(r - 1, e) must be 1 for d to exist. */
+            rc = mp_sub_d(prime, 1, &tmp);
+            if (rc == MP_OKAY) {
+                rc = mp_gcd(&tmp, e, &tmp);
+            }
+            if (rc == MP_OKAY && mp_cmp_d(&tmp, 1) != MP_EQ) {
+                isPrime = 0;
+            }
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_MSG("Failed to test prime candidate");
+            ret = 0;
+        }
+    }
+    OPENSSL_cleanse(buf, sizeof(buf));
+    if (inited) {
+        mp_forcezero(&tmp);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_multi_prime_gen", ret);
+
+    return ret;
+}
+
+/**
+ * Create an OpenSSL multi-prime RSA key from primes.
+ *
+ * d is calculated modulo the LCM of (r_i - 1) as in FIPS 186-4, B.3.1.
+ *
+ * @param  prime   [in]   Primes. Ownership passes to RSA key on success.
+ * @param  primes  [in]   Number of primes.
+ * @param  pubExp  [in]   Public exponent.
+ * @param  rsa     [out]  New OpenSSL RSA key.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_multi_prime_from_primes(BIGNUM **prime, int primes,
+                                          long pubExp, RSA **rsa)
+{
+    int ret = 1;
+    int i;
+    BN_CTX *bnCtx = NULL;
+    BIGNUM *n = NULL, *e = NULL, *d = NULL;
+    BIGNUM *exps[WE_RSA_MAX_PRIMES] = { NULL, };
+    BIGNUM *coeffs[WE_RSA_MAX_PRIMES - 1] = { NULL, };
+    BIGNUM *r1, *gcd, *lcm, *prod;
+
+    WOLFENGINE_ENTER("we_rsa_multi_prime_from_primes");
+
+    bnCtx = BN_CTX_new();
+    if (bnCtx == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("BN_CTX_new", bnCtx);
+        ret = 0;
+    }
+    if (ret == 1) {
+        BN_CTX_start(bnCtx);
+        r1 = BN_CTX_get(bnCtx);
+        gcd = BN_CTX_get(bnCtx);
+        lcm = BN_CTX_get(bnCtx);
+        prod = BN_CTX_get(bnCtx);
+        if (prod == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("BN_CTX_get", prod);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        n = BN_new();
+        e = BN_new();
+        d = BN_new();
+        if (n == NULL || e == NULL || d == NULL) {
+            ret = 0;
+        }
+        for (i = 0; i < primes; i++) {
+            exps[i] = BN_new();
+            if (exps[i] == NULL) {
+                ret = 0;
+            }
+        }
+        for (i = 0; i < primes - 1; i++) {
+            coeffs[i] = BN_new();
+            if (coeffs[i] == NULL) {
+                ret = 0;
+            }
+        }
+        if (ret == 0) {
+            WOLFENGINE_ERROR_MSG("Failed to allocate RSA key numbers");
+        }
+    }
+    if (ret == 1) {
+        ret = BN_set_word(e, (BN_ULONG)pubExp) && BN_one(n) && BN_one(lcm);
+        /* n = product of primes, lcm = LCM of (r_i - 1). */
+        for (i = 0; ret == 1 && i < primes; i++) {
+            ret = BN_mul(n, n, prime[i], bnCtx) &&
+                  BN_sub(r1, prime[i], BN_value_one()) &&
+                  BN_gcd(gcd, lcm, r1, bnCtx) &&
+                  BN_mul(lcm, lcm, r1, bnCtx) &&
+                  BN_div(lcm, NULL, lcm, gcd, bnCtx);
+        }
+        if (ret == 1) {
+            ret = BN_mod_inverse(d, e, lcm, bnCtx) != NULL;
+        }
+        /* d_i = d mod (r_i - 1) */
+        for (i = 0; ret == 1 && i < primes; i++) {
+            ret = BN_sub(r1, prime[i], BN_value_one()) &&
+                  BN_mod(exps[i], d, r1, bnCtx);
+        }
+        /* qInv = q^-1 mod p, t_i = (r_1 * ... * r_(i-1))^-1 mod r_i */
+        if (ret == 1) {
+            ret = BN_mod_inverse(coeffs[0], prime[1], prime[0], bnCtx) !=
+                  NULL && BN_mul(prod, prime[0], prime[1], bnCtx);
+        }
+        for (i = 2; ret == 1 && i < primes; i++) {
+            ret = BN_mod_inverse(coeffs[i - 1], prod, prime[i], bnCtx) !=
+                  NULL && BN_mul(prod, prod, prime[i], bnCtx);
+        }
+        if (ret == 0) {
+            WOLFENGINE_ERROR_MSG("Failed to calculate RSA key from primes");
+        }
+    }
+    if (ret == 1) {
+        *rsa = RSA_new();
+        if (*rsa == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("RSA_new", *rsa);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* Ownership of numbers passes to RSA object. */
+        RSA_set0_key(*rsa, n, e, d);
+        RSA_set0_factors(*rsa, prime[0], prime[1]);
+        RSA_set0_crt_params(*rsa, exps[0], exps[1], coeffs[0]);
+        n = e = d = NULL;
+        prime[0] = prime[1] = NULL;
+        exps[0] = exps[1] = coeffs[0] = NULL;
+
+        ret = RSA_set0_multi_prime_params(*rsa, &prime[2], &exps[2],
+                                          &coeffs[1], primes - 2);
+        if (ret != 1) {
+            WOLFENGINE_ERROR_FUNC("RSA_set0_multi_prime_params", ret);
+            RSA_free(*rsa);
+            *rsa = NULL;
+            ret = 0;
+        }
+        else {
+            for (i = 2; i < primes; i++) {
+                prime[i] = NULL;
+                exps[i] = NULL;
+                coeffs[i - 1] = NULL;
+            }
+        }
+    }
+    for (i = 0; i < primes; i++) {
+        BN_clear_free(exps[i]);
+    }
+    for (i = 0; i < primes - 1; i++) {
+        BN_clear_free(coeffs[i]);
+    }
+    BN_clear_free(d);
+    BN_free(e);
+    BN_free(n);
+
+    if (bnCtx != NULL) {
+        BN_CTX_end(bnCtx);
+        BN_CTX_free(bnCtx);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_multi_prime_from_primes", ret);
+
+    return ret;
+}
+
+/**
+ * Generate a multi-prime RSA key.
+ *
+ * The modulus is split evenly between the primes with the first prime taking
+ * any remainder. Primes are regenerated until the modulus is exactly the
+ * requested size and all primes are distinct.
+ *
+ * @param  bits    [in]   Size of modulus in bits.
+ * @param  primes  [in]   Number of primes - at least 3.
+ * @param  pubExp  [in]   Public exponent.
+ * @param  rsa     [out]  New OpenSSL RSA key.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_rsa_multi_prime_keygen(int bits, int primes, long pubExp, RSA **rsa)
+{
+    int ret = 1;
+    int rc;
+    int i, j;
+    int inited = 0;
+    int done = 0;
+    mp_int r[WE_RSA_MAX_PRIMES];
+    mp_int e, n;
+    BIGNUM *bn[WE_RSA_MAX_PRIMES] = { NULL, };
+
+    WOLFENGINE_ENTER("we_rsa_multi_prime_keygen");
+
+    if (primes < 3 || primes > we_rsa_multi_prime_max(bits) ||
+        bits > RSA_MAX_SIZE || pubExp < 3 || (pubExp & 1) == 0) {
+        WOLFENGINE_ERROR_MSG("Invalid multi-prime RSA key parameters");
+        ret = 0;
+    }
+    if (ret == 1) {
+        rc = mp_init_multi(&e, &n, &r[0], &r[1], &r[2], NULL);
+        for (i = 3; rc == MP_OKAY && i < WE_RSA_MAX_PRIMES; i++) {
+            rc = mp_init(&r[i]);
+            if (rc != MP_OKAY) {
+                /* Dispose of the numbers already initialized. */
+                while (i-- > 0) {
+                    mp_clear(&r[i]);
+                }
+                mp_clear(&n);
+                mp_clear(&e);
+            }
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_MSG("Failed to initialize numbers");
+            ret = 0;
+        }
+        else {
+            inited = 1;
+        }
+    }
+    if (ret == 1) {
+        rc = mp_set_int(&e, (unsigned long)pubExp);
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_set_int", rc);
+            ret = 0;
+        }
+    }
+    while (ret == 1 && !done) {
+        rc = mp_set_int(&n, 1);
+        for (i = 0; ret == 1 && rc == MP_OKAY && i < primes; i++) {
+            ret = we_rsa_multi_prime_gen(we_rng,
+                bits / primes + (i == 0 ? bits % primes : 0), &e, &r[i]);
+            if (ret == 1) {
+                rc = mp_mul(&n, &r[i], &n);
+            }
+        }
+        if (ret == 1 && rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_mul", rc);
+            ret = 0;
+        }
+        if (ret == 1) {
+            done = (mp_count_bits(&n) == bits);
+            for (i = 0; done && i < primes; i++) {
+                for (j = i + 1; done && j < primes; j++) {
+                    done = (mp_cmp(&r[i], &r[j]) != MP_EQ);
+                }
+            }
+        }
+    }
+    for (i = 0; ret == 1 && i < primes; i++) {
+        bn[i] = we_mp_to_bn(&r[i]);
+        if (bn[i] == NULL) {
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        ret = we_rsa_multi_prime_from_primes(bn, primes, pubExp, rsa);
+    }
+
+    for (i = 0; i < primes; i++) {
+        BN_clear_free(bn[i]);
+    }
+    if (inited) {
+        for (i = 0; i < WE_RSA_MAX_PRIMES; i++) {
+            mp_forcezero(&r[i]);
+        }
+        mp_clear(&n);
+        mp_clear(&e);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_multi_prime_keygen", ret);
+
+    return ret;
+}
+
+#endif /* WE_HAVE_RSA_MULTI_PRIME */
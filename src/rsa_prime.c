@@ -0,0 +1,927 @@
+/* rsa_prime.c
+ *
+ * Copyright (C) 2019-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfengine.
+ *
+ * wolfengine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfengine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#include "internal.h"
+
+#ifdef WE_HAVE_RSA_KEYGEN_THREADS
+
+#include <limits.h>
+#include <pthread.h>
+
+/* Maximum size of an RSA prime in bytes - half of largest modulus. */
+#define WE_RSA_MAX_PRIME_SZ     (RSA_MAX_SIZE / 16)
+/* Maximum number of threads that can be used to generate primes. */
+#define WE_RSA_PRIME_MAX_THREADS    64
+/* Public exponent that primes in pool are generated for. */
+#define WE_RSA_POOL_PUB_EXP     WC_RSA_EXPONENT
+
+/**
+ * Generate a probable prime for an RSA key.
+ *
+ * Candidates have the top two bits set so that the modulus has the full
+ * number of bits and the prime is greater than sqrt(2) * 2^(nlen/2 - 1).
+ * wolfCrypt checks the candidate as required by FIPS 186-4, B.3.3.
+ *
+ * @param  rng      [in]   Random number generator to use for candidates.
+ * @param  prime    [out]  Buffer to hold prime.
+ * @param  primeSz  [in]   Size of prime in bytes.
+ * @param  e        [in]   Public exponent as a big-endian byte array.
+ * @param  eSz      [in]   Size of public exponent in bytes.
+ * @param  stop     [in]   Pointer to flag indicating search must stop.
+ *                         May be NULL.
+ * @returns  1 on success and 0 on failure or when stopped.
+ */
+static int we_rsa_gen_prime(WC_RNG *rng, unsigned char *prime, int primeSz,
+                            const unsigned char *e, int eSz,
+                            volatile int *stop)
+{
+    int ret = 1;
+    int rc;
+    int isPrime = 0;
+
+    WOLFENGINE_ENTER("we_rsa_gen_prime");
+
+    while (ret == 1 && !isPrime) {
+        if (stop != NULL && *stop) {
+            WOLFENGINE_MSG("Prime search stopped");
+            ret = 0;
+        }
+        if (ret == 1) {
+            rc = wc_RNG_GenerateBlock(rng, prime, primeSz);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("wc_RNG_GenerateBlock", rc);
+                ret = 0;
+            }
+        }
+        if (ret == 1) {
+            prime[0] |= 0xc0;
+            prime[primeSz - 1] |= 0x01;
+
+            rc = wc_CheckProbablePrime_ex(prime, primeSz, NULL, 0, e, eSz,
+                                          primeSz * 16, &isPrime, rng);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("wc_CheckProbablePrime_ex", rc);
+                ret = 0;
+            }
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_gen_prime", ret);
+
+    return ret;
+}
+
+/**
+ * Create an OpenSSL RSA key from two primes.
+ *
+ * Calculates the modulus, private exponent and CRT parameters with wolfSSL's
+ * math functions as wc_MakeRsaKey() does. The private exponent is calculated
+ * modulo (p-1)(q-1) with the inversion blinded by a random value coprime to
+ * it, and q^-1 mod p is calculated as q^(p-2) mod p, so that the time taken
+ * doesn't depend on the primes.
+ *
+ * @param  pBuf     [in]   First prime as a big-endian byte array.
+ * @param  qBuf     [in]   Second prime as a big-endian byte array.
+ * @param  primeSz  [in]   Size of each prime in bytes.
+ * @param  pubExp   [in]   Public exponent.
+ * @param  rng      [in]   Random number generator for blinding.
+ * @param  rsa      [out]  New RSA key.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_from_primes(const unsigned char *pBuf,
+                              const unsigned char *qBuf, int primeSz,
+                              long pubExp, WC_RNG *rng, RSA **rsa)
+{
+    int ret = 1, rc;
+    int init = 0;
+    int coprime = 0;
+    mp_int p, q, p1, q1, phi, t;
+    mp_int d, dP, dQ, u, b, n;
+    BIGNUM *bn[8] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+    unsigned char rnd[RSA_MAX_SIZE / 8];
+    int i;
+
+    WOLFENGINE_ENTER("we_rsa_from_primes");
+
+    rc = mp_init_multi(&p, &q, &p1, &q1, &phi, &t);
+    if (rc == MP_OKAY) {
+        rc = mp_init_multi(&d, &dP, &dQ, &u, &b, &n);
+        if (rc != MP_OKAY) {
+            mp_free(&p);
+            mp_free(&q);
+            mp_free(&p1);
+            mp_free(&q1);
+            mp_free(&phi);
+            mp_free(&t);
+        }
+    }
+    if (rc != MP_OKAY) {
+        WOLFENGINE_ERROR_FUNC("mp_init_multi", rc);
+        ret = 0;
+    }
+    else {
+        init = 1;
+    }
+    if (ret == 1) {
+        rc = mp_read_unsigned_bin(&p, pBuf, primeSz);
+        if (rc == MP_OKAY) {
+            rc = mp_read_unsigned_bin(&q, qBuf, primeSz);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_read_unsigned_bin", rc);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* FIPS 186-4, B.3.3: |p - q| > 2^(nlen/2 - 100) */
+        if (mp_cmp(&p, &q) == MP_LT) {
+            rc = mp_sub(&q, &p, &t);
+        }
+        else {
+            rc = mp_sub(&p, &q, &t);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_sub", rc);
+            ret = 0;
+        }
+        else if (mp_count_bits(&t) <= primeSz * 8 - 100) {
+            WOLFENGINE_ERROR_MSG("Primes too close together");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* phi = (p-1)(q-1) */
+        rc = mp_sub_d(&p, 1, &p1);
+        if (rc == MP_OKAY) {
+            rc = mp_sub_d(&q, 1, &q1);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_mul(&p1, &q1, &phi);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_FUNC("mp_mul", rc);
+            ret = 0;
+        }
+    }
+    /* Blind the inversion with a random odd value coprime to phi. */
+    while (ret == 1 && !coprime) {
+        rc = wc_RNG_GenerateBlock(rng, rnd, 2 * primeSz);
+        if (rc != 0) {
+            WOLFENGINE_ERROR_FUNC("wc_RNG_GenerateBlock", rc);
+            ret = 0;
+        }
+        if (ret == 1) {
+            rc = mp_read_unsigned_bin(&b, rnd, 2 * primeSz);
+            if (rc == MP_OKAY) {
+                rc = mp_set_bit(&b, 0);
+            }
+            if (rc == MP_OKAY) {
+                rc = mp_gcd(&b, &phi, &t);
+            }
+            if (rc != MP_OKAY) {
+                WOLFENGINE_ERROR_FUNC("mp_gcd", rc);
+                ret = 0;
+            }
+            else {
+                coprime = mp_isone(&t);
+            }
+        }
+    }
+    if (ret == 1) {
+        /* d = (e.b)^-1 . b = e^-1 mod phi */
+        rc = mp_set_int(&t, (unsigned long)pubExp);
+        if (rc == MP_OKAY) {
+            rc = mp_mulmod(&t, &b, &phi, &t);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_invmod(&t, &phi, &d);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_mulmod(&d, &b, &phi, &d);
+        }
+        /* dP = d mod (p-1), dQ = d mod (q-1) */
+        if (rc == MP_OKAY) {
+            rc = mp_mod(&d, &p1, &dP);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_mod(&d, &q1, &dQ);
+        }
+        /* u = q^-1 mod p = q^(p-2) mod p */
+        if (rc == MP_OKAY) {
+            rc = mp_sub_d(&p, 2, &t);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_exptmod(&q, &t, &p, &u);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_mul(&p, &q, &n);
+        }
+        if (rc == MP_OKAY) {
+            rc = mp_set_int(&t, (unsigned long)pubExp);
+        }
+        if (rc != MP_OKAY) {
+            WOLFENGINE_ERROR_MSG("Failed to calculate RSA key from primes");
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* Order: n, e, d, p, q, dP, dQ, u */
+        bn[0] = we_mp_to_bn(&n);
+        bn[1] = we_mp_to_bn(&t);
+        bn[2] = we_mp_to_bn(&d);
+        bn[3] = we_mp_to_bn(&p);
+        bn[4] = we_mp_to_bn(&q);
+        bn[5] = we_mp_to_bn(&dP);
+        bn[6] = we_mp_to_bn(&dQ);
+        bn[7] = we_mp_to_bn(&u);
+        for (i = 0; i < 8; i++) {
+            if (bn[i] == NULL) {
+                ret = 0;
+            }
+        }
+    }
+    if (ret == 1) {
+        *rsa = RSA_new();
+        if (*rsa == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("RSA_new", *rsa);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        /* Ownership of numbers passes to RSA object. */
+        RSA_set0_key(*rsa, bn[0], bn[1], bn[2]);
+        RSA_set0_factors(*rsa, bn[3], bn[4]);
+        RSA_set0_crt_params(*rsa, bn[5], bn[6], bn[7]);
+    }
+    else {
+        for (i = 0; i < 8; i++) {
+            BN_clear_free(bn[i]);
+        }
+    }
+
+    OPENSSL_cleanse(rnd, sizeof(rnd));
+    if (init) {
+        mp_forcezero(&p);
+        mp_forcezero(&q);
+        mp_forcezero(&p1);
+        mp_forcezero(&q1);
+        mp_forcezero(&phi);
+        mp_forcezero(&t);
+        mp_forcezero(&d);
+        mp_forcezero(&dP);
+        mp_forcezero(&dQ);
+        mp_forcezero(&u);
+        mp_forcezero(&b);
+        mp_free(&n);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_from_primes", ret);
+
+    return ret;
+}
+
+/**
+ * Pool of primes for one size of RSA key.
+ */
+typedef struct we_RsaPrimePool {
+    /* Size of RSA key/modulus in bits. */
+    int bits;
+    /* Primes, each half the size of the modulus, stored contiguously. */
+    unsigned char *primes;
+    /* Number of primes available. */
+    int cnt;
+    /* Number of primes being generated by threads. */
+    int pending;
+} we_RsaPrimePool;
+
+/* Pools of primes - one for each commonly used key size. */
+static we_RsaPrimePool we_rsa_prime_pool[] = {
+    { 2048, NULL, 0, 0 },
+    { 3072, NULL, 0, 0 },
+    { 4096, NULL, 0, 0 },
+};
+#define WE_RSA_PRIME_POOL_CNT \
+    (int)(sizeof(we_rsa_prime_pool) / sizeof(*we_rsa_prime_pool))
+
+/* Protects prime pool data. */
+static pthread_mutex_t we_rsa_prime_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Signals the threads that the pool needs filling or that they must stop. */
+static pthread_cond_t we_rsa_prime_pool_cond = PTHREAD_COND_INITIALIZER;
+/* Threads generating primes for the pool. */
+static pthread_t we_rsa_prime_pool_thread[WE_RSA_PRIME_MAX_THREADS];
+/* Number of threads running. */
+static int we_rsa_prime_pool_running = 0;
+/* Number of primes to keep in each pool. */
+static int we_rsa_prime_pool_size = 0;
+/* Number of threads to run when pool is enabled. */
+static int we_rsa_prime_pool_threads = 0;
+/* Indicates threads must stop. */
+static volatile int we_rsa_prime_pool_stop = 0;
+/* Number of RSA keys generated from pooled primes. */
+static long we_rsa_prime_pool_used = 0;
+/* Registers the fork handlers once. */
+static pthread_once_t we_rsa_prime_pool_once = PTHREAD_ONCE_INIT;
+/* Indicates the fork handlers were registered. */
+static int we_rsa_prime_pool_atfork = 0;
+
+/**
+ * Fork handler called in the parent before fork.
+ *
+ * Holds the mutex so that the pools are consistent in the child.
+ */
+static void we_rsa_prime_pool_prepare(void)
+{
+    pthread_mutex_lock(&we_rsa_prime_pool_mutex);
+}
+
+/**
+ * Fork handler called in the parent after fork.
+ */
+static void we_rsa_prime_pool_parent(void)
+{
+    pthread_mutex_unlock(&we_rsa_prime_pool_mutex);
+}
+
+/**
+ * Fork handler called in the child after fork.
+ *
+ * The child has a copy of the parent's primes. Using them would give the
+ * parent and child keys with the same primes, so they are disposed of. The
+ * pool threads do not exist in the child so the pools are no longer running.
+ * Setting the size and thread count again restarts the pools in the child.
+ */
+static void we_rsa_prime_pool_child(void)
+{
+    int i;
+
+    for (i = 0; i < WE_RSA_PRIME_POOL_CNT; i++) {
+        if (we_rsa_prime_pool[i].primes != NULL) {
+            OPENSSL_clear_free(we_rsa_prime_pool[i].primes,
+                               we_rsa_prime_pool_size *
+                               (we_rsa_prime_pool[i].bits / 16));
+        }
+        we_rsa_prime_pool[i].primes = NULL;
+        we_rsa_prime_pool[i].cnt = 0;
+        we_rsa_prime_pool[i].pending = 0;
+    }
+    we_rsa_prime_pool_running = 0;
+    we_rsa_prime_pool_stop = 0;
+    we_rsa_prime_pool_size = 0;
+    we_rsa_prime_pool_threads = 0;
+    /* Only waiters were the pool threads which were not copied. */
+    pthread_cond_init(&we_rsa_prime_pool_cond, NULL);
+    pthread_mutex_unlock(&we_rsa_prime_pool_mutex);
+}
+
+/**
+ * Register the fork handlers.
+ */
+static void we_rsa_prime_pool_init_atfork(void)
+{
+    int rc;
+
+    rc = pthread_atfork(we_rsa_prime_pool_prepare, we_rsa_prime_pool_parent,
+                        we_rsa_prime_pool_child);
+    if (rc != 0) {
+        WOLFENGINE_ERROR_FUNC("pthread_atfork", rc);
+    }
+    else {
+        we_rsa_prime_pool_atfork = 1;
+    }
+}
+
+/**
+ * Find the pool that most needs a prime generated.
+ *
+ * Must be called with the pool mutex held.
+ *
+ * @returns  Pool to generate prime for or NULL when all pools are full.
+ */
+static we_RsaPrimePool *we_rsa_prime_pool_next(void)
+{
+    we_RsaPrimePool *pool = NULL;
+    int i;
+    int fill;
+    int minFill = we_rsa_prime_pool_size;
+
+    for (i = 0; i < WE_RSA_PRIME_POOL_CNT; i++) {
+        fill = we_rsa_prime_pool[i].cnt + we_rsa_prime_pool[i].pending;
+        if (fill < minFill) {
+            minFill = fill;
+            pool = &we_rsa_prime_pool[i];
+        }
+    }
+
+    return pool;
+}
+
+/**
+ * Thread function that fills the prime pools.
+ *
+ * Primes are generated without holding the mutex so that key generation is
+ * not blocked. Thread waits when all pools are full.
+ *
+ * @param  arg  [in]  Unused.
+ * @returns  NULL always.
+ */
+static void *we_rsa_prime_pool_worker(void *arg)
+{
+    int rc;
+    WC_RNG rng;
+    we_RsaPrimePool *pool;
+    unsigned char prime[WE_RSA_MAX_PRIME_SZ];
+    unsigned char e[3] = { 0x01, 0x00, 0x01 };
+    int primeSz;
+    int ok;
+
+    (void)arg;
+
+    WOLFENGINE_ENTER("we_rsa_prime_pool_worker");
+
+    /* Each thread has its own random so no locking is needed. */
+    rc = wc_InitRng(&rng);
+    if (rc != 0) {
+        WOLFENGINE_ERROR_FUNC("wc_InitRng", rc);
+    }
+    else {
+        pthread_mutex_lock(&we_rsa_prime_pool_mutex);
+        while (!we_rsa_prime_pool_stop) {
+            pool = we_rsa_prime_pool_next();
+            if (pool == NULL) {
+                pthread_cond_wait(&we_rsa_prime_pool_cond,
+                                  &we_rsa_prime_pool_mutex);
+                continue;
+            }
+            pool->pending++;
+            primeSz = pool->bits / 16;
+            pthread_mutex_unlock(&we_rsa_prime_pool_mutex);
+
+            ok = we_rsa_gen_prime(&rng, prime, primeSz, e, sizeof(e),
+                                  &we_rsa_prime_pool_stop);
+
+            pthread_mutex_lock(&we_rsa_prime_pool_mutex);
+            pool->pending--;
+            if (ok && pool->cnt < we_rsa_prime_pool_size) {
+                XMEMCPY(pool->primes + pool->cnt * primeSz, prime, primeSz);
+                pool->cnt++;
+            }
+        }
+        pthread_mutex_unlock(&we_rsa_prime_pool_mutex);
+
+        OPENSSL_cleanse(prime, sizeof(prime));
+        wc_FreeRng(&rng);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_prime_pool_worker", 0);
+
+    return NULL;
+}
+
+/**
+ * Stop the prime pool threads and dispose of the primes.
+ */
+static void we_rsa_prime_pool_stop_threads(void)
+{
+    int i;
+    int running;
+
+    WOLFENGINE_ENTER("we_rsa_prime_pool_stop_threads");
+
+    /* Key generation stops taking primes once running is cleared. */
+    pthread_mutex_lock(&we_rsa_prime_pool_mutex);
+    running = we_rsa_prime_pool_running;
+    we_rsa_prime_pool_running = 0;
+    we_rsa_prime_pool_stop = 1;
+    pthread_cond_broadcast(&we_rsa_prime_pool_cond);
+    pthread_mutex_unlock(&we_rsa_prime_pool_mutex);
+
+    for (i = 0; i < running; i++) {
+        pthread_join(we_rsa_prime_pool_thread[i], NULL);
+    }
+
+    pthread_mutex_lock(&we_rsa_prime_pool_mutex);
+    we_rsa_prime_pool_stop = 0;
+    for (i = 0; i < WE_RSA_PRIME_POOL_CNT; i++) {
+        if (we_rsa_prime_pool[i].primes != NULL) {
+            OPENSSL_clear_free(we_rsa_prime_pool[i].primes,
+                               we_rsa_prime_pool_size *
+                               (we_rsa_prime_pool[i].bits / 16));
+        }
+        we_rsa_prime_pool[i].primes = NULL;
+        we_rsa_prime_pool[i].cnt = 0;
+    }
+    pthread_mutex_unlock(&we_rsa_prime_pool_mutex);
+
+    WOLFENGINE_LEAVE("we_rsa_prime_pool_stop_threads", 1);
+}
+
+/**
+ * Apply the pool size and thread count configuration.
+ *
+ * Existing threads are stopped and primes disposed of. When both the pool
+ * size and thread count are non-zero, the pools are allocated and threads
+ * started.
+ *
+ * @param  size     [in]  Number of primes to keep for each key size.
+ * @param  threads  [in]  Number of threads generating primes.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_rsa_prime_pool_configure(int size, int threads)
+{
+    int ret = 1;
+    int rc;
+    int i;
+
+    WOLFENGINE_ENTER("we_rsa_prime_pool_configure");
+
+    if (size > 0 && threads > 0) {
+        /* Pool must not be used in a child process after fork. */
+        rc = pthread_once(&we_rsa_prime_pool_once,
+                          we_rsa_prime_pool_init_atfork);
+        if (rc != 0 || !we_rsa_prime_pool_atfork) {
+            WOLFENGINE_ERROR_MSG("Failed to register RSA prime pool fork "
+                                 "handlers");
+            ret = 0;
+        }
+    }
+
+    we_rsa_prime_pool_stop_threads();
+
+    pthread_mutex_lock(&we_rsa_prime_pool_mutex);
+    we_rsa_prime_pool_size = size;
+    we_rsa_prime_pool_threads = threads;
+    if (ret == 1 && size > 0 && threads > 0) {
+        for (i = 0; ret == 1 && i < WE_RSA_PRIME_POOL_CNT; i++) {
+            we_rsa_prime_pool[i].primes = (unsigned char *)OPENSSL_malloc(
+                size * (we_rsa_prime_pool[i].bits / 16));
+            if (we_rsa_prime_pool[i].primes == NULL) {
+                WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_malloc",
+                                           we_rsa_prime_pool[i].primes);
+                ret = 0;
+            }
+        }
+        for (i = 0; ret == 1 && i < threads; i++) {
+            rc = pthread_create(&we_rsa_prime_pool_thread[i], NULL,
+                                we_rsa_prime_pool_worker, NULL);
+            if (rc != 0) {
+                WOLFENGINE_ERROR_FUNC("pthread_create", rc);
+                ret = 0;
+            }
+            else {
+                we_rsa_prime_pool_running++;
+            }
+        }
+    }
+    pthread_mutex_unlock(&we_rsa_prime_pool_mutex);
+
+    if (ret == 0) {
+        we_rsa_prime_pool_stop_threads();
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_prime_pool_configure", ret);
+
+    return ret;
+}
+
+/**
+ * Set the number of primes to keep in the pool for each key size.
+ *
+ * @param  size  [in]  Number of primes. 0 disables the pool.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_rsa_prime_pool_set_size(long size)
+{
+    int ret = 1;
+
+    WOLFENGINE_ENTER("we_rsa_prime_pool_set_size");
+
+    if (size < 0 || size > INT_MAX / (RSA_MAX_SIZE / 16)) {
+        WOLFENGINE_ERROR_MSG("Invalid RSA prime pool size");
+        ret = 0;
+    }
+    if (ret == 1) {
+        ret = we_rsa_prime_pool_configure((int)size,
+                                          we_rsa_prime_pool_threads);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_prime_pool_set_size", ret);
+
+    return ret;
+}
+
+/**
+ * Set the number of threads that generate primes for the pool.
+ *
+ * @param  threads  [in]  Number of threads. 0 disables the pool.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_rsa_prime_pool_set_threads(long threads)
+{
+    int ret = 1;
+
+    WOLFENGINE_ENTER("we_rsa_prime_pool_set_threads");
+
+    if (threads < 0 || threads > WE_RSA_PRIME_MAX_THREADS) {
+        WOLFENGINE_ERROR_MSG("Invalid RSA prime pool thread count");
+        ret = 0;
+    }
+    if (ret == 1) {
+        ret = we_rsa_prime_pool_configure(we_rsa_prime_pool_size,
+                                          (int)threads);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_prime_pool_set_threads", ret);
+
+    return ret;
+}
+
+/**
+ * Stop the prime pool threads and free the pools.
+ */
+void we_rsa_prime_pool_free(void)
+{
+    we_rsa_prime_pool_stop_threads();
+    pthread_mutex_lock(&we_rsa_prime_pool_mutex);
+    we_rsa_prime_pool_size = 0;
+    we_rsa_prime_pool_threads = 0;
+    pthread_mutex_unlock(&we_rsa_prime_pool_mutex);
+}
+
+/**
+ * Get the number of RSA keys generated from pooled primes.
+ *
+ * @param  used  [out]  Number of keys generated from the pool.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_rsa_prime_pool_get_used(long *used)
+{
+    int ret = 1;
+
+    WOLFENGINE_ENTER("we_rsa_prime_pool_get_used");
+
+    if (used == NULL) {
+        WOLFENGINE_ERROR_MSG("No place to store RSA prime pool use count");
+        ret = 0;
+    }
+    if (ret == 1) {
+        pthread_mutex_lock(&we_rsa_prime_pool_mutex);
+        *used = we_rsa_prime_pool_used;
+        pthread_mutex_unlock(&we_rsa_prime_pool_mutex);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_prime_pool_get_used", ret);
+
+    return ret;
+}
+
+/**
+ * Generate an RSA key using two primes from the pool.
+ *
+ * Only keys with the default public exponent and a size that has a pool are
+ * supported. The caller falls back to generating the key on demand when no
+ * key is returned.
+ *
+ * @param  bits    [in]   Size of RSA key/modulus in bits.
+ * @param  pubExp  [in]   Public exponent.
+ * @param  rsa     [out]  New RSA key or NULL when pool can't be used.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_rsa_prime_pool_keygen(int bits, long pubExp, RSA **rsa)
+{
+    int ret = 1;
+    int i;
+    int primeSz = bits / 16;
+    we_RsaPrimePool *pool = NULL;
+    unsigned char p[WE_RSA_MAX_PRIME_SZ];
+    unsigned char q[WE_RSA_MAX_PRIME_SZ];
+
+    WOLFENGINE_ENTER("we_rsa_prime_pool_keygen");
+
+    *rsa = NULL;
+
+    pthread_mutex_lock(&we_rsa_prime_pool_mutex);
+    if (we_rsa_prime_pool_running > 0 && pubExp == WE_RSA_POOL_PUB_EXP) {
+        for (i = 0; i < WE_RSA_PRIME_POOL_CNT; i++) {
+            if (we_rsa_prime_pool[i].bits == bits) {
+                pool = &we_rsa_prime_pool[i];
+                break;
+            }
+        }
+    }
+    if (pool != NULL && pool->cnt >= 2) {
+        pool->cnt -= 2;
+        XMEMCPY(p, pool->primes + pool->cnt * primeSz, primeSz);
+        XMEMCPY(q, pool->primes + (pool->cnt + 1) * primeSz, primeSz);
+        OPENSSL_cleanse(pool->primes + pool->cnt * primeSz, 2 * primeSz);
+        /* Wake up threads to refill pool. */
+        pthread_cond_broadcast(&we_rsa_prime_pool_cond);
+    }
+    else {
+        pool = NULL;
+    }
+    pthread_mutex_unlock(&we_rsa_prime_pool_mutex);
+
+    if (pool != NULL) {
+        WOLFENGINE_MSG("Generating RSA key from prime pool");
+        ret = we_rsa_from_primes(p, q, primeSz, pubExp, we_rng, rsa);
+        OPENSSL_cleanse(p, primeSz);
+        OPENSSL_cleanse(q, primeSz);
+    }
+    if (ret == 1 && *rsa != NULL) {
+        pthread_mutex_lock(&we_rsa_prime_pool_mutex);
+        we_rsa_prime_pool_used++;
+        pthread_mutex_unlock(&we_rsa_prime_pool_mutex);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_prime_pool_keygen", ret);
+
+    return ret;
+}
+
+/* Number of threads searching for primes during on demand key generation. */
+static int we_rsa_keygen_threads = 1;
+
+/**
+ * State shared by threads searching for the two primes of one RSA key.
+ */
+typedef struct we_RsaPrimeSearch {
+    /* Protects primes found. */
+    pthread_mutex_t mutex;
+    /* Primes found. */
+    unsigned char primes[2][WE_RSA_MAX_PRIME_SZ];
+    /* Number of primes found. */
+    int cnt;
+    /* Indicates threads must stop searching. */
+    volatile int stop;
+    /* Size of each prime in bytes. */
+    int primeSz;
+    /* Public exponent as a big-endian byte array. */
+    unsigned char e[sizeof(long)];
+    /* Size of public exponent in bytes. */
+    int eSz;
+} we_RsaPrimeSearch;
+
+/**
+ * Thread function that searches for primes.
+ *
+ * Each thread tests an independent stream of candidates from its own random
+ * number generator. All threads stop when two primes have been found.
+ *
+ * @param  arg  [in]  Prime search state.
+ * @returns  NULL always.
+ */
+static void *we_rsa_prime_search_worker(void *arg)
+{
+    int rc;
+    WC_RNG rng;
+    we_RsaPrimeSearch *search = (we_RsaPrimeSearch *)arg;
+    unsigned char prime[WE_RSA_MAX_PRIME_SZ];
+
+    WOLFENGINE_ENTER("we_rsa_prime_search_worker");
+
+    rc = wc_InitRng(&rng);
+    if (rc != 0) {
+        WOLFENGINE_ERROR_FUNC("wc_InitRng", rc);
+    }
+    else {
+        while (we_rsa_gen_prime(&rng, prime, search->primeSz, search->e,
+                                search->eSz, &search->stop) == 1) {
+            pthread_mutex_lock(&search->mutex);
+            if (search->cnt < 2) {
+                XMEMCPY(search->primes[search->cnt], prime, search->primeSz);
+                search->cnt++;
+            }
+            if (search->cnt == 2) {
+                search->stop = 1;
+            }
+            pthread_mutex_unlock(&search->mutex);
+        }
+
+        OPENSSL_cleanse(prime, sizeof(prime));
+        wc_FreeRng(&rng);
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_prime_search_worker", 0);
+
+    return NULL;
+}
+
+/**
+ * Set the number of threads that search for primes when generating an RSA
+ * key on demand.
+ *
+ * @param  threads  [in]  Number of threads. 0 or 1 disables parallel search.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_rsa_keygen_set_threads(long threads)
+{
+    int ret = 1;
+
+    WOLFENGINE_ENTER("we_rsa_keygen_set_threads");
+
+    if (threads < 0 || threads > WE_RSA_PRIME_MAX_THREADS) {
+        WOLFENGINE_ERROR_MSG("Invalid RSA key generation thread count");
+        ret = 0;
+    }
+    if (ret == 1) {
+        we_rsa_keygen_threads = (int)threads;
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_keygen_set_threads", ret);
+
+    return ret;
+}
+
+/**
+ * Generate an RSA key by searching for both primes on multiple threads.
+ *
+ * The caller falls back to generating the key with wolfCrypt when parallel
+ * search is disabled or the key size is not supported.
+ *
+ * @param  bits    [in]   Size of RSA key/modulus in bits.
+ * @param  pubExp  [in]   Public exponent.
+ * @param  rsa     [out]  New RSA key or NULL when parallel search not used.
+ * @returns  1 on success and 0 on failure.
+ */
+int we_rsa_parallel_keygen(int bits, long pubExp, RSA **rsa)
+{
+    int ret = 1;
+    int rc;
+    int i;
+    int threads = we_rsa_keygen_threads;
+    int started = 0;
+    we_RsaPrimeSearch *search = NULL;
+    pthread_t thread[WE_RSA_PRIME_MAX_THREADS];
+
+    WOLFENGINE_ENTER("we_rsa_parallel_keygen");
+
+    *rsa = NULL;
+
+    if (threads > 1 && bits <= RSA_MAX_SIZE && (bits % 16) == 0) {
+        search = (we_RsaPrimeSearch *)OPENSSL_zalloc(sizeof(*search));
+        if (search == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_zalloc", search);
+            ret = 0;
+        }
+        if (ret == 1) {
+            pthread_mutex_init(&search->mutex, NULL);
+            search->primeSz = bits / 16;
+            /* Encode public exponent as big-endian bytes, no leading zeros. */
+            for (i = sizeof(long) - 1; i >= 0; i--) {
+                if (search->eSz > 0 || ((pubExp >> (i * 8)) & 0xff) != 0) {
+                    search->e[search->eSz++] = (pubExp >> (i * 8)) & 0xff;
+                }
+            }
+
+            WOLFENGINE_MSG("Searching for RSA primes on multiple threads");
+            for (i = 0; i < threads; i++) {
+                rc = pthread_create(&thread[i], NULL,
+                                    we_rsa_prime_search_worker, search);
+                if (rc != 0) {
+                    WOLFENGINE_ERROR_FUNC("pthread_create", rc);
+                    break;
+                }
+                started++;
+            }
+            for (i = 0; i < started; i++) {
+                pthread_join(thread[i], NULL);
+            }
+            if (search->cnt < 2) {
+                WOLFENGINE_ERROR_MSG("Failed to find RSA primes");
+                ret = 0;
+            }
+        }
+        if (ret == 1) {
+            ret = we_rsa_from_primes(search->primes[0], search->primes[1],
+                                     search->primeSz, pubExp, we_rng, rsa);
+        }
+        if (search != NULL) {
+            pthread_mutex_destroy(&search->mutex);
+            OPENSSL_clear_free(search, sizeof(*search));
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_rsa_parallel_keygen", ret);
+
+    return ret;
+}
+
+#endif /* WE_HAVE_RSA_KEYGEN_THREADS */
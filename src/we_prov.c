@@ -0,0 +1,1324 @@
+/* we_prov.c
+ *
+ * Copyright (C) 2019-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfEngine.
+ *
+ * wolfEngine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfengine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#include "internal.h"
+
+#ifdef WE_HAVE_PROVIDER
+
+#include <openssl/core.h>
+#include <openssl/core_dispatch.h>
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#include <limits.h>
+
+#ifdef WE_HAVE_THREADS
+#include <pthread.h>
+
+/* Protects the engine shared by the instances of the provider. */
+static pthread_mutex_t we_prov_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define WE_PROV_LOCK()          pthread_mutex_lock(&we_prov_mutex)
+#define WE_PROV_UNLOCK()        pthread_mutex_unlock(&we_prov_mutex)
+#else
+/* Provider is only loaded from one thread at a time without thread support. */
+#define WE_PROV_LOCK()
+#define WE_PROV_UNLOCK()
+#endif
+
+/* Maximum size of an AEAD tag in bytes. */
+#define WE_PROV_MAX_TAG_SIZE    16
+
+/* Property string that selects the algorithms of this provider. */
+#define WE_PROV_PROPS           "provider=libwolfprov"
+
+/* Name reported by the provider. */
+static const char *we_prov_name = "wolfEngine Provider";
+/* Version reported by the provider. */
+static const char *we_prov_version = "1.0.0";
+
+/*
+ * The provider implements its algorithms with the engine's EVP methods. The
+ * provider library is built from the engine sources and only exports
+ * OSSL_provider_init, so its engine doesn't share state with a wolfEngine
+ * loaded into the same process.
+ */
+
+/** Engine with the digest and cipher methods - one for all instances. */
+static ENGINE *we_prov_engine = NULL;
+/** Number of loaded instances of the provider using the engine. */
+static int we_prov_engine_cnt = 0;
+
+/**
+ * Create and initialize the engine on first use by an instance.
+ *
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_prov_engine_get(void)
+{
+    int ret = 1;
+    ENGINE *e = NULL;
+
+    WOLFENGINE_ENTER("we_prov_engine_get");
+
+    WE_PROV_LOCK();
+    if (we_prov_engine_cnt == 0) {
+        e = ENGINE_new();
+        if (e == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("ENGINE_new", e);
+            ret = 0;
+        }
+        if ((ret == 1) && (wolfengine_bind(e, NULL) != 1)) {
+            WOLFENGINE_ERROR_FUNC("wolfengine_bind", 0);
+            ret = 0;
+        }
+        if ((ret == 1) && (ENGINE_init(e) != 1)) {
+            WOLFENGINE_ERROR_FUNC("ENGINE_init", 0);
+            ret = 0;
+        }
+        if (ret == 1) {
+            we_prov_engine = e;
+        }
+        else {
+            ENGINE_free(e);
+        }
+    }
+    if (ret == 1) {
+        we_prov_engine_cnt++;
+    }
+    WE_PROV_UNLOCK();
+
+    WOLFENGINE_LEAVE("we_prov_engine_get", ret);
+
+    return ret;
+}
+
+/**
+ * Release the engine. Freed when the last instance is unloaded.
+ */
+static void we_prov_engine_put(void)
+{
+    WOLFENGINE_ENTER("we_prov_engine_put");
+
+    WE_PROV_LOCK();
+    if ((we_prov_engine_cnt > 0) && (--we_prov_engine_cnt == 0)) {
+        ENGINE_finish(we_prov_engine);
+        ENGINE_free(we_prov_engine);
+        we_prov_engine = NULL;
+    }
+    WE_PROV_UNLOCK();
+
+    WOLFENGINE_LEAVE("we_prov_engine_put", 1);
+}
+
+/**
+ * Provider context - one per loaded instance of the provider.
+ */
+typedef struct we_ProvCtx {
+    /** Handle from OpenSSL core for this instance. */
+    const OSSL_CORE_HANDLE *handle;
+} we_ProvCtx;
+
+#ifdef WE_HAVE_DIGEST
+
+/*
+ * Digests
+ */
+
+/**
+ * Data required to perform a digest operation.
+ */
+typedef struct we_ProvDigest {
+    /** EVP digest context using the engine's method. */
+    EVP_MD_CTX *ctx;
+    /** NID of digest algorithm. */
+    int         nid;
+} we_ProvDigest;
+
+/**
+ * Create a new digest context for the digest algorithm.
+ *
+ * @param  nid  [in]  NID of digest algorithm.
+ * @returns  New digest context on success and NULL on failure.
+ */
+static we_ProvDigest *we_prov_digest_new(int nid)
+{
+    we_ProvDigest *digest;
+
+    WOLFENGINE_ENTER("we_prov_digest_new");
+
+    digest = (we_ProvDigest *)OPENSSL_zalloc(sizeof(*digest));
+    if (digest == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_zalloc", digest);
+    }
+    else {
+        digest->nid = nid;
+        digest->ctx = EVP_MD_CTX_new();
+        if (digest->ctx == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("EVP_MD_CTX_new", digest->ctx);
+            OPENSSL_free(digest);
+            digest = NULL;
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_prov_digest_new", digest != NULL);
+
+    return digest;
+}
+
+/**
+ * Free the digest context.
+ *
+ * @param  vctx  [in]  Digest context to free.
+ */
+static void we_prov_digest_free(void *vctx)
+{
+    we_ProvDigest *digest = (we_ProvDigest *)vctx;
+
+    WOLFENGINE_ENTER("we_prov_digest_free");
+
+    if (digest != NULL) {
+        EVP_MD_CTX_free(digest->ctx);
+        OPENSSL_free(digest);
+    }
+
+    WOLFENGINE_LEAVE("we_prov_digest_free", 1);
+}
+
+/**
+ * Duplicate the digest context including the state of the hash.
+ *
+ * @param  vctx  [in]  Digest context to duplicate.
+ * @returns  New digest context on success and NULL on failure.
+ */
+static void *we_prov_digest_dup(void *vctx)
+{
+    we_ProvDigest *src = (we_ProvDigest *)vctx;
+    we_ProvDigest *dst;
+
+    WOLFENGINE_ENTER("we_prov_digest_dup");
+
+    dst = we_prov_digest_new(src->nid);
+    if ((dst != NULL) && (EVP_MD_CTX_md(src->ctx) != NULL) &&
+            (EVP_MD_CTX_copy_ex(dst->ctx, src->ctx) != 1)) {
+        WOLFENGINE_ERROR_FUNC("EVP_MD_CTX_copy_ex", 0);
+        we_prov_digest_free(dst);
+        dst = NULL;
+    }
+
+    WOLFENGINE_LEAVE("we_prov_digest_dup", dst != NULL);
+
+    return dst;
+}
+
+/**
+ * Initialize the digest operation with the engine's method.
+ *
+ * @param  vctx    [in]  Digest context.
+ * @param  params  [in]  Parameters - none supported.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_prov_digest_init(void *vctx, const OSSL_PARAM params[])
+{
+    int ret = 1;
+    we_ProvDigest *digest = (we_ProvDigest *)vctx;
+    const EVP_MD *md;
+
+    WOLFENGINE_ENTER("we_prov_digest_init");
+
+    (void)params;
+
+    md = ENGINE_get_digest(we_prov_engine, digest->nid);
+    if (md == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("ENGINE_get_digest", (void *)md);
+        ret = 0;
+    }
+    if ((ret == 1) &&
+            (EVP_DigestInit_ex(digest->ctx, md, we_prov_engine) != 1)) {
+        WOLFENGINE_ERROR_FUNC("EVP_DigestInit_ex", 0);
+        ret = 0;
+    }
+
+    WOLFENGINE_LEAVE("we_prov_digest_init", ret);
+
+    return ret;
+}
+
+/**
+ * Digest some more data.
+ *
+ * @param  vctx  [in]  Digest context.
+ * @param  data  [in]  More data to digest.
+ * @param  len   [in]  Length of data to digest.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_prov_digest_update(void *vctx, const unsigned char *data,
+                                 size_t len)
+{
+    int ret;
+    we_ProvDigest *digest = (we_ProvDigest *)vctx;
+
+    WOLFENGINE_ENTER("we_prov_digest_update");
+
+    ret = EVP_DigestUpdate(digest->ctx, data, len);
+    if (ret != 1) {
+        WOLFENGINE_ERROR_FUNC("EVP_DigestUpdate", ret);
+        ret = 0;
+    }
+
+    WOLFENGINE_LEAVE("we_prov_digest_update", ret);
+
+    return ret;
+}
+
+/**
+ * Finalize the digest operation and output the digest.
+ *
+ * @param  vctx    [in]   Digest context.
+ * @param  md      [out]  Buffer to hold digest.
+ * @param  mdLen   [out]  Length of digest in bytes.
+ * @param  mdSize  [in]   Size of buffer in bytes.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_prov_digest_final(void *vctx, unsigned char *md, size_t *mdLen,
+                                size_t mdSize)
+{
+    int ret = 1;
+    we_ProvDigest *digest = (we_ProvDigest *)vctx;
+    unsigned int len = 0;
+
+    WOLFENGINE_ENTER("we_prov_digest_final");
+
+    if (mdSize < (size_t)EVP_MD_CTX_size(digest->ctx)) {
+        WOLFENGINE_ERROR_MSG("Digest buffer too small");
+        ret = 0;
+    }
+    if ((ret == 1) && (EVP_DigestFinal_ex(digest->ctx, md, &len) != 1)) {
+        WOLFENGINE_ERROR_FUNC("EVP_DigestFinal_ex", 0);
+        ret = 0;
+    }
+    if (ret == 1) {
+        *mdLen = len;
+    }
+
+    WOLFENGINE_LEAVE("we_prov_digest_final", ret);
+
+    return ret;
+}
+
+/**
+ * Get the fixed parameters of a digest algorithm from the engine's method.
+ *
+ * @param  params  [in,out]  Parameters to fill.
+ * @param  nid     [in]      NID of digest algorithm.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_prov_digest_get_params(OSSL_PARAM params[], int nid)
+{
+    int ret = 1;
+    const EVP_MD *md;
+    OSSL_PARAM *p;
+
+    WOLFENGINE_ENTER("we_prov_digest_get_params");
+
+    md = ENGINE_get_digest(we_prov_engine, nid);
+    if (md == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("ENGINE_get_digest", (void *)md);
+        ret = 0;
+    }
+    p = OSSL_PARAM_locate(params, OSSL_DIGEST_PARAM_BLOCK_SIZE);
+    if ((ret == 1) && (p != NULL) &&
+            (!OSSL_PARAM_set_size_t(p, EVP_MD_block_size(md)))) {
+        WOLFENGINE_ERROR_FUNC("OSSL_PARAM_set_size_t", 0);
+        ret = 0;
+    }
+    p = OSSL_PARAM_locate(params, OSSL_DIGEST_PARAM_SIZE);
+    if ((ret == 1) && (p != NULL) &&
+            (!OSSL_PARAM_set_size_t(p, EVP_MD_size(md)))) {
+        WOLFENGINE_ERROR_FUNC("OSSL_PARAM_set_size_t", 0);
+        ret = 0;
+    }
+
+    WOLFENGINE_LEAVE("we_prov_digest_get_params", ret);
+
+    return ret;
+}
+
+/** Fixed parameters of a digest algorithm that can be retrieved. */
+static const OSSL_PARAM we_prov_digest_gettable[] = {
+    OSSL_PARAM_size_t(OSSL_DIGEST_PARAM_BLOCK_SIZE, NULL),
+    OSSL_PARAM_size_t(OSSL_DIGEST_PARAM_SIZE, NULL),
+    OSSL_PARAM_END
+};
+
+/**
+ * Get the table of digest parameters that can be retrieved.
+ *
+ * @param  provCtx  [in]  Provider context. Unused.
+ * @returns  Parameter table.
+ */
+static const OSSL_PARAM *we_prov_digest_gettable_params(void *provCtx)
+{
+    (void)provCtx;
+    return we_prov_digest_gettable;
+}
+
+/*
+ * Define the new context and parameter functions, and the dispatch table, of
+ * a digest algorithm.
+ *
+ * @param  alg  Algorithm name to use in identifiers.
+ * @param  nid  NID of digest algorithm.
+ */
+#define WE_PROV_DIGEST(alg, nid)                                              \
+static void *we_prov_##alg##_new(void *provCtx)                               \
+{                                                                             \
+    (void)provCtx;                                                            \
+    return we_prov_digest_new(nid);                                           \
+}                                                                             \
+static int we_prov_##alg##_get_params(OSSL_PARAM params[])                    \
+{                                                                             \
+    return we_prov_digest_get_params(params, nid);                            \
+}                                                                             \
+static const OSSL_DISPATCH we_prov_##alg##_funcs[] = {                        \
+    { OSSL_FUNC_DIGEST_NEWCTX, (void (*)(void))we_prov_##alg##_new },         \
+    { OSSL_FUNC_DIGEST_INIT, (void (*)(void))we_prov_digest_init },           \
+    { OSSL_FUNC_DIGEST_UPDATE, (void (*)(void))we_prov_digest_update },       \
+    { OSSL_FUNC_DIGEST_FINAL, (void (*)(void))we_prov_digest_final },         \
+    { OSSL_FUNC_DIGEST_FREECTX, (void (*)(void))we_prov_digest_free },        \
+    { OSSL_FUNC_DIGEST_DUPCTX, (void (*)(void))we_prov_digest_dup },          \
+    { OSSL_FUNC_DIGEST_GET_PARAMS, (void (*)(void))we_prov_##alg##_get_params },\
+    { OSSL_FUNC_DIGEST_GETTABLE_PARAMS,                                       \
+      (void (*)(void))we_prov_digest_gettable_params },                       \
+    { 0, NULL }                                                               \
+}
+
+#ifdef WE_HAVE_SHA1
+WE_PROV_DIGEST(sha1, NID_sha1);
+#endif
+#ifdef WE_HAVE_SHA224
+WE_PROV_DIGEST(sha224, NID_sha224);
+#endif
+#ifdef WE_HAVE_SHA256
+WE_PROV_DIGEST(sha256, NID_sha256);
+#endif
+#ifdef WE_HAVE_SHA384
+WE_PROV_DIGEST(sha384, NID_sha384);
+#endif
+#ifdef WE_HAVE_SHA512
+WE_PROV_DIGEST(sha512, NID_sha512);
+#endif
+#ifdef WE_HAVE_SHA3_224
+WE_PROV_DIGEST(sha3_224, NID_sha3_224);
+#endif
+#ifdef WE_HAVE_SHA3_256
+WE_PROV_DIGEST(sha3_256, NID_sha3_256);
+#endif
+#ifdef WE_HAVE_SHA3_384
+WE_PROV_DIGEST(sha3_384, NID_sha3_384);
+#endif
+#ifdef WE_HAVE_SHA3_512
+WE_PROV_DIGEST(sha3_512, NID_sha3_512);
+#endif
+
+/** Digest algorithms implemented by the provider. */
+static const OSSL_ALGORITHM we_prov_digests[] = {
+#ifdef WE_HAVE_SHA1
+    { "SHA1:SHA-1:SSL3-SHA1:1.3.14.3.2.26", WE_PROV_PROPS,
+      we_prov_sha1_funcs, NULL },
+#endif
+#ifdef WE_HAVE_SHA224
+    { "SHA2-224:SHA-224:SHA224:2.16.840.1.101.3.4.2.4", WE_PROV_PROPS,
+      we_prov_sha224_funcs, NULL },
+#endif
+#ifdef WE_HAVE_SHA256
+    { "SHA2-256:SHA-256:SHA256:2.16.840.1.101.3.4.2.1", WE_PROV_PROPS,
+      we_prov_sha256_funcs, NULL },
+#endif
+#ifdef WE_HAVE_SHA384
+    { "SHA2-384:SHA-384:SHA384:2.16.840.1.101.3.4.2.2", WE_PROV_PROPS,
+      we_prov_sha384_funcs, NULL },
+#endif
+#ifdef WE_HAVE_SHA512
+    { "SHA2-512:SHA-512:SHA512:2.16.840.1.101.3.4.2.3", WE_PROV_PROPS,
+      we_prov_sha512_funcs, NULL },
+#endif
+#ifdef WE_HAVE_SHA3_224
+    { "SHA3-224:2.16.840.1.101.3.4.2.7", WE_PROV_PROPS,
+      we_prov_sha3_224_funcs, NULL },
+#endif
+#ifdef WE_HAVE_SHA3_256
+    { "SHA3-256:2.16.840.1.101.3.4.2.8", WE_PROV_PROPS,
+      we_prov_sha3_256_funcs, NULL },
+#endif
+#ifdef WE_HAVE_SHA3_384
+    { "SHA3-384:2.16.840.1.101.3.4.2.9", WE_PROV_PROPS,
+      we_prov_sha3_384_funcs, NULL },
+#endif
+#ifdef WE_HAVE_SHA3_512
+    { "SHA3-512:2.16.840.1.101.3.4.2.10", WE_PROV_PROPS,
+      we_prov_sha3_512_funcs, NULL },
+#endif
+    { NULL, NULL, NULL, NULL }
+};
+
+#endif /* WE_HAVE_DIGEST */
+
+/*
+ * Ciphers
+ */
+
+/**
+ * Data required to perform a cipher operation.
+ */
+typedef struct we_ProvCipher {
+    /** EVP cipher context using the engine's method. */
+    EVP_CIPHER_CTX *ctx;
+    /** NID of cipher algorithm. */
+    int             nid;
+    /** Length of tag in bytes - AEAD only. */
+    size_t          tagLen;
+} we_ProvCipher;
+
+/**
+ * Create a new cipher context for the cipher algorithm.
+ *
+ * @param  nid  [in]  NID of cipher algorithm.
+ * @returns  New cipher context on success and NULL on failure.
+ */
+static we_ProvCipher *we_prov_cipher_new(int nid)
+{
+    we_ProvCipher *cipher;
+
+    WOLFENGINE_ENTER("we_prov_cipher_new");
+
+    cipher = (we_ProvCipher *)OPENSSL_zalloc(sizeof(*cipher));
+    if (cipher == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_zalloc", cipher);
+    }
+    else {
+        cipher->nid = nid;
+        /* Tag always full size on calculation. */
+        cipher->tagLen = WE_PROV_MAX_TAG_SIZE;
+        cipher->ctx = EVP_CIPHER_CTX_new();
+        if (cipher->ctx == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("EVP_CIPHER_CTX_new", cipher->ctx);
+            OPENSSL_free(cipher);
+            cipher = NULL;
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_prov_cipher_new", cipher != NULL);
+
+    return cipher;
+}
+
+/**
+ * Free the cipher context.
+ *
+ * @param  vctx  [in]  Cipher context to free.
+ */
+static void we_prov_cipher_free(void *vctx)
+{
+    we_ProvCipher *cipher = (we_ProvCipher *)vctx;
+
+    WOLFENGINE_ENTER("we_prov_cipher_free");
+
+    if (cipher != NULL) {
+        EVP_CIPHER_CTX_free(cipher->ctx);
+        OPENSSL_free(cipher);
+    }
+
+    WOLFENGINE_LEAVE("we_prov_cipher_free", 1);
+}
+
+/**
+ * Duplicate the cipher context including the state of the operation.
+ *
+ * @param  vctx  [in]  Cipher context to duplicate.
+ * @returns  New cipher context on success and NULL on failure.
+ */
+static void *we_prov_cipher_dup(void *vctx)
+{
+    we_ProvCipher *src = (we_ProvCipher *)vctx;
+    we_ProvCipher *dst;
+
+    WOLFENGINE_ENTER("we_prov_cipher_dup");
+
+    dst = we_prov_cipher_new(src->nid);
+    if (dst != NULL) {
+        dst->tagLen = src->tagLen;
+        /* Engine's method deep copies the AAD and streaming state. */
+        if ((EVP_CIPHER_CTX_cipher(src->ctx) != NULL) &&
+                (EVP_CIPHER_CTX_copy(dst->ctx, src->ctx) != 1)) {
+            WOLFENGINE_ERROR_FUNC("EVP_CIPHER_CTX_copy", 0);
+            we_prov_cipher_free(dst);
+            dst = NULL;
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_prov_cipher_dup", dst != NULL);
+
+    return dst;
+}
+
+/* Forward declaration. */
+static int we_prov_cipher_set_ctx_params(void *vctx,
+                                         const OSSL_PARAM params[]);
+
+/**
+ * Initialize the encrypt/decrypt operation with the engine's method.
+ *
+ * Parameters are set after the method so that the IV length can be changed
+ * before the IV is set.
+ *
+ * @param  cipher  [in,out]  Cipher context.
+ * @param  key     [in]      Key. May be NULL.
+ * @param  keyLen  [in]      Length of key in bytes.
+ * @param  iv      [in]      IV/nonce. May be NULL.
+ * @param  ivLen   [in]      Length of IV/nonce in bytes.
+ * @param  params  [in]      Parameters to set. May be NULL.
+ * @param  enc     [in]      1 when initializing for encrypt and 0 when decrypt.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_prov_cipher_init(we_ProvCipher *cipher, const unsigned char *key,
+                               size_t keyLen, const unsigned char *iv,
+                               size_t ivLen, const OSSL_PARAM params[],
+                               int enc)
+{
+    int ret = 1;
+    const EVP_CIPHER *c;
+
+    WOLFENGINE_ENTER("we_prov_cipher_init");
+
+    if (EVP_CIPHER_CTX_cipher(cipher->ctx) == NULL) {
+        c = ENGINE_get_cipher(we_prov_engine, cipher->nid);
+        if (c == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("ENGINE_get_cipher", (void *)c);
+            ret = 0;
+        }
+        if ((ret == 1) && (EVP_CipherInit_ex(cipher->ctx, c, we_prov_engine,
+                                             NULL, NULL, enc) != 1)) {
+            WOLFENGINE_ERROR_FUNC("EVP_CipherInit_ex", 0);
+            ret = 0;
+        }
+    }
+    else if ((key == NULL) && (iv == NULL)) {
+        /* Start a new operation without changing key or IV. */
+        if (EVP_CipherInit_ex(cipher->ctx, NULL, NULL, NULL, NULL, enc) != 1) {
+            WOLFENGINE_ERROR_FUNC("EVP_CipherInit_ex", 0);
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        ret = we_prov_cipher_set_ctx_params(cipher, params);
+    }
+    if ((ret == 1) && (key != NULL) &&
+            (keyLen != (size_t)EVP_CIPHER_CTX_key_length(cipher->ctx))) {
+        WOLFENGINE_ERROR_MSG("Invalid key length");
+        ret = 0;
+    }
+    if ((ret == 1) && (iv != NULL) &&
+            (ivLen < (size_t)EVP_CIPHER_CTX_iv_length(cipher->ctx))) {
+        WOLFENGINE_ERROR_MSG("Invalid IV length");
+        ret = 0;
+    }
+    if ((ret == 1) && ((key != NULL) || (iv != NULL)) &&
+            (EVP_CipherInit_ex(cipher->ctx, NULL, NULL, key, iv, enc) != 1)) {
+        WOLFENGINE_ERROR_FUNC("EVP_CipherInit_ex", 0);
+        ret = 0;
+    }
+
+    WOLFENGINE_LEAVE("we_prov_cipher_init", ret);
+
+    return ret;
+}
+
+/**
+ * Initialize the encrypt operation.
+ *
+ * @param  vctx    [in,out]  Cipher context.
+ * @param  key     [in]      Key. May be NULL.
+ * @param  keyLen  [in]      Length of key in bytes.
+ * @param  iv      [in]      IV/nonce. May be NULL.
+ * @param  ivLen   [in]      Length of IV/nonce in bytes.
+ * @param  params  [in]      Parameters to set. May be NULL.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_prov_cipher_einit(void *vctx, const unsigned char *key,
+                                size_t keyLen, const unsigned char *iv,
+                                size_t ivLen, const OSSL_PARAM params[])
+{
+    return we_prov_cipher_init((we_ProvCipher *)vctx, key, keyLen, iv, ivLen,
+                               params, 1);
+}
+
+/**
+ * Initialize the decrypt operation.
+ *
+ * @param  vctx    [in,out]  Cipher context.
+ * @param  key     [in]      Key. May be NULL.
+ * @param  keyLen  [in]      Length of key in bytes.
+ * @param  iv      [in]      IV/nonce. May be NULL.
+ * @param  ivLen   [in]      Length of IV/nonce in bytes.
+ * @param  params  [in]      Parameters to set. May be NULL.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_prov_cipher_dinit(void *vctx, const unsigned char *key,
+                                size_t keyLen, const unsigned char *iv,
+                                size_t ivLen, const OSSL_PARAM params[])
+{
+    return we_prov_cipher_init((we_ProvCipher *)vctx, key, keyLen, iv, ivLen,
+                               params, 0);
+}
+
+/**
+ * Encrypt/decrypt more data, or add AAD for AEAD algorithms.
+ * Streaming - partial blocks are buffered by the engine's method.
+ *
+ * @param  vctx     [in,out]  Cipher context.
+ * @param  out      [out]     Buffer to hold enciphered data.<br>
+ *                            NULL indicates AAD in.
+ * @param  outLen   [out]     Length of data output in bytes.
+ * @param  outSize  [in]      Size of output buffer in bytes.
+ * @param  in       [in]      AAD or data to encrypt/decrypt.
+ * @param  inLen    [in]      Length of AAD or data in bytes.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_prov_cipher_update(void *vctx, unsigned char *out,
+                                 size_t *outLen, size_t outSize,
+                                 const unsigned char *in, size_t inLen)
+{
+    int ret = 1;
+    we_ProvCipher *cipher = (we_ProvCipher *)vctx;
+    int blockSize;
+    int len = 0;
+
+    WOLFENGINE_ENTER("we_prov_cipher_update");
+
+    if (inLen > INT_MAX) {
+        WOLFENGINE_ERROR_MSG("Input too long");
+        ret = 0;
+    }
+    if ((ret == 1) && (out != NULL)) {
+        /* Buffered data may be output with input - up to a block less one. */
+        blockSize = EVP_CIPHER_CTX_block_size(cipher->ctx);
+        if (outSize < inLen + blockSize - 1) {
+            WOLFENGINE_ERROR_MSG("Output buffer too small");
+            ret = 0;
+        }
+    }
+    if ((ret == 1) && (EVP_CipherUpdate(cipher->ctx, out, &len, in,
+                                        (int)inLen) != 1)) {
+        WOLFENGINE_ERROR_FUNC("EVP_CipherUpdate", 0);
+        ret = 0;
+    }
+    if (ret == 1) {
+        *outLen = len;
+    }
+
+    WOLFENGINE_LEAVE("we_prov_cipher_update", ret);
+
+    return ret;
+}
+
+/**
+ * Finish the encrypt/decrypt operation.
+ * Outputs the last block when padding and checks the tag of AEAD decryption.
+ *
+ * @param  vctx     [in,out]  Cipher context.
+ * @param  out      [out]     Buffer to hold enciphered data.
+ * @param  outLen   [out]     Length of data output in bytes.
+ * @param  outSize  [in]      Size of output buffer in bytes.
+ * @returns  1 on success and 0 on failure or when tag did not verify.
+ */
+static int we_prov_cipher_final(void *vctx, unsigned char *out,
+                                size_t *outLen, size_t outSize)
+{
+    int ret = 1;
+    we_ProvCipher *cipher = (we_ProvCipher *)vctx;
+    int blockSize;
+    int len = 0;
+
+    WOLFENGINE_ENTER("we_prov_cipher_final");
+
+    blockSize = EVP_CIPHER_CTX_block_size(cipher->ctx);
+    if ((blockSize > 1) && (outSize < (size_t)blockSize)) {
+        WOLFENGINE_ERROR_MSG("Output buffer too small");
+        ret = 0;
+    }
+    if ((ret == 1) && (EVP_CipherFinal_ex(cipher->ctx, out, &len) != 1)) {
+        WOLFENGINE_ERROR_FUNC("EVP_CipherFinal_ex", 0);
+        ret = 0;
+    }
+    if (ret == 1) {
+        *outLen = len;
+    }
+
+    WOLFENGINE_LEAVE("we_prov_cipher_final", ret);
+
+    return ret;
+}
+
+/**
+ * Get the fixed parameters of a cipher algorithm from the engine's method.
+ *
+ * @param  params  [in,out]  Parameters to fill.
+ * @param  nid     [in]      NID of cipher algorithm.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_prov_cipher_get_params(OSSL_PARAM params[], int nid)
+{
+    int ret = 1;
+    const EVP_CIPHER *c;
+    unsigned long flags = 0;
+    OSSL_PARAM *p;
+
+    WOLFENGINE_ENTER("we_prov_cipher_get_params");
+
+    c = ENGINE_get_cipher(we_prov_engine, nid);
+    if (c == NULL) {
+        WOLFENGINE_ERROR_FUNC_NULL("ENGINE_get_cipher", (void *)c);
+        ret = 0;
+    }
+    else {
+        flags = EVP_CIPHER_flags(c);
+    }
+    p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_MODE);
+    if ((ret == 1) && (p != NULL) &&
+            (!OSSL_PARAM_set_uint(p, EVP_CIPHER_mode(c)))) {
+        ret = 0;
+    }
+    p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_KEYLEN);
+    if ((ret == 1) && (p != NULL) &&
+            (!OSSL_PARAM_set_size_t(p, EVP_CIPHER_key_length(c)))) {
+        ret = 0;
+    }
+    p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_IVLEN);
+    if ((ret == 1) && (p != NULL) &&
+            (!OSSL_PARAM_set_size_t(p, EVP_CIPHER_iv_length(c)))) {
+        ret = 0;
+    }
+    p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_BLOCK_SIZE);
+    if ((ret == 1) && (p != NULL) &&
+            (!OSSL_PARAM_set_size_t(p, EVP_CIPHER_block_size(c)))) {
+        ret = 0;
+    }
+    p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_AEAD);
+    if ((ret == 1) && (p != NULL) &&
+            (!OSSL_PARAM_set_int(p,
+                                 (flags & EVP_CIPH_FLAG_AEAD_CIPHER) != 0))) {
+        ret = 0;
+    }
+    p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_CUSTOM_IV);
+    if ((ret == 1) && (p != NULL) &&
+            (!OSSL_PARAM_set_int(p, (flags & EVP_CIPH_CUSTOM_IV) != 0))) {
+        ret = 0;
+    }
+    if (ret == 0) {
+        WOLFENGINE_ERROR_MSG("Failed to set cipher parameter");
+    }
+
+    WOLFENGINE_LEAVE("we_prov_cipher_get_params", ret);
+
+    return ret;
+}
+
+/**
+ * Get parameters of the cipher operation - key length, IV length, padding and,
+ * for AEAD algorithms, tag.
+ *
+ * @param  vctx    [in]      Cipher context.
+ * @param  params  [in,out]  Parameters to fill.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_prov_cipher_get_ctx_params(void *vctx, OSSL_PARAM params[])
+{
+    int ret = 1;
+    we_ProvCipher *cipher = (we_ProvCipher *)vctx;
+    int pad;
+    OSSL_PARAM *p;
+
+    WOLFENGINE_ENTER("we_prov_cipher_get_ctx_params");
+
+    if (EVP_CIPHER_CTX_cipher(cipher->ctx) == NULL) {
+        WOLFENGINE_ERROR_MSG("Cipher operation not initialized");
+        ret = 0;
+    }
+    p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_KEYLEN);
+    if ((ret == 1) && (p != NULL) &&
+            (!OSSL_PARAM_set_size_t(p,
+                                   EVP_CIPHER_CTX_key_length(cipher->ctx)))) {
+        ret = 0;
+    }
+    p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_IVLEN);
+    if ((ret == 1) && (p != NULL) &&
+            (!OSSL_PARAM_set_size_t(p,
+                                    EVP_CIPHER_CTX_iv_length(cipher->ctx)))) {
+        ret = 0;
+    }
+    p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_PADDING);
+    if ((ret == 1) && (p != NULL)) {
+        pad = !EVP_CIPHER_CTX_test_flags(cipher->ctx, EVP_CIPH_NO_PADDING);
+        if (!OSSL_PARAM_set_uint(p, pad)) {
+            ret = 0;
+        }
+    }
+    p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_AEAD_TAGLEN);
+    if ((ret == 1) && (p != NULL) &&
+            (!OSSL_PARAM_set_size_t(p, cipher->tagLen))) {
+        ret = 0;
+    }
+    p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_AEAD_TAG);
+    if ((ret == 1) && (p != NULL)) {
+        /* Tag only available after encrypting - checked by engine. */
+        if ((p->data_type != OSSL_PARAM_OCTET_STRING) ||
+                (p->data_size == 0) || (p->data_size > WE_PROV_MAX_TAG_SIZE) ||
+                (EVP_CIPHER_CTX_ctrl(cipher->ctx, EVP_CTRL_AEAD_GET_TAG,
+                                     (int)p->data_size, p->data) != 1)) {
+            WOLFENGINE_ERROR_MSG("Tag not available");
+            ret = 0;
+        }
+        else {
+            p->return_size = p->data_size;
+        }
+    }
+    if (ret == 0) {
+        WOLFENGINE_ERROR_MSG("Failed to get cipher parameter");
+    }
+
+    WOLFENGINE_LEAVE("we_prov_cipher_get_ctx_params", ret);
+
+    return ret;
+}
+
+/**
+ * Set parameters of the cipher operation - key length, padding and, for AEAD
+ * algorithms, IV length and tag.
+ *
+ * @param  vctx    [in,out]  Cipher context.
+ * @param  params  [in]      Parameters to set. May be NULL.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_prov_cipher_set_ctx_params(void *vctx,
+                                         const OSSL_PARAM params[])
+{
+    int ret = 1;
+    we_ProvCipher *cipher = (we_ProvCipher *)vctx;
+    const OSSL_PARAM *p;
+    unsigned int pad;
+    size_t len;
+
+    WOLFENGINE_ENTER("we_prov_cipher_set_ctx_params");
+
+    if ((params != NULL) && (params[0].key != NULL) &&
+            (EVP_CIPHER_CTX_cipher(cipher->ctx) == NULL)) {
+        WOLFENGINE_ERROR_MSG("Cipher operation not initialized");
+        ret = 0;
+    }
+    if ((ret == 1) && (params != NULL)) {
+        p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_KEYLEN);
+        if ((p != NULL) && ((!OSSL_PARAM_get_size_t(p, &len)) ||
+                 (len != (size_t)EVP_CIPHER_CTX_key_length(cipher->ctx)))) {
+            WOLFENGINE_ERROR_MSG("Invalid key length");
+            ret = 0;
+        }
+        p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_PADDING);
+        if ((ret == 1) && (p != NULL)) {
+            if (!OSSL_PARAM_get_uint(p, &pad)) {
+                WOLFENGINE_ERROR_MSG("Invalid padding");
+                ret = 0;
+            }
+            else {
+                EVP_CIPHER_CTX_set_padding(cipher->ctx, pad);
+            }
+        }
+        p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_AEAD_IVLEN);
+        if ((ret == 1) && (p != NULL)) {
+            if ((!OSSL_PARAM_get_size_t(p, &len)) || (len > INT_MAX) ||
+                    (EVP_CIPHER_CTX_ctrl(cipher->ctx, EVP_CTRL_AEAD_SET_IVLEN,
+                                         (int)len, NULL) != 1)) {
+                WOLFENGINE_ERROR_MSG("Invalid nonce length");
+                ret = 0;
+            }
+        }
+        p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_AEAD_TAG);
+        if ((ret == 1) && (p != NULL)) {
+            /* No data when only setting the tag length for encryption. */
+            if ((p->data_type != OSSL_PARAM_OCTET_STRING) ||
+                    (p->data_size > WE_PROV_MAX_TAG_SIZE) ||
+                    (EVP_CIPHER_CTX_ctrl(cipher->ctx, EVP_CTRL_AEAD_SET_TAG,
+                                         (int)p->data_size, p->data) != 1)) {
+                WOLFENGINE_ERROR_MSG("Invalid tag");
+                ret = 0;
+            }
+            else {
+                cipher->tagLen = p->data_size;
+            }
+        }
+    }
+
+    WOLFENGINE_LEAVE("we_prov_cipher_set_ctx_params", ret);
+
+    return ret;
+}
+
+/** Fixed parameters of a cipher algorithm that can be retrieved. */
+static const OSSL_PARAM we_prov_cipher_gettable[] = {
+    OSSL_PARAM_uint(OSSL_CIPHER_PARAM_MODE, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_IVLEN, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_BLOCK_SIZE, NULL),
+    OSSL_PARAM_int(OSSL_CIPHER_PARAM_AEAD, NULL),
+    OSSL_PARAM_int(OSSL_CIPHER_PARAM_CUSTOM_IV, NULL),
+    OSSL_PARAM_END
+};
+
+/** Parameters of a cipher operation that can be retrieved. */
+static const OSSL_PARAM we_prov_cipher_ctx_gettable[] = {
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_IVLEN, NULL),
+    OSSL_PARAM_uint(OSSL_CIPHER_PARAM_PADDING, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_AEAD_TAGLEN, NULL),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_AEAD_TAG, NULL, 0),
+    OSSL_PARAM_END
+};
+
+/** Parameters of a cipher operation that can be set. */
+static const OSSL_PARAM we_prov_cipher_ctx_settable[] = {
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
+    OSSL_PARAM_uint(OSSL_CIPHER_PARAM_PADDING, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_AEAD_IVLEN, NULL),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_AEAD_TAG, NULL, 0),
+    OSSL_PARAM_END
+};
+
+/**
+ * Get the table of cipher algorithm parameters that can be retrieved.
+ *
+ * @param  provCtx  [in]  Provider context. Unused.
+ * @returns  Parameter table.
+ */
+static const OSSL_PARAM *we_prov_cipher_gettable_params(void *provCtx)
+{
+    (void)provCtx;
+    return we_prov_cipher_gettable;
+}
+
+/**
+ * Get the table of cipher operation parameters that can be retrieved.
+ *
+ * @param  vctx     [in]  Cipher context. Unused.
+ * @param  provCtx  [in]  Provider context. Unused.
+ * @returns  Parameter table.
+ */
+static const OSSL_PARAM *we_prov_cipher_gettable_ctx_params(void *vctx,
+                                                            void *provCtx)
+{
+    (void)vctx;
+    (void)provCtx;
+    return we_prov_cipher_ctx_gettable;
+}
+
+/**
+ * Get the table of cipher operation parameters that can be set.
+ *
+ * @param  vctx     [in]  Cipher context. Unused.
+ * @param  provCtx  [in]  Provider context. Unused.
+ * @returns  Parameter table.
+ */
+static const OSSL_PARAM *we_prov_cipher_settable_ctx_params(void *vctx,
+                                                            void *provCtx)
+{
+    (void)vctx;
+    (void)provCtx;
+    return we_prov_cipher_ctx_settable;
+}
+
+/*
+ * Define the new context and parameter functions, and the dispatch table, of
+ * a cipher algorithm.
+ *
+ * @param  alg  Algorithm name to use in identifiers.
+ * @param  nid  NID of cipher algorithm.
+ */
+#define WE_PROV_CIPHER(alg, nid)                                              \
+static void *we_prov_##alg##_new(void *provCtx)                               \
+{                                                                             \
+    (void)provCtx;                                                            \
+    return we_prov_cipher_new(nid);                                           \
+}                                                                             \
+static int we_prov_##alg##_get_params(OSSL_PARAM params[])                    \
+{                                                                             \
+    return we_prov_cipher_get_params(params, nid);                            \
+}                                                                             \
+static const OSSL_DISPATCH we_prov_##alg##_funcs[] = {                        \
+    { OSSL_FUNC_CIPHER_NEWCTX, (void (*)(void))we_prov_##alg##_new },         \
+    { OSSL_FUNC_CIPHER_FREECTX, (void (*)(void))we_prov_cipher_free },        \
+    { OSSL_FUNC_CIPHER_DUPCTX, (void (*)(void))we_prov_cipher_dup },          \
+    { OSSL_FUNC_CIPHER_ENCRYPT_INIT, (void (*)(void))we_prov_cipher_einit },  \
+    { OSSL_FUNC_CIPHER_DECRYPT_INIT, (void (*)(void))we_prov_cipher_dinit },  \
+    { OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))we_prov_cipher_update },       \
+    { OSSL_FUNC_CIPHER_FINAL, (void (*)(void))we_prov_cipher_final },         \
+    { OSSL_FUNC_CIPHER_GET_PARAMS, (void (*)(void))we_prov_##alg##_get_params },\
+    { OSSL_FUNC_CIPHER_GET_CTX_PARAMS,                                        \
+      (void (*)(void))we_prov_cipher_get_ctx_params },                        \
+    { OSSL_FUNC_CIPHER_SET_CTX_PARAMS,                                        \
+      (void (*)(void))we_prov_cipher_set_ctx_params },                        \
+    { OSSL_FUNC_CIPHER_GETTABLE_PARAMS,                                       \
+      (void (*)(void))we_prov_cipher_gettable_params },                       \
+    { OSSL_FUNC_CIPHER_GETTABLE_CTX_PARAMS,                                   \
+      (void (*)(void))we_prov_cipher_gettable_ctx_params },                   \
+    { OSSL_FUNC_CIPHER_SETTABLE_CTX_PARAMS,                                   \
+      (void (*)(void))we_prov_cipher_settable_ctx_params },                   \
+    { 0, NULL }                                                               \
+}
+
+#ifdef WE_HAVE_DES3CBC
+WE_PROV_CIPHER(des_ede3_cbc, NID_des_ede3_cbc);
+#endif
+#ifdef WE_HAVE_AESECB
+WE_PROV_CIPHER(aes128_ecb, NID_aes_128_ecb);
+WE_PROV_CIPHER(aes192_ecb, NID_aes_192_ecb);
+WE_PROV_CIPHER(aes256_ecb, NID_aes_256_ecb);
+#endif
+#ifdef WE_HAVE_AESCBC
+WE_PROV_CIPHER(aes128_cbc, NID_aes_128_cbc);
+WE_PROV_CIPHER(aes192_cbc, NID_aes_192_cbc);
+WE_PROV_CIPHER(aes256_cbc, NID_aes_256_cbc);
+#endif
+#ifdef WE_HAVE_AESCTR
+WE_PROV_CIPHER(aes128_ctr, NID_aes_128_ctr);
+WE_PROV_CIPHER(aes192_ctr, NID_aes_192_ctr);
+WE_PROV_CIPHER(aes256_ctr, NID_aes_256_ctr);
+#endif
+#ifdef WE_HAVE_AESGCM
+WE_PROV_CIPHER(aes128_gcm, NID_aes_128_gcm);
+WE_PROV_CIPHER(aes192_gcm, NID_aes_192_gcm);
+WE_PROV_CIPHER(aes256_gcm, NID_aes_256_gcm);
+#endif
+#ifdef WE_HAVE_AESCCM
+WE_PROV_CIPHER(aes128_ccm, NID_aes_128_ccm);
+WE_PROV_CIPHER(aes192_ccm, NID_aes_192_ccm);
+WE_PROV_CIPHER(aes256_ccm, NID_aes_256_ccm);
+#endif
+
+/** Cipher algorithms implemented by the provider. */
+static const OSSL_ALGORITHM we_prov_ciphers[] = {
+#ifdef WE_HAVE_DES3CBC
+    { "DES-EDE3-CBC:DES3:1.2.840.113549.3.7", WE_PROV_PROPS,
+      we_prov_des_ede3_cbc_funcs, NULL },
+#endif
+#ifdef WE_HAVE_AESECB
+    { "AES-128-ECB:2.16.840.1.101.3.4.1.1", WE_PROV_PROPS,
+      we_prov_aes128_ecb_funcs, NULL },
+    { "AES-192-ECB:2.16.840.1.101.3.4.1.21", WE_PROV_PROPS,
+      we_prov_aes192_ecb_funcs, NULL },
+    { "AES-256-ECB:2.16.840.1.101.3.4.1.41", WE_PROV_PROPS,
+      we_prov_aes256_ecb_funcs, NULL },
+#endif
+#ifdef WE_HAVE_AESCBC
+    { "AES-128-CBC:AES128:2.16.840.1.101.3.4.1.2", WE_PROV_PROPS,
+      we_prov_aes128_cbc_funcs, NULL },
+    { "AES-192-CBC:AES192:2.16.840.1.101.3.4.1.22", WE_PROV_PROPS,
+      we_prov_aes192_cbc_funcs, NULL },
+    { "AES-256-CBC:AES256:2.16.840.1.101.3.4.1.42", WE_PROV_PROPS,
+      we_prov_aes256_cbc_funcs, NULL },
+#endif
+#ifdef WE_HAVE_AESCTR
+    { "AES-128-CTR", WE_PROV_PROPS, we_prov_aes128_ctr_funcs, NULL },
+    { "AES-192-CTR", WE_PROV_PROPS, we_prov_aes192_ctr_funcs, NULL },
+    { "AES-256-CTR", WE_PROV_PROPS, we_prov_aes256_ctr_funcs, NULL },
+#endif
+#ifdef WE_HAVE_AESGCM
+    { "AES-128-GCM:id-aes128-GCM:2.16.840.1.101.3.4.1.6", WE_PROV_PROPS,
+      we_prov_aes128_gcm_funcs, NULL },
+    { "AES-192-GCM:id-aes192-GCM:2.16.840.1.101.3.4.1.26", WE_PROV_PROPS,
+      we_prov_aes192_gcm_funcs, NULL },
+    { "AES-256-GCM:id-aes256-GCM:2.16.840.1.101.3.4.1.46", WE_PROV_PROPS,
+      we_prov_aes256_gcm_funcs, NULL },
+#endif
+#ifdef WE_HAVE_AESCCM
+    { "AES-128-CCM:id-aes128-CCM:2.16.840.1.101.3.4.1.7", WE_PROV_PROPS,
+      we_prov_aes128_ccm_funcs, NULL },
+    { "AES-192-CCM:id-aes192-CCM:2.16.840.1.101.3.4.1.27", WE_PROV_PROPS,
+      we_prov_aes192_ccm_funcs, NULL },
+    { "AES-256-CCM:id-aes256-CCM:2.16.840.1.101.3.4.1.47", WE_PROV_PROPS,
+      we_prov_aes256_ccm_funcs, NULL },
+#endif
+    { NULL, NULL, NULL, NULL }
+};
+
+/*
+ * Provider
+ */
+
+/** Provider parameters that can be retrieved. */
+static const OSSL_PARAM we_prov_param_types[] = {
+    OSSL_PARAM_utf8_ptr(OSSL_PROV_PARAM_NAME, NULL, 0),
+    OSSL_PARAM_utf8_ptr(OSSL_PROV_PARAM_VERSION, NULL, 0),
+    OSSL_PARAM_int(OSSL_PROV_PARAM_STATUS, NULL),
+    OSSL_PARAM_END
+};
+
+/**
+ * Get the table of provider parameters that can be retrieved.
+ *
+ * @param  provCtx  [in]  Provider context. Unused.
+ * @returns  Parameter table.
+ */
+static const OSSL_PARAM *we_prov_gettable_params(void *provCtx)
+{
+    (void)provCtx;
+    return we_prov_param_types;
+}
+
+/**
+ * Get the provider parameters - name, version and status.
+ *
+ * @param  provCtx  [in]      Provider context. Unused.
+ * @param  params   [in,out]  Parameters to fill.
+ * @returns  1 on success and 0 on failure.
+ */
+static int we_prov_get_params(void *provCtx, OSSL_PARAM params[])
+{
+    int ret = 1;
+    OSSL_PARAM *p;
+
+    WOLFENGINE_ENTER("we_prov_get_params");
+
+    (void)provCtx;
+
+    p = OSSL_PARAM_locate(params, OSSL_PROV_PARAM_NAME);
+    if ((p != NULL) && (!OSSL_PARAM_set_utf8_ptr(p, we_prov_name))) {
+        ret = 0;
+    }
+    p = OSSL_PARAM_locate(params, OSSL_PROV_PARAM_VERSION);
+    if ((ret == 1) && (p != NULL) &&
+            (!OSSL_PARAM_set_utf8_ptr(p, we_prov_version))) {
+        ret = 0;
+    }
+    p = OSSL_PARAM_locate(params, OSSL_PROV_PARAM_STATUS);
+    if ((ret == 1) && (p != NULL) && (!OSSL_PARAM_set_int(p, 1))) {
+        ret = 0;
+    }
+
+    WOLFENGINE_LEAVE("we_prov_get_params", ret);
+
+    return ret;
+}
+
+/**
+ * Get the algorithms implemented for an operation.
+ * Tables are constant so OpenSSL may cache the fetched methods.
+ *
+ * @param  provCtx   [in]   Provider context. Unused.
+ * @param  opId      [in]   Operation identifier.
+ * @param  noCache   [out]  Whether OpenSSL must not cache the result.
+ * @returns  Table of algorithms on success and NULL when none.
+ */
+static const OSSL_ALGORITHM *we_prov_query(void *provCtx, int opId,
+                                           int *noCache)
+{
+    const OSSL_ALGORITHM *algs = NULL;
+
+    (void)provCtx;
+
+    *noCache = 0;
+    switch (opId) {
+#ifdef WE_HAVE_DIGEST
+        case OSSL_OP_DIGEST:
+            algs = we_prov_digests;
+            break;
+#endif
+        case OSSL_OP_CIPHER:
+            algs = we_prov_ciphers;
+            break;
+        default:
+            break;
+    }
+
+    return algs;
+}
+
+/**
+ * Dispose of the provider context and release the engine.
+ *
+ * @param  provCtx  [in]  Provider context.
+ */
+static void we_prov_teardown(void *provCtx)
+{
+    WOLFENGINE_ENTER("we_prov_teardown");
+
+    OPENSSL_free(provCtx);
+    we_prov_engine_put();
+
+    WOLFENGINE_LEAVE("we_prov_teardown", 1);
+}
+
+/** Provider functions called by OpenSSL core. */
+static const OSSL_DISPATCH we_prov_dispatch[] = {
+    { OSSL_FUNC_PROVIDER_TEARDOWN, (void (*)(void))we_prov_teardown },
+    { OSSL_FUNC_PROVIDER_GETTABLE_PARAMS,
+      (void (*)(void))we_prov_gettable_params },
+    { OSSL_FUNC_PROVIDER_GET_PARAMS, (void (*)(void))we_prov_get_params },
+    { OSSL_FUNC_PROVIDER_QUERY_OPERATION, (void (*)(void))we_prov_query },
+    { 0, NULL }
+};
+
+/**
+ * Entry point called by OpenSSL when loading the provider.
+ *
+ * @param  handle   [in]   Handle from OpenSSL core for this instance.
+ * @param  in       [in]   Core functions. Unused.
+ * @param  out      [out]  Provider functions.
+ * @param  provCtx  [out]  Provider context.
+ * @returns  1 on success and 0 on failure.
+ */
+int OSSL_provider_init(const OSSL_CORE_HANDLE *handle, const OSSL_DISPATCH *in,
+                       const OSSL_DISPATCH **out, void **provCtx)
+{
+    int ret;
+    we_ProvCtx *ctx = NULL;
+
+    WOLFENGINE_ENTER("OSSL_provider_init");
+
+    (void)in;
+
+    ret = we_prov_engine_get();
+    if (ret == 1) {
+        ctx = (we_ProvCtx *)OPENSSL_zalloc(sizeof(*ctx));
+        if (ctx == NULL) {
+            WOLFENGINE_ERROR_FUNC_NULL("OPENSSL_zalloc", ctx);
+            we_prov_engine_put();
+            ret = 0;
+        }
+    }
+    if (ret == 1) {
+        ctx->handle = handle;
+        *provCtx = ctx;
+        *out = we_prov_dispatch;
+    }
+
+    WOLFENGINE_LEAVE("OSSL_provider_init", ret);
+
+    return ret;
+}
+
+#endif /* WE_HAVE_PROVIDER */
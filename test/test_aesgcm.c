@@ -521,6 +521,160 @@ int test_aes128_gcm_tls(ENGINE *e, void *data)
                             EVP_GCM_TLS_FIXED_IV_LEN, 0);
 }
 
+#ifdef WE_HAVE_AESGCM_STREAM
+
+/* Encrypt or decrypt data in pieces, copying the context part way through. */
+static int test_aes_gcm_stream_crypt(ENGINE *e, const EVP_CIPHER *cipher,
+                                     unsigned char *key, unsigned char *iv,
+                                     unsigned char *aad, int aadLen,
+                                     unsigned char *in, int len,
+                                     unsigned char *out, unsigned char *dupOut,
+                                     unsigned char *tag, int enc)
+{
+    int err;
+    EVP_CIPHER_CTX *ctx;
+    EVP_CIPHER_CTX *dup = NULL;
+    int outLen;
+    int dupLen = 0;
+    int i;
+    int sz;
+    static const int chunk[] = { 1, 15, 17, 64 };
+
+    err = (ctx = EVP_CIPHER_CTX_new()) == NULL;
+    if (err == 0) {
+        err = EVP_CipherInit_ex(ctx, cipher, e, NULL, NULL, enc) != 1;
+    }
+    if (err == 0) {
+        err = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, 12, NULL) != 1;
+    }
+    if ((err == 0) && !enc) {
+        err = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, 16, tag) != 1;
+    }
+    if (err == 0) {
+        err = EVP_CipherInit_ex(ctx, NULL, e, key, iv, enc) != 1;
+    }
+    if (err == 0) {
+        err = EVP_CipherUpdate(ctx, NULL, &outLen, aad, 1) != 1;
+    }
+    if (err == 0) {
+        err = EVP_CipherUpdate(ctx, NULL, &outLen, aad + 1, aadLen - 1) != 1;
+    }
+    for (i = 0; (err == 0) && (len > 0); i++) {
+        sz = chunk[i % (sizeof(chunk) / sizeof(*chunk))];
+        if (sz > len) {
+            sz = len;
+        }
+        err = EVP_CipherUpdate(ctx, out, &outLen, in, sz) != 1;
+        if ((err == 0) && (outLen != sz)) {
+            PRINT_ERR_MSG("Streamed output not same length as input");
+            err = 1;
+        }
+        if (dup != NULL) {
+            if (err == 0) {
+                err = EVP_CipherUpdate(dup, dupOut, &dupLen, in, sz) != 1;
+            }
+            dupOut += sz;
+        }
+        in += sz;
+        out += sz;
+        len -= sz;
+        if ((err == 0) && (i == 1)) {
+            PRINT_MSG("Copy context part way through data");
+            err = (dup = EVP_CIPHER_CTX_new()) == NULL;
+            if (err == 0) {
+                err = EVP_CIPHER_CTX_copy(dup, ctx) != 1;
+            }
+            /* Copy only outputs data after the first two pieces. */
+            dupOut += 1 + 15;
+        }
+    }
+    if (err == 0) {
+        err = EVP_CipherFinal_ex(ctx, out, &outLen) != 1;
+    }
+    if (err == 0) {
+        err = EVP_CipherFinal_ex(dup, dupOut, &dupLen) != 1;
+    }
+    if ((err == 0) && enc) {
+        err = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, 16, tag) != 1;
+    }
+    if ((err == 0) && enc) {
+        unsigned char dupTag[16];
+
+        err = EVP_CIPHER_CTX_ctrl(dup, EVP_CTRL_AEAD_GET_TAG, 16,
+                                  dupTag) != 1;
+        if ((err == 0) && (memcmp(dupTag, tag, sizeof(dupTag)) != 0)) {
+            PRINT_ERR_MSG("Tag from copied context different");
+            err = 1;
+        }
+    }
+
+    EVP_CIPHER_CTX_free(dup);
+    EVP_CIPHER_CTX_free(ctx);
+
+    return err;
+}
+
+int test_aes128_gcm_stream(ENGINE *e, void *data)
+{
+    int err = 0;
+    unsigned char msg[100];
+    unsigned char key[16];
+    unsigned char iv[12];
+    unsigned char aad[] = "AAD streamed";
+    unsigned char enc[sizeof(msg)];
+    unsigned char tag[AES_BLOCK_SIZE];
+    unsigned char wEnc[sizeof(msg)];
+    unsigned char wTag[AES_BLOCK_SIZE];
+    unsigned char dec[sizeof(msg)];
+    unsigned char dupOut[sizeof(msg)];
+    int aadLen = (int)strlen((char *)aad);
+
+    (void)data;
+
+    memset(key, 0x11, sizeof(key));
+    memset(iv, 0x22, sizeof(iv));
+    memset(msg, 0x33, sizeof(msg));
+
+    PRINT_MSG("Encrypt with OpenSSL");
+    err = test_aes_tag_enc(NULL, EVP_aes_128_gcm(), key, iv, sizeof(iv), aad,
+                           msg, sizeof(msg), enc, tag, 0);
+    if (err == 0) {
+        PRINT_MSG("Encrypt in pieces with wolfengine");
+        err = test_aes_gcm_stream_crypt(e, EVP_aes_128_gcm(), key, iv, aad,
+                                        aadLen, msg, sizeof(msg), wEnc, dupOut,
+                                        wTag, 1);
+    }
+    if ((err == 0) && ((memcmp(wEnc, enc, sizeof(enc)) != 0) ||
+                       (memcmp(dupOut + 16, enc + 16, sizeof(enc) - 16) != 0) ||
+                       (memcmp(wTag, tag, sizeof(tag)) != 0))) {
+        PRINT_ERR_MSG("Streamed encryption different to OpenSSL");
+        err = 1;
+    }
+    if (err == 0) {
+        PRINT_MSG("Decrypt in pieces with wolfengine");
+        err = test_aes_gcm_stream_crypt(e, EVP_aes_128_gcm(), key, iv, aad,
+                                        aadLen, enc, sizeof(enc), dec, dupOut,
+                                        tag, 0);
+    }
+    if ((err == 0) && ((memcmp(dec, msg, sizeof(msg)) != 0) ||
+                       (memcmp(dupOut + 16, msg + 16,
+                               sizeof(msg) - 16) != 0))) {
+        PRINT_ERR_MSG("Streamed decryption different to message");
+        err = 1;
+    }
+    if (err == 0) {
+        PRINT_MSG("Decrypt in pieces with bad tag fails");
+        tag[0] ^= 0x80;
+        err = test_aes_gcm_stream_crypt(e, EVP_aes_128_gcm(), key, iv, aad,
+                                        aadLen, enc, sizeof(enc), dec, dupOut,
+                                        tag, 0) == 0;
+    }
+
+    return err;
+}
+
+#endif /* WE_HAVE_AESGCM_STREAM */
+
 #endif /* WE_HAVE_AESGCM */
 
 /******************************************************************************/
@@ -19,8 +19,15 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
  */
 
+#include <unistd.h>
+
 #include "unit.h"
 
+#include <sys/wait.h>
+#ifdef WE_HAVE_THREADS
+#include <pthread.h>
+#endif
+
 #ifdef WE_HAVE_ECC
 
 #if defined(WE_HAVE_ECDSA) || defined(WE_HAVE_ECDH)
@@ -426,6 +433,316 @@ int test_ecdh_p384(ENGINE *e, void *data)
 }
 #endif /* WE_HAVE_EC_P384 */
 
+#ifdef WE_HAVE_EC_P256
+int test_ecdh_p256_peer_reuse(ENGINE *e, void *data)
+{
+    int err;
+    EVP_PKEY_CTX *ctx = NULL;
+    EVP_PKEY_CTX *dupCtx = NULL;
+    EVP_PKEY *keyA = NULL;
+    EVP_PKEY *keyB = NULL;
+    unsigned char secret[32];
+    unsigned char other[32];
+    size_t outLen;
+    const unsigned char *p;
+    int i;
+
+    (void)data;
+
+    p = ecc_key_der_256;
+    err = (keyA = d2i_PrivateKey(EVP_PKEY_EC, NULL, &p,
+                                 sizeof(ecc_key_der_256))) == NULL;
+    if (err == 0) {
+        p = ecc_peerkey_der_256;
+        err = (keyB = d2i_PrivateKey(EVP_PKEY_EC, NULL, &p,
+                                     sizeof(ecc_peerkey_der_256))) == NULL;
+    }
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    if (err == 0) {
+        err = EVP_PKEY_set1_engine(keyA, e) != 1;
+    }
+    if (err == 0) {
+        err = (ctx = EVP_PKEY_CTX_new(keyA, NULL)) == NULL;
+    }
+#else
+    if (err == 0) {
+        err = (ctx = EVP_PKEY_CTX_new(keyA, e)) == NULL;
+    }
+#endif
+    if (err == 0) {
+        err = EVP_PKEY_derive_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_derive_set_peer(ctx, keyB) != 1;
+    }
+    for (i = 0; err == 0 && i < 4; i++) {
+        PRINT_MSG("Derive secret with same peer");
+        outLen = sizeof(secret);
+        err = EVP_PKEY_derive(ctx, secret, &outLen) != 1;
+        if (err == 0) {
+            err = outLen != sizeof(ecc_derived_256) ||
+                  memcmp(secret, ecc_derived_256, outLen) != 0;
+            if (err != 0) {
+                PRINT_ERR_MSG("Secret does not match, expected!");
+            }
+        }
+    }
+    if (err == 0) {
+        PRINT_MSG("Derive secret with duplicated context");
+        err = (dupCtx = EVP_PKEY_CTX_dup(ctx)) == NULL;
+    }
+    if (err == 0) {
+        outLen = sizeof(secret);
+        err = EVP_PKEY_derive(dupCtx, secret, &outLen) != 1;
+    }
+    if (err == 0) {
+        err = memcmp(secret, ecc_derived_256, sizeof(secret)) != 0;
+        if (err != 0) {
+            PRINT_ERR_MSG("Secret does not match, expected!");
+        }
+    }
+    if (err == 0) {
+        PRINT_MSG("Derive secret with different peer");
+        err = EVP_PKEY_derive_set_peer(ctx, keyA) != 1;
+    }
+    if (err == 0) {
+        outLen = sizeof(other);
+        err = EVP_PKEY_derive(ctx, other, &outLen) != 1;
+    }
+    if (err == 0) {
+        err = memcmp(other, ecc_derived_256, sizeof(other)) == 0;
+        if (err != 0) {
+            PRINT_ERR_MSG("Secret with different peer matches!");
+        }
+    }
+    if (err == 0) {
+        PRINT_MSG("Derive secret with original peer again");
+        err = EVP_PKEY_derive_set_peer(ctx, keyB) != 1;
+    }
+    if (err == 0) {
+        outLen = sizeof(secret);
+        err = EVP_PKEY_derive(ctx, secret, &outLen) != 1;
+    }
+    if (err == 0) {
+        err = memcmp(secret, ecc_derived_256, sizeof(secret)) != 0;
+        if (err != 0) {
+            PRINT_ERR_MSG("Secret does not match, expected!");
+        }
+    }
+
+    EVP_PKEY_CTX_free(dupCtx);
+    EVP_PKEY_CTX_free(ctx);
+    EVP_PKEY_free(keyB);
+    EVP_PKEY_free(keyA);
+
+    return err;
+}
+
+static int test_ecdh_x963_kdf_derive(ENGINE *e, EVP_PKEY *key,
+                                     EVP_PKEY *peerKey,
+                                     const unsigned char *ukm, int ukmLen,
+                                     unsigned char *out, size_t outLen,
+                                     int *skip)
+{
+    int err;
+    EVP_PKEY_CTX *ctx = NULL;
+    unsigned char *ukmCopy = NULL;
+    size_t len;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    err = EVP_PKEY_set1_engine(key, e) != 1;
+    if (err == 0) {
+        err = (ctx = EVP_PKEY_CTX_new(key, NULL)) == NULL;
+    }
+#else
+    err = (ctx = EVP_PKEY_CTX_new(key, e)) == NULL;
+#endif
+    if (err == 0) {
+        err = EVP_PKEY_derive_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_derive_set_peer(ctx, peerKey) != 1;
+    }
+    if (err == 0 &&
+        EVP_PKEY_CTX_set_ecdh_kdf_type(ctx, EVP_PKEY_ECDH_KDF_X9_63) != 1) {
+        /* wolfSSL not built with the X9.63 KDF. */
+        *skip = 1;
+    }
+    if (err == 0 && !*skip) {
+        err = EVP_PKEY_CTX_set_ecdh_kdf_md(ctx, EVP_sha256()) != 1;
+    }
+    if (err == 0 && !*skip) {
+        err = EVP_PKEY_CTX_set_ecdh_kdf_outlen(ctx, (int)outLen) != 1;
+    }
+    if (err == 0 && !*skip) {
+        err = (ukmCopy = (unsigned char *)OPENSSL_memdup(ukm, ukmLen)) ==
+              NULL;
+    }
+    if (err == 0 && !*skip) {
+        /* Context takes ownership of user keying material. */
+        err = EVP_PKEY_CTX_set0_ecdh_kdf_ukm(ctx, ukmCopy, ukmLen) != 1;
+        if (err == 0) {
+            ukmCopy = NULL;
+        }
+    }
+    if (err == 0 && !*skip) {
+        err = EVP_PKEY_derive(ctx, NULL, &len) != 1;
+    }
+    if (err == 0 && !*skip) {
+        err = len != outLen;
+    }
+    if (err == 0 && !*skip) {
+        err = EVP_PKEY_derive(ctx, out, &len) != 1;
+    }
+
+    OPENSSL_free(ukmCopy);
+    EVP_PKEY_CTX_free(ctx);
+
+    return err;
+}
+
+int test_ecdh_p256_x963_kdf(ENGINE *e, void *data)
+{
+    int err;
+    EVP_PKEY *keyA = NULL;
+    EVP_PKEY *keyB = NULL;
+    unsigned char ukm[16];
+    unsigned char keyWe[40];
+    unsigned char keyOssl[40];
+    const unsigned char *p;
+    int skip = 0;
+
+    (void)data;
+
+    memset(ukm, 0xa5, sizeof(ukm));
+
+    p = ecc_key_der_256;
+    err = (keyA = d2i_PrivateKey(EVP_PKEY_EC, NULL, &p,
+                                 sizeof(ecc_key_der_256))) == NULL;
+    if (err == 0) {
+        p = ecc_peerkey_der_256;
+        err = (keyB = d2i_PrivateKey(EVP_PKEY_EC, NULL, &p,
+                                     sizeof(ecc_peerkey_der_256))) == NULL;
+    }
+    if (err == 0) {
+        PRINT_MSG("Derive key with X9.63 KDF using wolfengine");
+        err = test_ecdh_x963_kdf_derive(e, keyA, keyB, ukm, sizeof(ukm),
+                                        keyWe, sizeof(keyWe), &skip);
+        if (err == 0 && skip) {
+            PRINT_MSG("ECDH X9.63 KDF not supported - skipping");
+        }
+    }
+    if (err == 0 && !skip) {
+        PRINT_MSG("Derive key with X9.63 KDF using OpenSSL");
+        err = test_ecdh_x963_kdf_derive(NULL, keyB, keyA, ukm, sizeof(ukm),
+                                        keyOssl, sizeof(keyOssl), &skip);
+    }
+    if (err == 0 && !skip) {
+        PRINT_BUFFER("wolfengine key", keyWe, sizeof(keyWe));
+        PRINT_BUFFER("OpenSSL key", keyOssl, sizeof(keyOssl));
+        err = memcmp(keyWe, keyOssl, sizeof(keyWe)) != 0;
+        if (err != 0) {
+            PRINT_ERR_MSG("Derived keys do not match!");
+        }
+    }
+
+    EVP_PKEY_free(keyB);
+    EVP_PKEY_free(keyA);
+
+    return err;
+}
+
+int test_ecdh_p256_multi_derive(ENGINE *e, void *data)
+{
+    int err;
+    EVP_PKEY *keyA = NULL;
+    EVP_PKEY *keyB = NULL;
+    unsigned char *pub = NULL;
+    size_t pubLen = 0;
+    unsigned char badPub[65];
+    WE_ECDH_PEER peers[4];
+    WE_ECDH_MULTI_DERIVE derive;
+    unsigned char secrets[4 * 32];
+    unsigned char results[1];
+    unsigned char zero[32];
+    const unsigned char *p;
+    int threads[2] = { 1, 2 };
+    int i;
+
+    (void)data;
+
+    memset(zero, 0, sizeof(zero));
+
+    p = ecc_key_der_256;
+    err = (keyA = d2i_PrivateKey(EVP_PKEY_EC, NULL, &p,
+                                 sizeof(ecc_key_der_256))) == NULL;
+    if (err == 0) {
+        p = ecc_peerkey_der_256;
+        err = (keyB = d2i_PrivateKey(EVP_PKEY_EC, NULL, &p,
+                                     sizeof(ecc_peerkey_der_256))) == NULL;
+    }
+    if (err == 0) {
+        pubLen = EC_KEY_key2buf(EVP_PKEY_get0_EC_KEY(keyB),
+                                POINT_CONVERSION_UNCOMPRESSED, &pub, NULL);
+        err = pubLen != sizeof(badPub);
+    }
+    if (err == 0) {
+        /* Point not on curve. */
+        memcpy(badPub, pub, sizeof(badPub));
+        badPub[sizeof(badPub) - 1] ^= 0x01;
+
+        peers[0].point = pub;
+        peers[0].pointLen = pubLen;
+        peers[1].point = badPub;
+        peers[1].pointLen = sizeof(badPub);
+        peers[2].point = pub;
+        peers[2].pointLen = pubLen;
+        peers[3].point = NULL;
+        peers[3].pointLen = 0;
+    }
+
+    for (i = 0; err == 0 && i < 2; i++) {
+        PRINT_MSG("Derive secrets with many peers using wolfengine");
+        memset(secrets, 0xff, sizeof(secrets));
+        derive.pkey = keyA;
+        derive.peers = peers;
+        derive.cnt = 4;
+        derive.secrets = secrets;
+        derive.results = results;
+        derive.threads = threads[i];
+        err = ENGINE_ctrl_cmd(e, "ecdh_multi_derive", 0, &derive, NULL,
+                              0) != 1;
+        if (err == 0) {
+            err = results[0] != 0x05;
+            if (err != 0) {
+                PRINT_ERR_MSG("Unexpected multi derive results!");
+            }
+        }
+        if (err == 0) {
+            PRINT_BUFFER("Secret 0", secrets, 32);
+            err = memcmp(secrets, ecc_derived_256, 32) != 0 ||
+                  memcmp(secrets + 2 * 32, ecc_derived_256, 32) != 0;
+            if (err != 0) {
+                PRINT_ERR_MSG("Secret does not match, expected!");
+            }
+        }
+        if (err == 0) {
+            err = memcmp(secrets + 1 * 32, zero, 32) != 0 ||
+                  memcmp(secrets + 3 * 32, zero, 32) != 0;
+            if (err != 0) {
+                PRINT_ERR_MSG("Secret of failed peer not zeroized!");
+            }
+        }
+    }
+
+    OPENSSL_free(pub);
+    EVP_PKEY_free(keyB);
+    EVP_PKEY_free(keyA);
+
+    return err;
+}
+#endif /* WE_HAVE_EC_P256 */
+
 #endif /* WE_HAVE_ECDH */
 
 #ifdef WE_HAVE_ECDSA
@@ -540,6 +857,61 @@ int test_ecdsa_p384_pkey(ENGINE *e, void *data)
 }
 #endif /* WE_HAVE_EC_P384 */
 
+#ifdef WE_HAVE_EC_P256
+int test_ecdsa_p256_pkey_dup(ENGINE *e, void *data)
+{
+    int err;
+    EVP_PKEY *pkey = NULL;
+    EVP_PKEY_CTX *ctx = NULL;
+    EVP_PKEY_CTX *dup = NULL;
+    unsigned char ecdsaSig[80];
+    size_t ecdsaSigLen;
+    unsigned char buf[20];
+    const unsigned char *p = ecc_key_der_256;
+
+    (void)data;
+
+    err = RAND_bytes(buf, sizeof(buf)) == 0;
+    if (err == 0) {
+        pkey = d2i_PrivateKey(EVP_PKEY_EC, NULL, &p, sizeof(ecc_key_der_256));
+        err = pkey == NULL;
+    }
+    if (err == 0) {
+        err = (ctx = EVP_PKEY_CTX_new(pkey, e)) == NULL;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_sign_init(ctx) != 1;
+    }
+    if (err == 0) {
+        PRINT_MSG("Sign with wolfengine");
+        ecdsaSigLen = sizeof(ecdsaSig);
+        err = EVP_PKEY_sign(ctx, ecdsaSig, &ecdsaSigLen, buf,
+                            sizeof(buf)) != 1;
+    }
+    if (err == 0) {
+        PRINT_MSG("Duplicate context with key set");
+        err = (dup = EVP_PKEY_CTX_dup(ctx)) == NULL;
+    }
+    if (err == 0) {
+        PRINT_MSG("Sign with duplicate context");
+        ecdsaSigLen = sizeof(ecdsaSig);
+        err = EVP_PKEY_sign(dup, ecdsaSig, &ecdsaSigLen, buf,
+                            sizeof(buf)) != 1;
+    }
+    if (err == 0) {
+        PRINT_MSG("Verify with OpenSSL");
+        err = test_pkey_verify(pkey, NULL, buf, sizeof(buf), ecdsaSig,
+                               ecdsaSigLen);
+    }
+
+    EVP_PKEY_CTX_free(dup);
+    EVP_PKEY_CTX_free(ctx);
+    EVP_PKEY_free(pkey);
+
+    return err;
+}
+#endif /* WE_HAVE_EC_P256 */
+
 #ifdef WE_HAVE_EC_P256
 int test_ecdsa_p256(ENGINE *e, void *data)
 {
@@ -650,56 +1022,581 @@ int test_ecdsa_p384(ENGINE *e, void *data)
 }
 #endif /* WE_HAVE_EC_P384 */
 
-#endif /* WE_HAVE_ECDSA */
-
-#endif /* WE_HAVE_EVP_PKEY */
-
-#ifdef WE_HAVE_EC_KEY
-
-#ifdef WE_HAVE_ECKEYGEN
-
-int test_ec_key_keygen_by_nid(ENGINE *e, int nid)
+#ifdef WE_HAVE_EC_P256
+int test_ecdsa_p256_pkey_pub_cache(ENGINE *e, void *data)
 {
     int err;
-    EC_KEY *key = NULL;
-    EC_GROUP *group = NULL;
+    int res;
+    int i, j;
+    EVP_PKEY *pkey[3] = { NULL, NULL, NULL };
+    EVP_PKEY_CTX *ctx[2] = { NULL, NULL };
+    EC_KEY *ecKey = NULL;
+    unsigned char ecdsaSig[3][80];
+    size_t ecdsaSigLen[3];
+    unsigned char buf[20];
+    const unsigned char *p = ecc_key_der_256;
 
-    PRINT_MSG("Create group");
-    err = (group = EC_GROUP_new_by_curve_name(nid)) == NULL;
+    (void)data;
+
+    err = RAND_bytes(buf, sizeof(buf)) == 0;
     if (err == 0) {
-        PRINT_MSG("Create key with engine");
-        err = (key = EC_KEY_new_method(e)) == NULL;
+        pkey[0] = d2i_PrivateKey(EVP_PKEY_EC, NULL, &p,
+                                 sizeof(ecc_key_der_256));
+        err = pkey[0] == NULL;
+    }
+    for (i = 1; err == 0 && i < 3; i++) {
+        PRINT_MSG("Generate key with OpenSSL");
+        err = (ecKey = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1)) ==
+              NULL;
+        if (err == 0) {
+            err = EC_KEY_generate_key(ecKey) != 1;
+        }
+        if (err == 0) {
+            err = (pkey[i] = EVP_PKEY_new()) == NULL;
+        }
+        if (err == 0) {
+            err = EVP_PKEY_assign_EC_KEY(pkey[i], ecKey) != 1;
+        }
+        if (err == 0) {
+            ecKey = NULL;
+        }
+    }
+    for (i = 0; err == 0 && i < 3; i++) {
+        PRINT_MSG("Sign with OpenSSL");
+        ecdsaSigLen[i] = sizeof(ecdsaSig[i]);
+        err = test_pkey_sign(pkey[i], NULL, buf, sizeof(buf), ecdsaSig[i],
+                             &ecdsaSigLen[i]);
     }
     if (err == 0) {
-        PRINT_MSG("Set group");
-        err = EC_KEY_set_group(key, group) != 1;
+        PRINT_MSG("Enable public key cache - smaller than number of keys");
+        err = ENGINE_ctrl_cmd(e, "ec_pub_cache_size", 2, NULL, NULL, 0) != 1;
+    }
+    /* Keys are cached, found and evicted. */
+    for (j = 0; err == 0 && j < 3; j++) {
+        for (i = 0; err == 0 && i < 3; i++) {
+            PRINT_MSG("Verify with wolfengine");
+            err = test_pkey_verify(pkey[i], e, buf, sizeof(buf), ecdsaSig[i],
+                                   ecdsaSigLen[i]);
+        }
+        if (err == 0) {
+            PRINT_MSG("Verify with wolfengine using wrong key");
+            res = test_pkey_verify(pkey[j], e, buf, sizeof(buf),
+                                   ecdsaSig[(j + 1) % 3],
+                                   ecdsaSigLen[(j + 1) % 3]);
+            if (res != 1)
+                err = 1;
+        }
     }
+
+    PRINT_MSG("Contexts share cached key - still usable after eviction");
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
     if (err == 0) {
-        PRINT_MSG("Generate key");
-        err = EC_KEY_generate_key(key) != 1;
+        err = EVP_PKEY_set1_engine(pkey[0], e) != 1;
+    }
+#endif
+    for (i = 0; err == 0 && i < 2; i++) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        err = (ctx[i] = EVP_PKEY_CTX_new(pkey[0], NULL)) == NULL;
+#else
+        err = (ctx[i] = EVP_PKEY_CTX_new(pkey[0], e)) == NULL;
+#endif
+        if (err == 0) {
+            err = EVP_PKEY_verify_init(ctx[i]) != 1;
+        }
+        if (err == 0) {
+            err = EVP_PKEY_verify(ctx[i], ecdsaSig[0], ecdsaSigLen[0], buf,
+                                  sizeof(buf)) != 1;
+        }
+    }
+    for (i = 1; err == 0 && i < 3; i++) {
+        /* Other keys evict the shared key from the cache. */
+        err = test_pkey_verify(pkey[i], e, buf, sizeof(buf), ecdsaSig[i],
+                               ecdsaSigLen[i]);
+    }
+    for (i = 0; err == 0 && i < 2; i++) {
+        err = EVP_PKEY_verify(ctx[i], ecdsaSig[0], ecdsaSigLen[0], buf,
+                              sizeof(buf)) != 1;
     }
 
-    EC_KEY_free(key);
-    EC_GROUP_free(group);
+    PRINT_MSG("Disable public key cache");
+    if (ENGINE_ctrl_cmd(e, "ec_pub_cache_size", 0, NULL, NULL, 0) != 1) {
+        err = 1;
+    }
+    if (err == 0) {
+        /* Key held by context remains valid after cache disposed of. */
+        err = EVP_PKEY_verify(ctx[0], ecdsaSig[0], ecdsaSigLen[0], buf,
+                              sizeof(buf)) != 1;
+    }
+
+    EVP_PKEY_CTX_free(ctx[1]);
+    EVP_PKEY_CTX_free(ctx[0]);
+    EC_KEY_free(ecKey);
+    for (i = 0; i < 3; i++) {
+        EVP_PKEY_free(pkey[i]);
+    }
 
     return err;
 }
 
-#ifdef WE_HAVE_EC_P256
-int test_ec_key_keygen_p256_by_nid(ENGINE *e, void *data)
+int test_ecdsa_p256_batch_verify(ENGINE *e, void *data)
 {
-    (void)data;
-    return test_ec_key_keygen_by_nid(e, NID_X9_62_prime256v1);
-}
-#endif /* WE_HAVE_EC_P256 */
+    int err;
+    int i;
+    EVP_PKEY *pkey[2] = { NULL, NULL };
+    EC_KEY *ecKey = NULL;
+    const unsigned char *p = ecc_key_der_256;
+    unsigned char digest[9][32];
+    unsigned char sig[9][80];
+    unsigned int sigLen;
+    WE_ECDSA_VERIFY_ITEM items[9];
+    WE_ECDSA_BATCH_VERIFY batch;
+    unsigned char results[2];
+    int threads[] = { 1, 4 };
 
-#ifdef WE_HAVE_EC_P384
-int test_ec_key_keygen_p384_by_nid(ENGINE *e, void *data)
-{
     (void)data;
-    return test_ec_key_keygen_by_nid(e, NID_secp384r1);
-}
-#endif /* WE_HAVE_EC_P384 */
+
+    PRINT_MSG("Set up two EC keys");
+    pkey[0] = d2i_PrivateKey(EVP_PKEY_EC, NULL, &p, sizeof(ecc_key_der_256));
+    err = pkey[0] == NULL;
+    if (err == 0) {
+        err = (ecKey = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1)) ==
+              NULL;
+    }
+    if (err == 0) {
+        err = EC_KEY_generate_key(ecKey) != 1;
+    }
+    if (err == 0) {
+        err = (pkey[1] = EVP_PKEY_new()) == NULL;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_assign_EC_KEY(pkey[1], ecKey) != 1;
+    }
+    if (err == 0) {
+        ecKey = NULL;
+    }
+
+    PRINT_MSG("Sign with OpenSSL");
+    for (i = 0; err == 0 && i < 9; i++) {
+        err = RAND_bytes(digest[i], sizeof(digest[i])) == 0;
+        if (err == 0) {
+            sigLen = sizeof(sig[i]);
+            err = ECDSA_sign(0, digest[i], sizeof(digest[i]), sig[i], &sigLen,
+                    (EC_KEY *)EVP_PKEY_get0_EC_KEY(pkey[i % 2])) != 1;
+        }
+        if (err == 0) {
+            items[i].pkey = pkey[i % 2];
+            items[i].digest = digest[i];
+            items[i].digestLen = sizeof(digest[i]);
+            items[i].sig = sig[i];
+            items[i].sigLen = sigLen;
+        }
+    }
+    if (err == 0) {
+        /* Bad signature, wrong digest and no key. */
+        sig[3][items[3].sigLen - 1] ^= 0x01;
+        digest[6][0] ^= 0x01;
+        items[8].pkey = NULL;
+    }
+
+    for (i = 0; err == 0 && i < 2; i++) {
+        PRINT_MSG("Batch verify with wolfengine");
+        batch.items = items;
+        batch.cnt = 9;
+        batch.results = results;
+        batch.threads = threads[i];
+        err = ENGINE_ctrl_cmd(e, "ecdsa_batch_verify", 0, &batch, NULL,
+                              0) != 1;
+        if (err == 0) {
+            err = results[0] != 0xb7 || results[1] != 0x00;
+        }
+    }
+
+    EC_KEY_free(ecKey);
+    for (i = 0; i < 2; i++) {
+        EVP_PKEY_free(pkey[i]);
+    }
+
+    return err;
+}
+#endif /* WE_HAVE_EC_P256 */
+
+#endif /* WE_HAVE_ECDSA */
+
+#if defined(WE_HAVE_ECDSA) && defined(WE_HAVE_ECDH) && \
+    defined(WE_HAVE_EC_P256)
+int test_ec_p256_pkey_no_alloc(ENGINE *e, void *data)
+{
+    int err;
+    EVP_PKEY *keyA = NULL;
+    EVP_PKEY *keyB = NULL;
+    EVP_PKEY_CTX *signCtx = NULL;
+    EVP_PKEY_CTX *verifyCtx = NULL;
+    EVP_PKEY_CTX *deriveCtx = NULL;
+    unsigned char digest[32];
+    unsigned char sig[80];
+    size_t sigLen = 0;
+    unsigned char secret[32];
+    size_t secretLen;
+    const unsigned char *p;
+    long cnt = 0;
+    int i;
+
+    (void)data;
+
+    if (test_alloc_count() < 0) {
+        PRINT_MSG("Allocations not counted - skipping");
+        return 0;
+    }
+
+    memset(digest, 0x5a, sizeof(digest));
+
+    p = ecc_key_der_256;
+    err = (keyA = d2i_PrivateKey(EVP_PKEY_EC, NULL, &p,
+                                 sizeof(ecc_key_der_256))) == NULL;
+    if (err == 0) {
+        p = ecc_peerkey_der_256;
+        err = (keyB = d2i_PrivateKey(EVP_PKEY_EC, NULL, &p,
+                                     sizeof(ecc_peerkey_der_256))) == NULL;
+    }
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    if (err == 0) {
+        err = EVP_PKEY_set1_engine(keyA, e) != 1;
+    }
+    if (err == 0) {
+        err = (signCtx = EVP_PKEY_CTX_new(keyA, NULL)) == NULL;
+    }
+    if (err == 0) {
+        err = (verifyCtx = EVP_PKEY_CTX_new(keyA, NULL)) == NULL;
+    }
+    if (err == 0) {
+        err = (deriveCtx = EVP_PKEY_CTX_new(keyA, NULL)) == NULL;
+    }
+#else
+    if (err == 0) {
+        err = (signCtx = EVP_PKEY_CTX_new(keyA, e)) == NULL;
+    }
+    if (err == 0) {
+        err = (verifyCtx = EVP_PKEY_CTX_new(keyA, e)) == NULL;
+    }
+    if (err == 0) {
+        err = (deriveCtx = EVP_PKEY_CTX_new(keyA, e)) == NULL;
+    }
+#endif
+    if (err == 0) {
+        err = EVP_PKEY_sign_init(signCtx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_verify_init(verifyCtx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_derive_init(deriveCtx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_derive_set_peer(deriveCtx, keyB) != 1;
+    }
+
+    /* First operation sets the keys into the wolfSSL objects. */
+    if (err == 0) {
+        PRINT_MSG("Sign, verify and derive once with wolfengine");
+        sigLen = sizeof(sig);
+        err = EVP_PKEY_sign(signCtx, sig, &sigLen, digest,
+                            sizeof(digest)) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_verify(verifyCtx, sig, sigLen, digest,
+                              sizeof(digest)) != 1;
+    }
+    if (err == 0) {
+        secretLen = sizeof(secret);
+        err = EVP_PKEY_derive(deriveCtx, secret, &secretLen) != 1;
+    }
+
+    if (err == 0) {
+        PRINT_MSG("Sign, verify and derive again without allocating");
+        cnt = test_alloc_count();
+    }
+    for (i = 0; err == 0 && i < 4; i++) {
+        sigLen = sizeof(sig);
+        err = EVP_PKEY_sign(signCtx, sig, &sigLen, digest,
+                            sizeof(digest)) != 1;
+        if (err == 0) {
+            err = EVP_PKEY_verify(verifyCtx, sig, sigLen, digest,
+                                  sizeof(digest)) != 1;
+        }
+        if (err == 0) {
+            secretLen = sizeof(secret);
+            err = EVP_PKEY_derive(deriveCtx, secret, &secretLen) != 1;
+        }
+    }
+    if (err == 0) {
+        err = test_alloc_count() != cnt;
+        if (err != 0) {
+            PRINT_ERR_MSG("Memory allocated in steady-state operation!");
+        }
+    }
+
+    EVP_PKEY_CTX_free(deriveCtx);
+    EVP_PKEY_CTX_free(verifyCtx);
+    EVP_PKEY_CTX_free(signCtx);
+    EVP_PKEY_free(keyB);
+    EVP_PKEY_free(keyA);
+
+    return err;
+}
+#endif /* WE_HAVE_ECDSA && WE_HAVE_ECDH && WE_HAVE_EC_P256 */
+
+#endif /* WE_HAVE_EVP_PKEY */
+
+#if defined(WE_HAVE_ECKEYGEN) && defined(WE_HAVE_EC_P256)
+int test_ec_keygen_p256_batch(ENGINE *e, void *data)
+{
+    int err = 0;
+    WE_EC_KEYGEN_BATCH batch;
+    EVP_PKEY *pkeys[5];
+    unsigned char raw[5 * 3 * 32];
+    unsigned char d[32];
+    const EC_KEY *ec;
+    int threads[2] = { 1, 3 };
+    int i;
+    int j;
+
+    (void)data;
+
+    for (i = 0; err == 0 && i < 2; i++) {
+        PRINT_MSG("Generate batch of P-256 key pairs with wolfengine");
+        memset(&batch, 0, sizeof(batch));
+        batch.curveNid = NID_X9_62_prime256v1;
+        batch.cnt = 5;
+        batch.raw = raw;
+        batch.pkeys = pkeys;
+        batch.threads = threads[i];
+        err = ENGINE_ctrl_cmd(e, "ec_keygen_batch", 0, &batch, NULL, 0) != 1;
+
+        for (j = 0; err == 0 && j < 5; j++) {
+            ec = EVP_PKEY_get0_EC_KEY(pkeys[j]);
+            err = ec == NULL;
+            if (err == 0) {
+                err = EC_KEY_check_key(ec) != 1;
+                if (err != 0) {
+                    PRINT_ERR_MSG("Generated EC key is not valid!");
+                }
+            }
+            if (err == 0) {
+                err = EC_KEY_priv2oct(ec, d, sizeof(d)) != sizeof(d);
+            }
+            if (err == 0) {
+                /* Private key follows x and y in raw key pair. */
+                err = memcmp(d, raw + j * 3 * 32 + 2 * 32, sizeof(d)) != 0;
+                if (err != 0) {
+                    PRINT_ERR_MSG("Raw key pair does not match EVP_PKEY!");
+                }
+            }
+        }
+        if (err == 0) {
+            err = memcmp(raw, raw + 3 * 32, 3 * 32) == 0;
+            if (err != 0) {
+                PRINT_ERR_MSG("Generated key pairs are the same!");
+            }
+        }
+        for (j = 0; j < 5; j++) {
+            EVP_PKEY_free(pkeys[j]);
+            pkeys[j] = NULL;
+        }
+    }
+
+    if (err == 0) {
+        PRINT_MSG("Batch with unsupported curve fails");
+        memset(&batch, 0, sizeof(batch));
+        batch.curveNid = NID_secp521r1;
+        batch.cnt = 1;
+        batch.raw = raw;
+        err = ENGINE_ctrl_cmd(e, "ec_keygen_batch", 0, &batch, NULL, 0) == 1;
+    }
+
+    return err;
+}
+#endif /* WE_HAVE_ECKEYGEN && WE_HAVE_EC_P256 */
+
+#ifdef WE_HAVE_EC_KEY
+
+#ifdef WE_HAVE_ECKEYGEN
+
+int test_ec_key_keygen_by_nid(ENGINE *e, int nid)
+{
+    int err;
+    EC_KEY *key = NULL;
+    EC_GROUP *group = NULL;
+
+    PRINT_MSG("Create group");
+    err = (group = EC_GROUP_new_by_curve_name(nid)) == NULL;
+    if (err == 0) {
+        PRINT_MSG("Create key with engine");
+        err = (key = EC_KEY_new_method(e)) == NULL;
+    }
+    if (err == 0) {
+        PRINT_MSG("Set group");
+        err = EC_KEY_set_group(key, group) != 1;
+    }
+    if (err == 0) {
+        PRINT_MSG("Generate key");
+        err = EC_KEY_generate_key(key) != 1;
+    }
+
+    EC_KEY_free(key);
+    EC_GROUP_free(group);
+
+    return err;
+}
+
+#ifdef WE_HAVE_EC_P256
+int test_ec_key_keygen_p256_by_nid(ENGINE *e, void *data)
+{
+    (void)data;
+    return test_ec_key_keygen_by_nid(e, NID_X9_62_prime256v1);
+}
+#endif /* WE_HAVE_EC_P256 */
+
+#ifdef WE_HAVE_EC_P384
+int test_ec_key_keygen_p384_by_nid(ENGINE *e, void *data)
+{
+    (void)data;
+    return test_ec_key_keygen_by_nid(e, NID_secp384r1);
+}
+#endif /* WE_HAVE_EC_P384 */
+
+#ifdef WE_HAVE_EC_P256
+int test_ec_key_keygen_p256_pool(ENGINE *e, void *data)
+{
+    int err;
+    EC_GROUP *group = NULL;
+    EC_KEY *key = NULL;
+    EC_KEY *prevKey = NULL;
+    int i;
+    unsigned char pub[65];
+    unsigned char childPub[65];
+    size_t pubLen = 0;
+    ssize_t childPubLen = 0;
+    int fds[2] = { -1, -1 };
+    pid_t pid = -1;
+    int status;
+
+    (void)data;
+
+    err = (group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1)) == NULL;
+    if (err == 0) {
+        PRINT_MSG("Enable key pool");
+        /* Pool needs wolfEngine built with threads - optional. */
+        err = ENGINE_ctrl_cmd(e, "ec_key_pool_size", 4, NULL, NULL, 1) != 1;
+    }
+    if (err == 0) {
+        err = ENGINE_ctrl_cmd(e, "ec_key_pool_low", 1, NULL, NULL, 1) != 1;
+    }
+    /* Generate more keys than pool holds - falls back when empty. */
+    for (i = 0; err == 0 && i < 8; i++) {
+        PRINT_MSG("Generate key with key pool enabled");
+        err = (key = EC_KEY_new_method(e)) == NULL;
+        if (err == 0) {
+            err = EC_KEY_set_group(key, group) != 1;
+        }
+        if (err == 0) {
+            err = EC_KEY_generate_key(key) != 1;
+        }
+        if (err == 0) {
+            err = EC_KEY_check_key(key) != 1;
+            if (err != 0) {
+                PRINT_ERR_MSG("Generated key is not valid!");
+            }
+        }
+        if (err == 0 && prevKey != NULL) {
+            err = EC_POINT_cmp(group, EC_KEY_get0_public_key(key),
+                               EC_KEY_get0_public_key(prevKey), NULL) == 0;
+            if (err != 0) {
+                PRINT_ERR_MSG("Key handed out twice!");
+            }
+        }
+        EC_KEY_free(prevKey);
+        prevKey = key;
+        key = NULL;
+    }
+    if (err == 0) {
+        /* Give the thread time to refill the pool. */
+        usleep(100000);
+        PRINT_MSG("Generate key in child and parent after fork");
+        err = pipe(fds) != 0;
+    }
+    if (err == 0) {
+        pid = fork();
+        err = pid < 0;
+    }
+    if (err == 0 && pid == 0) {
+        /* Child must not take the key pairs left in the parent's pool. */
+        close(fds[0]);
+        key = EC_KEY_new_method(e);
+        if (key == NULL || EC_KEY_set_group(key, group) != 1 ||
+                EC_KEY_generate_key(key) != 1) {
+            _exit(1);
+        }
+        pubLen = EC_POINT_point2oct(group, EC_KEY_get0_public_key(key),
+                                    POINT_CONVERSION_UNCOMPRESSED, pub,
+                                    sizeof(pub), NULL);
+        if (pubLen == 0 || write(fds[1], pub, pubLen) != (ssize_t)pubLen) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    if (err == 0) {
+        close(fds[1]);
+        fds[1] = -1;
+        err = (key = EC_KEY_new_method(e)) == NULL;
+        if (err == 0) {
+            err = EC_KEY_set_group(key, group) != 1;
+        }
+        if (err == 0) {
+            err = EC_KEY_generate_key(key) != 1;
+        }
+        if (err == 0) {
+            pubLen = EC_POINT_point2oct(group, EC_KEY_get0_public_key(key),
+                                        POINT_CONVERSION_UNCOMPRESSED, pub,
+                                        sizeof(pub), NULL);
+            err = pubLen == 0;
+        }
+        if (err == 0) {
+            childPubLen = read(fds[0], childPub, sizeof(childPub));
+        }
+        if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+                WEXITSTATUS(status) != 0) {
+            PRINT_ERR_MSG("Child failed to generate key");
+            err = 1;
+        }
+    }
+    if (err == 0) {
+        err = childPubLen == (ssize_t)pubLen &&
+              memcmp(childPub, pub, pubLen) == 0;
+        if (err != 0) {
+            PRINT_ERR_MSG("Child and parent got the same key!");
+        }
+    }
+    if (fds[0] >= 0) {
+        close(fds[0]);
+    }
+    if (fds[1] >= 0) {
+        close(fds[1]);
+    }
+    PRINT_MSG("Disable key pool");
+    if (ENGINE_ctrl_cmd(e, "ec_key_pool_low", -1, NULL, NULL, 1) != 1) {
+        err = 1;
+    }
+    if (ENGINE_ctrl_cmd(e, "ec_key_pool_size", 0, NULL, NULL, 1) != 1) {
+        err = 1;
+    }
+
+    EC_KEY_free(key);
+    EC_KEY_free(prevKey);
+    EC_GROUP_free(group);
+
+    return err;
+}
+#endif /* WE_HAVE_EC_P256 */
 
 #endif /* WE_HAVE_ECKEYGEN */
 
@@ -865,6 +1762,179 @@ int test_ec_key_ecdh_p384(ENGINE *e, void *data)
 }
 #endif /* WE_HAVE_EC_P384 */
 
+#ifdef WE_HAVE_EC_P256
+int test_ec_key_ecdh_p256_peer_reuse(ENGINE *e, void *data)
+{
+    int err;
+    EC_KEY *keyA = NULL;
+    EC_KEY *keyB = NULL;
+    const EC_POINT *pubKeyA;
+    const EC_POINT *pubKeyB;
+    unsigned char secret[32];
+    unsigned char other[32];
+    const unsigned char *p;
+    int i;
+
+    (void)data;
+
+    err = (keyA = EC_KEY_new_method(e)) == NULL;
+    if (err == 0) {
+        p = ecc_key_der_256;
+        err = (keyA = d2i_ECPrivateKey(&keyA, &p,
+                                       sizeof(ecc_key_der_256))) == NULL;
+    }
+    if (err == 0) {
+        err = (keyB = EC_KEY_new_method(e)) == NULL;
+    }
+    if (err == 0) {
+        p = ecc_peerkey_der_256;
+        err = (keyB = d2i_ECPrivateKey(&keyB, &p,
+                                       sizeof(ecc_peerkey_der_256))) == NULL;
+    }
+    if (err == 0) {
+        err = (pubKeyA = EC_KEY_get0_public_key(keyA)) == NULL;
+    }
+    if (err == 0) {
+        err = (pubKeyB = EC_KEY_get0_public_key(keyB)) == NULL;
+    }
+    for (i = 0; err == 0 && i < 4; i++) {
+        PRINT_MSG("Derive secret with same peer");
+        err = ECDH_compute_key(secret, sizeof(secret), pubKeyB, keyA,
+                               NULL) != (int)sizeof(secret);
+        if (err == 0) {
+            err = memcmp(secret, ecc_derived_256, sizeof(secret)) != 0;
+            if (err != 0) {
+                PRINT_ERR_MSG("Secret does not match, expected!");
+            }
+        }
+    }
+    if (err == 0) {
+        PRINT_MSG("Derive secret with different peer");
+        err = ECDH_compute_key(other, sizeof(other), pubKeyA, keyA,
+                               NULL) != (int)sizeof(other);
+    }
+    if (err == 0) {
+        err = memcmp(other, ecc_derived_256, sizeof(other)) == 0;
+        if (err != 0) {
+            PRINT_ERR_MSG("Secret with different peer matches!");
+        }
+    }
+    if (err == 0) {
+        PRINT_MSG("Derive secret with original peer again");
+        err = ECDH_compute_key(secret, sizeof(secret), pubKeyB, keyA,
+                               NULL) != (int)sizeof(secret);
+    }
+    if (err == 0) {
+        err = memcmp(secret, ecc_derived_256, sizeof(secret)) != 0;
+        if (err != 0) {
+            PRINT_ERR_MSG("Secret does not match, expected!");
+        }
+    }
+
+    EC_KEY_free(keyB);
+    EC_KEY_free(keyA);
+
+    return err;
+}
+
+#ifdef WE_HAVE_THREADS
+/* Number of threads deriving with one EC_KEY object at the same time. */
+#define TEST_EC_KEY_ECDH_THREADS    4
+
+/**
+ * Shared state of threads deriving with one EC_KEY object and two peers.
+ */
+typedef struct TEST_EC_KEY_ECDH {
+    EC_KEY *key;
+    const EC_POINT *peer[2];
+    unsigned char secret[2][32];
+} TEST_EC_KEY_ECDH;
+
+/**
+ * Derive repeatedly, alternating peers, and compare with the expected secret.
+ */
+static void *test_ec_key_ecdh_thread(void *arg)
+{
+    TEST_EC_KEY_ECDH *ecdh = (TEST_EC_KEY_ECDH *)arg;
+    unsigned char secret[32];
+    int err = 0;
+    int i;
+
+    for (i = 0; err == 0 && i < 32; i++) {
+        err = ECDH_compute_key(secret, sizeof(secret), ecdh->peer[i & 1],
+                               ecdh->key, NULL) != (int)sizeof(secret);
+        if (err == 0) {
+            err = memcmp(secret, ecdh->secret[i & 1], sizeof(secret)) != 0;
+        }
+    }
+
+    return err == 0 ? NULL : arg;
+}
+
+int test_ec_key_ecdh_p256_threads(ENGINE *e, void *data)
+{
+    int err;
+    TEST_EC_KEY_ECDH ecdh;
+    EC_KEY *keyB = NULL;
+    pthread_t thread[TEST_EC_KEY_ECDH_THREADS];
+    void *res;
+    int started = 0;
+    int i;
+    const unsigned char *p;
+
+    (void)data;
+
+    memset(&ecdh, 0, sizeof(ecdh));
+    err = (ecdh.key = EC_KEY_new_method(e)) == NULL;
+    if (err == 0) {
+        p = ecc_key_der_256;
+        err = (ecdh.key = d2i_ECPrivateKey(&ecdh.key, &p,
+                                           sizeof(ecc_key_der_256))) == NULL;
+    }
+    if (err == 0) {
+        p = ecc_peerkey_der_256;
+        err = (keyB = d2i_ECPrivateKey(NULL, &p,
+                                       sizeof(ecc_peerkey_der_256))) == NULL;
+    }
+    if (err == 0) {
+        ecdh.peer[0] = EC_KEY_get0_public_key(keyB);
+        ecdh.peer[1] = EC_KEY_get0_public_key(ecdh.key);
+        err = ecdh.peer[0] == NULL || ecdh.peer[1] == NULL;
+    }
+    for (i = 0; err == 0 && i < 2; i++) {
+        PRINT_MSG("Derive expected secret");
+        err = ECDH_compute_key(ecdh.secret[i], sizeof(ecdh.secret[i]),
+                               ecdh.peer[i], ecdh.key, NULL) !=
+              (int)sizeof(ecdh.secret[i]);
+    }
+    if (err == 0) {
+        err = memcmp(ecdh.secret[0], ecc_derived_256,
+                     sizeof(ecdh.secret[0])) != 0;
+    }
+    PRINT_MSG("Derive with two peers and one EC_KEY on multiple threads");
+    for (i = 0; err == 0 && i < TEST_EC_KEY_ECDH_THREADS; i++) {
+        err = pthread_create(&thread[i], NULL, test_ec_key_ecdh_thread,
+                             &ecdh) != 0;
+        if (err == 0) {
+            started++;
+        }
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(thread[i], &res);
+        if (res != NULL) {
+            PRINT_ERR_MSG("Thread derived wrong secret");
+            err = 1;
+        }
+    }
+
+    EC_KEY_free(keyB);
+    EC_KEY_free(ecdh.key);
+
+    return err;
+}
+#endif /* WE_HAVE_THREADS */
+#endif /* WE_HAVE_EC_P256 */
+
 #endif /* WE_HAVE_ECDH */
 
 #ifdef WE_HAVE_ECDSA
@@ -1001,6 +2071,334 @@ int test_ec_key_ecdsa_p384(ENGINE *e, void *data)
 }
 #endif /* WE_HAVE_EC_P384 */
 
+#ifdef WE_HAVE_EC_P256
+int test_ec_key_ecdsa_p256_key_change(ENGINE *e, void *data)
+{
+    int err;
+    EC_KEY *key = NULL;
+    EC_KEY *keyDup = NULL;
+    EC_KEY *keyOSSL = NULL;
+    unsigned char ecdsaSig[140];
+    size_t ecdsaSigLen;
+    unsigned char buf[20];
+    const unsigned char *p = ecc_key_der_256;
+
+    (void)data;
+
+    err = RAND_bytes(buf, sizeof(buf)) == 0;
+    if (err == 0) {
+        err = (key = EC_KEY_new_method(e)) == NULL;
+    }
+    if (err == 0) {
+        key = d2i_ECPrivateKey(&key, &p, sizeof(ecc_key_der_256));
+        err = (key == NULL);
+    }
+    if (err == 0) {
+        PRINT_MSG("Sign and verify with wolfengine - caches key");
+        ecdsaSigLen = sizeof(ecdsaSig);
+        err = test_ec_key_ecdsa_sign(key, buf, sizeof(buf), ecdsaSig,
+                                     &ecdsaSigLen);
+    }
+    if (err == 0) {
+        err = test_ec_key_ecdsa_verify(key, buf, sizeof(buf), ecdsaSig,
+                                       ecdsaSigLen);
+    }
+    if (err == 0) {
+        PRINT_MSG("Duplicate key and sign with duplicate");
+        err = (keyDup = EC_KEY_dup(key)) == NULL;
+    }
+    if (err == 0) {
+        ecdsaSigLen = sizeof(ecdsaSig);
+        err = test_ec_key_ecdsa_sign(keyDup, buf, sizeof(buf), ecdsaSig,
+                                     &ecdsaSigLen);
+    }
+    if (err == 0) {
+        err = test_ec_key_ecdsa_verify(key, buf, sizeof(buf), ecdsaSig,
+                                       ecdsaSigLen);
+    }
+    if (err == 0) {
+        PRINT_MSG("Generate new key with OpenSSL");
+        err = (keyOSSL = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1)) ==
+              NULL;
+    }
+    if (err == 0) {
+        err = EC_KEY_generate_key(keyOSSL) != 1;
+    }
+    if (err == 0) {
+        PRINT_MSG("Set new key into key object");
+        err = EC_KEY_set_private_key(key,
+                                     EC_KEY_get0_private_key(keyOSSL)) != 1;
+    }
+    if (err == 0) {
+        err = EC_KEY_set_public_key(key, EC_KEY_get0_public_key(keyOSSL)) != 1;
+    }
+    if (err == 0) {
+        PRINT_MSG("Sign with wolfengine, verify with OpenSSL");
+        ecdsaSigLen = sizeof(ecdsaSig);
+        err = test_ec_key_ecdsa_sign(key, buf, sizeof(buf), ecdsaSig,
+                                     &ecdsaSigLen);
+    }
+    if (err == 0) {
+        err = test_ec_key_ecdsa_verify(keyOSSL, buf, sizeof(buf), ecdsaSig,
+                                       ecdsaSigLen);
+    }
+    if (err == 0) {
+        PRINT_MSG("Sign with OpenSSL, verify with wolfengine");
+        ecdsaSigLen = sizeof(ecdsaSig);
+        err = test_ec_key_ecdsa_sign(keyOSSL, buf, sizeof(buf), ecdsaSig,
+                                     &ecdsaSigLen);
+    }
+    if (err == 0) {
+        err = test_ec_key_ecdsa_verify(key, buf, sizeof(buf), ecdsaSig,
+                                       ecdsaSigLen);
+    }
+    if (err == 0) {
+        PRINT_MSG("Free original key and sign with duplicate");
+        EC_KEY_free(key);
+        key = NULL;
+        ecdsaSigLen = sizeof(ecdsaSig);
+        err = test_ec_key_ecdsa_sign(keyDup, buf, sizeof(buf), ecdsaSig,
+                                     &ecdsaSigLen);
+    }
+
+    EC_KEY_free(keyOSSL);
+    EC_KEY_free(keyDup);
+    EC_KEY_free(key);
+
+    return err;
+}
+#endif /* WE_HAVE_EC_P256 */
+
+#ifdef WE_HAVE_EC_P256
+#ifdef WE_HAVE_THREADS
+/* Number of threads using one EC_KEY object at the same time. */
+#define TEST_EC_KEY_THREADS     4
+
+/**
+ * Sign and verify repeatedly with an EC_KEY object shared between threads.
+ */
+static void *test_ec_key_ecdsa_thread(void *arg)
+{
+    EC_KEY *key = (EC_KEY *)arg;
+    unsigned char buf[20];
+    unsigned char ecdsaSig[140];
+    unsigned int sigLen;
+    int err = 0;
+    int i;
+
+    memset(buf, 0xa5, sizeof(buf));
+    for (i = 0; err == 0 && i < 16; i++) {
+        sigLen = sizeof(ecdsaSig);
+        err = ECDSA_sign(0, buf, sizeof(buf), ecdsaSig, &sigLen, key) != 1;
+        if (err == 0) {
+            err = ECDSA_verify(0, buf, sizeof(buf), ecdsaSig, (int)sigLen,
+                               key) != 1;
+        }
+    }
+
+    return err == 0 ? NULL : arg;
+}
+
+int test_ec_key_ecdsa_p256_threads(ENGINE *e, void *data)
+{
+    int err;
+    EC_KEY *key = NULL;
+    pthread_t thread[TEST_EC_KEY_THREADS];
+    void *res;
+    int started = 0;
+    int i;
+    const unsigned char *p = ecc_key_der_256;
+
+    (void)data;
+
+    err = (key = EC_KEY_new_method(e)) == NULL;
+    if (err == 0) {
+        key = d2i_ECPrivateKey(&key, &p, sizeof(ecc_key_der_256));
+        err = (key == NULL);
+    }
+    /* Keys are imported on first use - all threads start with none. */
+    PRINT_MSG("Sign and verify with one EC_KEY on multiple threads");
+    for (i = 0; err == 0 && i < TEST_EC_KEY_THREADS; i++) {
+        err = pthread_create(&thread[i], NULL, test_ec_key_ecdsa_thread,
+                             key) != 0;
+        if (err == 0) {
+            started++;
+        }
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(thread[i], &res);
+        if (res != NULL) {
+            PRINT_ERR_MSG("Thread failed to sign or verify");
+            err = 1;
+        }
+    }
+
+    EC_KEY_free(key);
+
+    return err;
+}
+#endif /* WE_HAVE_THREADS */
+#endif /* WE_HAVE_EC_P256 */
+
+#ifdef WE_HAVE_EC_P256
+int test_ec_key_ecdsa_p256_sign_setup(ENGINE *e, void *data)
+{
+    int err;
+    int skip = 0;
+    int i;
+    EC_KEY *key = NULL;
+    EC_KEY *keyOSSL = NULL;
+    BIGNUM *kinv = NULL;
+    BIGNUM *r = NULL;
+    ECDSA_SIG *sig = NULL;
+    const BIGNUM *sigR = NULL;
+    unsigned char ecdsaSig[140];
+    unsigned int sigLen;
+    unsigned char buf[32];
+    const unsigned char *p;
+    unsigned char childSig[140];
+    unsigned int childSigLen = 0;
+    int fds[2] = { -1, -1 };
+    pid_t pid = -1;
+    int status;
+
+    (void)data;
+
+    err = RAND_bytes(buf, sizeof(buf)) == 0;
+    if (err == 0) {
+        err = (key = EC_KEY_new_method(e)) == NULL;
+    }
+    if (err == 0) {
+        p = ecc_key_der_256;
+        key = d2i_ECPrivateKey(&key, &p, sizeof(ecc_key_der_256));
+        err = (key == NULL);
+    }
+    if (err == 0) {
+        p = ecc_key_der_256;
+        keyOSSL = d2i_ECPrivateKey(NULL, &p, sizeof(ecc_key_der_256));
+        err = (keyOSSL == NULL);
+    }
+    if (err == 0) {
+        PRINT_MSG("Sign setup with wolfengine");
+        if (ECDSA_sign_setup(key, NULL, &kinv, &r) != 1) {
+            PRINT_MSG("ECDSA sign setup not supported - skipping");
+            skip = 1;
+        }
+    }
+    if (err == 0 && !skip) {
+        PRINT_MSG("Sign with precomputed values");
+        sigLen = sizeof(ecdsaSig);
+        err = ECDSA_sign_ex(0, buf, sizeof(buf), ecdsaSig, &sigLen, kinv, r,
+                            key) != 1;
+    }
+    if (err == 0 && !skip) {
+        PRINT_MSG("Verify with OpenSSL");
+        err = test_ec_key_ecdsa_verify(keyOSSL, buf, sizeof(buf), ecdsaSig,
+                                       sigLen);
+    }
+    if (err == 0 && !skip) {
+        PRINT_MSG("Check r is the precomputed value");
+        p = ecdsaSig;
+        err = (sig = d2i_ECDSA_SIG(NULL, &p, sigLen)) == NULL;
+    }
+    if (err == 0 && !skip) {
+        ECDSA_SIG_get0(sig, &sigR, NULL);
+        err = BN_cmp(sigR, r) != 0;
+    }
+    ECDSA_SIG_free(sig);
+    sig = NULL;
+    if (err == 0 && !skip) {
+        PRINT_MSG("Sign signature object with precomputed values");
+        err = (sig = ECDSA_do_sign_ex(buf, sizeof(buf), kinv, r, key)) == NULL;
+    }
+    if (err == 0 && !skip) {
+        PRINT_MSG("Verify signature object with OpenSSL");
+        err = ECDSA_do_verify(buf, sizeof(buf), sig, keyOSSL) != 1;
+    }
+    if (err == 0 && !skip) {
+        PRINT_MSG("Enable sign pool");
+        err = ENGINE_ctrl_cmd(e, "ecdsa_sign_pool_size", 4, NULL, NULL,
+                              1) != 1;
+    }
+    /* Sign more times than pool holds - falls back when empty. */
+    for (i = 0; err == 0 && !skip && i < 8; i++) {
+        PRINT_MSG("Sign with sign pool enabled");
+        sigLen = sizeof(ecdsaSig);
+        err = ECDSA_sign(0, buf, sizeof(buf), ecdsaSig, &sigLen, key) != 1;
+        if (err == 0) {
+            PRINT_MSG("Verify with OpenSSL");
+            err = test_ec_key_ecdsa_verify(keyOSSL, buf, sizeof(buf),
+                                           ecdsaSig, sigLen);
+        }
+    }
+    if (err == 0 && !skip) {
+        /* Give the thread time to refill the pool. */
+        usleep(100000);
+        PRINT_MSG("Sign in child and parent after fork");
+        err = pipe(fds) != 0;
+    }
+    if (err == 0 && !skip) {
+        pid = fork();
+        err = pid < 0;
+    }
+    if (err == 0 && !skip && pid == 0) {
+        /* Child must not take the values left in the parent's pool. */
+        close(fds[0]);
+        sigLen = sizeof(ecdsaSig);
+        if (ECDSA_sign(0, buf, sizeof(buf), ecdsaSig, &sigLen, key) != 1 ||
+                write(fds[1], ecdsaSig, sigLen) != (ssize_t)sigLen) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    if (err == 0 && !skip) {
+        close(fds[1]);
+        fds[1] = -1;
+        sigLen = sizeof(ecdsaSig);
+        err = ECDSA_sign(0, buf, sizeof(buf), ecdsaSig, &sigLen, key) != 1;
+        if (err == 0) {
+            childSigLen = (unsigned int)read(fds[0], childSig,
+                                             sizeof(childSig));
+        }
+        if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+                WEXITSTATUS(status) != 0) {
+            PRINT_ERR_MSG("Child failed to sign");
+            err = 1;
+        }
+    }
+    if (err == 0 && !skip) {
+        PRINT_MSG("Verify child's signature with OpenSSL");
+        err = test_ec_key_ecdsa_verify(keyOSSL, buf, sizeof(buf), childSig,
+                                       childSigLen);
+    }
+    if (err == 0 && !skip) {
+        PRINT_MSG("Check child and parent used different k");
+        err = childSigLen == sigLen && memcmp(childSig, ecdsaSig, sigLen) == 0;
+    }
+    if (fds[0] >= 0) {
+        close(fds[0]);
+    }
+    if (fds[1] >= 0) {
+        close(fds[1]);
+    }
+    if (!skip) {
+        PRINT_MSG("Disable sign pool");
+        if (ENGINE_ctrl_cmd(e, "ecdsa_sign_pool_size", 0, NULL, NULL,
+                            1) != 1) {
+            err = 1;
+        }
+    }
+
+    ECDSA_SIG_free(sig);
+    BN_clear_free(kinv);
+    BN_free(r);
+    EC_KEY_free(keyOSSL);
+    EC_KEY_free(key);
+
+    return err;
+}
+#endif /* WE_HAVE_EC_P256 */
+
 #endif /* WE_HAVE_ECDSA */
 
 #endif /* WE_HAVE_EC_KEY */
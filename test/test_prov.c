@@ -0,0 +1,619 @@
+/* test_prov.c
+ *
+ * Copyright (C) 2019-2021 wolfSSL Inc.
+ *
+ * This file is part of wolfengine.
+ *
+ * wolfengine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfengine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#include "unit.h"
+
+#ifdef WE_HAVE_PROVIDER
+
+#include <openssl/provider.h>
+
+/* Property query that fetches algorithms from the wolfEngine provider. */
+#define PROV_PROPS      "provider=libwolfprov"
+/* Property query that fetches algorithms from OpenSSL's default provider. */
+#define DEF_PROPS       "provider=default"
+
+/* Load OpenSSL's default provider, to compare with, and the wolfEngine
+ * provider. */
+static int test_prov_load(OSSL_PROVIDER **def, OSSL_PROVIDER **prov)
+{
+    int err;
+
+    err = (*def = OSSL_PROVIDER_load(NULL, "default")) == NULL;
+    if (err == 0) {
+        err = (*prov = OSSL_PROVIDER_load(NULL, "libwolfprov")) == NULL;
+        if (err == 1) {
+            PRINT_ERR_MSG("Failed to load provider libwolfprov");
+            OSSL_PROVIDER_unload(*def);
+        }
+    }
+
+    return err;
+}
+
+/******************************************************************************/
+
+#ifdef WE_HAVE_SHA256
+
+static int test_prov_digest_calc(EVP_MD *md, unsigned char *msg, int len,
+                                 unsigned char *dgst, unsigned char *dupDgst)
+{
+    int err;
+    EVP_MD_CTX *ctx;
+    EVP_MD_CTX *dup = NULL;
+    unsigned int dLen;
+
+    err = (ctx = EVP_MD_CTX_new()) == NULL;
+    if (err == 0) {
+        err = (dup = EVP_MD_CTX_new()) == NULL;
+    }
+    if (err == 0) {
+        err = EVP_DigestInit_ex(ctx, md, NULL) != 1;
+    }
+    if (err == 0) {
+        err = EVP_DigestUpdate(ctx, msg, len / 2) != 1;
+    }
+    if (err == 0) {
+        /* Duplicate part way through - both must finish the same. */
+        err = EVP_MD_CTX_copy_ex(dup, ctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_DigestUpdate(ctx, msg + len / 2, len - len / 2) != 1;
+    }
+    if (err == 0) {
+        err = EVP_DigestUpdate(dup, msg + len / 2, len - len / 2) != 1;
+    }
+    if (err == 0) {
+        err = EVP_DigestFinal_ex(ctx, dgst, &dLen) != 1;
+    }
+    if (err == 0) {
+        err = EVP_DigestFinal_ex(dup, dupDgst, &dLen) != 1;
+    }
+
+    EVP_MD_CTX_free(dup);
+    EVP_MD_CTX_free(ctx);
+
+    return err;
+}
+
+int test_prov_digest(ENGINE *e, void *data)
+{
+    int err;
+    OSSL_PROVIDER *def;
+    OSSL_PROVIDER *prov;
+    EVP_MD *md = NULL;
+    EVP_MD *defMd = NULL;
+    unsigned char msg[] = "Test pattern for provider digest";
+    unsigned char dgst[SHA256_DIGEST_LENGTH];
+    unsigned char dupDgst[SHA256_DIGEST_LENGTH];
+    unsigned char exp[SHA256_DIGEST_LENGTH];
+
+    (void)e;
+    (void)data;
+
+    err = test_prov_load(&def, &prov);
+    if (err == 0) {
+        err = (md = EVP_MD_fetch(NULL, "SHA256", PROV_PROPS)) == NULL;
+        if (err == 0) {
+            err = (defMd = EVP_MD_fetch(NULL, "SHA256", DEF_PROPS)) == NULL;
+        }
+        if (err == 0) {
+            PRINT_MSG("Digest with OpenSSL");
+            err = test_prov_digest_calc(defMd, msg, sizeof(msg), exp, dupDgst);
+        }
+        if (err == 0) {
+            PRINT_MSG("Digest with wolfEngine provider");
+            err = test_prov_digest_calc(md, msg, sizeof(msg), dgst, dupDgst);
+        }
+        if (err == 0) {
+            PRINT_BUFFER("Digest", dgst, sizeof(dgst));
+            if ((memcmp(dgst, exp, sizeof(exp)) != 0) ||
+                    (memcmp(dupDgst, exp, sizeof(exp)) != 0)) {
+                PRINT_ERR_MSG("Digest doesn't match OpenSSL");
+                err = 1;
+            }
+        }
+
+        EVP_MD_free(defMd);
+        EVP_MD_free(md);
+        OSSL_PROVIDER_unload(prov);
+        OSSL_PROVIDER_unload(def);
+    }
+
+    return err;
+}
+
+#endif /* WE_HAVE_SHA256 */
+
+/******************************************************************************/
+
+#if defined(WE_HAVE_DES3CBC) || defined(WE_HAVE_AESECB) || \
+    defined(WE_HAVE_AESCBC) || defined(WE_HAVE_AESCTR)
+
+/* Encrypt or decrypt the data in pieces of a fixed size. */
+static int test_prov_cipher_stream(EVP_CIPHER *cipher, int enc,
+                                   unsigned char *key, unsigned char *iv,
+                                   unsigned char *in, int len, int part,
+                                   unsigned char *out, int *outLen)
+{
+    int err;
+    EVP_CIPHER_CTX *ctx;
+    int oLen = 0;
+    int l;
+    int i;
+
+    err = (ctx = EVP_CIPHER_CTX_new()) == NULL;
+    if (err == 0) {
+        err = EVP_CipherInit_ex(ctx, cipher, NULL, key, iv, enc) != 1;
+    }
+    for (i = 0; (err == 0) && (i < len); i += part) {
+        err = EVP_CipherUpdate(ctx, out + oLen, &l, in + i,
+                               (len - i < part) ? len - i : part) != 1;
+        if (err == 0) {
+            oLen += l;
+        }
+    }
+    if (err == 0) {
+        err = EVP_CipherFinal_ex(ctx, out + oLen, &l) != 1;
+    }
+    if (err == 0) {
+        *outLen = oLen + l;
+    }
+
+    EVP_CIPHER_CTX_free(ctx);
+
+    return err;
+}
+
+/* Compare encryption in pieces with OpenSSL and decrypt back. */
+static int test_prov_cipher_cmp(const char *name, int keyLen, int ivLen)
+{
+    int err;
+    EVP_CIPHER *cipher = NULL;
+    EVP_CIPHER *defCipher = NULL;
+    unsigned char msg[] = "Test pattern for provider ciphers in pieces";
+    unsigned char key[32];
+    unsigned char iv[16];
+    unsigned char exp[sizeof(msg) + 16];
+    unsigned char enc[sizeof(msg) + 16];
+    unsigned char dec[sizeof(msg) + 16];
+    int expLen;
+    int encLen;
+    int decLen;
+    int part;
+
+    PRINT_MSG(name);
+
+    err = RAND_bytes(key, keyLen) != 1;
+    if ((err == 0) && (ivLen > 0)) {
+        err = RAND_bytes(iv, ivLen) != 1;
+    }
+    if (err == 0) {
+        err = (cipher = EVP_CIPHER_fetch(NULL, name, PROV_PROPS)) == NULL;
+    }
+    if (err == 0) {
+        err = (defCipher = EVP_CIPHER_fetch(NULL, name, DEF_PROPS)) == NULL;
+    }
+    if (err == 0) {
+        err = test_prov_cipher_stream(defCipher, 1, key, iv, msg, sizeof(msg),
+                                      sizeof(msg), exp, &expLen);
+    }
+    for (part = 1; (err == 0) && (part <= 17); part += 8) {
+        err = test_prov_cipher_stream(cipher, 1, key, iv, msg, sizeof(msg),
+                                      part, enc, &encLen);
+        if ((err == 0) && ((encLen != expLen) ||
+                           (memcmp(enc, exp, expLen) != 0))) {
+            PRINT_ERR_MSG("Encrypted data doesn't match OpenSSL");
+            err = 1;
+        }
+        if (err == 0) {
+            err = test_prov_cipher_stream(cipher, 0, key, iv, enc, encLen,
+                                          part, dec, &decLen);
+        }
+        if ((err == 0) && ((decLen != (int)sizeof(msg)) ||
+                           (memcmp(dec, msg, sizeof(msg)) != 0))) {
+            PRINT_ERR_MSG("Decrypted data doesn't match message");
+            err = 1;
+        }
+    }
+
+    EVP_CIPHER_free(defCipher);
+    EVP_CIPHER_free(cipher);
+
+    return err;
+}
+
+int test_prov_cipher(ENGINE *e, void *data)
+{
+    int err;
+    OSSL_PROVIDER *def;
+    OSSL_PROVIDER *prov;
+
+    (void)e;
+    (void)data;
+
+    err = test_prov_load(&def, &prov);
+    if (err == 0) {
+    #ifdef WE_HAVE_DES3CBC
+        if (err == 0) {
+            err = test_prov_cipher_cmp("DES-EDE3-CBC", 24, 8);
+        }
+    #endif
+    #ifdef WE_HAVE_AESECB
+        if (err == 0) {
+            err = test_prov_cipher_cmp("AES-128-ECB", 16, 0);
+        }
+        if (err == 0) {
+            err = test_prov_cipher_cmp("AES-256-ECB", 32, 0);
+        }
+    #endif
+    #ifdef WE_HAVE_AESCBC
+        if (err == 0) {
+            err = test_prov_cipher_cmp("AES-128-CBC", 16, 16);
+        }
+        if (err == 0) {
+            err = test_prov_cipher_cmp("AES-256-CBC", 32, 16);
+        }
+    #endif
+    #ifdef WE_HAVE_AESCTR
+        if (err == 0) {
+            err = test_prov_cipher_cmp("AES-128-CTR", 16, 16);
+        }
+        if (err == 0) {
+            err = test_prov_cipher_cmp("AES-256-CTR", 32, 16);
+        }
+    #endif
+
+        OSSL_PROVIDER_unload(prov);
+        OSSL_PROVIDER_unload(def);
+    }
+
+    return err;
+}
+
+#endif /* WE_HAVE_DES3CBC || WE_HAVE_AESECB || WE_HAVE_AESCBC || ... */
+
+/******************************************************************************/
+
+#if defined(WE_HAVE_AESGCM) || defined(WE_HAVE_AESCCM)
+
+/* Decrypt and check the tag. */
+static int test_prov_aead_dec(EVP_CIPHER *cipher, unsigned char *key,
+                              unsigned char *iv, int ivLen, unsigned char *aad,
+                              int aadLen, unsigned char *enc, int len,
+                              unsigned char *tag, unsigned char *dec, int ccm)
+{
+    int err;
+    EVP_CIPHER_CTX *ctx;
+    int decLen;
+
+    err = (ctx = EVP_CIPHER_CTX_new()) == NULL;
+    if (err == 0) {
+        err = EVP_DecryptInit_ex(ctx, cipher, NULL, NULL, NULL) != 1;
+    }
+    if (err == 0) {
+        err = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, ivLen,
+                                  NULL) != 1;
+    }
+    if (err == 0) {
+        err = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, 16, tag) != 1;
+    }
+    if (err == 0) {
+        err = EVP_DecryptInit_ex(ctx, NULL, NULL, key, iv) != 1;
+    }
+    if ((err == 0) && ccm) {
+        err = EVP_DecryptUpdate(ctx, NULL, &decLen, NULL, len) != 1;
+    }
+    if (err == 0) {
+        err = EVP_DecryptUpdate(ctx, NULL, &decLen, aad, aadLen) != 1;
+    }
+    if (err == 0) {
+        err = EVP_DecryptUpdate(ctx, dec, &decLen, enc, len) != 1;
+    }
+    /* CCM checks the tag when decrypting. */
+    if ((err == 0) && !ccm) {
+        err = EVP_DecryptFinal_ex(ctx, dec + decLen, &decLen) != 1;
+    }
+
+    EVP_CIPHER_CTX_free(ctx);
+
+    return err;
+}
+
+#endif /* WE_HAVE_AESGCM || WE_HAVE_AESCCM */
+
+#ifdef WE_HAVE_AESGCM
+
+#ifdef WE_HAVE_AESGCM_STREAM
+/* Length of data encrypted before duplicating - streaming supported. */
+#define PROV_GCM_PART       16
+#else
+/* All data encrypted in one update after duplicating - no streaming. */
+#define PROV_GCM_PART       0
+#endif
+
+/* Encrypt with AES-GCM, duplicating the context part way through. Both
+ * contexts must produce the same encrypted data and tag. */
+static int test_prov_aes_gcm_enc(EVP_CIPHER *cipher, unsigned char *key,
+                                 unsigned char *iv, unsigned char *aad,
+                                 int aadLen, unsigned char *msg, int len,
+                                 unsigned char *enc, unsigned char *tag,
+                                 unsigned char *dupEnc, unsigned char *dupTag)
+{
+    int err;
+    EVP_CIPHER_CTX *ctx;
+    EVP_CIPHER_CTX *dup = NULL;
+    int encLen;
+
+    err = (ctx = EVP_CIPHER_CTX_new()) == NULL;
+    if (err == 0) {
+        err = (dup = EVP_CIPHER_CTX_new()) == NULL;
+    }
+    if (err == 0) {
+        err = EVP_EncryptInit_ex(ctx, cipher, NULL, key, iv) != 1;
+    }
+    if (err == 0) {
+        err = EVP_EncryptUpdate(ctx, NULL, &encLen, aad, aadLen) != 1;
+    }
+    if ((err == 0) && (PROV_GCM_PART > 0)) {
+        err = EVP_EncryptUpdate(ctx, enc, &encLen, msg, PROV_GCM_PART) != 1;
+        if (err == 0) {
+            memcpy(dupEnc, enc, PROV_GCM_PART);
+        }
+    }
+    if (err == 0) {
+        err = EVP_CIPHER_CTX_copy(dup, ctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_EncryptUpdate(ctx, enc + PROV_GCM_PART, &encLen,
+                                msg + PROV_GCM_PART, len - PROV_GCM_PART) != 1;
+    }
+    if (err == 0) {
+        err = EVP_EncryptUpdate(dup, dupEnc + PROV_GCM_PART, &encLen,
+                                msg + PROV_GCM_PART, len - PROV_GCM_PART) != 1;
+    }
+    if (err == 0) {
+        err = EVP_EncryptFinal_ex(ctx, enc + len, &encLen) != 1;
+    }
+    if (err == 0) {
+        err = EVP_EncryptFinal_ex(dup, dupEnc + len, &encLen) != 1;
+    }
+    if (err == 0) {
+        err = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, 16, tag) != 1;
+    }
+    if (err == 0) {
+        err = EVP_CIPHER_CTX_ctrl(dup, EVP_CTRL_AEAD_GET_TAG, 16, dupTag) != 1;
+    }
+
+    EVP_CIPHER_CTX_free(dup);
+    EVP_CIPHER_CTX_free(ctx);
+
+    return err;
+}
+
+int test_prov_aes_gcm(ENGINE *e, void *data)
+{
+    int err;
+    OSSL_PROVIDER *def;
+    OSSL_PROVIDER *prov;
+    EVP_CIPHER *cipher = NULL;
+    EVP_CIPHER *defCipher = NULL;
+    unsigned char msg[] = "Test pattern for provider AES-GCM streaming";
+    unsigned char aad[] = "AAD for provider";
+    unsigned char key[16];
+    unsigned char iv[12];
+    unsigned char exp[sizeof(msg)];
+    unsigned char expTag[16];
+    unsigned char enc[sizeof(msg)];
+    unsigned char tag[16];
+    unsigned char dupEnc[sizeof(msg)];
+    unsigned char dupTag[16];
+    unsigned char dec[sizeof(msg)];
+
+    (void)e;
+    (void)data;
+
+    err = test_prov_load(&def, &prov);
+    if (err == 0) {
+        err = RAND_bytes(key, sizeof(key)) != 1;
+        if (err == 0) {
+            err = RAND_bytes(iv, sizeof(iv)) != 1;
+        }
+        if (err == 0) {
+            err = (cipher = EVP_CIPHER_fetch(NULL, "AES-128-GCM",
+                                             PROV_PROPS)) == NULL;
+        }
+        if (err == 0) {
+            err = (defCipher = EVP_CIPHER_fetch(NULL, "AES-128-GCM",
+                                                DEF_PROPS)) == NULL;
+        }
+        if (err == 0) {
+            PRINT_MSG("Encrypt with OpenSSL");
+            err = test_prov_aes_gcm_enc(defCipher, key, iv, aad, sizeof(aad),
+                                        msg, sizeof(msg), exp, expTag, dupEnc,
+                                        dupTag);
+        }
+        if (err == 0) {
+            PRINT_MSG("Encrypt with wolfEngine provider");
+            err = test_prov_aes_gcm_enc(cipher, key, iv, aad, sizeof(aad), msg,
+                                        sizeof(msg), enc, tag, dupEnc, dupTag);
+        }
+        if ((err == 0) && ((memcmp(enc, exp, sizeof(exp)) != 0) ||
+                           (memcmp(tag, expTag, sizeof(tag)) != 0) ||
+                           (memcmp(dupEnc, exp, sizeof(exp)) != 0) ||
+                           (memcmp(dupTag, expTag, sizeof(tag)) != 0))) {
+            PRINT_ERR_MSG("Encrypted data or tag doesn't match OpenSSL");
+            err = 1;
+        }
+        if (err == 0) {
+            PRINT_MSG("Decrypt with wolfEngine provider");
+            err = test_prov_aead_dec(cipher, key, iv, sizeof(iv), aad,
+                                     sizeof(aad), enc, sizeof(msg), tag, dec,
+                                     0);
+        }
+        if ((err == 0) && (memcmp(dec, msg, sizeof(msg)) != 0)) {
+            PRINT_ERR_MSG("Decrypted data doesn't match message");
+            err = 1;
+        }
+        if (err == 0) {
+            PRINT_MSG("Decrypt with bad tag");
+            tag[0] ^= 0x80;
+            err = test_prov_aead_dec(cipher, key, iv, sizeof(iv), aad,
+                                     sizeof(aad), enc, sizeof(msg), tag, dec,
+                                     0) != 1;
+        }
+
+        EVP_CIPHER_free(defCipher);
+        EVP_CIPHER_free(cipher);
+        OSSL_PROVIDER_unload(prov);
+        OSSL_PROVIDER_unload(def);
+    }
+
+    return err;
+}
+
+#endif /* WE_HAVE_AESGCM */
+
+#ifdef WE_HAVE_AESCCM
+
+/* Encrypt with AES-CCM. */
+static int test_prov_aes_ccm_enc(EVP_CIPHER *cipher, unsigned char *key,
+                                 unsigned char *iv, int ivLen,
+                                 unsigned char *aad, int aadLen,
+                                 unsigned char *msg, int len,
+                                 unsigned char *enc, unsigned char *tag)
+{
+    int err;
+    EVP_CIPHER_CTX *ctx;
+    int encLen;
+
+    err = (ctx = EVP_CIPHER_CTX_new()) == NULL;
+    if (err == 0) {
+        err = EVP_EncryptInit_ex(ctx, cipher, NULL, NULL, NULL) != 1;
+    }
+    if (err == 0) {
+        err = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, ivLen,
+                                  NULL) != 1;
+    }
+    if (err == 0) {
+        /* CCM needs tag length set before encryption. */
+        err = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, 16, NULL) != 1;
+    }
+    if (err == 0) {
+        err = EVP_EncryptInit_ex(ctx, NULL, NULL, key, iv) != 1;
+    }
+    if (err == 0) {
+        err = EVP_EncryptUpdate(ctx, NULL, &encLen, NULL, len) != 1;
+    }
+    if (err == 0) {
+        err = EVP_EncryptUpdate(ctx, NULL, &encLen, aad, aadLen) != 1;
+    }
+    if (err == 0) {
+        err = EVP_EncryptUpdate(ctx, enc, &encLen, msg, len) != 1;
+    }
+    if (err == 0) {
+        err = EVP_EncryptFinal_ex(ctx, enc + encLen, &encLen) != 1;
+    }
+    if (err == 0) {
+        err = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, 16, tag) != 1;
+    }
+
+    EVP_CIPHER_CTX_free(ctx);
+
+    return err;
+}
+
+int test_prov_aes_ccm(ENGINE *e, void *data)
+{
+    int err;
+    OSSL_PROVIDER *def;
+    OSSL_PROVIDER *prov;
+    EVP_CIPHER *cipher = NULL;
+    EVP_CIPHER *defCipher = NULL;
+    unsigned char msg[] = "Test pattern for provider AES-CCM";
+    unsigned char aad[] = "AAD for provider";
+    unsigned char key[16];
+    unsigned char iv[13];
+    unsigned char enc[sizeof(msg)];
+    unsigned char tag[16];
+    unsigned char dec[sizeof(msg)];
+
+    (void)e;
+    (void)data;
+
+    err = test_prov_load(&def, &prov);
+    if (err == 0) {
+        err = RAND_bytes(key, sizeof(key)) != 1;
+        if (err == 0) {
+            err = RAND_bytes(iv, sizeof(iv)) != 1;
+        }
+        if (err == 0) {
+            err = (cipher = EVP_CIPHER_fetch(NULL, "AES-128-CCM",
+                                             PROV_PROPS)) == NULL;
+        }
+        if (err == 0) {
+            err = (defCipher = EVP_CIPHER_fetch(NULL, "AES-128-CCM",
+                                                DEF_PROPS)) == NULL;
+        }
+        if (err == 0) {
+            PRINT_MSG("Encrypt with OpenSSL");
+            err = test_prov_aes_ccm_enc(defCipher, key, iv, sizeof(iv), aad,
+                                        sizeof(aad), msg, sizeof(msg), enc,
+                                        tag);
+        }
+        if (err == 0) {
+            PRINT_MSG("Decrypt with wolfEngine provider");
+            err = test_prov_aead_dec(cipher, key, iv, sizeof(iv), aad,
+                                     sizeof(aad), enc, sizeof(msg), tag, dec,
+                                     1);
+        }
+        if ((err == 0) && (memcmp(dec, msg, sizeof(msg)) != 0)) {
+            PRINT_ERR_MSG("Decrypted data doesn't match message");
+            err = 1;
+        }
+        if (err == 0) {
+            PRINT_MSG("Encrypt with wolfEngine provider");
+            err = test_prov_aes_ccm_enc(cipher, key, iv, sizeof(iv), aad,
+                                        sizeof(aad), msg, sizeof(msg), enc,
+                                        tag);
+        }
+        if (err == 0) {
+            PRINT_MSG("Decrypt with OpenSSL");
+            err = test_prov_aead_dec(defCipher, key, iv, sizeof(iv), aad,
+                                     sizeof(aad), enc, sizeof(msg), tag, dec,
+                                     1);
+        }
+        if ((err == 0) && (memcmp(dec, msg, sizeof(msg)) != 0)) {
+            PRINT_ERR_MSG("Decrypted data doesn't match message");
+            err = 1;
+        }
+
+        EVP_CIPHER_free(defCipher);
+        EVP_CIPHER_free(cipher);
+        OSSL_PROVIDER_unload(prov);
+        OSSL_PROVIDER_unload(def);
+    }
+
+    return err;
+}
+
+#endif /* WE_HAVE_AESCCM */
+
+#endif /* WE_HAVE_PROVIDER */
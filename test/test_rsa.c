@@ -19,8 +19,20 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
  */
 
+#include <stdlib.h>
+#include <unistd.h>
+
 #include "unit.h"
 
+#include <sys/wait.h>
+#ifdef WE_HAVE_KEYD
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <pthread.h>
+#endif
+
 #ifdef WE_HAVE_RSA
 
 static const unsigned char rsa_key_der_2048[] =
@@ -353,6 +365,532 @@ int test_rsa_direct(ENGINE *e, void *data)
     return err;
 }
 
+int test_rsa_sign_verify_direct(ENGINE *e, void *data)
+{
+    int err = 0;
+    RSA *rsaWolfEngine = NULL;
+    RSA *rsaOpenSSL = NULL;
+    unsigned char digest[64];
+    unsigned char *sig = NULL;
+    unsigned int sigLen = 0;
+    const unsigned char *p = rsa_key_der_2048;
+    const RSA_METHOD *rsaMeth = NULL;
+    static const struct {
+        int type;
+        int len;
+    } digests[] = {
+#ifdef WE_HAVE_SHA1
+        { NID_sha1, 20 },
+#endif
+#ifdef WE_HAVE_SHA256
+        { NID_sha256, 32 },
+#endif
+#ifdef WE_HAVE_SHA384
+        { NID_sha384, 48 },
+#endif
+#ifdef WE_HAVE_SHA512
+        { NID_sha512, 64 },
+#endif
+        /* TLS 1.0/1.1 - concatenated digests with no DigestInfo. */
+        { NID_md5_sha1, 36 }
+    };
+    int i;
+    int type;
+    int len;
+
+    (void)data;
+
+    rsaWolfEngine = d2i_RSAPrivateKey(NULL, &p, sizeof(rsa_key_der_2048));
+    err = rsaWolfEngine == NULL;
+    if (err == 0) {
+        p = rsa_key_der_2048;
+        rsaOpenSSL = d2i_RSAPrivateKey(NULL, &p, sizeof(rsa_key_der_2048));
+        err = rsaOpenSSL == NULL;
+    }
+    if (err == 0) {
+        rsaMeth = ENGINE_get_RSA(e);
+        err = rsaMeth == NULL;
+    }
+    if (err == 0) {
+        err = RSA_set_method(rsaWolfEngine, rsaMeth) != 1;
+    }
+    if (err == 0) {
+        sig = OPENSSL_malloc(RSA_size(rsaWolfEngine));
+        err = sig == NULL;
+    }
+
+    for (i = 0; err == 0 && i < (int)(sizeof(digests) / sizeof(*digests));
+         i++) {
+        type = digests[i].type;
+        len = digests[i].len;
+        PRINT_MSG(OBJ_nid2sn(type));
+        err = RAND_bytes(digest, len) == 0;
+        if (err == 0) {
+            PRINT_MSG("RSA_sign with wolfengine");
+            err = RSA_sign(type, digest, len, sig, &sigLen,
+                           rsaWolfEngine) != 1;
+        }
+        if (err == 0) {
+            PRINT_MSG("RSA_verify with OpenSSL");
+            err = RSA_verify(type, digest, len, sig, sigLen,
+                             rsaOpenSSL) != 1;
+        }
+        if (err == 0) {
+            PRINT_MSG("RSA_sign with OpenSSL");
+            err = RSA_sign(type, digest, len, sig, &sigLen,
+                           rsaOpenSSL) != 1;
+        }
+        if (err == 0) {
+            PRINT_MSG("RSA_verify with wolfengine");
+            err = RSA_verify(type, digest, len, sig, sigLen,
+                             rsaWolfEngine) != 1;
+        }
+        if (err == 0) {
+            PRINT_MSG("RSA_verify bad signature with wolfengine");
+            sig[1] ^= 0x80;
+            err = RSA_verify(type, digest, len, sig, sigLen,
+                             rsaWolfEngine) == 1;
+        }
+    }
+
+    OPENSSL_free(sig);
+    RSA_free(rsaWolfEngine);
+    RSA_free(rsaOpenSSL);
+
+    return err;
+}
+
+#ifdef WE_HAVE_SHA256
+int test_rsa_batch_verify(ENGINE *e, void *data)
+{
+    int err = 0;
+    RSA *rsa[2] = { NULL, NULL };
+    EVP_PKEY *pkey[2] = { NULL, NULL };
+    BIGNUM *pubExp = NULL;
+    const unsigned char *p = rsa_key_der_2048;
+    unsigned char digest[9][32];
+    unsigned char sig[9][256];
+    unsigned int sigLen;
+    WE_RSA_VERIFY_ITEM items[9];
+    WE_RSA_BATCH_VERIFY batch;
+    unsigned char results[2];
+    int threads[] = { 1, 4 };
+    int i;
+
+    (void)data;
+
+    PRINT_MSG("Set up two RSA keys");
+    rsa[0] = d2i_RSAPrivateKey(NULL, &p, sizeof(rsa_key_der_2048));
+    err = rsa[0] == NULL;
+    if (err == 0) {
+        err = (rsa[1] = RSA_new()) == NULL;
+    }
+    if (err == 0) {
+        err = (pubExp = BN_new()) == NULL;
+    }
+    if (err == 0) {
+        err = BN_set_word(pubExp, RSA_F4) != 1;
+    }
+    if (err == 0) {
+        err = RSA_generate_key_ex(rsa[1], 2048, pubExp, NULL) != 1;
+    }
+    for (i = 0; err == 0 && i < 2; i++) {
+        err = (pkey[i] = EVP_PKEY_new()) == NULL;
+        if (err == 0) {
+            err = EVP_PKEY_set1_RSA(pkey[i], rsa[i]) != 1;
+        }
+    }
+
+    PRINT_MSG("Sign with OpenSSL");
+    for (i = 0; err == 0 && i < 9; i++) {
+        err = RAND_bytes(digest[i], sizeof(digest[i])) == 0;
+        if (err == 0) {
+            err = RSA_sign(NID_sha256, digest[i], sizeof(digest[i]), sig[i],
+                           &sigLen, rsa[i % 2]) != 1;
+        }
+        if (err == 0) {
+            items[i].pkey = pkey[i % 2];
+            items[i].md = EVP_sha256();
+            items[i].digest = digest[i];
+            items[i].digestLen = sizeof(digest[i]);
+            items[i].sig = sig[i];
+            items[i].sigLen = sigLen;
+        }
+    }
+    if (err == 0) {
+        /* Bad signature, wrong digest and no key. */
+        sig[3][1] ^= 0x80;
+        digest[6][0] ^= 0x01;
+        items[8].pkey = NULL;
+    }
+
+    for (i = 0; err == 0 && i < 2; i++) {
+        PRINT_MSG("Batch verify with wolfengine");
+        batch.items = items;
+        batch.cnt = 9;
+        batch.results = results;
+        batch.threads = threads[i];
+        err = ENGINE_ctrl_cmd(e, "rsa_batch_verify", 0, &batch, NULL,
+                              0) != 1;
+        if (err == 0) {
+            err = results[0] != 0xb7 || results[1] != 0x00;
+        }
+    }
+
+    BN_free(pubExp);
+    for (i = 0; i < 2; i++) {
+        EVP_PKEY_free(pkey[i]);
+        RSA_free(rsa[i]);
+    }
+
+    return err;
+}
+#endif /* WE_HAVE_SHA256 */
+
+int test_rsa_keystore(ENGINE *e, void *data)
+{
+    int err = 0;
+    char path[] = "/tmp/we_keystore_XXXXXX";
+    int fd = -1;
+    EVP_PKEY *priv[2] = { NULL, NULL };
+    EVP_PKEY *pub = NULL;
+    RSA *rsa = NULL;
+    const unsigned char *p = rsa_key_der_2048;
+    unsigned char digest[32];
+    unsigned char sig[256];
+    unsigned int sigLen;
+    int i;
+    int init = 0;
+
+    (void)data;
+
+    PRINT_MSG("Write DER key file");
+    fd = mkstemp(path);
+    err = fd < 0;
+    if (err == 0) {
+        err = write(fd, rsa_key_der_2048, sizeof(rsa_key_der_2048)) !=
+              (ssize_t)sizeof(rsa_key_der_2048);
+        close(fd);
+    }
+    if (err == 0) {
+        /* Loading keys requires a functional reference. */
+        err = ENGINE_init(e) != 1;
+        init = (err == 0);
+    }
+    if (err == 0) {
+        /* Identifier is the path when no keystore directory set. */
+        err = ENGINE_ctrl_cmd(e, "keystore_dir", 0, NULL, NULL, 0) != 1;
+    }
+
+    PRINT_MSG("Load private key twice - same key returned");
+    if (err == 0) {
+        err = (priv[0] = ENGINE_load_private_key(e, path, NULL, NULL)) == NULL;
+    }
+    if (err == 0) {
+        /* Later loads return the decoded key - no need for the file. */
+        err = unlink(path) != 0;
+    }
+    if (err == 0) {
+        err = (priv[1] = ENGINE_load_private_key(e, path, NULL, NULL)) == NULL;
+    }
+    if (err == 0) {
+        err = priv[0] != priv[1];
+    }
+    if (err == 0) {
+        err = (pub = ENGINE_load_public_key(e, path, NULL, NULL)) == NULL;
+    }
+
+    PRINT_MSG("Sign with keystore keys");
+    if (err == 0) {
+        err = RAND_bytes(digest, sizeof(digest)) == 0;
+    }
+    for (i = 1; err == 0 && i >= 0; i--) {
+        err = RSA_sign(NID_sha256, digest, sizeof(digest), sig, &sigLen,
+                       (RSA *)EVP_PKEY_get0_RSA(priv[i])) != 1;
+    }
+
+    PRINT_MSG("Verify with OpenSSL and keystore public key");
+    if (err == 0) {
+        err = (rsa = d2i_RSAPrivateKey(NULL, &p,
+                                       sizeof(rsa_key_der_2048))) == NULL;
+    }
+    if (err == 0) {
+        err = RSA_verify(NID_sha256, digest, sizeof(digest), sig, sigLen,
+                         rsa) != 1;
+    }
+    if (err == 0) {
+        err = RSA_verify(NID_sha256, digest, sizeof(digest), sig, sigLen,
+                         (RSA *)EVP_PKEY_get0_RSA(pub)) != 1;
+    }
+
+    PRINT_MSG("Unknown key identifier fails");
+    if (err == 0) {
+        err = ENGINE_load_private_key(e, "/tmp/we_keystore_none", NULL,
+                                      NULL) != NULL;
+    }
+
+    ENGINE_ctrl_cmd(e, "keystore_dir", 0, NULL, NULL, 0);
+    RSA_free(rsa);
+    EVP_PKEY_free(pub);
+    EVP_PKEY_free(priv[1]);
+    EVP_PKEY_free(priv[0]);
+    if (init) {
+        ENGINE_finish(e);
+    }
+    if (fd >= 0) {
+        unlink(path);
+    }
+
+    return err;
+}
+
+#ifdef WE_HAVE_KEYD
+/* Key daemon program - tests run from the top of the build directory. */
+#define KEYD_PROG       "./keyd"
+
+/* Start the key daemon and wait for it to accept connections. */
+static int test_keyd_start(const char *keysDir, const char *sockPath,
+                           pid_t *pid)
+{
+    int err = 0;
+    const char *engDir = getenv("OPENSSL_ENGINES");
+    struct sockaddr_un addr;
+    int listening = 0;
+    int status;
+    int fd;
+    int i;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sockPath, sizeof(addr.sun_path) - 1);
+
+    *pid = fork();
+    err = *pid < 0;
+    if (err == 0 && *pid == 0) {
+        execl(KEYD_PROG, KEYD_PROG, "--socket", sockPath, "--keys", keysDir,
+              "--threads", "2", "--dir", (engDir != NULL) ? engDir : ".libs",
+              (char *)NULL);
+        _exit(127);
+    }
+    for (i = 0; err == 0 && !listening && i < 100; i++) {
+        err = (fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0;
+        if (err == 0) {
+            listening = connect(fd, (struct sockaddr *)&addr,
+                                sizeof(addr)) == 0;
+            close(fd);
+        }
+        if (err == 0 && !listening) {
+            if (waitpid(*pid, &status, WNOHANG) == *pid) {
+                PRINT_ERR_MSG("Key daemon exited");
+                *pid = -1;
+                err = 1;
+            }
+            else {
+                usleep(100000);
+            }
+        }
+    }
+    if (err == 0 && !listening) {
+        PRINT_ERR_MSG("Key daemon not listening");
+        err = 1;
+    }
+
+    return err;
+}
+
+/* Stop the key daemon with SIGTERM - must exit cleanly and remove socket. */
+static int test_keyd_stop(pid_t pid, const char *sockPath)
+{
+    int err;
+    int status = 0;
+
+    err = kill(pid, SIGTERM) != 0;
+    if (err == 0) {
+        err = waitpid(pid, &status, 0) != pid;
+    }
+    if (err == 0) {
+        err = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    if (err == 0) {
+        err = access(sockPath, F_OK) == 0;
+    }
+
+    return err;
+}
+
+/* Number of threads signing through the key daemon at once. */
+#define TEST_KEYD_THREADS       8
+
+/* Keys used by the signing threads. */
+typedef struct TEST_KEYD_KEYS {
+    /* Key held by daemon. */
+    RSA *remote;
+    /* Same key loaded from file to verify with. */
+    RSA *local;
+} TEST_KEYD_KEYS;
+
+/* Sign with key in daemon while other threads have requests outstanding. */
+static void *test_rsa_keyd_thread(void *arg)
+{
+    TEST_KEYD_KEYS *keys = (TEST_KEYD_KEYS *)arg;
+    int err = 0;
+    unsigned char digest[32];
+    unsigned char sig[256];
+    unsigned int sigLen;
+    int i;
+
+    for (i = 0; err == 0 && i < 16; i++) {
+        err = RAND_bytes(digest, sizeof(digest)) == 0;
+        if (err == 0) {
+            err = RSA_sign(NID_sha256, digest, sizeof(digest), sig, &sigLen,
+                           keys->remote) != 1;
+        }
+        if (err == 0) {
+            err = RSA_verify(NID_sha256, digest, sizeof(digest), sig, sigLen,
+                             keys->local) != 1;
+        }
+    }
+
+    return err ? (void *)1 : NULL;
+}
+
+int test_rsa_keyd(ENGINE *e, void *data)
+{
+    int err = 0;
+    char dir[] = "/tmp/we_keyd_XXXXXX";
+    char path[sizeof(dir) + 16] = "";
+    char sockPath[sizeof(dir) + 16] = "";
+    int fd = -1;
+    int init = 0;
+    pid_t pid = -1;
+    EVP_PKEY *pkey = NULL;
+    EVP_PKEY *remote = NULL;
+    unsigned char digest[32];
+    unsigned char sig[256];
+    unsigned int sigLen;
+    int i;
+    TEST_KEYD_KEYS keys;
+    pthread_t thread[TEST_KEYD_THREADS];
+    int started = 0;
+    void *res;
+
+    (void)data;
+
+    PRINT_MSG("Write DER key file");
+    err = mkdtemp(dir) == NULL;
+    if (err == 0) {
+        BIO_snprintf(path, sizeof(path), "%s/rsa.der", dir);
+        BIO_snprintf(sockPath, sizeof(sockPath), "%s/keyd.sock", dir);
+        fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+        err = fd < 0;
+    }
+    if (err == 0) {
+        err = write(fd, rsa_key_der_2048, sizeof(rsa_key_der_2048)) !=
+              (ssize_t)sizeof(rsa_key_der_2048);
+        close(fd);
+    }
+    if (err == 0) {
+        /* Loading keys requires a functional reference. */
+        err = ENGINE_init(e) != 1;
+        init = (err == 0);
+    }
+
+    PRINT_MSG("Key daemon not running - load fails");
+    if (err == 0) {
+        err = ENGINE_ctrl_cmd_string(e, "keyd_socket", sockPath, 0) != 1;
+    }
+    if (err == 0) {
+        err = ENGINE_load_private_key(e, "rsa.der", NULL, NULL) != NULL;
+    }
+
+    PRINT_MSG("Key daemon socket cleared - key loaded from file");
+    if (err == 0) {
+        err = ENGINE_ctrl_cmd(e, "keyd_socket", 0, NULL, NULL, 0) != 1;
+    }
+    if (err == 0) {
+        err = (pkey = ENGINE_load_private_key(e, path, NULL, NULL)) == NULL;
+    }
+    if (err == 0) {
+        err = RAND_bytes(digest, sizeof(digest)) == 0;
+    }
+    if (err == 0) {
+        err = RSA_sign(NID_sha256, digest, sizeof(digest), sig, &sigLen,
+                       (RSA *)EVP_PKEY_get0_RSA(pkey)) != 1;
+    }
+    if (err == 0) {
+        err = RSA_verify(NID_sha256, digest, sizeof(digest), sig, sigLen,
+                         (RSA *)EVP_PKEY_get0_RSA(pkey)) != 1;
+    }
+
+    PRINT_MSG("Start key daemon");
+    if (err == 0) {
+        err = test_keyd_start(dir, sockPath, &pid);
+    }
+    if (err == 0) {
+        err = ENGINE_ctrl_cmd_string(e, "keyd_socket", sockPath, 0) != 1;
+    }
+    if (err == 0) {
+        err = (remote = ENGINE_load_private_key(e, "rsa.der", NULL,
+                                                NULL)) == NULL;
+    }
+
+    PRINT_MSG("Sign with key in daemon - verify with key from file");
+    for (i = 0; err == 0 && i < 4; i++) {
+        err = RAND_bytes(digest, sizeof(digest)) == 0;
+        if (err == 0) {
+            err = RSA_sign(NID_sha256, digest, sizeof(digest), sig, &sigLen,
+                           (RSA *)EVP_PKEY_get0_RSA(remote)) != 1;
+        }
+        if (err == 0) {
+            err = RSA_verify(NID_sha256, digest, sizeof(digest), sig, sigLen,
+                             (RSA *)EVP_PKEY_get0_RSA(pkey)) != 1;
+        }
+    }
+
+    PRINT_MSG("Sign in many threads - requests pipelined on connections");
+    if (err == 0) {
+        keys.remote = (RSA *)EVP_PKEY_get0_RSA(remote);
+        keys.local = (RSA *)EVP_PKEY_get0_RSA(pkey);
+    }
+    while (err == 0 && started < TEST_KEYD_THREADS) {
+        err = pthread_create(&thread[started], NULL, test_rsa_keyd_thread,
+                             &keys) != 0;
+        if (err == 0) {
+            started++;
+        }
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(thread[i], &res);
+        if (res != NULL) {
+            err = 1;
+        }
+    }
+
+    PRINT_MSG("Stop key daemon with SIGTERM");
+    if (err == 0) {
+        err = test_keyd_stop(pid, sockPath);
+        pid = -1;
+    }
+
+    if (pid > 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    EVP_PKEY_free(remote);
+    EVP_PKEY_free(pkey);
+    if (init) {
+        ENGINE_ctrl_cmd(e, "keyd_socket", 0, NULL, NULL, 0);
+        ENGINE_finish(e);
+    }
+    unlink(sockPath);
+    unlink(path);
+    rmdir(dir);
+
+    return err;
+}
+#endif /* WE_HAVE_KEYD */
+
+
 #ifdef WE_HAVE_EVP_PKEY
 
 int test_rsa_sign_verify(ENGINE *e, void *data)
@@ -453,26 +991,190 @@ int test_rsa_sign_verify(ENGINE *e, void *data)
     return err;
 }
 
-int test_rsa_keygen(ENGINE *e, void *data)
+int test_rsa_sign_verify_digests(ENGINE *e, void *data)
 {
     int err;
-    EVP_PKEY_CTX *ctx = NULL;
+    size_t i;
     EVP_PKEY *pkey = NULL;
-#if OPENSSL_VERSION_NUMBER >= 0x30000000L
-    const RSA *rsaKey = NULL;
-#else
-    RSA *rsaKey = NULL;
+    unsigned char *rsaSig = NULL;
+    size_t rsaSigLen = 0;
+    unsigned char buf[20];
+    const unsigned char *p = rsa_key_der_2048;
+    const EVP_MD *mds[] = {
+#ifdef WE_HAVE_SHA1
+        EVP_sha1(),
 #endif
-    BIGNUM *eCmd = NULL;
-    BIGNUM *n = NULL;
-    BIGNUM *eKey = NULL;
-    const int newKeySize = 1024;
+#ifdef WE_HAVE_SHA224
+        EVP_sha224(),
+#endif
+#ifdef WE_HAVE_SHA256
+        EVP_sha256(),
+#endif
+#ifdef WE_HAVE_SHA384
+        EVP_sha384(),
+#endif
+#ifdef WE_HAVE_SHA512
+        EVP_sha512(),
+#endif
+#ifdef WE_HAVE_SHA3_224
+        EVP_sha3_224(),
+#endif
+#ifdef WE_HAVE_SHA3_256
+        EVP_sha3_256(),
+#endif
+#ifdef WE_HAVE_SHA3_384
+        EVP_sha3_384(),
+#endif
+#ifdef WE_HAVE_SHA3_512
+        EVP_sha3_512(),
+#endif
+        NULL
+    };
 
     (void)data;
 
-    err = (ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, e)) == NULL;
+    PRINT_MSG("Load RSA key");
+    pkey = d2i_PrivateKey(EVP_PKEY_RSA, NULL, &p, sizeof(rsa_key_der_2048));
+    err = pkey == NULL;
     if (err == 0) {
-        err = EVP_PKEY_keygen_init(ctx) != 1;
+        err = RAND_bytes(buf, sizeof(buf)) == 0;
+    }
+    if (err == 0) {
+        rsaSig = OPENSSL_malloc(EVP_PKEY_size(pkey));
+        err = rsaSig == NULL;
+    }
+
+    for (i = 0; err == 0 && mds[i] != NULL; i++) {
+        PRINT_MSG(OBJ_nid2sn(EVP_MD_type(mds[i])));
+        PRINT_MSG("Sign with OpenSSL");
+        rsaSigLen = EVP_PKEY_size(pkey);
+        err = test_digest_sign(pkey, NULL, buf, sizeof(buf), mds[i], rsaSig,
+                               &rsaSigLen);
+        if (err == 0) {
+            PRINT_MSG("Verify with wolfengine");
+            err = test_digest_verify(pkey, e, buf, sizeof(buf), mds[i],
+                                     rsaSig, rsaSigLen);
+        }
+        if (err == 0) {
+            PRINT_MSG("Sign with wolfengine");
+            rsaSigLen = EVP_PKEY_size(pkey);
+            err = test_digest_sign(pkey, e, buf, sizeof(buf), mds[i], rsaSig,
+                                   &rsaSigLen);
+        }
+        if (err == 0) {
+            PRINT_MSG("Verify with OpenSSL");
+            err = test_digest_verify(pkey, NULL, buf, sizeof(buf), mds[i],
+                                     rsaSig, rsaSigLen);
+        }
+    }
+
+    OPENSSL_free(rsaSig);
+    EVP_PKEY_free(pkey);
+
+    return err;
+}
+
+int test_rsa_pkey_dup(ENGINE *e, void *data)
+{
+    int err;
+    EVP_PKEY *pkey = NULL;
+    EVP_PKEY_CTX *ctx = NULL;
+    EVP_PKEY_CTX *dup = NULL;
+    EVP_PKEY_CTX *vctx = NULL;
+    unsigned char *rsaSig = NULL;
+    unsigned char *dupSig = NULL;
+    size_t rsaSigLen = 0;
+    size_t dupSigLen = 0;
+    unsigned char buf[32];
+    const unsigned char *p = rsa_key_der_2048;
+
+    (void)data;
+
+    PRINT_MSG("Load RSA key");
+    pkey = d2i_PrivateKey(EVP_PKEY_RSA, NULL, &p, sizeof(rsa_key_der_2048));
+    err = pkey == NULL;
+    if (err == 0) {
+        err = RAND_bytes(buf, sizeof(buf)) == 0;
+    }
+    if (err == 0) {
+        rsaSigLen = dupSigLen = EVP_PKEY_size(pkey);
+        rsaSig = OPENSSL_malloc(rsaSigLen);
+        dupSig = OPENSSL_malloc(dupSigLen);
+        err = rsaSig == NULL || dupSig == NULL;
+    }
+    if (err == 0) {
+        err = (ctx = EVP_PKEY_CTX_new(pkey, e)) == NULL;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_sign_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PADDING) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_signature_md(ctx, EVP_sha256()) != 1;
+    }
+    if (err == 0) {
+        PRINT_MSG("Sign with wolfengine");
+        err = EVP_PKEY_sign(ctx, rsaSig, &rsaSigLen, buf, sizeof(buf)) != 1;
+    }
+    if (err == 0) {
+        PRINT_MSG("Duplicate context with key set");
+        err = (dup = EVP_PKEY_CTX_dup(ctx)) == NULL;
+    }
+    if (err == 0) {
+        PRINT_MSG("Sign with duplicate context");
+        err = EVP_PKEY_sign(dup, dupSig, &dupSigLen, buf, sizeof(buf)) != 1;
+    }
+    if (err == 0) {
+        /* PKCS #1 v1.5 signatures are deterministic. */
+        err = dupSigLen != rsaSigLen ||
+              memcmp(dupSig, rsaSig, rsaSigLen) != 0;
+    }
+    if (err == 0) {
+        PRINT_MSG("Verify with OpenSSL");
+        err = (vctx = EVP_PKEY_CTX_new(pkey, NULL)) == NULL;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_verify_init(vctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_signature_md(vctx, EVP_sha256()) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_verify(vctx, dupSig, dupSigLen, buf, sizeof(buf)) != 1;
+    }
+
+    EVP_PKEY_CTX_free(vctx);
+    EVP_PKEY_CTX_free(dup);
+    EVP_PKEY_CTX_free(ctx);
+    OPENSSL_free(dupSig);
+    OPENSSL_free(rsaSig);
+    EVP_PKEY_free(pkey);
+
+    return err;
+}
+
+int test_rsa_keygen(ENGINE *e, void *data)
+{
+    int err;
+    EVP_PKEY_CTX *ctx = NULL;
+    EVP_PKEY *pkey = NULL;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    const RSA *rsaKey = NULL;
+#else
+    RSA *rsaKey = NULL;
+#endif
+    BIGNUM *eCmd = NULL;
+    BIGNUM *n = NULL;
+    BIGNUM *eKey = NULL;
+    const int newKeySize = 1024;
+
+    (void)data;
+
+    err = (ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, e)) == NULL;
+    if (err == 0) {
+        err = EVP_PKEY_keygen_init(ctx) != 1;
     }
     if (err == 0) {
         PRINT_MSG("Change the key size w/ ctrl command");
@@ -515,6 +1217,704 @@ int test_rsa_keygen(ENGINE *e, void *data)
     return err;
 }
 
+#ifdef WE_HAVE_THREADS
+int test_rsa_prime_pool(ENGINE *e, void *data)
+{
+    int err;
+    EVP_PKEY_CTX *ctx = NULL;
+    EVP_PKEY *pkey = NULL;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    const RSA *rsaKey = NULL;
+#else
+    RSA *rsaKey = NULL;
+#endif
+    int i;
+    long used = 0;
+    long childUsed;
+    pid_t pid;
+    int status;
+
+    (void)data;
+
+    /* Command not available when wolfSSL's mp API is private. */
+    if (ENGINE_ctrl(e, ENGINE_CTRL_GET_CMD_FROM_NAME, 0,
+                    (void *)"rsa_prime_pool_size", NULL) <= 0) {
+        PRINT_MSG("Skipping: prime pool needs WOLFSSL_PUBLIC_MP");
+        return 0;
+    }
+
+    PRINT_MSG("Invalid prime pool thread count");
+    err = ENGINE_ctrl_cmd(e, "rsa_prime_pool_threads", -1, NULL, NULL,
+                          0) == 1;
+    if (err == 0) {
+        PRINT_MSG("Enable prime pool");
+        err = ENGINE_ctrl_cmd(e, "rsa_prime_pool_size", 4, NULL, NULL,
+                              0) != 1;
+    }
+    if (err == 0) {
+        err = ENGINE_ctrl_cmd(e, "rsa_prime_pool_threads", 2, NULL, NULL,
+                              0) != 1;
+    }
+    if (err == 0) {
+        err = (ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, e)) == NULL;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_keygen_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) != 1;
+    }
+    /* Early keys are generated on demand while pool fills. */
+    for (i = 0; err == 0 && i < 4; i++) {
+        PRINT_MSG("Generate RSA key with prime pool enabled");
+        pkey = NULL;
+        err = EVP_PKEY_keygen(ctx, &pkey) != 1;
+        if (err == 0) {
+            rsaKey = EVP_PKEY_get0_RSA(pkey);
+            err = rsaKey == NULL;
+        }
+        if (err == 0) {
+            PRINT_MSG("Check RSA key");
+            err = RSA_check_key((RSA *)rsaKey) != 1;
+        }
+        if (err == 0) {
+            err = RSA_bits(rsaKey) != 2048;
+        }
+        EVP_PKEY_free(pkey);
+    }
+    /* Give the threads time to fill the pool, then a key must use it. */
+    for (i = 0; err == 0 && used == 0 && i < 10; i++) {
+        sleep(1);
+        pkey = NULL;
+        err = EVP_PKEY_keygen(ctx, &pkey) != 1;
+        EVP_PKEY_free(pkey);
+        if (err == 0) {
+            err = ENGINE_ctrl_cmd(e, "rsa_prime_pool_used", 0, &used, NULL,
+                                  0) != 1;
+        }
+    }
+    if (err == 0) {
+        PRINT_MSG("Check key generated from prime pool");
+        err = used == 0;
+    }
+    if (err == 0) {
+        /* Give the threads time to refill the pool. */
+        sleep(1);
+        PRINT_MSG("Generate RSA key in child after fork");
+        err = (pid = fork()) < 0;
+    }
+    if (err == 0 && pid == 0) {
+        /* Child must not take the primes left in the parent's pool. */
+        pkey = NULL;
+        childUsed = used;
+        if (EVP_PKEY_keygen(ctx, &pkey) != 1 ||
+                ENGINE_ctrl_cmd(e, "rsa_prime_pool_used", 0, &childUsed, NULL,
+                                0) != 1 || childUsed != used) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    if (err == 0) {
+        if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+                WEXITSTATUS(status) != 0) {
+            PRINT_ERR_MSG("Child used the parent's prime pool");
+            err = 1;
+        }
+    }
+
+    PRINT_MSG("Disable prime pool");
+    if (ENGINE_ctrl_cmd(e, "rsa_prime_pool_threads", 0, NULL, NULL, 0) != 1) {
+        err = 1;
+    }
+    if (ENGINE_ctrl_cmd(e, "rsa_prime_pool_size", 0, NULL, NULL, 0) != 1) {
+        err = 1;
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+
+    return err;
+}
+
+int test_rsa_parallel_keygen(ENGINE *e, void *data)
+{
+    int err;
+    EVP_PKEY_CTX *ctx = NULL;
+    EVP_PKEY *pkey = NULL;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    const RSA *rsaKey = NULL;
+#else
+    RSA *rsaKey = NULL;
+#endif
+
+    (void)data;
+
+    /* Command not available when wolfSSL's mp API is private. */
+    if (ENGINE_ctrl(e, ENGINE_CTRL_GET_CMD_FROM_NAME, 0,
+                    (void *)"rsa_keygen_threads", NULL) <= 0) {
+        PRINT_MSG("Skipping: parallel keygen needs WOLFSSL_PUBLIC_MP");
+        return 0;
+    }
+
+    PRINT_MSG("Search for primes on 4 threads");
+    err = ENGINE_ctrl_cmd(e, "rsa_keygen_threads", 4, NULL, NULL, 0) != 1;
+    if (err == 0) {
+        err = (ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, e)) == NULL;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_keygen_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) != 1;
+    }
+    if (err == 0) {
+        PRINT_MSG("Generate RSA key");
+        err = EVP_PKEY_keygen(ctx, &pkey) != 1;
+    }
+    if (err == 0) {
+        rsaKey = EVP_PKEY_get0_RSA(pkey);
+        err = rsaKey == NULL;
+    }
+    if (err == 0) {
+        PRINT_MSG("Check RSA key");
+        err = RSA_check_key((RSA *)rsaKey) != 1;
+    }
+    if (err == 0) {
+        err = RSA_bits(rsaKey) != 2048;
+    }
+
+    if (ENGINE_ctrl_cmd(e, "rsa_keygen_threads", 1, NULL, NULL, 0) != 1) {
+        err = 1;
+    }
+
+    EVP_PKEY_free(pkey);
+    EVP_PKEY_CTX_free(ctx);
+
+    return err;
+}
+
+int test_rsa_parallel_crt(ENGINE *e, void *data)
+{
+    int err;
+    EVP_PKEY *pkey = NULL;
+    unsigned char *rsaSig = NULL;
+    unsigned char *expSig = NULL;
+    size_t rsaSigLen = 0;
+    size_t expSigLen = 0;
+    unsigned char buf[20];
+    const unsigned char *p = rsa_key_der_2048;
+    pid_t pid;
+    int status = 0;
+
+    (void)data;
+
+    /* Command not available when wolfSSL's mp API is private. */
+    if (ENGINE_ctrl(e, ENGINE_CTRL_GET_CMD_FROM_NAME, 0,
+                    (void *)"rsa_parallel_crt", NULL) <= 0) {
+        PRINT_MSG("Skipping: parallel CRT needs WOLFSSL_PUBLIC_MP");
+        return 0;
+    }
+
+    PRINT_MSG("Enable parallel CRT");
+    err = ENGINE_ctrl_cmd(e, "rsa_parallel_crt", 1, NULL, NULL, 0) != 1;
+    if (err == 0) {
+        PRINT_MSG("Load RSA key");
+        pkey = d2i_PrivateKey(EVP_PKEY_RSA, NULL, &p,
+                              sizeof(rsa_key_der_2048));
+        err = pkey == NULL;
+    }
+    if (err == 0) {
+        err = RAND_bytes(buf, sizeof(buf)) == 0;
+    }
+    if (err == 0) {
+        rsaSigLen = expSigLen = EVP_PKEY_size(pkey);
+        rsaSig = OPENSSL_malloc(rsaSigLen);
+        expSig = OPENSSL_malloc(expSigLen);
+        err = rsaSig == NULL || expSig == NULL;
+    }
+
+    if (err == 0) {
+        PRINT_MSG("Sign with wolfengine");
+        err = test_digest_sign(pkey, e, buf, sizeof(buf), EVP_sha256(),
+                               rsaSig, &rsaSigLen);
+    }
+    if (err == 0) {
+        PRINT_MSG("Verify with OpenSSL");
+        err = test_digest_verify(pkey, NULL, buf, sizeof(buf), EVP_sha256(),
+                                 rsaSig, rsaSigLen);
+    }
+    if (err == 0) {
+        PRINT_MSG("Compare with OpenSSL signature");
+        err = test_digest_sign(pkey, NULL, buf, sizeof(buf), EVP_sha256(),
+                               expSig, &expSigLen);
+    }
+    if (err == 0) {
+        err = rsaSigLen != expSigLen ||
+              memcmp(rsaSig, expSig, rsaSigLen) != 0;
+    }
+
+    PRINT_MSG("Sign in child process - helper thread started again");
+    if (err == 0) {
+        pid = fork();
+        err = pid < 0;
+    }
+    if (err == 0 && pid == 0) {
+        rsaSigLen = EVP_PKEY_size(pkey);
+        err = test_digest_sign(pkey, e, buf, sizeof(buf), EVP_sha256(),
+                               rsaSig, &rsaSigLen);
+        if (err == 0) {
+            err = rsaSigLen != expSigLen ||
+                  memcmp(rsaSig, expSig, rsaSigLen) != 0;
+        }
+        _exit(err);
+    }
+    if (err == 0) {
+        err = waitpid(pid, &status, 0) != pid;
+    }
+    if (err == 0) {
+        err = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+
+    PRINT_MSG("Disable parallel CRT");
+    if (ENGINE_ctrl_cmd(e, "rsa_parallel_crt", 0, NULL, NULL, 0) != 1) {
+        err = 1;
+    }
+
+    OPENSSL_free(expSig);
+    OPENSSL_free(rsaSig);
+    EVP_PKEY_free(pkey);
+
+    return err;
+}
+#endif /* WE_HAVE_THREADS */
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+int test_rsa_multi_prime(ENGINE *e, void *data)
+{
+    int err;
+    int skip = 0;
+    EVP_PKEY_CTX *ctx = NULL;
+    EVP_PKEY *pkey = NULL;
+    RSA *rsa = NULL;
+    unsigned char *rsaSig = NULL;
+    unsigned char *expSig = NULL;
+    size_t rsaSigLen = 0;
+    size_t expSigLen = 0;
+    unsigned char buf[20];
+
+    (void)data;
+
+    PRINT_MSG("Generate 3-prime RSA key with wolfengine");
+    err = (ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, e)) == NULL;
+    if (err == 0) {
+        err = EVP_PKEY_keygen_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) != 1;
+    }
+    if (err == 0) {
+        /* Not available when wolfSSL's mp API is private. */
+        if (EVP_PKEY_CTX_set_rsa_keygen_primes(ctx, 3) != 1) {
+            PRINT_MSG("Multi-prime RSA not supported - skipping");
+            skip = 1;
+        }
+    }
+    if (err == 0 && !skip) {
+        err = EVP_PKEY_keygen(ctx, &pkey) != 1;
+    }
+    if (err == 0 && !skip) {
+        PRINT_MSG("Check key with OpenSSL");
+        err = (rsa = (RSA *)EVP_PKEY_get0_RSA(pkey)) == NULL;
+    }
+    if (err == 0 && !skip) {
+        err = RSA_get_multi_prime_extra_count(rsa) != 1 ||
+              RSA_bits(rsa) != 2048 || RSA_check_key(rsa) != 1;
+    }
+    if (err == 0 && !skip) {
+        err = RAND_bytes(buf, sizeof(buf)) == 0;
+    }
+    if (err == 0 && !skip) {
+        rsaSigLen = expSigLen = EVP_PKEY_size(pkey);
+        rsaSig = OPENSSL_malloc(rsaSigLen);
+        expSig = OPENSSL_malloc(expSigLen);
+        err = rsaSig == NULL || expSig == NULL;
+    }
+    if (err == 0 && !skip) {
+        PRINT_MSG("Sign with wolfengine");
+        err = test_digest_sign(pkey, e, buf, sizeof(buf), EVP_sha256(),
+                               rsaSig, &rsaSigLen);
+    }
+    if (err == 0 && !skip) {
+        PRINT_MSG("Verify with OpenSSL");
+        err = test_digest_verify(pkey, NULL, buf, sizeof(buf), EVP_sha256(),
+                                 rsaSig, rsaSigLen);
+    }
+    if (err == 0 && !skip) {
+        PRINT_MSG("Compare with OpenSSL signature");
+        err = test_digest_sign(pkey, NULL, buf, sizeof(buf), EVP_sha256(),
+                               expSig, &expSigLen);
+    }
+    if (err == 0 && !skip) {
+        err = rsaSigLen != expSigLen ||
+              memcmp(rsaSig, expSig, rsaSigLen) != 0;
+    }
+
+    OPENSSL_free(expSig);
+    OPENSSL_free(rsaSig);
+    EVP_PKEY_free(pkey);
+    EVP_PKEY_CTX_free(ctx);
+
+    return err;
+}
+#endif /* OPENSSL_VERSION_NUMBER >= 0x10101000L */
+
+static int test_rsa_oaep_ctx_setup(EVP_PKEY_CTX *ctx, const EVP_MD *md,
+                                   const unsigned char *label, int labelLen)
+{
+    int err;
+    unsigned char *labelCopy = NULL;
+
+    err = EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) != 1;
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_rsa_oaep_md(ctx, md) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_rsa_mgf1_md(ctx, md) != 1;
+    }
+    if (err == 0 && label != NULL) {
+        /* Context takes ownership of label. */
+        labelCopy = OPENSSL_memdup(label, labelLen);
+        err = labelCopy == NULL;
+        if (err == 0) {
+            err = EVP_PKEY_CTX_set0_rsa_oaep_label(ctx, labelCopy,
+                                                   labelLen) != 1;
+            if (err == 1) {
+                OPENSSL_free(labelCopy);
+            }
+        }
+    }
+
+    return err;
+}
+
+static int test_rsa_oaep_enc(EVP_PKEY *pkey, ENGINE *e, const EVP_MD *md,
+                             const unsigned char *label, int labelLen,
+                             unsigned char *msg, size_t msgLen,
+                             unsigned char *ct, size_t *ctLen)
+{
+    int err;
+    EVP_PKEY_CTX *ctx = NULL;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    err = EVP_PKEY_set1_engine(pkey, e) != 1;
+    if (err == 0) {
+        err = (ctx = EVP_PKEY_CTX_new(pkey, NULL)) == NULL;
+    }
+#else
+    err = (ctx = EVP_PKEY_CTX_new(pkey, e)) == NULL;
+#endif
+    if (err == 0) {
+        err = EVP_PKEY_encrypt_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = test_rsa_oaep_ctx_setup(ctx, md, label, labelLen);
+    }
+    if (err == 0) {
+        err = EVP_PKEY_encrypt(ctx, ct, ctLen, msg, msgLen) != 1;
+    }
+    if (err == 0) {
+        PRINT_BUFFER("Ciphertext", ct, *ctLen);
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+
+    return err;
+}
+
+static int test_rsa_oaep_dec(EVP_PKEY *pkey, ENGINE *e, const EVP_MD *md,
+                             const unsigned char *label, int labelLen,
+                             unsigned char *ct, size_t ctLen,
+                             unsigned char *msg, size_t msgLen)
+{
+    int err;
+    EVP_PKEY_CTX *ctx = NULL;
+    unsigned char *pt = NULL;
+    size_t ptLen = 0;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    err = EVP_PKEY_set1_engine(pkey, e) != 1;
+    if (err == 0) {
+        err = (ctx = EVP_PKEY_CTX_new(pkey, NULL)) == NULL;
+    }
+#else
+    err = (ctx = EVP_PKEY_CTX_new(pkey, e)) == NULL;
+#endif
+    if (err == 0) {
+        err = EVP_PKEY_decrypt_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = test_rsa_oaep_ctx_setup(ctx, md, label, labelLen);
+    }
+    if (err == 0) {
+        ptLen = EVP_PKEY_size(pkey);
+        pt = OPENSSL_malloc(ptLen);
+        err = pt == NULL;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_decrypt(ctx, pt, &ptLen, ct, ctLen) != 1;
+    }
+    if (err == 0) {
+        PRINT_BUFFER("Plaintext", pt, ptLen);
+        err = ptLen != msgLen || memcmp(pt, msg, msgLen) != 0;
+    }
+
+    OPENSSL_free(pt);
+    EVP_PKEY_CTX_free(ctx);
+
+    return err;
+}
+
+int test_rsa_oaep(ENGINE *e, void *data)
+{
+    int err;
+    int res;
+    EVP_PKEY *pkey = NULL;
+    unsigned char *ct = NULL;
+    size_t ctLen = 0;
+    unsigned char msg[32];
+    unsigned char label[16];
+    const unsigned char *p = rsa_key_der_2048;
+    const EVP_MD *mds[3];
+    int i;
+    int j;
+
+    (void)data;
+
+    mds[0] = EVP_sha1();
+    mds[1] = EVP_sha256();
+    mds[2] = EVP_sha384();
+
+    PRINT_MSG("Load RSA key");
+    pkey = d2i_PrivateKey(EVP_PKEY_RSA, NULL, &p, sizeof(rsa_key_der_2048));
+    err = pkey == NULL;
+    if (err == 0) {
+        err = RAND_bytes(msg, sizeof(msg)) == 0;
+    }
+    if (err == 0) {
+        err = RAND_bytes(label, sizeof(label)) == 0;
+    }
+    if (err == 0) {
+        ctLen = EVP_PKEY_size(pkey);
+        ct = OPENSSL_malloc(ctLen);
+        err = ct == NULL;
+    }
+
+    for (i = 0; err == 0 && i < (int)(sizeof(mds) / sizeof(*mds)); i++) {
+        /* j == 0: no label, j == 1: label. */
+        for (j = 0; err == 0 && j < 2; j++) {
+            PRINT_MSG(j == 0 ? "OAEP without label" : "OAEP with label");
+            if (err == 0) {
+                PRINT_MSG("Encrypt with OpenSSL");
+                ctLen = EVP_PKEY_size(pkey);
+                err = test_rsa_oaep_enc(pkey, NULL, mds[i],
+                                        j ? label : NULL, sizeof(label),
+                                        msg, sizeof(msg), ct, &ctLen);
+            }
+            if (err == 0) {
+                PRINT_MSG("Decrypt with wolfengine");
+                err = test_rsa_oaep_dec(pkey, e, mds[i], j ? label : NULL,
+                                        sizeof(label), ct, ctLen, msg,
+                                        sizeof(msg));
+            }
+            if (err == 0) {
+                PRINT_MSG("Decrypt with wrong label with wolfengine");
+                res = test_rsa_oaep_dec(pkey, e, mds[i], j ? NULL : label,
+                                        sizeof(label), ct, ctLen, msg,
+                                        sizeof(msg));
+                if (res != 1)
+                    err = 1;
+            }
+            if (err == 0) {
+                PRINT_MSG("Encrypt with wolfengine");
+                ctLen = EVP_PKEY_size(pkey);
+                err = test_rsa_oaep_enc(pkey, e, mds[i], j ? label : NULL,
+                                        sizeof(label), msg, sizeof(msg), ct,
+                                        &ctLen);
+            }
+            if (err == 0) {
+                PRINT_MSG("Decrypt with OpenSSL");
+                err = test_rsa_oaep_dec(pkey, NULL, mds[i], j ? label : NULL,
+                                        sizeof(label), ct, ctLen, msg,
+                                        sizeof(msg));
+            }
+        }
+    }
+
+    EVP_PKEY_free(pkey);
+
+    if (ct)
+        OPENSSL_free(ct);
+
+    return err;
+}
+
+#ifdef WE_HAVE_RSA_PSS
+
+static int test_rsa_pss_sign(EVP_PKEY *pkey, ENGINE *e, unsigned char *hash,
+                             size_t hashLen, const EVP_MD *md, int saltLen,
+                             unsigned char *sig, size_t *sigLen)
+{
+    int err;
+    EVP_PKEY_CTX *ctx = NULL;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    err = EVP_PKEY_set1_engine(pkey, e) != 1;
+    if (err == 0) {
+        err = (ctx = EVP_PKEY_CTX_new(pkey, NULL)) == NULL;
+    }
+#else
+    err = (ctx = EVP_PKEY_CTX_new(pkey, e)) == NULL;
+#endif
+    if (err == 0) {
+        err = EVP_PKEY_sign_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PSS_PADDING) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_signature_md(ctx, md) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_rsa_pss_saltlen(ctx, saltLen) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_sign(ctx, sig, sigLen, hash, hashLen) != 1;
+    }
+    if (err == 0) {
+        PRINT_BUFFER("Signature", sig, *sigLen);
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+
+    return err;
+}
+
+static int test_rsa_pss_verify(EVP_PKEY *pkey, ENGINE *e, unsigned char *hash,
+                               size_t hashLen, const EVP_MD *md, int saltLen,
+                               unsigned char *sig, size_t sigLen)
+{
+    int err;
+    EVP_PKEY_CTX *ctx = NULL;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    err = EVP_PKEY_set1_engine(pkey, e) != 1;
+    if (err == 0) {
+        err = (ctx = EVP_PKEY_CTX_new(pkey, NULL)) == NULL;
+    }
+#else
+    err = (ctx = EVP_PKEY_CTX_new(pkey, e)) == NULL;
+#endif
+    if (err == 0) {
+        err = EVP_PKEY_verify_init(ctx) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PSS_PADDING) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_signature_md(ctx, md) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_CTX_set_rsa_pss_saltlen(ctx, saltLen) != 1;
+    }
+    if (err == 0) {
+        err = EVP_PKEY_verify(ctx, sig, sigLen, hash, hashLen) != 1;
+    }
+    if (err == 0) {
+        PRINT_MSG("Signature verified");
+    }
+    else {
+        PRINT_MSG("Signature not verified");
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+
+    return err;
+}
+
+int test_rsa_pss_sign_verify(ENGINE *e, void *data)
+{
+    int err;
+    int res;
+    EVP_PKEY *pkey = NULL;
+    unsigned char *rsaSig = NULL;
+    size_t rsaSigLen = 0;
+    unsigned char hash[32];
+    const unsigned char *p = rsa_key_der_2048;
+    int saltLens[] = { RSA_PSS_SALTLEN_DIGEST, 0, 20 };
+    int i;
+
+    (void)data;
+
+    PRINT_MSG("Load RSA key");
+    pkey = d2i_PrivateKey(EVP_PKEY_RSA, NULL, &p, sizeof(rsa_key_der_2048));
+    err = pkey == NULL;
+    if (err == 0) {
+        err = RAND_bytes(hash, sizeof(hash)) == 0;
+    }
+    if (err == 0) {
+        rsaSigLen = EVP_PKEY_size(pkey);
+        rsaSig = OPENSSL_malloc(rsaSigLen);
+        err = rsaSig == NULL;
+    }
+
+    for (i = 0; err == 0 && i < (int)(sizeof(saltLens) / sizeof(*saltLens));
+         i++) {
+        if (err == 0) {
+            PRINT_MSG("Sign with OpenSSL");
+            rsaSigLen = EVP_PKEY_size(pkey);
+            err = test_rsa_pss_sign(pkey, NULL, hash, sizeof(hash),
+                                    EVP_sha256(), saltLens[i], rsaSig,
+                                    &rsaSigLen);
+        }
+        if (err == 0) {
+            PRINT_MSG("Verify with wolfengine");
+            err = test_rsa_pss_verify(pkey, e, hash, sizeof(hash),
+                                      EVP_sha256(), saltLens[i], rsaSig,
+                                      rsaSigLen);
+        }
+        if (err == 0) {
+            PRINT_MSG("Verify bad signature with wolfengine");
+            rsaSig[1] ^= 0x80;
+            res = test_rsa_pss_verify(pkey, e, hash, sizeof(hash),
+                                      EVP_sha256(), saltLens[i], rsaSig,
+                                      rsaSigLen);
+            if (res != 1)
+                err = 1;
+        }
+        if (err == 0) {
+            PRINT_MSG("Sign with wolfengine");
+            rsaSigLen = EVP_PKEY_size(pkey);
+            err = test_rsa_pss_sign(pkey, e, hash, sizeof(hash),
+                                    EVP_sha256(), saltLens[i], rsaSig,
+                                    &rsaSigLen);
+        }
+        if (err == 0) {
+            PRINT_MSG("Verify with OpenSSL");
+            err = test_rsa_pss_verify(pkey, NULL, hash, sizeof(hash),
+                                      EVP_sha256(), saltLens[i], rsaSig,
+                                      rsaSigLen);
+        }
+    }
+
+    EVP_PKEY_free(pkey);
+
+    if (rsaSig)
+        OPENSSL_free(rsaSig);
+
+    return err;
+}
+
+#endif /* WE_HAVE_RSA_PSS */
+
 #endif /* WE_HAVE_EVP_PKEY */
 
 #endif /* WE_HAVE_RSA */
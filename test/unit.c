@@ -23,6 +23,13 @@
 #include "we_logging.h"
 #include "unit.h"
 
+#ifdef WE_HAVE_THREADS
+#include <pthread.h>
+#endif
+#ifdef WE_HAVE_PROVIDER
+#include <openssl/provider.h>
+#endif
+
 #ifdef WOLFENGINE_DEBUG
 void print_buffer(const char *desc, const unsigned char *buffer, size_t len)
 {
@@ -45,6 +52,61 @@ static int debug = 1;
 static int debug = 0;
 #endif /* WOLFENGINE_DEBUG */
 
+/* Number of allocations made through OpenSSL's memory functions by the thread
+ * running the tests. */
+static long alloc_cnt = 0;
+/* Whether the counting memory functions were set into OpenSSL. */
+static int alloc_counting = 0;
+#ifdef WE_HAVE_THREADS
+/* Thread running the tests - set before OpenSSL allocates any memory. */
+static pthread_t alloc_thread;
+#endif
+
+/**
+ * Count an allocation when made by the thread running the tests.
+ *
+ * Threaded tests and the engine's background pool threads allocate at the same
+ * time. Only counting the test thread keeps the count free of data races and
+ * stable while checking that an operation doesn't allocate.
+ */
+static void test_alloc_inc(void)
+{
+#ifdef WE_HAVE_THREADS
+    if (pthread_equal(pthread_self(), alloc_thread))
+#endif
+    {
+        alloc_cnt++;
+    }
+}
+
+static void *test_malloc(size_t num, const char *file, int line)
+{
+    (void)file;
+    (void)line;
+    test_alloc_inc();
+    return malloc(num);
+}
+
+static void *test_realloc(void *ptr, size_t num, const char *file, int line)
+{
+    (void)file;
+    (void)line;
+    test_alloc_inc();
+    return realloc(ptr, num);
+}
+
+static void test_free(void *ptr, const char *file, int line)
+{
+    (void)file;
+    (void)line;
+    free(ptr);
+}
+
+long test_alloc_count(void)
+{
+    return alloc_counting ? alloc_cnt : -1;
+}
+
 TEST_CASE test_case[] = {
     TEST_DECL(test_logging, &debug),
 #ifdef WE_HAVE_SHA1
@@ -105,6 +167,9 @@ TEST_CASE test_case[] = {
     TEST_DECL(test_aes256_gcm, NULL),
     TEST_DECL(test_aes128_gcm_fixed, NULL),
     TEST_DECL(test_aes128_gcm_tls, NULL),
+#ifdef WE_HAVE_AESGCM_STREAM
+    TEST_DECL(test_aes128_gcm_stream, NULL),
+#endif
 #endif
 #ifdef WE_HAVE_AESCCM
     TEST_DECL(test_aes128_ccm, NULL),
@@ -114,13 +179,50 @@ TEST_CASE test_case[] = {
     TEST_DECL(test_aes128_ccm_tls, NULL),
 #endif
 #endif
+#ifdef WE_HAVE_PROVIDER
+#ifdef WE_HAVE_SHA256
+    TEST_DECL(test_prov_digest, NULL),
+#endif
+#if defined(WE_HAVE_DES3CBC) || defined(WE_HAVE_AESECB) || \
+    defined(WE_HAVE_AESCBC) || defined(WE_HAVE_AESCTR)
+    TEST_DECL(test_prov_cipher, NULL),
+#endif
+#ifdef WE_HAVE_AESGCM
+    TEST_DECL(test_prov_aes_gcm, NULL),
+#endif
+#ifdef WE_HAVE_AESCCM
+    TEST_DECL(test_prov_aes_ccm, NULL),
+#endif
+#endif /* WE_HAVE_PROVIDER */
 #ifdef WE_HAVE_RSA
     TEST_DECL(test_rsa_direct, NULL),
+    TEST_DECL(test_rsa_sign_verify_direct, NULL),
+#ifdef WE_HAVE_SHA256
+    TEST_DECL(test_rsa_batch_verify, NULL),
+    TEST_DECL(test_rsa_keystore, NULL),
+#ifdef WE_HAVE_KEYD
+    TEST_DECL(test_rsa_keyd, NULL),
+#endif
+#endif
 #endif /* WE_HAVE_RSA */
 #ifdef WE_HAVE_EVP_PKEY
 #ifdef WE_HAVE_RSA
     TEST_DECL(test_rsa_sign_verify, NULL),
+    TEST_DECL(test_rsa_sign_verify_digests, NULL),
+    TEST_DECL(test_rsa_pkey_dup, NULL),
     TEST_DECL(test_rsa_keygen, NULL),
+    TEST_DECL(test_rsa_oaep, NULL),
+#ifdef WE_HAVE_THREADS
+    TEST_DECL(test_rsa_prime_pool, NULL),
+    TEST_DECL(test_rsa_parallel_keygen, NULL),
+    TEST_DECL(test_rsa_parallel_crt, NULL),
+#endif
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    TEST_DECL(test_rsa_multi_prime, NULL),
+#endif
+#ifdef WE_HAVE_RSA_PSS
+    TEST_DECL(test_rsa_pss_sign_verify, NULL),
+#endif /* WE_HAVE_RSA_PSS */
 #endif /* WE_HAVE_RSA */
 #ifdef WE_HAVE_EC_P256
     #ifdef WE_HAVE_ECKEYGEN
@@ -132,10 +234,19 @@ TEST_CASE test_case[] = {
         TEST_DECL(test_ecdh_p256_keygen, NULL),
     #endif
         TEST_DECL(test_ecdh_p256, NULL),
+        TEST_DECL(test_ecdh_p256_peer_reuse, NULL),
+        TEST_DECL(test_ecdh_p256_x963_kdf, NULL),
+        TEST_DECL(test_ecdh_p256_multi_derive, NULL),
     #endif
     #ifdef WE_HAVE_ECDSA
         TEST_DECL(test_ecdsa_p256_pkey, NULL),
+        TEST_DECL(test_ecdsa_p256_pkey_dup, NULL),
         TEST_DECL(test_ecdsa_p256, NULL),
+        TEST_DECL(test_ecdsa_p256_pkey_pub_cache, NULL),
+        TEST_DECL(test_ecdsa_p256_batch_verify, NULL),
+    #endif
+    #if defined(WE_HAVE_ECDSA) && defined(WE_HAVE_ECDH)
+        TEST_DECL(test_ec_p256_pkey_no_alloc, NULL),
     #endif
 #endif
 #ifdef WE_HAVE_EC_P384
@@ -155,19 +266,32 @@ TEST_CASE test_case[] = {
     #endif
 #endif
 #endif /* WE_HAVE_EVP_PKEY */
+#if defined(WE_HAVE_ECKEYGEN) && defined(WE_HAVE_EC_P256)
+    TEST_DECL(test_ec_keygen_p256_batch, NULL),
+#endif
 #ifdef WE_HAVE_EC_KEY
 #ifdef WE_HAVE_EC_P256
     #ifdef WE_HAVE_ECKEYGEN
         TEST_DECL(test_ec_key_keygen_p256_by_nid, NULL),
+        TEST_DECL(test_ec_key_keygen_p256_pool, NULL),
     #endif
     #ifdef WE_HAVE_ECDH
     #ifdef WE_HAVE_ECKEYGEN
         TEST_DECL(test_ec_key_ecdh_p256_keygen, NULL),
     #endif
         TEST_DECL(test_ec_key_ecdh_p256, NULL),
+        TEST_DECL(test_ec_key_ecdh_p256_peer_reuse, NULL),
+    #ifdef WE_HAVE_THREADS
+        TEST_DECL(test_ec_key_ecdh_p256_threads, NULL),
+    #endif
     #endif
     #ifdef WE_HAVE_ECDSA
         TEST_DECL(test_ec_key_ecdsa_p256, NULL),
+        TEST_DECL(test_ec_key_ecdsa_p256_key_change, NULL),
+        TEST_DECL(test_ec_key_ecdsa_p256_sign_setup, NULL),
+    #ifdef WE_HAVE_THREADS
+        TEST_DECL(test_ec_key_ecdsa_p256_threads, NULL),
+    #endif
     #endif
 #endif
 #ifdef WE_HAVE_EC_P384
@@ -218,6 +342,13 @@ int main(int argc, char* argv[])
     int runAll = 1;
     int runTests = 1;
 
+    /* Count allocations - must be set before OpenSSL allocates any memory. */
+#ifdef WE_HAVE_THREADS
+    alloc_thread = pthread_self();
+#endif
+    alloc_counting = CRYPTO_set_mem_functions(test_malloc, test_realloc,
+                                              test_free);
+
     for (--argc, ++argv; argc > 0; argc--, argv++) {
         if (strncmp(*argv, "--help", 6) == 0) {
             usage();
@@ -287,6 +418,10 @@ int main(int argc, char* argv[])
 
         /* Set directory where wolfsslengine library is stored */
         setenv("OPENSSL_ENGINES", dir, 1);
+    #ifdef WE_HAVE_PROVIDER
+        /* Provider library is built into the same directory. */
+        OSSL_PROVIDER_set_default_search_path(NULL, dir);
+    #endif
 
         if (staticTest == 1) {
             printf("Running tests using static engine.\n");
@@ -34,6 +34,7 @@
 #include <openssl/aes.h>
 
 #include "openssl_bc.h"
+#include "wolfengine.h"
 
 #define PRINT_MSG(str)         printf("MSG: %s\n", str)
 #define PRINT_ERR_MSG(str)     printf("ERR: %s\n", str)
@@ -45,6 +46,10 @@ void print_buffer(const char *desc, const unsigned char *buffer, size_t len);
 #endif
 #define TEST_DECL(func, data)        { #func, func, data, 0, 0, 0 }
 
+/* Allocations through OpenSSL memory functions by the thread running the
+ * tests, -1 when not counting. */
+long test_alloc_count(void);
+
 typedef int (*TEST_FUNC)(ENGINE *e, void *data);
 typedef struct TEST_CASE {
     const char *name;
@@ -116,6 +121,9 @@ int test_aes192_gcm(ENGINE *e, void *data);
 int test_aes256_gcm(ENGINE *e, void *data);
 int test_aes128_gcm_fixed(ENGINE *e, void *data);
 int test_aes128_gcm_tls(ENGINE *e, void *data);
+#ifdef WE_HAVE_AESGCM_STREAM
+int test_aes128_gcm_stream(ENGINE *e, void *data);
+#endif
 
 #endif /* WE_HAVE_AESGCM */
 
@@ -128,6 +136,24 @@ int test_aes128_ccm_tls(ENGINE *e, void *data);
 
 #endif /* WE_HAVE_AESCCM */
 
+#ifdef WE_HAVE_PROVIDER
+
+#ifdef WE_HAVE_SHA256
+int test_prov_digest(ENGINE *e, void *data);
+#endif
+#if defined(WE_HAVE_DES3CBC) || defined(WE_HAVE_AESECB) || \
+    defined(WE_HAVE_AESCBC) || defined(WE_HAVE_AESCTR)
+int test_prov_cipher(ENGINE *e, void *data);
+#endif
+#ifdef WE_HAVE_AESGCM
+int test_prov_aes_gcm(ENGINE *e, void *data);
+#endif
+#ifdef WE_HAVE_AESCCM
+int test_prov_aes_ccm(ENGINE *e, void *data);
+#endif
+
+#endif /* WE_HAVE_PROVIDER */
+
 #ifdef WE_HAVE_EVP_PKEY
 
 int test_digest_sign(EVP_PKEY *pkey, ENGINE *e, unsigned char *data,
@@ -149,9 +175,31 @@ int test_pkey_verify(EVP_PKEY *pkey, ENGINE *e,
 
 #ifdef WE_HAVE_RSA
 int test_rsa_direct(ENGINE *e, void *data);
+int test_rsa_sign_verify_direct(ENGINE *e, void *data);
+#ifdef WE_HAVE_SHA256
+int test_rsa_batch_verify(ENGINE *e, void *data);
+int test_rsa_keystore(ENGINE *e, void *data);
+#ifdef WE_HAVE_KEYD
+int test_rsa_keyd(ENGINE *e, void *data);
+#endif
+#endif
 #ifdef WE_HAVE_EVP_PKEY
 int test_rsa_sign_verify(ENGINE *e, void *data);
+int test_rsa_sign_verify_digests(ENGINE *e, void *data);
+int test_rsa_pkey_dup(ENGINE *e, void *data);
 int test_rsa_keygen(ENGINE *e, void *data);
+int test_rsa_oaep(ENGINE *e, void *data);
+#ifdef WE_HAVE_THREADS
+int test_rsa_prime_pool(ENGINE *e, void *data);
+int test_rsa_parallel_keygen(ENGINE *e, void *data);
+int test_rsa_parallel_crt(ENGINE *e, void *data);
+#endif
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+int test_rsa_multi_prime(ENGINE *e, void *data);
+#endif
+#ifdef WE_HAVE_RSA_PSS
+int test_rsa_pss_sign_verify(ENGINE *e, void *data);
+#endif /* WE_HAVE_RSA_PSS */
 #endif /* WE_HAVE_EVP_PKEY */
 
 #endif /* WE_HAVE_RSA */
@@ -200,6 +248,11 @@ int test_ecdh_p256(ENGINE *e, void *data);
 #ifdef WE_HAVE_EC_P384
 int test_ecdh_p384(ENGINE *e, void *data);
 #endif /* WE_HAVE_EC_P384 */
+#ifdef WE_HAVE_EC_P256
+int test_ecdh_p256_peer_reuse(ENGINE *e, void *data);
+int test_ecdh_p256_x963_kdf(ENGINE *e, void *data);
+int test_ecdh_p256_multi_derive(ENGINE *e, void *data);
+#endif /* WE_HAVE_EC_P256 */
 
 #endif /* WE_HAVE_ECDH */
 
@@ -213,6 +266,10 @@ int test_ecdsa_p256_pkey(ENGINE *e, void *data);
 int test_ecdsa_p384_pkey(ENGINE *e, void *data);
 #endif /* WE_HAVE_EC_P384 */
 
+#ifdef WE_HAVE_EC_P256
+int test_ecdsa_p256_pkey_dup(ENGINE *e, void *data);
+#endif /* WE_HAVE_EC_P256 */
+
 #ifdef WE_HAVE_EC_P256
 int test_ecdsa_p256(ENGINE *e, void *data);
 #endif /* WE_HAVE_EC_P256 */
@@ -221,10 +278,24 @@ int test_ecdsa_p256(ENGINE *e, void *data);
 int test_ecdsa_p384(ENGINE *e, void *data);
 #endif /* WE_HAVE_EC_P384 */
 
+#ifdef WE_HAVE_EC_P256
+int test_ecdsa_p256_pkey_pub_cache(ENGINE *e, void *data);
+int test_ecdsa_p256_batch_verify(ENGINE *e, void *data);
+#endif /* WE_HAVE_EC_P256 */
+
 #endif /* WE_HAVE_ECDSA */
 
+#if defined(WE_HAVE_ECDSA) && defined(WE_HAVE_ECDH) && \
+    defined(WE_HAVE_EC_P256)
+int test_ec_p256_pkey_no_alloc(ENGINE *e, void *data);
+#endif /* WE_HAVE_ECDSA && WE_HAVE_ECDH && WE_HAVE_EC_P256 */
+
 #endif /* WE_HAVE_EVP_PKEY */
 
+#if defined(WE_HAVE_ECKEYGEN) && defined(WE_HAVE_EC_P256)
+int test_ec_keygen_p256_batch(ENGINE *e, void *data);
+#endif /* WE_HAVE_ECKEYGEN && WE_HAVE_EC_P256 */
+
 #ifdef WE_HAVE_EC_KEY
 
 #ifdef WE_HAVE_ECKEYGEN
@@ -239,6 +310,10 @@ int test_ec_key_keygen_p256_by_nid(ENGINE *e, void *data);
 int test_ec_key_keygen_p384_by_nid(ENGINE *e, void *data);
 #endif /* WE_HAVE_EC_P384 */
 
+#ifdef WE_HAVE_EC_P256
+int test_ec_key_keygen_p256_pool(ENGINE *e, void *data);
+#endif /* WE_HAVE_EC_P256 */
+
 #endif /* WE_HAVE_ECKEYGEN */
 
 #ifdef WE_HAVE_ECDH
@@ -264,6 +339,12 @@ int test_ec_key_ecdh_p256(ENGINE *e, void *data);
 #ifdef WE_HAVE_EC_P384
 int test_ec_key_ecdh_p384(ENGINE *e, void *data);
 #endif /* WE_HAVE_EC_P384 */
+#ifdef WE_HAVE_EC_P256
+int test_ec_key_ecdh_p256_peer_reuse(ENGINE *e, void *data);
+#ifdef WE_HAVE_THREADS
+int test_ec_key_ecdh_p256_threads(ENGINE *e, void *data);
+#endif
+#endif /* WE_HAVE_EC_P256 */
 
 #endif /* WE_HAVE_ECDH */
 
@@ -283,6 +364,13 @@ int test_ec_key_ecdsa_p256(ENGINE *e, void *data);
 #ifdef WE_HAVE_EC_P384
 int test_ec_key_ecdsa_p384(ENGINE *e, void *data);
 #endif /* WE_HAVE_EC_P384 */
+#ifdef WE_HAVE_EC_P256
+int test_ec_key_ecdsa_p256_key_change(ENGINE *e, void *data);
+int test_ec_key_ecdsa_p256_sign_setup(ENGINE *e, void *data);
+#ifdef WE_HAVE_THREADS
+int test_ec_key_ecdsa_p256_threads(ENGINE *e, void *data);
+#endif
+#endif /* WE_HAVE_EC_P256 */
 
 #endif /* WE_HAVE_ECDSA */
 